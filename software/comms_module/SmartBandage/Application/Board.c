@@ -82,3 +82,34 @@ const I2C_Config I2C_config[] = {
 /*
  *  ========================== I2C end =========================================
 */
+
+/*
+ *  ============================= Crypto Begin==================================
+*/
+#if defined(__TI_COMPILER_VERSION__)
+#pragma DATA_SECTION(CryptoCC26XX_config, ".const:CryptoCC26XX_config")
+#pragma DATA_SECTION(cryptoCC26XXHWAttrs, ".const:cryptoCC26XXHWAttrs")
+#endif
+
+/* Include drivers */
+#include <ti/drivers/crypto/CryptoCC26XX.h>
+
+/* Crypto objects */
+CryptoCC26XX_Object cryptoCC26XXObjects[CC2650_CRYPTOCOUNT];
+
+/* Crypto configuration structure */
+const CryptoCC26XX_HWAttrs cryptoCC26XXHWAttrs[CC2650_CRYPTOCOUNT] = {
+    {
+        .baseAddr = CRYPTO_BASE,
+        .powerMngrId = PERIPH_CRYPTO,
+        .intNum = INT_CRYPTO,
+    }
+};
+
+const CryptoCC26XX_Config CryptoCC26XX_config[] = {
+    {&cryptoCC26XXObjects[0], &cryptoCC26XXHWAttrs[0]},
+    {NULL, NULL}
+};
+/*
+ *  ========================== Crypto end ======================================
+*/
@@ -32,6 +32,7 @@
 #define I2C_TASK_STACK_SIZE  256
 #define PMGR_TASK_STACK_SIZE 644
 #define SBP_TASK_STACK_SIZE  DEFAULT_TASK_STACK_SIZE
+#define FSM_TASK_STACK_SIZE  384
 
 typedef enum {
 	IDLE_TASK_PRIORITY = 0,
@@ -41,6 +42,10 @@ typedef enum {
 	GAPROLE_TASK_PRIORITY,
 } TASK_PRIORITIES;
 
+// The state machine only waits and dispatches, so shares the level of the peripheral manager.
+// No free level is left below that of the stack.
+#define FSM_TASK_PRIORITY PMGR_TASK_PRIORITY
+
 /*****************************************************************
  * IO Configuration
  ****************************************************************/
@@ -146,6 +151,15 @@ typedef enum CC2650_I2CName {
     CC2650_I2CCOUNT
 } CC2650_I2CName;
 
+/*!
+ *  @def    CC2650_CryptoName
+ *  @brief  Enum of Crypto names on the CC2650 dev board
+ */
+typedef enum CC2650_CryptoName {
+    CC2650_CRYPTO0 = 0,
+    CC2650_CRYPTOCOUNT
+} CC2650_CryptoName;
+
 /*****************************************************************
  * GPIO Configuration
  ****************************************************************/
@@ -164,6 +178,8 @@ typedef enum {
 	OperationTimeout,
 	OutOfMemory,
 	SemaphorePendTimeout,
+	FlashIOError,
+	NoDataAvailable,
 } SB_Error;
 
 /*****************************************************************
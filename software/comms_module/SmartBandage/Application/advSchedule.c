@@ -0,0 +1,300 @@
+/*
+ * advSchedule.c
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#include <ti/sysbios/knl/Clock.h>
+#include <xdc/runtime/System.h>
+
+#include "gap.h"
+
+#include "util.h"
+#include "advSchedule.h"
+
+static void SB_advScheduleClockHandler(UArg arg);
+static void applyPhase(SB_AdvPhase phase);
+static void setInterval(uint16_t interval);
+static bool connectableEnabled();
+static void account();
+
+static const struct {
+	uint16_t interval;
+	uint32_t durationMs;
+} phases[SB_ADV_NUM_PHASES] = {
+	[SB_ADV_PHASE_FAST]   = { SB_ADVSCHED_FAST_INTERVAL,   SB_ADVSCHED_FAST_MS },
+	[SB_ADV_PHASE_MEDIUM] = { SB_ADVSCHED_MEDIUM_INTERVAL, SB_ADVSCHED_MEDIUM_MS },
+	[SB_ADV_PHASE_SLOW]   = { SB_ADVSCHED_SLOW_INTERVAL,   SB_ADVSCHED_SLOW_MS },
+	[SB_ADV_PHASE_IDLE]   = { SB_ADVSCHED_IDLE_INTERVAL,   SB_ADVSCHED_IDLE_MS },
+};
+
+struct {
+	SB_AdvPhase phase;
+
+	bool connected;
+
+	// Connectable advertising, which is restarted to apply a new interval
+	bool connectable;
+	bool restarting;
+
+	// Set from other contexts, handled by SB_advScheduleProcess
+	bool stepDue;
+	bool alertDue;
+
+	// Ticks at which advertising time was last accounted, and the time left over
+	// from the last whole advertising event counted
+	uint32_t since;
+	uint32_t remainderUs;
+
+	Clock_Struct phaseClock;
+	SB_AdvSchedulePendingCB pendingCB;
+
+	SB_AdvScheduleStats stats;
+} ADVSCHED;
+
+/**
+ * \brief Applies the fast interval for the advertising started at boot.
+ * \remark Must be called from the task registered with ICall, before the GAP role is started.
+ * \param pendingCB Called from task or SWI context when the schedule needs attention. The BLE
+ * 			task should respond by calling SB_advScheduleProcess.
+ */
+SB_Error SB_advScheduleInit(SB_AdvSchedulePendingCB pendingCB) {
+	ADVSCHED.pendingCB = pendingCB;
+	ADVSCHED.phase = SB_ADV_PHASE_FAST;
+	ADVSCHED.since = Clock_getTicks();
+
+	if (NULL == Util_constructClock(
+			&ADVSCHED.phaseClock,
+			SB_advScheduleClockHandler,
+			SB_ADVSCHED_FAST_MS,
+			0,
+			false,
+			0)) {
+#ifdef SB_DEBUG
+		System_printf("ADVSCHED: Failed to initialize phase clock\n");
+		System_flush();
+#endif
+		return OSResourceInitializationError;
+	}
+
+	setInterval(phases[SB_ADV_PHASE_FAST].interval);
+
+	return NoError;
+}
+
+/**
+ * \brief Follows the GAP role through advertising and connections.
+ * \remark Must be called from the task registered with ICall for every GAP role state change.
+ * \return True if the state change was caused by the schedule restarting advertising, and
+ * 			should be ignored by the caller.
+ */
+bool SB_advScheduleStateChange(gaprole_States_t newState) {
+	account();
+
+	switch (newState) {
+		case GAPROLE_ADVERTISING:
+		case GAPROLE_CONNECTED_ADV:
+			ADVSCHED.stats.advertising = true;
+			ADVSCHED.connectable = (newState == GAPROLE_ADVERTISING) || connectableEnabled();
+
+			if (ADVSCHED.restarting) {
+				ADVSCHED.restarting = false;
+				++ADVSCHED.stats.restarts;
+			}
+
+			// Advertising for another central carries on after the last link drops, at
+			// whatever phase it had reached: have it start fast again
+			if (newState == GAPROLE_ADVERTISING && ADVSCHED.connected) {
+				ADVSCHED.connected = false;
+				++ADVSCHED.stats.fastTriggers;
+
+				if (ADVSCHED.phase != SB_ADV_PHASE_FAST) {
+					applyPhase(SB_ADV_PHASE_FAST);
+				}
+			}
+
+			if (phases[ADVSCHED.phase].durationMs != 0 && !Util_isActive(&ADVSCHED.phaseClock)) {
+				Util_restartClock(&ADVSCHED.phaseClock, phases[ADVSCHED.phase].durationMs);
+			}
+			break;
+
+		case GAPROLE_CONNECTED:
+			ADVSCHED.stats.advertising = false;
+			ADVSCHED.connectable = false;
+			ADVSCHED.connected = true;
+
+			// Advertising for another central was stopped to apply a new interval
+			if (ADVSCHED.restarting) {
+				uint8_t advertEnabled = TRUE;
+
+				GAPRole_SetParameter(GAPROLE_ADVERT_ENABLED, sizeof(uint8_t), &advertEnabled);
+				return true;
+			}
+
+			// Advertising resumes by itself, for another central or after the link drops:
+			// have it start fast
+			Util_stopClock(&ADVSCHED.phaseClock);
+			ADVSCHED.phase = SB_ADV_PHASE_FAST;
+			ADVSCHED.stats.phase = SB_ADV_PHASE_FAST;
+			setInterval(phases[SB_ADV_PHASE_FAST].interval);
+			break;
+
+		case GAPROLE_WAITING:
+			ADVSCHED.stats.advertising = false;
+			ADVSCHED.connectable = false;
+
+			if (ADVSCHED.restarting) {
+				uint8_t advertEnabled = TRUE;
+
+				GAPRole_SetParameter(GAPROLE_ADVERT_ENABLED, sizeof(uint8_t), &advertEnabled);
+				return true;
+			}
+
+			if (ADVSCHED.connected) {
+				ADVSCHED.connected = false;
+				++ADVSCHED.stats.fastTriggers;
+			}
+			break;
+
+		case GAPROLE_WAITING_AFTER_TIMEOUT:
+		case GAPROLE_ADVERTISING_NONCONN:
+			// Non-connectable advertising continues after the link drops with PLUS_BROADCASTER
+			ADVSCHED.stats.advertising = (newState == GAPROLE_ADVERTISING_NONCONN);
+			ADVSCHED.connectable = false;
+
+			if (ADVSCHED.connected) {
+				ADVSCHED.connected = false;
+				++ADVSCHED.stats.fastTriggers;
+			}
+			break;
+
+		default:
+			break;
+	}
+
+	return false;
+}
+
+/**
+ * \brief Returns to fast advertising, so the alert is seen quickly.
+ * \remark May be called from any task.
+ */
+void SB_advScheduleAlert() {
+	ADVSCHED.alertDue = true;
+
+	if (ADVSCHED.pendingCB != NULL) {
+		ADVSCHED.pendingCB();
+	}
+}
+
+/**
+ * \brief Handles alerts and steps to the next phase once the current one has run its course.
+ * \remark Must be called from the task registered with ICall.
+ */
+void SB_advScheduleProcess() {
+	if (ADVSCHED.alertDue) {
+		ADVSCHED.alertDue = false;
+		ADVSCHED.stepDue = false;
+
+		if (!ADVSCHED.connected) {
+			++ADVSCHED.stats.fastTriggers;
+			applyPhase(SB_ADV_PHASE_FAST);
+		}
+	}
+
+	if (ADVSCHED.stepDue) {
+		ADVSCHED.stepDue = false;
+
+		if (ADVSCHED.phase + 1 < SB_ADV_NUM_PHASES) {
+			applyPhase((SB_AdvPhase)(ADVSCHED.phase + 1));
+		}
+	}
+}
+
+/**
+ * \brief Brings the advertising time up to date and copies the statistics.
+ * \remark Must be called from the task registered with ICall.
+ */
+void SB_advScheduleGetStats(SB_AdvScheduleStats *stats) {
+	account();
+
+	*stats = ADVSCHED.stats;
+	stats->airTimeMs = ((uint64_t)ADVSCHED.stats.advertEvents * SB_ADVSCHED_EVENT_AIR_US) / 1000;
+}
+
+static void SB_advScheduleClockHandler(UArg arg) {
+	ADVSCHED.stepDue = true;
+
+	if (ADVSCHED.pendingCB != NULL) {
+		ADVSCHED.pendingCB();
+	}
+}
+
+/**
+ * \brief Moves to a phase, restarting connectable advertising so its interval takes effect.
+ */
+static void applyPhase(SB_AdvPhase phase) {
+	account();
+
+	ADVSCHED.phase = phase;
+	ADVSCHED.stats.phase = phase;
+	ADVSCHED.remainderUs = 0;
+	setInterval(phases[phase].interval);
+
+	Util_stopClock(&ADVSCHED.phaseClock);
+	if (phases[phase].durationMs != 0 && ADVSCHED.stats.advertising) {
+		Util_restartClock(&ADVSCHED.phaseClock, phases[phase].durationMs);
+	}
+
+	// Resumes in SB_advScheduleStateChange once the stack reports advertising has stopped
+	if (ADVSCHED.connectable && !ADVSCHED.restarting) {
+		uint8_t advertEnabled = FALSE;
+
+		ADVSCHED.restarting = true;
+		GAPRole_SetParameter(GAPROLE_ADVERT_ENABLED, sizeof(uint8_t), &advertEnabled);
+	}
+}
+
+static void setInterval(uint16_t interval) {
+	GAP_SetParamValue(TGAP_LIM_DISC_ADV_INT_MIN, interval);
+	GAP_SetParamValue(TGAP_LIM_DISC_ADV_INT_MAX, interval);
+	GAP_SetParamValue(TGAP_GEN_DISC_ADV_INT_MIN, interval);
+	GAP_SetParamValue(TGAP_GEN_DISC_ADV_INT_MAX, interval);
+}
+
+/**
+ * \brief True if connectable advertising is enabled, rather than the non-connectable
+ * 			advertising PLUS_BROADCASTER runs while connected.
+ */
+static bool connectableEnabled() {
+	uint8_t advertEnabled = FALSE;
+
+	GAPRole_GetParameter(GAPROLE_ADVERT_ENABLED, &advertEnabled);
+
+	return advertEnabled == TRUE;
+}
+
+/**
+ * \brief Adds the time advertised since the last call to the current phase.
+ */
+static void account() {
+	uint32_t now = Clock_getTicks();
+	uint32_t elapsedMs = (now - ADVSCHED.since) / (NTICKS_PER_MILLSECOND);
+	uint32_t intervalUs;
+	uint64_t elapsedUs;
+
+	ADVSCHED.since += elapsedMs * (NTICKS_PER_MILLSECOND);
+
+	if (!ADVSCHED.stats.advertising) {
+		return;
+	}
+
+	ADVSCHED.stats.msInPhase[ADVSCHED.phase] += elapsedMs;
+
+	// Intervals are in units of 625us
+	intervalUs = (uint32_t)phases[ADVSCHED.phase].interval * 625;
+	elapsedUs = (uint64_t)elapsedMs * 1000 + ADVSCHED.remainderUs;
+
+	ADVSCHED.stats.advertEvents += elapsedUs / intervalUs;
+	ADVSCHED.remainderUs = elapsedUs % intervalUs;
+}
@@ -0,0 +1,62 @@
+/*
+ * @file advSchedule.h
+ * @brief Steps the advertising interval down from fast to slow while no phone connects.
+ *
+ * Advertising starts fast after boot, after a disconnect and after an alert, when a
+ * phone or gateway is most likely to be looking for the bandage. Each phase lasts
+ * its duration before the next, slower one is applied, until the last phase which
+ * lasts indefinitely. A new interval only takes effect when advertising starts, so
+ * advertising is stopped and restarted to apply it. The same steps apply to the
+ * advertising for another central while one is connected.
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef APPLICATION_ADVSCHEDULE_H_
+#define APPLICATION_ADVSCHEDULE_H_
+
+#include "bcomdef.h"
+#include "peripheral.h"
+
+#include "Board.h"
+
+// Phase intervals (units of 625us) and durations. A duration of 0 lasts indefinitely.
+#define SB_ADVSCHED_FAST_INTERVAL		160		// 100 ms
+#define SB_ADVSCHED_FAST_MS				30000
+#define SB_ADVSCHED_MEDIUM_INTERVAL		668		// 417.5 ms
+#define SB_ADVSCHED_MEDIUM_MS			60000
+#define SB_ADVSCHED_SLOW_INTERVAL		1636	// 1022.5 ms
+#define SB_ADVSCHED_SLOW_MS				300000
+#define SB_ADVSCHED_IDLE_INTERVAL		3200	// 2 s
+#define SB_ADVSCHED_IDLE_MS				0
+
+// On-air time of one advertising event: a full 31 byte advertisement on each of the 3 channels
+#define SB_ADVSCHED_EVENT_AIR_US		(3 * 8 * (16 + 31))
+
+typedef enum {
+	SB_ADV_PHASE_FAST = 0,
+	SB_ADV_PHASE_MEDIUM,
+	SB_ADV_PHASE_SLOW,
+	SB_ADV_PHASE_IDLE,
+	SB_ADV_NUM_PHASES
+} SB_AdvPhase;
+
+typedef struct {
+	uint32_t msInPhase[SB_ADV_NUM_PHASES];	// Time spent advertising in each phase
+	uint32_t advertEvents;					// Estimated from the time and interval
+	uint32_t airTimeMs;						// Estimated radio time spent advertising
+	uint16_t restarts;						// Advertising restarts to apply a new interval
+	uint16_t fastTriggers;					// Returns to the fast phase after a disconnect or alert
+	uint8_t  phase;
+	bool     advertising;
+} SB_AdvScheduleStats;
+
+typedef void (*SB_AdvSchedulePendingCB)(void);
+
+SB_Error SB_advScheduleInit(SB_AdvSchedulePendingCB pendingCB);
+bool     SB_advScheduleStateChange(gaprole_States_t newState);
+void     SB_advScheduleAlert();
+void     SB_advScheduleProcess();
+void     SB_advScheduleGetStats(SB_AdvScheduleStats *stats);
+
+#endif /* APPLICATION_ADVSCHEDULE_H_ */
@@ -10,6 +10,7 @@
 #include <ti/sysbios/knl/Clock.h>
 #include <ti/sysbios/knl/Semaphore.h>
 #include <ti/sysbios/knl/Queue.h>
+#include <ti/sysbios/hal/Hwi.h>
 #include <xdc/runtime/System.h>
 
 #include "hci_tl.h"
@@ -26,6 +27,17 @@
 #include "ICallBleAPIMSG.h"
 
 #include "util.h"
+#include "settings.h"
+#include "logCrypt.h"
+#include "connEvent.h"
+#include "liveStream.h"
+#include "history.h"
+#include "connPolicy.h"
+#include "advSchedule.h"
+#include "reportPolicy.h"
+#include "systemTime.h"
+#include "diagnostics.h"
+#include "fsm.h"
 #include "ble.h"
 
 /*********************************************************************
@@ -38,6 +50,21 @@ typedef struct
   appEvtHdr_t hdr;  // event header.
 } sbpEvt_t;
 
+// Link established or terminated, passed from the GAP role.
+typedef struct
+{
+  appEvtHdr_t hdr;      // event header, state is TRUE when established.
+  uint16_t connHandle;  // connection handle of the link.
+} sbpLinkEvt_t;
+
+// Characteristic written by a client, passed from the profile.
+typedef struct
+{
+  appEvtHdr_t hdr;      // event header, state is the parameter ID.
+  uint8_t len;          // length of the value.
+  uint8_t value[SB_BLE_REPORTPOLICY_LEN]; // value as written, no longer than the longest writable one.
+} sbpCharChangeEvt_t;
+
 
 /*********************************************************************
  * LOCAL VARIABLES
@@ -53,6 +80,10 @@ static ICall_EntityID selfEntity;
 // Semaphore globally used to post events to the application thread
 static ICall_Semaphore sem;
 
+// Internal events raised from clock handlers and other tasks. Only
+// changed through SimpleBLEPeripheral_setEvent and _takeEvent.
+static uint16_t events = 0;
+
 // Clock instances for internal periodic events.
 static Clock_Struct periodicClock;
 
@@ -107,9 +138,12 @@ static uint8_t scanRspData[] =
   0       // 0dBm
 };
 
+// Offset of the sensor summary in the advertisement data
+#define SB_ADV_SUMMARY_OFFSET                 11
+
 // GAP - Advertisement data (max size = 31 bytes, though this is
 // best kept short to conserve power while advertisting)
-static uint8_t advertData[] =
+static uint8_t advertData[SB_ADV_SUMMARY_OFFSET + SB_ADV_SUMMARY_LEN] =
 {
   // Flags; this sets the device to use limited discoverable
   // mode (advertises for 30 seconds at a time) instead of general
@@ -127,17 +161,33 @@ static uint8_t advertData[] =
   HI_UINT16(OAD_SERVICE_UUID)
 #else
   LO_UINT16(SB_BLE_SERV_UUID),
-  HI_UINT16(SB_BLE_SERV_UUID)
+  HI_UINT16(SB_BLE_SERV_UUID),
 #endif //!FEATURE_OAD
+
+  // sensor summary, filled in by SimpleBLEPeripheral_updateAdvertData
+  SB_ADV_SUMMARY_LEN + 3,   // length of this data
+  GAP_ADTYPE_MANUFACTURER_SPECIFIC,
+  LO_UINT16(SB_ADV_COMPANY_ID),
+  HI_UINT16(SB_ADV_COMPANY_ID)
 };
 
 // GAP GATT Attributes
 static uint8_t attDeviceName[GAP_DEVICE_NAME_LEN] = "Simple BLE Peripheral";
 
-// Globals used for ATT Response retransmission
-static gattMsgEvent_t *pAttRsp = NULL;
+// ATT responses waiting for retransmission, oldest first
+static gattMsgEvent_t *attRspQueue[SBP_ATT_RSP_QUEUE_LEN];
+static uint8_t attRspHead = 0;
+static uint8_t attRspCount = 0;
+
+// Transmission attempts of the response at the head of the queue
 static uint8_t rspTxRetry = 0;
 
+static SB_AttRspStats attRspStats;
+
+// Set from a transmit asked for by the state machine until the stack has
+// taken its packets
+static bool transmitPending = false;
+
 /*********************************************************************
  * LOCAL FUNCTIONS
  */
@@ -149,16 +199,32 @@ static uint8_t SimpleBLEPeripheral_processStackMsg(ICall_Hdr *pMsg);
 static uint8_t SimpleBLEPeripheral_processGATTMsg(gattMsgEvent_t *pMsg);
 static void SimpleBLEPeripheral_processAppMsg(sbpEvt_t *pMsg);
 static void SimpleBLEPeripheral_processStateChangeEvt(gaprole_States_t newState);
-static void SimpleBLEPeripheral_processCharValueChangeEvt(uint8_t paramID);
+static void SimpleBLEPeripheral_processLinkChangeEvt(uint16_t connHandle, uint8_t established);
+static void SimpleBLEPeripheral_processCharValueChangeEvt(uint8_t paramID, const uint8_t *pValue, uint8_t len);
 
 static void SimpleBLEPeripheral_sendAttRsp(void);
 static void SimpleBLEPeripheral_freeAttRsp(uint8_t status);
+static void SimpleBLEPeripheral_freeLinkAttRsp(uint16_t connHandle);
+static void SimpleBLEPeripheral_followAttRsp(void);
+static void SimpleBLEPeripheral_dequeueAttRsp(uint8_t status);
 
 static void SimpleBLEPeripheral_stateChangeCB(gaprole_States_t newState);
+static void SimpleBLEPeripheral_linkChangeCB(uint16_t connHandle, uint8_t established);
+static void SimpleBLEPeripheral_clockHandler(UArg arg);
+static void SimpleBLEPeripheral_setEvent(uint16_t event);
+static bool SimpleBLEPeripheral_takeEvent(uint16_t event);
 #ifndef FEATURE_OAD
-static void SimpleBLEPeripheral_charValueChangeCB(uint8_t paramID);
+static void SimpleBLEPeripheral_charValueChangeCB(uint8_t paramID, uint8_t *pValue, uint8_t len);
+static void SimpleBLEPeripheral_notifyPendingCB(void);
 #endif //!FEATURE_OAD
 static void SimpleBLEPeripheral_enqueueMsg(uint8_t event, uint8_t state);
+static void SimpleBLEPeripheral_settingsFlushCB(void);
+static void SimpleBLEPeripheral_liveStreamCB(void);
+static void SimpleBLEPeripheral_connPolicyCB(void);
+static void SimpleBLEPeripheral_advScheduleCB(void);
+#ifndef FEATURE_OAD
+static void SimpleBLEPeripheral_updateAdvertData(void);
+#endif //!FEATURE_OAD
 
 #ifdef FEATURE_OAD
 void SimpleBLEPeripheral_processOadWriteCB(uint8_t event, uint16_t connHandle,
@@ -172,9 +238,13 @@ void SimpleBLEPeripheral_processOadWriteCB(uint8_t event, uint16_t connHandle,
 // GAP Role Callbacks
 static gapRolesCBs_t SB_gapRoleCBs =
 {
-  SimpleBLEPeripheral_stateChangeCB     // Profile State Change Callbacks
+  SimpleBLEPeripheral_stateChangeCB,    // Profile State Change Callbacks
+  SimpleBLEPeripheral_linkChangeCB      // Link Established / Terminated Callbacks
 };
 
+// GAP Role connection parameter update callback
+static gapRolesParamUpdateCB_t SB_paramUpdateCB = SB_connPolicyParamsUpdated;
+
 // GAP Bond Manager Callbacks
 static gapBondCBs_t SB_BondMgrCBs =
 {
@@ -186,7 +256,8 @@ static gapBondCBs_t SB_BondMgrCBs =
 #ifndef FEATURE_OAD
 static simpleProfileCBs_t SB_simpleProfileCBs =
 {
-  SimpleBLEPeripheral_charValueChangeCB // Characteristic value change callback
+  SimpleBLEPeripheral_charValueChangeCB, // Characteristic value change callback
+  SimpleBLEPeripheral_notifyPendingCB    // Notification pending callback
 };
 #endif //!FEATURE_OAD
 
@@ -221,6 +292,8 @@ void SimpleBLEPeripheral_createTask(void)
   taskParams.priority = SBP_TASK_PRIORITY;
 
   Task_construct(&sbpTask, SimpleBLEPeripheral_taskFxn, &taskParams, NULL);
+
+  SB_diagnosticsRegisterTask(SB_DIAGNOSTICS_TASK_BLE, Task_handle(&sbpTask));
 }
 
 /*********************************************************************
@@ -250,6 +323,34 @@ static void SimpleBLEPeripheral_init(void)
 	// Create an RTOS queue for message from profile to be sent to app.
 	appMsgQueue = Util_constructQueue(&appMsg);
 
+	// Refresh the diagnostics periodically while connected
+	Util_constructClock(&periodicClock, SimpleBLEPeripheral_clockHandler,
+			SBP_PERIODIC_EVT_PERIOD, SBP_PERIODIC_EVT_PERIOD, false, SBP_PERIODIC_EVT);
+
+	// Load the application configuration. SNV is only reachable through ICall.
+	SB_settingsInit(SimpleBLEPeripheral_settingsFlushCB);
+
+	// Only notify sensor changes that matter, as configured in the settings
+	SB_reportPolicyInit();
+
+	// Keep the wall clock running between syncs from the phone
+	SB_systemTimeInit();
+
+	// Load the log key. The peripheral manager waits for it before opening the flash logs.
+	SB_logCryptLoadKey();
+
+	// The ATT response queue and the live stream share the connection event notice
+	SB_connEventInit(selfEntity, SBP_CONN_EVT_END_EVT);
+
+	// Batch samples into MTU sized notifications, measured per connection event
+	SB_liveStreamInit(SimpleBLEPeripheral_liveStreamCB);
+
+	// Serve bulk downloads of the sample log over an L2CAP channel
+	SB_historyInit(selfEntity);
+
+	// Ask for connection parameters suited to the traffic on the link
+	SB_connPolicyInit(SimpleBLEPeripheral_connPolicyCB);
+
 	// Setup the GAP
 	GAP_SetParamValue(TGAP_CONN_PAUSE_PERIPHERAL, DEFAULT_CONN_PAUSE_PERIPHERAL);
 
@@ -269,7 +370,12 @@ static void SimpleBLEPeripheral_init(void)
 		GAPRole_SetParameter(GAPROLE_ADVERT_OFF_TIME, sizeof(uint16_t), &advertOffTime);
 
 		GAPRole_SetParameter(GAPROLE_SCAN_RSP_DATA, sizeof(scanRspData), scanRspData);
+#if !defined(FEATURE_OAD) && DEFAULT_ADVERT_SENSOR_SUMMARY
 		GAPRole_SetParameter(GAPROLE_ADVERT_DATA, sizeof(advertData), advertData);
+#else
+		// Leave out the sensor summary
+		GAPRole_SetParameter(GAPROLE_ADVERT_DATA, SB_ADV_SUMMARY_OFFSET - 4, advertData);
+#endif
 
 		GAPRole_SetParameter(GAPROLE_PARAM_UPDATE_ENABLE, sizeof(uint8_t), &enableUpdateRequest);
 		GAPRole_SetParameter(GAPROLE_MIN_CONN_INTERVAL, sizeof(uint16_t), &desiredMinInterval);
@@ -281,15 +387,8 @@ static void SimpleBLEPeripheral_init(void)
 	// Set the GAP Characteristics
 	GGS_SetParameter(GGS_DEVICE_NAME_ATT, GAP_DEVICE_NAME_LEN, attDeviceName);
 
-	// Set advertising interval
-	{
-		uint16_t advInt = DEFAULT_ADVERTISING_INTERVAL;
-
-		GAP_SetParamValue(TGAP_LIM_DISC_ADV_INT_MIN, advInt);
-		GAP_SetParamValue(TGAP_LIM_DISC_ADV_INT_MAX, advInt);
-		GAP_SetParamValue(TGAP_GEN_DISC_ADV_INT_MIN, advInt);
-		GAP_SetParamValue(TGAP_GEN_DISC_ADV_INT_MAX, advInt);
-	}
+	// Set advertising interval, fast after boot and slowing while nobody connects
+	SB_advScheduleInit(SimpleBLEPeripheral_advScheduleCB);
 
 	// Setup the GAP Bond Manager
 	{
@@ -333,6 +432,7 @@ static void SimpleBLEPeripheral_init(void)
 
 	// Start the Device
 	VOID GAPRole_StartDevice(&SB_gapRoleCBs);
+	GAPRole_RegisterAppCBs(&SB_paramUpdateCB);
 
 	// Start Bond Manager
 	VOID GAPBondMgr_Register(&SB_BondMgrCBs);
@@ -389,6 +489,9 @@ static void SimpleBLEPeripheral_taskFxn(UArg a0, UArg a1)
             {
               // Try to retransmit pending ATT Response (if any)
               SimpleBLEPeripheral_sendAttRsp();
+
+              // Continue the live stream
+              SB_liveStreamConnEvent();
             }
           }
           else
@@ -417,6 +520,77 @@ static void SimpleBLEPeripheral_taskFxn(UArg a0, UArg a1)
           ICall_free(pMsg);
         }
       }
+
+      // Send the live stream packets that are ready
+      if (SimpleBLEPeripheral_takeEvent(SBP_LIVESTREAM_EVT))
+      {
+        SB_liveStreamSend();
+      }
+
+      // Send notifications of characteristics changed by other tasks
+      if (SimpleBLEPeripheral_takeEvent(SBP_NOTIFY_EVT))
+      {
+        SB_Profile_SendNotifications();
+
+#if !defined(FEATURE_OAD) && DEFAULT_ADVERT_SENSOR_SUMMARY
+        // Broadcast the new values
+        SimpleBLEPeripheral_updateAdvertData();
+#endif
+      }
+
+      // Publish new diagnostics. They are refreshed whatever the state of
+      // the state machine, so a fault can still be read.
+      if (SimpleBLEPeripheral_takeEvent(SBP_PERIODIC_EVT))
+      {
+        SB_diagnosticsRefresh();
+      }
+
+      // Send what the state machine entered S_TRANSMIT for. An alert does
+      // not wait for its packet to fill.
+      if (SimpleBLEPeripheral_takeEvent(SBP_TRANSMIT_EVT))
+      {
+        if (SimpleBLEPeripheral_takeEvent(SBP_TRANSMIT_FLUSH_EVT))
+        {
+          SB_liveStreamFlush();
+        }
+        else
+        {
+          SB_liveStreamSend();
+        }
+
+#if !defined(FEATURE_OAD) && DEFAULT_ADVERT_SENSOR_SUMMARY
+        SimpleBLEPeripheral_updateAdvertData();
+#endif
+
+        transmitPending = true;
+      }
+
+      // The transmit is done once the stack has taken every packet, which
+      // may take the buffers freed by later connection events
+      if (transmitPending && !SB_liveStreamIsPending())
+      {
+        transmitPending = false;
+        SB_fsmPostEvent(E_TRANSMIT_DONE);
+      }
+
+      // Step the advertising interval
+      if (SimpleBLEPeripheral_takeEvent(SBP_ADV_SCHEDULE_EVT))
+      {
+        SB_advScheduleProcess();
+      }
+
+      // Re-evaluate the connection parameters
+      if (SimpleBLEPeripheral_takeEvent(SBP_CONN_POLICY_EVT))
+      {
+        SB_connPolicyEvaluate();
+      }
+
+      // Write configuration changes while no ATT response is waiting to go
+      // out, as the SNV write may compact and stall the stack.
+      if ((attRspCount == 0) && SimpleBLEPeripheral_takeEvent(SBP_SETTINGS_FLUSH_EVT))
+      {
+        SB_settingsFlush();
+      }
     }
 
 #ifdef FEATURE_OAD
@@ -462,6 +636,19 @@ static uint8_t SimpleBLEPeripheral_processStackMsg(ICall_Hdr *pMsg)
       safeToDealloc = SimpleBLEPeripheral_processGATTMsg((gattMsgEvent_t *)pMsg);
       break;
 
+    case L2CAP_SIGNAL_EVENT:
+      // Process history channel events
+      SB_historyProcessSignal((l2capSignalEvent_t *)pMsg);
+      break;
+
+    case L2CAP_DATA_EVENT:
+      // Process history requests
+      SB_historyProcessData((l2capDataEvent_t *)pMsg);
+
+      // Speed the link up as soon as a download starts
+      SB_connPolicyEvaluate();
+      break;
+
     case HCI_GAP_EVENT_EVENT:
       {
         // Process HCI message
@@ -498,15 +685,26 @@ static uint8_t SimpleBLEPeripheral_processGATTMsg(gattMsgEvent_t *pMsg)
   if (pMsg->hdr.status == blePending)
   {
     // No HCI buffer was available. Let's try to retransmit the response
-    // on the next connection event.
-    if (HCI_EXT_ConnEventNoticeCmd(pMsg->connHandle, selfEntity,
-                                   SBP_CONN_EVT_END_EVT) == SUCCESS)
+    // on the next connection event, after any already waiting.
+    if (attRspCount == SBP_ATT_RSP_QUEUE_LEN)
     {
-      // First free any pending response
-      SimpleBLEPeripheral_freeAttRsp(FAILURE);
+      attRspStats.drops++;
 
+      System_printf("Rsp dropped, queue full\n");
+    }
+    else if ((attRspCount > 0) ||
+             (SB_connEventRequest(SB_CONN_EVENT_ATT_RSP,
+                                  pMsg->connHandle) == SUCCESS))
+    {
       // Hold on to the response message for retransmission
-      pAttRsp = pMsg;
+      attRspQueue[(attRspHead + attRspCount) % SBP_ATT_RSP_QUEUE_LEN] = pMsg;
+      attRspCount++;
+
+      attRspStats.queued++;
+      if (attRspCount > attRspStats.maxDepth)
+      {
+        attRspStats.maxDepth = attRspCount;
+      }
 
       // Don't free the response message yet
       return (FALSE);
@@ -525,6 +723,8 @@ static uint8_t SimpleBLEPeripheral_processGATTMsg(gattMsgEvent_t *pMsg)
   {
     // MTU size updated
     System_printf("MTU Size:%d\n", pMsg->msg.mtuEvt.MTU);
+
+    SB_liveStreamSetMTU(pMsg->connHandle, pMsg->msg.mtuEvt.MTU);
   }
 
   // Free message payload. Needed only for ATT Protocol messages
@@ -537,7 +737,8 @@ static uint8_t SimpleBLEPeripheral_processGATTMsg(gattMsgEvent_t *pMsg)
 /*********************************************************************
  * @fn      SimpleBLEPeripheral_sendAttRsp
  *
- * @brief   Send a pending ATT response message.
+ * @brief   Send pending ATT response messages in the order they were
+ *          queued, until the stack runs out of buffers again.
  *
  * @param   none
  *
@@ -546,36 +747,36 @@ static uint8_t SimpleBLEPeripheral_processGATTMsg(gattMsgEvent_t *pMsg)
 static void SimpleBLEPeripheral_sendAttRsp(void)
 {
   // See if there's a pending ATT Response to be transmitted
-  if (pAttRsp != NULL)
+  while (attRspCount > 0)
   {
+    gattMsgEvent_t *pAttRsp = attRspQueue[attRspHead];
     uint8_t status;
 
     // Increment retransmission count
     rspTxRetry++;
+    attRspStats.retries++;
 
     // Try to retransmit ATT response till either we're successful or
     // the ATT Client times out (after 30s) and drops the connection.
     status = GATT_SendRsp(pAttRsp->connHandle, pAttRsp->method, &(pAttRsp->msg));
-    if ((status != blePending) && (status != MSG_BUFFER_NOT_AVAIL))
-    {
-      // Disable connection event end notice
-      HCI_EXT_ConnEventNoticeCmd(pAttRsp->connHandle, selfEntity, 0);
-
-      // We're done with the response message
-      SimpleBLEPeripheral_freeAttRsp(status);
-    }
-    else
+    if ((status == blePending) || (status == MSG_BUFFER_NOT_AVAIL))
     {
-      // Continue retrying
-    	System_printf("Rsp send retry: %d\n", rspTxRetry);
+      // Continue retrying on the next connection event
+      System_printf("Rsp send retry: %d\n", rspTxRetry);
+      break;
     }
+
+    // We're done with the response message
+    SimpleBLEPeripheral_dequeueAttRsp(status);
   }
+
+  SimpleBLEPeripheral_followAttRsp();
 }
 
 /*********************************************************************
  * @fn      SimpleBLEPeripheral_freeAttRsp
  *
- * @brief   Free ATT response message.
+ * @brief   Free every queued ATT response message.
  *
  * @param   status - response transmit status
  *
@@ -583,31 +784,123 @@ static void SimpleBLEPeripheral_sendAttRsp(void)
  */
 static void SimpleBLEPeripheral_freeAttRsp(uint8_t status)
 {
-  // See if there's a pending ATT response message
-  if (pAttRsp != NULL)
+  while (attRspCount > 0)
   {
-    // See if the response was sent out successfully
-    if (status == SUCCESS)
+    SimpleBLEPeripheral_dequeueAttRsp(status);
+  }
+
+  SimpleBLEPeripheral_followAttRsp();
+}
+
+/*********************************************************************
+ * @fn      SimpleBLEPeripheral_freeLinkAttRsp
+ *
+ * @brief   Free the queued ATT response messages of a terminated link,
+ *          keeping those of other links in order.
+ *
+ * @param   connHandle - connection handle of the link
+ *
+ * @return  none
+ */
+static void SimpleBLEPeripheral_freeLinkAttRsp(uint16_t connHandle)
+{
+  uint8_t i, kept = 0, count = attRspCount;
+
+  for (i = 0; i < count; i++)
+  {
+    gattMsgEvent_t *pAttRsp = attRspQueue[(attRspHead + i) % SBP_ATT_RSP_QUEUE_LEN];
+
+    attRspQueue[(attRspHead + i) % SBP_ATT_RSP_QUEUE_LEN] = NULL;
+
+    if (pAttRsp->connHandle == connHandle)
     {
-    	System_printf("Rsp sent, retry:%d\n", rspTxRetry);
+      GATT_bm_free(&pAttRsp->msg, pAttRsp->method);
+      ICall_freeMsg(pAttRsp);
+
+      attRspStats.drops++;
+
+      // Retries counted so far were for this response
+      if (i == 0)
+      {
+        rspTxRetry = 0;
+      }
     }
     else
     {
-      // Free response payload
-      GATT_bm_free(&pAttRsp->msg, pAttRsp->method);
-
-      System_printf("Rsp retry failed:%d\n", rspTxRetry);
+      attRspQueue[(attRspHead + kept) % SBP_ATT_RSP_QUEUE_LEN] = pAttRsp;
+      kept++;
     }
+  }
 
-    // Free response message
-    ICall_freeMsg(pAttRsp);
+  attRspCount = kept;
+
+  SimpleBLEPeripheral_followAttRsp();
+}
 
-    // Reset our globals
-    pAttRsp = NULL;
-    rspTxRetry = 0;
+/*********************************************************************
+ * @fn      SimpleBLEPeripheral_followAttRsp
+ *
+ * @brief   Ask for connection event notices on the link of the response
+ *          at the head of the queue, which is retried first, or give
+ *          them up once the queue is empty.
+ *
+ * @param   none
+ *
+ * @return  none
+ */
+static void SimpleBLEPeripheral_followAttRsp(void)
+{
+  if (attRspCount > 0)
+  {
+    SB_connEventRequest(SB_CONN_EVENT_ATT_RSP,
+                        attRspQueue[attRspHead]->connHandle);
+  }
+  else
+  {
+    SB_connEventRelease(SB_CONN_EVENT_ATT_RSP);
   }
 }
 
+/*********************************************************************
+ * @fn      SimpleBLEPeripheral_dequeueAttRsp
+ *
+ * @brief   Free the ATT response message at the head of the queue.
+ *
+ * @param   status - response transmit status
+ *
+ * @return  none
+ */
+static void SimpleBLEPeripheral_dequeueAttRsp(uint8_t status)
+{
+  gattMsgEvent_t *pAttRsp = attRspQueue[attRspHead];
+
+  // See if the response was sent out successfully
+  if (status == SUCCESS)
+  {
+    attRspStats.sent++;
+
+    System_printf("Rsp sent, retry:%d\n", rspTxRetry);
+  }
+  else
+  {
+    // Free response payload
+    GATT_bm_free(&pAttRsp->msg, pAttRsp->method);
+
+    attRspStats.drops++;
+
+    System_printf("Rsp retry failed:%d\n", rspTxRetry);
+  }
+
+  // Free response message
+  ICall_freeMsg(pAttRsp);
+
+  // Move on to the next response
+  attRspQueue[attRspHead] = NULL;
+  attRspHead = (attRspHead + 1) % SBP_ATT_RSP_QUEUE_LEN;
+  attRspCount--;
+  rspTxRetry = 0;
+}
+
 /*********************************************************************
  * @fn      SimpleBLEPeripheral_processAppMsg
  *
@@ -627,7 +920,14 @@ static void SimpleBLEPeripheral_processAppMsg(sbpEvt_t *pMsg)
       break;
 
     case SBP_CHAR_CHANGE_EVT:
-      SimpleBLEPeripheral_processCharValueChangeEvt(pMsg->hdr.state);
+      SimpleBLEPeripheral_processCharValueChangeEvt(pMsg->hdr.state,
+                                                    ((sbpCharChangeEvt_t *)pMsg)->value,
+                                                    ((sbpCharChangeEvt_t *)pMsg)->len);
+      break;
+
+    case SBP_LINK_CHANGE_EVT:
+      SimpleBLEPeripheral_processLinkChangeEvt(((sbpLinkEvt_t *)pMsg)->connHandle,
+                                               pMsg->hdr.state);
       break;
 
     default:
@@ -650,6 +950,90 @@ static void SimpleBLEPeripheral_stateChangeCB(gaprole_States_t newState)
   SimpleBLEPeripheral_enqueueMsg(SBP_STATE_CHANGE_EVT, newState);
 }
 
+/*********************************************************************
+ * @fn      SimpleBLEPeripheral_linkChangeCB
+ *
+ * @brief   Callback from GAP Role indicating a link was established or
+ *          terminated.
+ *
+ * @param   connHandle - connection handle of the link
+ * @param   established - TRUE if established, FALSE if terminated
+ *
+ * @return  None.
+ */
+static void SimpleBLEPeripheral_linkChangeCB(uint16_t connHandle, uint8_t established)
+{
+  sbpLinkEvt_t *pMsg;
+
+  // Create dynamic pointer to message.
+  if ((pMsg = ICall_malloc(sizeof(sbpLinkEvt_t))))
+  {
+    pMsg->hdr.event = SBP_LINK_CHANGE_EVT;
+    pMsg->hdr.state = established;
+    pMsg->connHandle = connHandle;
+
+    // Enqueue the message.
+    Util_enqueueMsg(appMsgQueue, sem, (uint8*)pMsg);
+  }
+}
+
+/*********************************************************************
+ * @fn      SimpleBLEPeripheral_processLinkChangeEvt
+ *
+ * @brief   Start or stop serving one link. Every central has its own
+ *          live stream cursor; the connection parameter policy follows
+ *          the link the GAP role tracks, which is the most recent one.
+ *
+ * @param   connHandle - connection handle of the link
+ * @param   established - TRUE if established, FALSE if terminated
+ *
+ * @return  None.
+ */
+static void SimpleBLEPeripheral_processLinkChangeEvt(uint16_t connHandle, uint8_t established)
+{
+  static uint16_t policyHandle = INVALID_CONNHANDLE;
+  uint16_t connInterval, connLatency, connTimeout;
+
+  if (established)
+  {
+    SB_liveStreamConnected(connHandle);
+
+    System_printf("BLE Link %d up\n", connHandle);
+  }
+  else
+  {
+    // The stack has stopped the notice if it was on this link
+    SB_connEventDisconnected(connHandle);
+    SimpleBLEPeripheral_freeLinkAttRsp(connHandle);
+    SB_liveStreamDisconnected(connHandle);
+
+    System_printf("BLE Link %d down\n", connHandle);
+
+    if (connHandle != policyHandle)
+    {
+      return;
+    }
+
+    SB_connPolicyDisconnected();
+    policyHandle = INVALID_CONNHANDLE;
+  }
+
+  // Apply the policy to whichever link the GAP role now tracks, if any
+  GAPRole_GetParameter(GAPROLE_CONNHANDLE, &policyHandle);
+
+  if (policyHandle != INVALID_CONNHANDLE)
+  {
+    // When the tracked link drops the GAP role moves on to a remaining one, and
+    // reads its parameters as 0 until they next change. The policy then starts
+    // from SB_CONN_MODE_DEFAULT rather than taking them as a fast interval.
+    GAPRole_GetParameter(GAPROLE_CONN_INTERVAL, &connInterval);
+    GAPRole_GetParameter(GAPROLE_CONN_LATENCY, &connLatency);
+    GAPRole_GetParameter(GAPROLE_CONN_TIMEOUT, &connTimeout);
+
+    SB_connPolicyConnected(connInterval, connLatency, connTimeout);
+  }
+}
+
 /*********************************************************************
  * @fn      SimpleBLEPeripheral_processStateChangeEvt
  *
@@ -665,6 +1049,12 @@ static void SimpleBLEPeripheral_processStateChangeEvt(gaprole_States_t newState)
   static bool firstConnFlag = false;
 #endif // PLUS_BROADCASTER
 
+  // Advertising stopped and restarted to apply a new interval
+  if (SB_advScheduleStateChange(newState))
+  {
+    return;
+  }
+
   switch ( newState )
   {
     case GAPROLE_STARTED:
@@ -697,6 +1087,10 @@ static void SimpleBLEPeripheral_processStateChangeEvt(gaprole_States_t newState)
       break;
 
     case GAPROLE_ADVERTISING:
+      // Also reached when the last of several centrals disconnects
+      Util_stopClock(&periodicClock);
+      SB_fsmSetBleTimer(false);
+
     	System_printf("BLE Advertising\n");
       break;
 
@@ -722,8 +1116,6 @@ static void SimpleBLEPeripheral_processStateChangeEvt(gaprole_States_t newState)
 
         // Reset flag for next connection.
         firstConnFlag = false;
-
-        SimpleBLEPeripheral_freeAttRsp(bleNotConnected);
       }
       break;
 #endif //PLUS_BROADCASTER
@@ -732,9 +1124,14 @@ static void SimpleBLEPeripheral_processStateChangeEvt(gaprole_States_t newState)
       {
         uint8_t peerAddress[B_ADDR_LEN];
 
+        // Each link is set up as it is established, see
+        // SimpleBLEPeripheral_processLinkChangeEvt
         GAPRole_GetParameter(GAPROLE_CONN_BD_ADDR, peerAddress);
 
+        // The first read after connecting sees current diagnostics
+        SB_diagnosticsRefresh();
         Util_startClock(&periodicClock);
+        SB_fsmSetBleTimer(true);
 
         System_printf("BLE Connected\n");
         System_printf(Util_convertBdAddr2Str(peerAddress));
@@ -769,12 +1166,15 @@ static void SimpleBLEPeripheral_processStateChangeEvt(gaprole_States_t newState)
 
     case GAPROLE_WAITING:
       Util_stopClock(&periodicClock);
+      SB_fsmSetBleTimer(false);
       SimpleBLEPeripheral_freeAttRsp(bleNotConnected);
 
       System_printf("BLE Disconnected\n");
       break;
 
     case GAPROLE_WAITING_AFTER_TIMEOUT:
+      Util_stopClock(&periodicClock);
+      SB_fsmSetBleTimer(false);
       SimpleBLEPeripheral_freeAttRsp(bleNotConnected);
 
       System_printf("BLE Timed Out\n");
@@ -803,15 +1203,113 @@ static void SimpleBLEPeripheral_processStateChangeEvt(gaprole_States_t newState)
  * @fn      SimpleBLEPeripheral_charValueChangeCB
  *
  * @brief   Callback from Simple Profile indicating a characteristic
- *          value change.
+ *          value change. The value is copied into the message, as
+ *          the profile may not have published it yet.
  *
  * @param   paramID - parameter ID of the value that was changed.
+ * @param   pValue - the value as written.
+ * @param   len - length of the value.
  *
  * @return  None.
  */
-static void SimpleBLEPeripheral_charValueChangeCB(uint8_t paramID)
+static void SimpleBLEPeripheral_charValueChangeCB(uint8_t paramID, uint8_t *pValue, uint8_t len)
 {
-  SimpleBLEPeripheral_enqueueMsg(SBP_CHAR_CHANGE_EVT, paramID);
+  sbpCharChangeEvt_t *pMsg;
+
+  if (len > sizeof(pMsg->value))
+  {
+    return;
+  }
+
+  // Create dynamic pointer to message.
+  if ((pMsg = ICall_malloc(sizeof(sbpCharChangeEvt_t))))
+  {
+    pMsg->hdr.event = SBP_CHAR_CHANGE_EVT;
+    pMsg->hdr.state = paramID;
+    pMsg->len = len;
+    memcpy(pMsg->value, pValue, len);
+
+    // Enqueue the message.
+    Util_enqueueMsg(appMsgQueue, sem, (uint8*)pMsg);
+  }
+}
+
+/*********************************************************************
+ * @fn      SimpleBLEPeripheral_notifyPendingCB
+ *
+ * @brief   Callback from Simple Profile indicating characteristic
+ *          notifications are waiting to be sent. May be called from
+ *          any task.
+ *
+ * @param   None.
+ *
+ * @return  None.
+ */
+static void SimpleBLEPeripheral_notifyPendingCB(void)
+{
+  SimpleBLEPeripheral_setEvent(SBP_NOTIFY_EVT);
+}
+#endif //!FEATURE_OAD
+
+#ifndef FEATURE_OAD
+/*********************************************************************
+ * @fn      SimpleBLEPeripheral_updateAdvertData
+ *
+ * @brief   Refresh the sensor summary in the advertisement data from
+ *          the profile values. The advertisement data is only updated,
+ *          and the counter incremented, if the summary changed. With
+ *          PLUS_BROADCASTER the summary is also carried by the
+ *          non-connectable advertisements sent while connected.
+ *
+ * @param   None.
+ *
+ * @return  None.
+ */
+static void SimpleBLEPeripheral_updateAdvertData(void)
+{
+  uint8_t summary[SB_ADV_SUMMARY_LEN - 1];
+  uint8_t state[SB_BLE_BANDAGESTATE_LEN];
+  uint8_t extPower;
+  uint8_t *p = summary;
+
+  *p++ = SB_ADV_SUMMARY_FORMAT;
+
+  SB_Profile_GetParameter(SB_CHARACTERISTIC_TEMPERATURE, p, SB_BLE_TEMPERATURE_LEN);
+  p += SB_BLE_TEMPERATURE_LEN;
+  SB_Profile_GetParameter(SB_CHARACTERISTIC_HUMIDITY, p, SB_BLE_HUMIDITY_LEN);
+  p += SB_BLE_HUMIDITY_LEN;
+  SB_Profile_GetParameter(SB_CHARACTERISTIC_BATTCHARGE, p, SB_BLE_BATTCHARGE_LEN);
+  p += SB_BLE_BATTCHARGE_LEN;
+
+  SB_Profile_GetParameter(SB_CHARACTERISTIC_EXTPOWER, &extPower, SB_BLE_EXTPOWER_LEN);
+  SB_Profile_GetParameter(SB_CHARACTERISTIC_BANDAGESTATE, state, SB_BLE_BANDAGESTATE_LEN);
+
+  *p = 0;
+  if (extPower)
+  {
+    *p |= SB_ADV_FLAG_EXT_POWER;
+  }
+  if (state[0] || state[1])
+  {
+    *p |= SB_ADV_FLAG_ALERT;
+
+    // Advertise fast while a new alert is fresh
+    if (!(advertData[SB_ADV_SUMMARY_OFFSET + sizeof(summary) - 1] & SB_ADV_FLAG_ALERT))
+    {
+      SB_advScheduleAlert();
+    }
+  }
+
+  // The counter follows the summary and is left out of the comparison
+  if (memcmp(summary, &advertData[SB_ADV_SUMMARY_OFFSET], sizeof(summary)) == 0)
+  {
+    return;
+  }
+
+  memcpy(&advertData[SB_ADV_SUMMARY_OFFSET], summary, sizeof(summary));
+  ++advertData[SB_ADV_SUMMARY_OFFSET + sizeof(summary)];
+
+  GAPRole_SetParameter(GAPROLE_ADVERT_DATA, sizeof(advertData), advertData);
 }
 #endif //!FEATURE_OAD
 
@@ -822,21 +1320,39 @@ static void SimpleBLEPeripheral_charValueChangeCB(uint8_t paramID)
  *          event.
  *
  * @param   paramID - parameter ID of the value that was changed.
+ * @param   pValue - the value as written.
+ * @param   len - length of the value.
  *
  * @return  None.
  */
-static void SimpleBLEPeripheral_processCharValueChangeEvt(uint8_t paramID)
+static void SimpleBLEPeripheral_processCharValueChangeEvt(uint8_t paramID, const uint8_t *pValue, uint8_t len)
 {
 #ifndef FEATURE_OAD
-	uint8_t newValue[4];
+	UTCTime newTime;
+	SB_ReportPolicy policies[SB_REPORT_NUM_POLICIES];
 
 	switch(paramID)
 	{
 		case SB_CHARACTERISTIC_SYSTEMTIME:
-			// TODO: Integrate this with the rest of the system, and the storage mechanism
-			SB_Profile_GetParameter(SB_CHARACTERISTIC_SYSTEMTIME, &newValue, 4);
+			if (len != sizeof(newTime)) {
+				break;
+			}
+
+			memcpy(&newTime, pValue, sizeof(newTime));
+			SB_systemTimeSet(newTime);
+
+#ifdef SB_DEBUG
+			System_printf("System time set: %d\n", newTime);
+#endif
+			break;
+
+		case SB_CHARACTERISTIC_REPORTPOLICY:
+			if (len != sizeof(policies)) {
+				break;
+			}
 
-			System_printf("System time set: %d\n", *(uint32_t*)newValue);
+			memcpy(policies, pValue, sizeof(policies));
+			SB_reportPolicyConfigure(policies);
 			break;
 
 		default:
@@ -886,6 +1402,66 @@ void SimpleBLEPeripheral_processOadWriteCB(uint8_t event, uint16_t connHandle,
 }
 #endif //FEATURE_OAD
 
+/*********************************************************************
+ * @fn      SimpleBLEPeripheral_clockHandler
+ *
+ * @brief   Handler function for clock timeouts.
+ *
+ * @param   arg - event type
+ *
+ * @return  None.
+ */
+static void SimpleBLEPeripheral_clockHandler(UArg arg)
+{
+  SimpleBLEPeripheral_setEvent(arg);
+}
+
+/*********************************************************************
+ * @fn      SimpleBLEPeripheral_setEvent
+ *
+ * @brief   Stores an internal event and wakes up the application. May be
+ *          called from any task or Swi. The read-modify-write of the
+ *          events runs with interrupts disabled so that no other setter
+ *          or _takeEvent can interleave with it.
+ *
+ * @param   event - event to raise
+ *
+ * @return  None.
+ */
+static void SimpleBLEPeripheral_setEvent(uint16_t event)
+{
+  UInt key = Hwi_disable();
+
+  events |= event;
+
+  Hwi_restore(key);
+
+  // Wake up the application.
+  Semaphore_post(sem);
+}
+
+/*********************************************************************
+ * @fn      SimpleBLEPeripheral_takeEvent
+ *
+ * @brief   Tests and clears an internal event in one step, so an event
+ *          raised again while it is being handled is not lost.
+ *
+ * @param   event - event to take
+ *
+ * @return  true if the event was raised.
+ */
+static bool SimpleBLEPeripheral_takeEvent(uint16_t event)
+{
+  UInt key = Hwi_disable();
+  bool raised = (events & event) != 0;
+
+  events &= ~event;
+
+  Hwi_restore(key);
+
+  return raised;
+}
+
 /*********************************************************************
  * @fn      SimpleBLEPeripheral_enqueueMsg
  *
@@ -911,9 +1487,92 @@ static void SimpleBLEPeripheral_enqueueMsg(uint8_t event, uint8_t state)
   }
 }
 
+/*********************************************************************
+ * @fn      SimpleBLEPeripheral_settingsFlushCB
+ *
+ * @brief   Callback from the settings module once configuration changes
+ *          have settled and should be written to SNV.
+ *
+ * @param   None.
+ *
+ * @return  None.
+ */
+static void SimpleBLEPeripheral_settingsFlushCB(void)
+{
+  SimpleBLEPeripheral_setEvent(SBP_SETTINGS_FLUSH_EVT);
+}
+
+/*********************************************************************
+ * @fn      SimpleBLEPeripheral_liveStreamCB
+ *
+ * @brief   Callback from the live stream when packets are ready to be
+ *          sent.
+ *
+ * @param   None.
+ *
+ * @return  None.
+ */
+static void SimpleBLEPeripheral_liveStreamCB(void)
+{
+  SimpleBLEPeripheral_setEvent(SBP_LIVESTREAM_EVT);
+}
+
+/*********************************************************************
+ * @fn      SimpleBLEPeripheral_connPolicyCB
+ *
+ * @brief   Callback from the connection policy when the connection
+ *          parameters should be re-evaluated.
+ *
+ * @param   None.
+ *
+ * @return  None.
+ */
+static void SimpleBLEPeripheral_connPolicyCB(void)
+{
+  SimpleBLEPeripheral_setEvent(SBP_CONN_POLICY_EVT);
+}
+
+/*********************************************************************
+ * @fn      SimpleBLEPeripheral_advScheduleCB
+ *
+ * @brief   Callback from the advertising schedule when the interval
+ *          should be stepped or an alert needs fast advertising.
+ *
+ * @param   None.
+ *
+ * @return  None.
+ */
+static void SimpleBLEPeripheral_advScheduleCB(void)
+{
+  SimpleBLEPeripheral_setEvent(SBP_ADV_SCHEDULE_EVT);
+}
+
 /*********************************************************************
 *********************************************************************/
 
 void SB_bleInit() {
 	SimpleBLEPeripheral_createTask();
 }
+
+/**
+ * \brief Asks the BLE task to send the live stream and broadcast the latest readings.
+ * 			E_TRANSMIT_DONE is posted to the state machine once the stack has taken them.
+ * \remark May be called from any task.
+ * \param flush True to send the samples queued in partial packets rather than wait for
+ * 			them to fill, as for an alert
+ */
+void SB_bleRequestTransmit(bool flush) {
+	SimpleBLEPeripheral_setEvent(flush ? (SBP_TRANSMIT_EVT | SBP_TRANSMIT_FLUSH_EVT) : SBP_TRANSMIT_EVT);
+}
+
+/**
+ * \brief Copies the ATT response retransmission counters.
+ */
+void SB_bleGetAttRspStats(SB_AttRspStats *stats) {
+	UInt key = Task_disable();
+
+	*stats = attRspStats;
+	stats->depth = attRspCount;
+
+	Task_restore(key);
+}
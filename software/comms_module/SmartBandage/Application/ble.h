@@ -9,18 +9,37 @@
 #define APPLICATION_BLE_H_
 
 #include "Board.h"
+#include "../PROFILES/smartBandageProfile.h"
 
 /*********************************************************************
  * CONSTANTS
  */
-// Advertising interval when device is discoverable (units of 625us, 160=100ms)
-#define DEFAULT_ADVERTISING_INTERVAL          160
-
 // By setting this to zero, the device will go into the waiting state after
 // being discoverable for 30.72 second, and will not being advertising again
 // until the enabler is set back to TRUE
 #define DEFAULT_ADVERTISING_OFF_TIME		  0
 
+// Whether the latest sensor values are broadcast in the advertising data, so
+// gateways can monitor the bandage without connecting
+#define DEFAULT_ADVERT_SENSOR_SUMMARY         TRUE
+
+// Manufacturer specific advertising data carrying the sensor summary. 0xFFFF is
+// reserved for testing and must be replaced by an assigned company identifier.
+#define SB_ADV_COMPANY_ID                     0xFFFF
+#define SB_ADV_SUMMARY_FORMAT                 1
+
+// Summary layout (little endian):
+//   uint8_t  format       SB_ADV_SUMMARY_FORMAT
+//   uint16_t temperature[4]
+//   uint16_t humidity
+//   uint16_t battCharge
+//   uint8_t  flags        SB_ADV_FLAG_*
+//   uint8_t  counter      Incremented whenever the summary changes
+#define SB_ADV_SUMMARY_LEN                    (1 + SB_BLE_TEMPERATURE_LEN + SB_BLE_HUMIDITY_LEN + SB_BLE_BATTCHARGE_LEN + 2)
+
+#define SB_ADV_FLAG_EXT_POWER                 0x01
+#define SB_ADV_FLAG_ALERT                     0x02  // BandageState is non-zero
+
 // Limited discoverable mode advertises for 30.72s, and then stops
 // General discoverable mode advertises indefinitely
 #define DEFAULT_DISCOVERABLE_MODE             GAP_ADTYPE_FLAGS_GENERAL
@@ -83,8 +102,32 @@
 #define SBP_CHAR_CHANGE_EVT                   0x0002
 #define SBP_PERIODIC_EVT                      0x0004
 #define SBP_CONN_EVT_END_EVT                  0x0008
+#define SBP_SETTINGS_FLUSH_EVT                0x0010
+#define SBP_NOTIFY_EVT                        0x0020
+#define SBP_LIVESTREAM_EVT                    0x0040
+#define SBP_CONN_POLICY_EVT                   0x0080
+#define SBP_ADV_SCHEDULE_EVT                  0x0100
+#define SBP_TRANSMIT_EVT                      0x0200
+#define SBP_TRANSMIT_FLUSH_EVT                0x0400
+
+// Messages for RTOS application, only ever queued and never raised as events
+#define SBP_LINK_CHANGE_EVT                   0x0003
+
+// ATT responses held for retransmission when the stack is out of buffers
+#define SBP_ATT_RSP_QUEUE_LEN                 4
+
+typedef struct {
+	uint32_t queued;		// Responses the stack could not send at first
+	uint32_t sent;			// Queued responses sent on retry
+	uint32_t retries;		// Retransmission attempts
+	uint32_t drops;			// Responses freed unsent: queue full, send failure or disconnect
+	uint8_t  depth;
+	uint8_t  maxDepth;
+} SB_AttRspStats;
 
 
 void SB_bleInit();
+void SB_bleGetAttRspStats(SB_AttRspStats *stats);
+void SB_bleRequestTransmit(bool flush);
 
 #endif /* APPLICATION_BLE_H_ */
@@ -0,0 +1,125 @@
+/*
+ * connEvent.c
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#include "hci.h"
+#include "linkdb.h"
+
+#include "connEvent.h"
+
+static bStatus_t update();
+
+struct {
+	uint8_t entity;
+	uint16_t eventFlag;
+
+	// Link each user wants the notice on, INVALID_CONNHANDLE if none
+	uint16_t wanted[SB_CONN_EVENT_NUM_USERS];
+
+	// Link the notice is registered on, INVALID_CONNHANDLE while it is off
+	uint16_t connHandle;
+} CONNEVENT = {
+	.connHandle = INVALID_CONNHANDLE,
+};
+
+/**
+ * \brief Sets where the notice is sent.
+ * \remark Must be called before the live stream or the BLE task use the notice.
+ * \param entity ICall entity of the BLE task
+ * \param eventFlag Event flag set for the BLE task at the end of each connection event
+ */
+void SB_connEventInit(uint8_t entity, uint16_t eventFlag) {
+	uint8_t i;
+
+	CONNEVENT.entity = entity;
+	CONNEVENT.eventFlag = eventFlag;
+
+	for (i = 0; i < SB_CONN_EVENT_NUM_USERS; ++i) {
+		CONNEVENT.wanted[i] = INVALID_CONNHANDLE;
+	}
+}
+
+/**
+ * \brief Asks for the notice on a link, in place of any the user asked for before.
+ * \remark Must be called from the task registered with ICall.
+ * \return SUCCESS once the notice is registered on the link of the first user asking
+ * 			for it, or the status of the stack refusing it
+ */
+bStatus_t SB_connEventRequest(SB_ConnEventUser user, uint16_t connHandle) {
+	CONNEVENT.wanted[user] = connHandle;
+
+	return update();
+}
+
+/**
+ * \brief Gives up the notice. It stays on while another user needs it.
+ * \remark Must be called from the task registered with ICall.
+ */
+void SB_connEventRelease(SB_ConnEventUser user) {
+	CONNEVENT.wanted[user] = INVALID_CONNHANDLE;
+
+	update();
+}
+
+/**
+ * \brief Forgets a closed link, for which the stack has stopped the notice. Users still
+ * 			waiting ask again for another link.
+ * \remark Must be called from the task registered with ICall.
+ */
+void SB_connEventDisconnected(uint16_t connHandle) {
+	uint8_t i;
+
+	for (i = 0; i < SB_CONN_EVENT_NUM_USERS; ++i) {
+		if (CONNEVENT.wanted[i] == connHandle) {
+			CONNEVENT.wanted[i] = INVALID_CONNHANDLE;
+		}
+	}
+
+	if (CONNEVENT.connHandle == connHandle) {
+		CONNEVENT.connHandle = INVALID_CONNHANDLE;
+	}
+
+	update();
+}
+
+/**
+ * \brief Link the notices come from, INVALID_CONNHANDLE while they are off.
+ */
+uint16_t SB_connEventHandle() {
+	return CONNEVENT.connHandle;
+}
+
+/**
+ * \brief Moves the notice to the link of the first user that wants it, or turns it off.
+ */
+static bStatus_t update() {
+	uint16_t target = INVALID_CONNHANDLE;
+	bStatus_t status;
+	uint8_t i;
+
+	for (i = 0; i < SB_CONN_EVENT_NUM_USERS && target == INVALID_CONNHANDLE; ++i) {
+		target = CONNEVENT.wanted[i];
+	}
+
+	if (target == CONNEVENT.connHandle) {
+		return SUCCESS;
+	}
+
+	if (CONNEVENT.connHandle != INVALID_CONNHANDLE) {
+		HCI_EXT_ConnEventNoticeCmd(CONNEVENT.connHandle, CONNEVENT.entity, 0);
+		CONNEVENT.connHandle = INVALID_CONNHANDLE;
+	}
+
+	if (target == INVALID_CONNHANDLE) {
+		return SUCCESS;
+	}
+
+	status = HCI_EXT_ConnEventNoticeCmd(target, CONNEVENT.entity, CONNEVENT.eventFlag);
+	if (status == SUCCESS) {
+		CONNEVENT.connHandle = target;
+	}
+
+	return status;
+}
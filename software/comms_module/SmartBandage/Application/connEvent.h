@@ -0,0 +1,35 @@
+/*
+ * @file connEvent.h
+ * @brief Shares the stack's one connection event notice between the modules that need it.
+ *
+ * The stack reports the end of connection events for a single link at a time, to a
+ * single task. Queued ATT responses and the live stream both retry sends on those
+ * events, so each asks for the notice on the link it is waiting for and releases it
+ * when done. The notice is kept on the link of the first user in SB_ConnEventUser
+ * order which still asks for it, moved when that changes, and only turned off once
+ * no user needs it.
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef APPLICATION_CONNEVENT_H_
+#define APPLICATION_CONNEVENT_H_
+
+#include "bcomdef.h"
+
+#include "Board.h"
+
+// Users of the notice, the first served first
+typedef enum {
+	SB_CONN_EVENT_ATT_RSP = 0,		// Queued ATT responses, which the client times out
+	SB_CONN_EVENT_LIVESTREAM,
+	SB_CONN_EVENT_NUM_USERS
+} SB_ConnEventUser;
+
+void      SB_connEventInit(uint8_t entity, uint16_t eventFlag);
+bStatus_t SB_connEventRequest(SB_ConnEventUser user, uint16_t connHandle);
+void      SB_connEventRelease(SB_ConnEventUser user);
+void      SB_connEventDisconnected(uint16_t connHandle);
+uint16_t  SB_connEventHandle();
+
+#endif /* APPLICATION_CONNEVENT_H_ */
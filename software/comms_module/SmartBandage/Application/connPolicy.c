@@ -0,0 +1,265 @@
+/*
+ * connPolicy.c
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#include <ti/sysbios/knl/Task.h>
+#include <ti/sysbios/knl/Clock.h>
+#include <xdc/runtime/System.h>
+
+#include "bcomdef.h"
+#include "peripheral.h"
+
+#include "util.h"
+#include "history.h"
+#include "liveStream.h"
+#include "connPolicy.h"
+
+static void        SB_connPolicyClockHandler(UArg arg);
+static SB_ConnMode classify(uint16_t connInterval);
+static void        setMode(SB_ConnMode mode);
+static bool        request(SB_ConnMode mode);
+
+struct {
+	bool connected;
+
+	// Ticks at which the current mode was entered
+	uint32_t modeSince;
+
+	uint32_t lastDemand;
+	uint32_t lastRequest;
+	bool requestSent;
+
+	// Repeats of the request for stats.requestedMode, and whether the central's parameters
+	// have been accepted in its place
+	uint8_t retries;
+	bool accepted;
+
+	Clock_Struct evalClock;
+	SB_ConnPolicyPendingCB pendingCB;
+
+	SB_ConnPolicyStats stats;
+} CONNPOLICY;
+
+/**
+ * \brief Prepares the policy.
+ * \param pendingCB Called from SWI context when demand should be re-evaluated. The BLE task
+ * 			should respond by calling SB_connPolicyEvaluate.
+ */
+SB_Error SB_connPolicyInit(SB_ConnPolicyPendingCB pendingCB) {
+	CONNPOLICY.pendingCB = pendingCB;
+	CONNPOLICY.modeSince = Clock_getTicks();
+
+	if (NULL == Util_constructClock(
+			&CONNPOLICY.evalClock,
+			SB_connPolicyClockHandler,
+			SB_CONNPOLICY_EVAL_PERIOD_MS,
+			SB_CONNPOLICY_EVAL_PERIOD_MS,
+			false,
+			0)) {
+#ifdef SB_DEBUG
+		System_printf("CPOLICY: Failed to initialize evaluation clock\n");
+		System_flush();
+#endif
+		return OSResourceInitializationError;
+	}
+
+	return NoError;
+}
+
+/**
+ * \brief Starts applying the policy to a new connection.
+ * \param connInterval 0 if the parameters of the link are not known, which leaves the mode
+ * 			at SB_CONN_MODE_DEFAULT until the central next updates them
+ */
+void SB_connPolicyConnected(uint16_t connInterval, uint16_t connLatency, uint16_t connTimeout) {
+	UInt key = Task_disable();
+
+	CONNPOLICY.connected = true;
+	CONNPOLICY.requestSent = false;
+	CONNPOLICY.retries = 0;
+	CONNPOLICY.accepted = false;
+	CONNPOLICY.lastDemand = Clock_getTicks();
+	CONNPOLICY.stats.requestedMode = SB_CONN_MODE_DEFAULT;
+	CONNPOLICY.stats.connInterval = connInterval;
+	CONNPOLICY.stats.connLatency = connLatency;
+	CONNPOLICY.stats.connTimeout = connTimeout;
+	setMode(classify(connInterval));
+	Task_restore(key);
+
+	Util_startClock(&CONNPOLICY.evalClock);
+}
+
+void SB_connPolicyDisconnected() {
+	UInt key;
+
+	Util_stopClock(&CONNPOLICY.evalClock);
+
+	key = Task_disable();
+	CONNPOLICY.connected = false;
+	CONNPOLICY.stats.requestedMode = SB_CONN_MODE_DISCONNECTED;
+	CONNPOLICY.stats.connInterval = 0;
+	CONNPOLICY.stats.connLatency = 0;
+	CONNPOLICY.stats.connTimeout = 0;
+	setMode(SB_CONN_MODE_DISCONNECTED);
+	Task_restore(key);
+}
+
+/**
+ * \brief Records the parameters applied by the central.
+ * \remark May be called from the GAP role task.
+ */
+void SB_connPolicyParamsUpdated(uint16_t connInterval, uint16_t connLatency, uint16_t connTimeout) {
+	UInt key = Task_disable();
+
+	if (CONNPOLICY.connected) {
+		++CONNPOLICY.stats.updates;
+		CONNPOLICY.stats.connInterval = connInterval;
+		CONNPOLICY.stats.connLatency = connLatency;
+		CONNPOLICY.stats.connTimeout = connTimeout;
+		setMode(classify(connInterval));
+
+		// Granted: a later request for the mode starts over
+		if (CONNPOLICY.stats.mode == CONNPOLICY.stats.requestedMode) {
+			CONNPOLICY.retries = 0;
+			CONNPOLICY.accepted = false;
+		}
+	}
+
+	Task_restore(key);
+}
+
+/**
+ * \brief Requests the parameters suited to the current traffic.
+ * \remark Must be called from the task registered with ICall.
+ */
+void SB_connPolicyEvaluate() {
+	uint32_t now = Clock_getTicks();
+	uint32_t gapMs = SB_CONNPOLICY_MIN_REQUEST_GAP_MS;
+	SB_ConnMode target;
+	bool repeat;
+
+	if (!CONNPOLICY.connected) {
+		return;
+	}
+
+	if (SB_historyIsActive() || SB_liveStreamIsBacklogged()) {
+		CONNPOLICY.lastDemand = now;
+		target = SB_CONN_MODE_FAST;
+	} else if ((now - CONNPOLICY.lastDemand) >= SB_CONNPOLICY_IDLE_HOLDOFF_MS * (NTICKS_PER_MILLSECOND)) {
+		target = SB_CONN_MODE_IDLE;
+	} else {
+		// Within the holdoff: keep whatever was last asked for
+		return;
+	}
+
+	// Compared with the parameters applied, not those asked for, so a request the central
+	// refused or ignored is sent again once the gap has passed
+	if (target == CONNPOLICY.stats.mode) {
+		return;
+	}
+
+	// A request sent again waits twice as long as the one before it
+	repeat = CONNPOLICY.requestSent && target == CONNPOLICY.stats.requestedMode;
+	if (repeat) {
+		if (CONNPOLICY.accepted) {
+			return;
+		}
+		gapMs <<= CONNPOLICY.retries;
+	}
+
+	if (CONNPOLICY.requestSent
+			&& (now - CONNPOLICY.lastRequest) < gapMs * (NTICKS_PER_MILLSECOND)) {
+		// Waiting on the central to answer the last request is not a deferred change
+		if (!repeat) {
+			++CONNPOLICY.stats.suppressed;
+		}
+		return;
+	}
+
+	// The central kept its parameters through every retry: stop asking until the traffic
+	// calls for another mode
+	if (repeat && CONNPOLICY.retries == SB_CONNPOLICY_MAX_RETRIES) {
+		CONNPOLICY.accepted = true;
+		++CONNPOLICY.stats.accepted;
+		return;
+	}
+
+	if (request(target)) {
+		CONNPOLICY.retries = repeat ? CONNPOLICY.retries + 1 : 0;
+		CONNPOLICY.accepted = false;
+		CONNPOLICY.requestSent = true;
+		CONNPOLICY.lastRequest = now;
+		CONNPOLICY.stats.requestedMode = target;
+	}
+}
+
+void SB_connPolicyGetStats(SB_ConnPolicyStats *stats) {
+	UInt key = Task_disable();
+
+	// Account for the time spent in the current mode so far
+	setMode((SB_ConnMode)CONNPOLICY.stats.mode);
+	*stats = CONNPOLICY.stats;
+
+	Task_restore(key);
+}
+
+static void SB_connPolicyClockHandler(UArg arg) {
+	if (CONNPOLICY.pendingCB != NULL) {
+		CONNPOLICY.pendingCB();
+	}
+}
+
+static SB_ConnMode classify(uint16_t connInterval) {
+	if (connInterval == 0) {
+		return SB_CONN_MODE_DEFAULT;
+	}
+
+	if (connInterval <= SB_CONNPOLICY_FAST_MAX_INTERVAL) {
+		return SB_CONN_MODE_FAST;
+	}
+
+	if (connInterval >= SB_CONNPOLICY_IDLE_MIN_INTERVAL) {
+		return SB_CONN_MODE_IDLE;
+	}
+
+	return SB_CONN_MODE_DEFAULT;
+}
+
+/**
+ * \brief Adds the time since the last change to the current mode, then switches mode.
+ * \remark Must be called with tasks disabled.
+ */
+static void setMode(SB_ConnMode mode) {
+	uint32_t now = Clock_getTicks();
+	uint32_t elapsedMs = (now - CONNPOLICY.modeSince) / (NTICKS_PER_MILLSECOND);
+
+	CONNPOLICY.stats.msInMode[CONNPOLICY.stats.mode] += elapsedMs;
+	CONNPOLICY.modeSince += elapsedMs * (NTICKS_PER_MILLSECOND);
+	CONNPOLICY.stats.mode = mode;
+}
+
+static bool request(SB_ConnMode mode) {
+	bStatus_t status;
+
+	if (mode == SB_CONN_MODE_FAST) {
+		status = GAPRole_SendUpdateParam(SB_CONNPOLICY_FAST_MIN_INTERVAL, SB_CONNPOLICY_FAST_MAX_INTERVAL,
+				SB_CONNPOLICY_FAST_LATENCY, SB_CONNPOLICY_FAST_TIMEOUT, GAPROLE_NO_ACTION);
+	} else {
+		status = GAPRole_SendUpdateParam(SB_CONNPOLICY_IDLE_MIN_INTERVAL, SB_CONNPOLICY_IDLE_MAX_INTERVAL,
+				SB_CONNPOLICY_IDLE_LATENCY, SB_CONNPOLICY_IDLE_TIMEOUT, GAPROLE_NO_ACTION);
+	}
+
+	if (status != SUCCESS) {
+		++CONNPOLICY.stats.requestFailures;
+#ifdef SB_DEBUG
+		System_printf("CPOLICY: Update request failed: %d\n", status);
+		System_flush();
+#endif
+		return false;
+	}
+
+	++CONNPOLICY.stats.requests[mode];
+	return true;
+}
@@ -0,0 +1,81 @@
+/*
+ * @file connPolicy.h
+ * @brief Chooses connection parameters for the traffic on the link.
+ *
+ * While a history download is running or the live stream is backlogged the
+ * central is asked for a short connection interval. Once the link has been
+ * quiet for SB_CONNPOLICY_IDLE_HOLDOFF_MS it is asked for a long interval with
+ * slave latency, so steady monitoring costs few radio events. Speeding up is
+ * immediate while slowing down waits out the holdoff, and requests are spaced
+ * by at least SB_CONNPOLICY_MIN_REQUEST_GAP_MS, so bursty traffic does not
+ * thrash the parameters. A request the central refuses or ignores is sent
+ * again, each time after twice the gap of the last, until the parameters
+ * applied match. After SB_CONNPOLICY_MAX_RETRIES repeats the parameters of
+ * the central are accepted, until the traffic calls for another mode.
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef APPLICATION_CONNPOLICY_H_
+#define APPLICATION_CONNPOLICY_H_
+
+#include "bcomdef.h"
+
+#include "Board.h"
+
+// Bulk transfer: 15 ms to 30 ms (units of 1.25 ms), no latency, 2 s supervision timeout
+#define SB_CONNPOLICY_FAST_MIN_INTERVAL		12
+#define SB_CONNPOLICY_FAST_MAX_INTERVAL		24
+#define SB_CONNPOLICY_FAST_LATENCY			0
+#define SB_CONNPOLICY_FAST_TIMEOUT			200
+
+// Monitoring: 400 ms to 500 ms, skipping up to 2 events, 6 s supervision timeout
+#define SB_CONNPOLICY_IDLE_MIN_INTERVAL		320
+#define SB_CONNPOLICY_IDLE_MAX_INTERVAL		400
+#define SB_CONNPOLICY_IDLE_LATENCY			2
+#define SB_CONNPOLICY_IDLE_TIMEOUT			600
+
+// How often demand is re-evaluated while connected
+#define SB_CONNPOLICY_EVAL_PERIOD_MS		1000
+
+// Time without demand before asking for the idle parameters
+#define SB_CONNPOLICY_IDLE_HOLDOFF_MS		10000
+
+// Shortest time between two update requests
+#define SB_CONNPOLICY_MIN_REQUEST_GAP_MS	2000
+
+// Repeats of a request the central did not apply, before its parameters are accepted
+#define SB_CONNPOLICY_MAX_RETRIES			3
+
+typedef enum {
+	SB_CONN_MODE_DISCONNECTED = 0,
+	SB_CONN_MODE_DEFAULT,			// Parameters chosen by the central or not known, not yet classified
+	SB_CONN_MODE_FAST,
+	SB_CONN_MODE_IDLE,
+	SB_CONN_MODE_COUNT
+} SB_ConnMode;
+
+typedef struct {
+	uint32_t msInMode[SB_CONN_MODE_COUNT];	// Time spent with parameters in each mode
+	uint16_t requests[SB_CONN_MODE_COUNT];	// Update requests sent for each mode
+	uint16_t requestFailures;				// Requests the stack refused to send
+	uint16_t updates;						// Parameter updates applied by the central
+	uint16_t suppressed;					// Mode changes deferred by the request gap
+	uint16_t accepted;						// Modes given up after SB_CONNPOLICY_MAX_RETRIES
+	uint16_t connInterval;					// Current parameters, as applied
+	uint16_t connLatency;
+	uint16_t connTimeout;
+	uint8_t  mode;							// Mode of the current parameters
+	uint8_t  requestedMode;
+} SB_ConnPolicyStats;
+
+typedef void (*SB_ConnPolicyPendingCB)(void);
+
+SB_Error SB_connPolicyInit(SB_ConnPolicyPendingCB pendingCB);
+void     SB_connPolicyConnected(uint16_t connInterval, uint16_t connLatency, uint16_t connTimeout);
+void     SB_connPolicyDisconnected();
+void     SB_connPolicyParamsUpdated(uint16_t connInterval, uint16_t connLatency, uint16_t connTimeout);
+void     SB_connPolicyEvaluate();
+void     SB_connPolicyGetStats(SB_ConnPolicyStats *stats);
+
+#endif /* APPLICATION_CONNPOLICY_H_ */
@@ -0,0 +1,272 @@
+/*
+ * diagnostics.c
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#include <string.h>
+
+#include "diagnostics.h"
+#include "peripheralManager.h"
+#include "flashLog.h"
+#include "liveStream.h"
+#include "systemTime.h"
+#include "settings.h"
+#include "reportPolicy.h"
+#include "ble.h"
+#include "../PROFILES/smartBandageProfile.h"
+
+#ifdef HEAPMGR_METRICS
+// Provided by the heap manager built into ICall.c
+extern void ICall_heapGetMetrics(uint16_t *pBlkMax, uint16_t *pBlkCnt, uint16_t *pBlkFree,
+								 uint16_t *pMemAlo, uint16_t *pMemMax, uint16_t *pMemUB);
+#endif
+
+// The characteristic must be exactly as long as the snapshot
+typedef char SB_DiagnosticsLengthCheck[(sizeof(SB_DiagnosticsSnapshot) == SB_BLE_DIAGNOSTICS_LEN) ? 1 : -1];
+// Longest attribute value ATT allows
+typedef char SB_DiagnosticsMaxLengthCheck[(SB_BLE_DIAGNOSTICS_LEN <= 512) ? 1 : -1];
+typedef char SB_DiagnosticsPeripheralCheck[(SB_NUM_MCP9808_SENSORS <= SB_DIAGNOSTICS_TEMPERATURE_SLOTS) ? 1 : -1];
+typedef char SB_DiagnosticsLinkCheck[(SB_LIVESTREAM_MAX_LINKS <= SB_DIAGNOSTICS_LINKS) ? 1 : -1];
+
+static void fillMemory(SB_DiagnosticsSnapshot *snapshot);
+static void fillI2C(SB_DiagnosticsSnapshot *snapshot);
+static void fillPeripherals(SB_DiagnosticsSnapshot *snapshot);
+static void fillFSM(SB_DiagnosticsSnapshot *snapshot);
+static void fillLogs(SB_DiagnosticsSnapshot *snapshot);
+static void fillBLE(SB_DiagnosticsSnapshot *snapshot);
+static void fillRadio(SB_DiagnosticsSnapshot *snapshot);
+static void fillReporting(SB_DiagnosticsSnapshot *snapshot);
+static void fillSettings(SB_DiagnosticsSnapshot *snapshot);
+static uint16_t logFill(SB_FlashLog *log);
+
+struct {
+	Task_Handle tasks[SB_DIAGNOSTICS_NUM_TASKS];
+
+	// Built here rather than on the stack of the BLE task
+	SB_DiagnosticsSnapshot snapshot;
+	uint8_t sequence;
+} DIAG;
+
+/**
+ * \brief Adds a task to the stack high-watermarks. Called once by each module creating a task.
+ */
+void SB_diagnosticsRegisterTask(SB_DiagnosticsTask task, Task_Handle handle) {
+	if (task < SB_DIAGNOSTICS_NUM_TASKS) {
+		DIAG.tasks[task] = handle;
+	}
+}
+
+/**
+ * \brief Gathers the counters of every module into a new snapshot, and publishes it as the
+ * 			Diagnostics characteristic.
+ * \remark Must only be called from the BLE task.
+ */
+void SB_diagnosticsRefresh() {
+	SB_DiagnosticsSnapshot *snapshot = &DIAG.snapshot;
+
+	memset(snapshot, 0, sizeof(SB_DiagnosticsSnapshot));
+
+	snapshot->sequence = ++DIAG.sequence;
+	snapshot->format = SB_DIAGNOSTICS_FORMAT;
+	snapshot->time = SB_systemTimeGet();
+
+	fillMemory(snapshot);
+	fillI2C(snapshot);
+	fillPeripherals(snapshot);
+	fillFSM(snapshot);
+	fillLogs(snapshot);
+	fillBLE(snapshot);
+	fillRadio(snapshot);
+	fillReporting(snapshot);
+	fillSettings(snapshot);
+
+	snapshot->sequenceEnd = snapshot->sequence;
+
+	SB_Profile_SetParameter(SB_CHARACTERISTIC_DIAGNOSTICS, sizeof(SB_DiagnosticsSnapshot), snapshot);
+}
+
+static void fillMemory(SB_DiagnosticsSnapshot *snapshot) {
+	Task_Stat stat;
+	uint8_t i;
+
+#ifdef HEAPMGR_METRICS
+	uint16_t blkMax, blkCnt, blkFree, memAlo, memMax, memUB;
+
+	ICall_heapGetMetrics(&blkMax, &blkCnt, &blkFree, &memAlo, &memMax, &memUB);
+
+	snapshot->heapSize = HEAPMGR_SIZE;
+	snapshot->heapUsed = memAlo;
+	snapshot->heapMaxUsed = memMax;
+#endif
+
+	// Stacks are filled with a known value when created, so the deepest use can be found
+	for (i = 0; i < SB_DIAGNOSTICS_NUM_TASKS; ++i) {
+		if (DIAG.tasks[i] != NULL) {
+			Task_stat(DIAG.tasks[i], &stat);
+
+			snapshot->stackUsed[i] = stat.used;
+			snapshot->stackSize[i] = stat.stackSize;
+		}
+	}
+}
+
+static void fillI2C(SB_DiagnosticsSnapshot *snapshot) {
+	SB_i2cStats stats;
+
+	SB_i2cGetStats(&stats);
+
+	snapshot->i2cTransactions = stats.transactions;
+	snapshot->i2cFailures = stats.failures;
+	snapshot->i2cDepth = stats.depth;
+	snapshot->i2cMaxDepth = stats.maxDepth;
+	snapshot->i2cMaxLatencyMs = stats.maxLatencyMs;
+	memcpy(snapshot->i2cLatency, stats.latency, sizeof(snapshot->i2cLatency));
+}
+
+static void fillPeripherals(SB_DiagnosticsSnapshot *snapshot) {
+	SB_PeripheralState states[SB_PERIPHERAL_NUM_DEVICES];
+	uint8_t i, slot;
+
+	SB_peripheralGetStates(states);
+
+	for (i = 0; i < SB_PERIPHERAL_NUM_DEVICES; ++i) {
+		// The humidity sensor and IO expander follow the padded temperature slots
+		slot = (i < SB_NUM_MCP9808_SENSORS) ? i : i - SB_NUM_MCP9808_SENSORS + SB_DIAGNOSTICS_TEMPERATURE_SLOTS;
+
+		snapshot->peripheralState[slot] = states[i].currentState;
+		snapshot->peripheralLastError[slot] = states[i].lastError;
+		snapshot->peripheralErrors[slot] = states[i].errors;
+	}
+}
+
+static void fillFSM(SB_DiagnosticsSnapshot *snapshot) {
+	uint32_t residencyMs[SB_NUM_STATES];
+	SB_FsmCallbackStats callbacks;
+	uint8_t i;
+
+	SB_fsmGetResidency(residencyMs);
+
+	snapshot->fsmState = SB_currentState();
+	for (i = 0; i < SB_NUM_STATES; ++i) {
+		snapshot->fsmResidencyS[i] = residencyMs[i] / 1000;
+	}
+
+	SB_fsmGetTraceSummary(&snapshot->fsmTrace);
+
+	SB_fsmGetCallbackStats(&callbacks);
+
+	snapshot->fsmCallbacksRejected = callbacks.registrationsRejected;
+	snapshot->fsmMaxDispatchTime = callbacks.maxDispatchTime;
+}
+
+static void fillLogs(SB_DiagnosticsSnapshot *snapshot) {
+	snapshot->sampleLogFill = logFill(&SB_sampleLog);
+	snapshot->minuteLogFill = logFill(&SB_minuteRollupLog);
+	snapshot->hourLogFill = logFill(&SB_hourRollupLog);
+
+	snapshot->sampleRecordsWritten = SB_sampleLog.stats.recordsWritten;
+	snapshot->tornRecords = SB_sampleLog.stats.tornRecords
+			+ SB_minuteRollupLog.stats.tornRecords
+			+ SB_hourRollupLog.stats.tornRecords;
+}
+
+static void fillBLE(SB_DiagnosticsSnapshot *snapshot) {
+	SB_AttRspStats attRsp;
+	SB_LiveStreamStats liveStream;
+	uint8_t i;
+
+	SB_bleGetAttRspStats(&attRsp);
+
+	snapshot->attRspQueued = attRsp.queued;
+	snapshot->attRspRetries = attRsp.retries;
+	snapshot->attRspDrops = attRsp.drops;
+	snapshot->attRspMaxDepth = attRsp.maxDepth;
+
+	SB_liveStreamGetStats(&liveStream);
+
+	snapshot->liveStreamRetries = liveStream.sendRetries;
+	snapshot->liveStreamDrops = liveStream.samplesDropped;
+	snapshot->liveStreamMaxLatencyMs = liveStream.maxLatencyMs;
+
+	for (i = 0; i < SB_DIAGNOSTICS_LINKS; ++i) {
+		snapshot->linkConnHandle[i] = SB_liveStreamGetLinkStats(i, &liveStream);
+		snapshot->linkMtu[i] = liveStream.mtu;
+		snapshot->linkBytesSent[i] = liveStream.bytesSent;
+		snapshot->linkConnectedMs[i] = liveStream.connectedMs;
+	}
+}
+
+static void fillRadio(SB_DiagnosticsSnapshot *snapshot) {
+	SB_AdvScheduleStats adv;
+	SB_ConnPolicyStats conn;
+	uint8_t i;
+
+	SB_advScheduleGetStats(&adv);
+
+	snapshot->advPhase = adv.phase;
+	snapshot->advertising = adv.advertising;
+	snapshot->advAirTimeMs = adv.airTimeMs;
+	memcpy(snapshot->advMsInPhase, adv.msInPhase, sizeof(snapshot->advMsInPhase));
+	snapshot->advRestarts = adv.restarts;
+	snapshot->advFastTriggers = adv.fastTriggers;
+
+	SB_connPolicyGetStats(&conn);
+
+	snapshot->connMode = conn.mode;
+	snapshot->connInterval = conn.connInterval;
+	snapshot->connLatency = conn.connLatency;
+	memcpy(snapshot->connMsInMode, conn.msInMode, sizeof(snapshot->connMsInMode));
+	for (i = 0; i < SB_CONN_MODE_COUNT; ++i) {
+		snapshot->connRequests += conn.requests[i];
+	}
+	snapshot->connRequestFailures = conn.requestFailures;
+	snapshot->connUpdates = conn.updates;
+	snapshot->connAccepted = conn.accepted;
+}
+
+static void fillReporting(SB_DiagnosticsSnapshot *snapshot) {
+	SB_ReportPolicyStats report;
+	uint8_t i;
+
+	SB_reportPolicyGetStats(&report);
+
+	for (i = 0; i < SB_REPORT_NUM_POLICIES; ++i) {
+		snapshot->reportSent += report.sent[i];
+		snapshot->reportSuppressed += report.suppressed[i];
+		snapshot->reportAlerts += report.alerts[i];
+	}
+	snapshot->reportRejected = report.rejected;
+}
+
+static void fillSettings(SB_DiagnosticsSnapshot *snapshot) {
+	SB_SettingsStats settings;
+	SB_SystemTimeStats time;
+
+	SB_settingsGetStats(&settings);
+
+	snapshot->settingsLoadedFromNV = settings.loadedFromNV;
+	snapshot->settingsWrites = settings.writes;
+	snapshot->settingsWriteFailures = settings.writeFailures;
+	snapshot->settingsMaxWriteTicks = settings.maxWriteTicks;
+
+	SB_systemTimeGetStats(&time);
+
+	snapshot->timeSet = time.set;
+	snapshot->timeSyncs = time.syncs;
+	snapshot->timeDriftPpb = time.driftPpb;
+	snapshot->timeLastOffsetMs = time.lastOffsetMs;
+}
+
+/**
+ * \brief How full a log is, in thousandths of its capacity. Logs not yet opened read as empty.
+ */
+static uint16_t logFill(SB_FlashLog *log) {
+	uint32_t capacity = (uint32_t)log->numSectors * FLASHLOG_SECTOR_SIZE;
+
+	if (capacity == 0) {
+		return 0;
+	}
+
+	return (SB_flashLogUsedBytes(log) * 1000) / capacity;
+}
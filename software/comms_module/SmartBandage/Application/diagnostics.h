@@ -0,0 +1,150 @@
+/*
+ * @file diagnostics.h
+ * @brief A snapshot of the runtime counters of the firmware, read by the phone in one ATT read.
+ *
+ * The BLE task refreshes the snapshot every SBP_PERIODIC_EVT_PERIOD while connected and
+ * publishes it as the Diagnostics characteristic, which is notified to subscribed clients.
+ * With an ATT MTU larger than SB_BLE_DIAGNOSTICS_LEN the snapshot is read whole; otherwise
+ * the client reads the rest with Read Blob requests, which the largest MTU always needs. The sequence number is repeated as the
+ * last byte, so a refresh between those reads can be detected and the read repeated.
+ *
+ * The snapshot is SB_DiagnosticsSnapshot, packed and little endian. Fields are only appended,
+ * and SB_DIAGNOSTICS_FORMAT changes if the meaning of one changes.
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef APPLICATION_DIAGNOSTICS_H_
+#define APPLICATION_DIAGNOSTICS_H_
+
+#include <ti/sysbios/knl/Task.h>
+
+#include "Board.h"
+#include "fsm.h"
+#include "i2c.h"
+#include "advSchedule.h"
+#include "connPolicy.h"
+
+#define SB_DIAGNOSTICS_FORMAT				3
+
+typedef enum {
+	SB_DIAGNOSTICS_TASK_BLE,
+	SB_DIAGNOSTICS_TASK_PMGR,
+	SB_DIAGNOSTICS_TASK_I2C,
+	SB_DIAGNOSTICS_TASK_FSM,
+
+	SB_DIAGNOSTICS_NUM_TASKS
+} SB_DiagnosticsTask;
+
+// Peripheral slots: the temperature sensors, padded to four, then the humidity sensor and IO expander
+#define SB_DIAGNOSTICS_TEMPERATURE_SLOTS	4
+#define SB_DIAGNOSTICS_NUM_PERIPHERALS		(SB_DIAGNOSTICS_TEMPERATURE_SLOTS + 2)
+
+// Live stream links reported, whatever the number of connections built for
+#define SB_DIAGNOSTICS_LINKS				2
+
+typedef struct __attribute__((packed)) {
+	uint8_t  sequence;					// Incremented by each refresh
+	uint8_t  format;					// SB_DIAGNOSTICS_FORMAT
+	uint32_t time;						// System time of the refresh
+
+	// ICall heap in bytes, zero unless built with HEAPMGR_METRICS
+	uint16_t heapSize;
+	uint16_t heapUsed;
+	uint16_t heapMaxUsed;
+
+	// Stack high-watermark and size of each task, in SB_DiagnosticsTask order
+	uint16_t stackUsed[SB_DIAGNOSTICS_NUM_TASKS];
+	uint16_t stackSize[SB_DIAGNOSTICS_NUM_TASKS];
+
+	// I2C queue, see SB_i2cStats
+	uint32_t i2cTransactions;
+	uint16_t i2cFailures;
+	uint8_t  i2cDepth;
+	uint8_t  i2cMaxDepth;
+	uint16_t i2cMaxLatencyMs;
+	uint16_t i2cLatency[SB_I2C_LATENCY_BUCKETS];
+
+	// Peripherals, in the slots above
+	uint8_t  peripheralState[SB_DIAGNOSTICS_NUM_PERIPHERALS];		// SB_PeripheralFunctionalState
+	uint8_t  peripheralLastError[SB_DIAGNOSTICS_NUM_PERIPHERALS];	// SB_Error
+	uint16_t peripheralErrors[SB_DIAGNOSTICS_NUM_PERIPHERALS];
+
+	// State machine
+	uint8_t  fsmState;
+	uint32_t fsmResidencyS[SB_NUM_STATES];
+
+	// Flash logs, filled to thousandths of their capacity
+	uint16_t sampleLogFill;
+	uint16_t minuteLogFill;
+	uint16_t hourLogFill;
+	uint32_t sampleRecordsWritten;
+	uint16_t tornRecords;				// Discarded on recovery, over all logs
+
+	// BLE, see SB_AttRspStats and SB_LiveStreamStats
+	uint32_t attRspQueued;
+	uint32_t attRspRetries;
+	uint32_t attRspDrops;
+	uint8_t  attRspMaxDepth;
+	uint32_t liveStreamRetries;
+	uint32_t liveStreamDrops;
+	uint32_t liveStreamMaxLatencyMs;
+
+	// Each live stream link since it connected, INVALID_CONNHANDLE when unused
+	uint16_t linkConnHandle[SB_DIAGNOSTICS_LINKS];
+	uint16_t linkMtu[SB_DIAGNOSTICS_LINKS];
+	uint32_t linkBytesSent[SB_DIAGNOSTICS_LINKS];
+	uint32_t linkConnectedMs[SB_DIAGNOSTICS_LINKS];
+
+	// State machine tracer, see SB_FsmTraceSummary
+	SB_FsmTraceSummary fsmTrace;
+
+	// Advertising, see SB_AdvScheduleStats
+	uint8_t  advPhase;					// SB_AdvPhase
+	uint8_t  advertising;
+	uint32_t advAirTimeMs;
+	uint32_t advMsInPhase[SB_ADV_NUM_PHASES];
+	uint16_t advRestarts;
+	uint16_t advFastTriggers;
+
+	// Connection parameters of the tracked link, see SB_ConnPolicyStats
+	uint8_t  connMode;					// SB_ConnMode
+	uint16_t connInterval;
+	uint16_t connLatency;
+	uint32_t connMsInMode[SB_CONN_MODE_COUNT];
+	uint16_t connRequests;				// Over all modes
+	uint16_t connRequestFailures;
+	uint16_t connUpdates;
+
+	// Report policy, see SB_ReportPolicyStats, summed over the sensors
+	uint32_t reportSent;
+	uint32_t reportSuppressed;
+	uint32_t reportAlerts;
+	uint16_t reportRejected;
+
+	// Settings in SNV, see SB_SettingsStats
+	uint8_t  settingsLoadedFromNV;
+	uint16_t settingsWrites;
+	uint16_t settingsWriteFailures;
+	uint32_t settingsMaxWriteTicks;
+
+	// System time, see SB_SystemTimeStats
+	uint8_t  timeSet;
+	uint16_t timeSyncs;
+	int32_t  timeDriftPpb;
+	int32_t  timeLastOffsetMs;
+
+	// State machine callbacks, see SB_FsmCallbackStats
+	uint16_t fsmCallbacksRejected;
+	uint32_t fsmMaxDispatchTime;
+
+	// Connection modes left to the central, see SB_ConnPolicyStats
+	uint16_t connAccepted;
+
+	uint8_t  sequenceEnd;				// Equal to sequence
+} SB_DiagnosticsSnapshot;
+
+void SB_diagnosticsRegisterTask(SB_DiagnosticsTask task, Task_Handle handle);
+void SB_diagnosticsRefresh();
+
+#endif /* APPLICATION_DIAGNOSTICS_H_ */
@@ -0,0 +1,549 @@
+/*
+ * flashLog.c
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#include <stddef.h>
+#include <string.h>
+
+#include <ti/sysbios/BIOS.h>
+#include <ti/sysbios/knl/Clock.h>
+#include <ti/sysbios/knl/Semaphore.h>
+#include <xdc/runtime/System.h>
+
+#include "util.h"
+#include "logCrypt.h"
+#include "flashLog.h"
+
+#define SECTOR_ADDR(log, sector) ((log)->base + (uint32_t)(sector) * FLASHLOG_SECTOR_SIZE)
+#define NEXT_SECTOR(log, sector) ((uint8_t)(((sector) + 1) % (log)->numSectors))
+
+// Scratch buffer used while scanning the head sector during recovery
+#define FLASHLOG_SCAN_CHUNK 64
+
+static uint8_t scanBuf[FLASHLOG_SCAN_CHUNK];
+
+SB_FlashLog SB_sampleLog;
+SB_FlashLog SB_minuteRollupLog;
+SB_FlashLog SB_hourRollupLog;
+
+// The external flash is shared by every log. It is only opened once, and one lock
+// serializes the logs of every task on it.
+static Semaphore_Handle flashLock = NULL;
+static bool flashOpen = false;
+
+static bool readSectorHeader(SB_FlashLog *log, uint8_t sector, SB_FlashLogSectorHeader *header);
+static bool sectorHeaderValid(const SB_FlashLogSectorHeader *header);
+static bool commitByte(uint32_t address);
+static SB_Error openNextSector(SB_FlashLog *log);
+static void recoverHeadSector(SB_FlashLog *log, uint32_t firstRecordSeq);
+static bool tailIsErased(SB_FlashLog *log, uint16_t offset);
+static bool payloadCrcValid(uint32_t address, const SB_FlashLogRecordHeader *record);
+
+/**
+ * \brief Finds the head and tail of the log and the write position in the head sector.
+ * \remark Reads every sector header and only the records of the newest sector.
+ */
+SB_Error SB_flashLogInit(SB_FlashLog *log, uint32_t base, uint8_t numSectors, bool encrypted) {
+	SB_FlashLogSectorHeader header;
+	uint32_t headFirstRecordSeq = 0;
+	uint32_t start;
+	uint8_t i;
+	SB_Error result;
+
+	if (log == NULL || numSectors < 2) {
+		return InvalidParameter;
+	}
+
+	memset(log, 0, sizeof(SB_FlashLog));
+	log->base = base;
+	log->numSectors = numSectors;
+	log->empty = true;
+	log->encrypted = encrypted;
+	log->tailSectorSeq = 0xFFFFFFFF;
+
+	// Initialize flash semaphore with 1 free resource (use as mutex), once for every log
+	if (flashLock == NULL && NULL == (flashLock = Semaphore_create(1, NULL, NULL))) {
+		return OSResourceInitializationError;
+	}
+
+	// Never fall back to storing an encrypted log in the clear
+	if (encrypted && NoError != (result = SB_logCryptWaitKey(SB_LOGCRYPT_KEY_TIMEOUT))) {
+		return result;
+	}
+
+	if (!Semaphore_pend(flashLock, BIOS_WAIT_FOREVER)) {
+		return SemaphorePendTimeout;
+	}
+
+	if (!flashOpen && !(flashOpen = extFlashOpen())) {
+#ifdef SB_DEBUG
+		System_printf("FLOG: External flash not responding\n");
+		System_flush();
+#endif
+		Semaphore_post(flashLock);
+		return FlashIOError;
+	}
+
+	start = Clock_getTicks();
+
+	// Pass 1: sector headers only
+	for (i = 0; i < numSectors; ++i) {
+		if (!readSectorHeader(log, i, &header)) {
+			Semaphore_post(flashLock);
+			return FlashIOError;
+		}
+
+		++log->stats.headersRead;
+
+		if (!sectorHeaderValid(&header)) {
+			continue;
+		}
+
+		if (log->empty || header.sectorSeq > log->headSectorSeq) {
+			log->headSector = i;
+			log->headSectorSeq = header.sectorSeq;
+			log->headKeyEpoch = header.keyEpoch;
+			headFirstRecordSeq = header.firstRecordSeq;
+		}
+
+		if (header.sectorSeq < log->tailSectorSeq) {
+			log->tailSector = i;
+			log->tailSectorSeq = header.sectorSeq;
+			log->tailFirstRecordSeq = header.firstRecordSeq;
+			log->tailKeyEpoch = header.keyEpoch;
+		}
+
+		log->empty = false;
+	}
+
+	// Pass 2: the records of the newest sector
+	if (!log->empty) {
+		recoverHeadSector(log, headFirstRecordSeq);
+	}
+
+	log->stats.recoveryTicks = Clock_getTicks() - start;
+
+	Semaphore_post(flashLock);
+
+#ifdef SB_DEBUG
+	System_printf("FLOG: Recovered head %d:%d, next record %d, %d torn\n",
+			log->headSector, log->headOffset, log->nextRecordSeq, log->stats.tornRecords);
+	System_flush();
+#endif
+
+	return NoError;
+}
+
+/**
+ * \brief Appends a record. The record is only visible to recovery once its commit byte is programmed.
+ */
+SB_Error SB_flashLogAppend(SB_FlashLog *log, const uint8_t *data, uint8_t length) {
+	SB_FlashLogRecordHeader header;
+	SB_Error result = NoError;
+	uint32_t address;
+	bool written;
+
+	if (log == NULL || data == NULL || length == 0 || length > FLASHLOG_MAX_RECORD_LEN) {
+		return InvalidParameter;
+	}
+
+	if (!Semaphore_pend(flashLock, BIOS_WAIT_FOREVER)) {
+		return SemaphorePendTimeout;
+	}
+
+	// Records never straddle sectors
+	if (log->empty || log->headOffset + sizeof(SB_FlashLogRecordHeader) + length > FLASHLOG_SECTOR_SIZE) {
+		if (NoError != (result = openNextSector(log))) {
+			Semaphore_post(flashLock);
+			return result;
+		}
+	}
+
+	header.length = length;
+	header.commit = FLASHLOG_ERASED_BYTE;
+
+	address = SECTOR_ADDR(log, log->headSector) + log->headOffset;
+
+	// The payload goes in first so that the header CRC can cover the ciphertext.
+	// Recovery treats a programmed payload behind an erased header as torn.
+	if (log->encrypted) {
+		header.crc = 0xFFFF;
+		written = (NoError == SB_logCryptWrite(address + sizeof(header), data, length,
+				log->headKeyEpoch, log->headSectorSeq, &header.crc));
+	} else {
+		header.crc = Util_crc16(0xFFFF, data, length);
+		written = extFlashWrite(address + sizeof(header), length, data);
+	}
+
+	if (!written
+			|| !extFlashWrite(address, sizeof(header), (const uint8_t*)&header)
+			|| !commitByte(address + offsetof(SB_FlashLogRecordHeader, commit))) {
+		// Whatever was programmed is torn. Don't write after it.
+		log->headOffset = FLASHLOG_SECTOR_SIZE;
+		Semaphore_post(flashLock);
+		return FlashIOError;
+	}
+
+	log->headOffset += sizeof(header) + length;
+	++log->nextRecordSeq;
+	++log->stats.recordsWritten;
+
+	Semaphore_post(flashLock);
+
+	return NoError;
+}
+
+/**
+ * \brief Positions the cursor on the record with the given sequence number, or on the oldest record
+ * 			still in the log if that record has been overwritten.
+ */
+SB_Error SB_flashLogSeek(SB_FlashLog *log, SB_FlashLogCursor *cursor, uint32_t recordSeq) {
+	SB_FlashLogSectorHeader header;
+	SB_FlashLogRecordHeader record;
+	uint8_t sector;
+	SB_Error result = NoError;
+
+	if (log == NULL || cursor == NULL) {
+		return InvalidParameter;
+	}
+
+	if (!Semaphore_pend(flashLock, BIOS_WAIT_FOREVER)) {
+		return SemaphorePendTimeout;
+	}
+
+	if (log->empty) {
+		Semaphore_post(flashLock);
+		return NoDataAvailable;
+	}
+
+	// Find the last sector starting at or before recordSeq
+	sector = log->tailSector;
+	if (!readSectorHeader(log, sector, &header)) {
+		Semaphore_post(flashLock);
+		return FlashIOError;
+	}
+
+	cursor->sector = sector;
+	cursor->sectorSeq = header.sectorSeq;
+	cursor->keyEpoch = header.keyEpoch;
+	cursor->recordSeq = header.firstRecordSeq;
+
+	while (sector != log->headSector) {
+		sector = NEXT_SECTOR(log, sector);
+
+		if (!readSectorHeader(log, sector, &header)) {
+			Semaphore_post(flashLock);
+			return FlashIOError;
+		}
+
+		if (!sectorHeaderValid(&header) || header.firstRecordSeq > recordSeq) {
+			break;
+		}
+
+		cursor->sector = sector;
+		cursor->sectorSeq = header.sectorSeq;
+		cursor->keyEpoch = header.keyEpoch;
+		cursor->recordSeq = header.firstRecordSeq;
+	}
+
+	cursor->offset = sizeof(SB_FlashLogSectorHeader);
+
+	// Walk the records of that sector
+	while (cursor->recordSeq < recordSeq) {
+		if (cursor->sector == log->headSector && cursor->offset >= log->headOffset) {
+			break;
+		}
+
+		if (!extFlashRead(SECTOR_ADDR(log, cursor->sector) + cursor->offset, sizeof(record), (uint8_t*)&record)) {
+			result = FlashIOError;
+			break;
+		}
+
+		if (record.length == FLASHLOG_ERASED_BYTE || record.commit != FLASHLOG_COMMITTED) {
+			break;
+		}
+
+		cursor->offset += sizeof(record) + record.length;
+		++cursor->recordSeq;
+	}
+
+	Semaphore_post(flashLock);
+
+	return result;
+}
+
+/**
+ * \brief Reads the record at the cursor and advances it.
+ * \return NoDataAvailable when the cursor has reached the head of the log.
+ */
+SB_Error SB_flashLogRead(SB_FlashLog *log, SB_FlashLogCursor *cursor, uint8_t *buf, uint8_t maxLength, uint8_t *length) {
+	SB_FlashLogSectorHeader header;
+	SB_FlashLogRecordHeader record;
+	uint32_t address;
+
+	if (log == NULL || cursor == NULL || buf == NULL || length == NULL) {
+		return InvalidParameter;
+	}
+
+	if (!Semaphore_pend(flashLock, BIOS_WAIT_FOREVER)) {
+		return SemaphorePendTimeout;
+	}
+
+	// The sector under the cursor has been overwritten; continue from the oldest record
+	if (!log->empty && cursor->recordSeq < log->tailFirstRecordSeq) {
+		cursor->sector = log->tailSector;
+		cursor->offset = sizeof(SB_FlashLogSectorHeader);
+		cursor->sectorSeq = log->tailSectorSeq;
+		cursor->keyEpoch = log->tailKeyEpoch;
+		cursor->recordSeq = log->tailFirstRecordSeq;
+	}
+
+	while (1) {
+		if (log->empty || (cursor->sector == log->headSector && cursor->offset >= log->headOffset)) {
+			Semaphore_post(flashLock);
+			return NoDataAvailable;
+		}
+
+		address = SECTOR_ADDR(log, cursor->sector) + cursor->offset;
+		record.length = FLASHLOG_ERASED_BYTE;
+
+		if (cursor->offset + sizeof(record) <= FLASHLOG_SECTOR_SIZE
+				&& !extFlashRead(address, sizeof(record), (uint8_t*)&record)) {
+			Semaphore_post(flashLock);
+			return FlashIOError;
+		}
+
+		if (record.length != FLASHLOG_ERASED_BYTE && record.commit == FLASHLOG_COMMITTED) {
+			break;
+		}
+
+		// End of this sector (or a torn record, which only ever ends a sector)
+		if (cursor->sector == log->headSector) {
+			Semaphore_post(flashLock);
+			return NoDataAvailable;
+		}
+
+		cursor->sector = NEXT_SECTOR(log, cursor->sector);
+		cursor->offset = sizeof(SB_FlashLogSectorHeader);
+
+		if (!readSectorHeader(log, cursor->sector, &header)) {
+			Semaphore_post(flashLock);
+			return FlashIOError;
+		}
+
+		cursor->sectorSeq = header.sectorSeq;
+		cursor->keyEpoch = header.keyEpoch;
+		cursor->recordSeq = header.firstRecordSeq;
+	}
+
+	if (record.length > maxLength) {
+		Semaphore_post(flashLock);
+		return InvalidParameter;
+	}
+
+	if (!extFlashRead(address + sizeof(record), record.length, buf)) {
+		Semaphore_post(flashLock);
+		return FlashIOError;
+	}
+
+	Semaphore_post(flashLock);
+
+	*length = record.length;
+	cursor->offset += sizeof(record) + record.length;
+	++cursor->recordSeq;
+
+	if (record.crc != Util_crc16(0xFFFF, buf, record.length)) {
+		// Skip it, but let the caller know this record is bad
+		return FlashIOError;
+	}
+
+	if (log->encrypted) {
+		return SB_logCryptApply(address + sizeof(record), buf, record.length, cursor->keyEpoch, cursor->sectorSeq);
+	}
+
+	return NoError;
+}
+
+/**
+ * \brief Number of bytes between the oldest record and the head of the log.
+ */
+uint32_t SB_flashLogUsedBytes(SB_FlashLog *log) {
+	uint8_t fullSectors;
+
+	if (log->empty) {
+		return 0;
+	}
+
+	fullSectors = (log->headSector + log->numSectors - log->tailSector) % log->numSectors;
+
+	return (uint32_t)fullSectors * FLASHLOG_SECTOR_SIZE + log->headOffset;
+}
+
+static bool readSectorHeader(SB_FlashLog *log, uint8_t sector, SB_FlashLogSectorHeader *header) {
+	return extFlashRead(SECTOR_ADDR(log, sector), sizeof(SB_FlashLogSectorHeader), (uint8_t*)header);
+}
+
+static bool sectorHeaderValid(const SB_FlashLogSectorHeader *header) {
+	return header->magic == FLASHLOG_SECTOR_MAGIC && header->commit == FLASHLOG_COMMITTED;
+}
+
+static bool commitByte(uint32_t address) {
+	const uint8_t committed = FLASHLOG_COMMITTED;
+
+	return extFlashWrite(address, sizeof(committed), &committed);
+}
+
+/**
+ * \brief Erases and opens the sector after the head, dropping the oldest sector if the log is full.
+ * \remark Caller must hold flashLock.
+ */
+static SB_Error openNextSector(SB_FlashLog *log) {
+	SB_FlashLogSectorHeader header;
+	uint8_t sector = log->empty ? 0 : NEXT_SECTOR(log, log->headSector);
+	uint32_t address = SECTOR_ADDR(log, sector);
+
+	if (!log->empty && sector == log->tailSector) {
+		log->tailSector = NEXT_SECTOR(log, log->tailSector);
+
+		if (!readSectorHeader(log, log->tailSector, &header)) {
+			return FlashIOError;
+		}
+		log->tailSectorSeq = header.sectorSeq;
+		log->tailFirstRecordSeq = header.firstRecordSeq;
+		log->tailKeyEpoch = header.keyEpoch;
+	}
+
+	// A sector is always erased before being opened so that torn erases and
+	// torn headers from before a power loss never leak into the new sector.
+	if (!extFlashErase(address, FLASHLOG_SECTOR_SIZE)) {
+		return FlashIOError;
+	}
+	++log->stats.sectorsErased;
+
+	header.magic = FLASHLOG_SECTOR_MAGIC;
+	// Starts over when the log recovered empty. The key epoch keeps the nonce fresh.
+	header.sectorSeq = log->empty ? 1 : log->headSectorSeq + 1;
+	header.firstRecordSeq = log->nextRecordSeq;
+	header.keyEpoch = SB_logCryptGetEpoch();
+	memset(header.reserved, FLASHLOG_ERASED_BYTE, sizeof(header.reserved));
+	header.commit = FLASHLOG_ERASED_BYTE;
+
+	if (!extFlashWrite(address, sizeof(header), (const uint8_t*)&header)
+			|| !commitByte(address + offsetof(SB_FlashLogSectorHeader, commit))) {
+		return FlashIOError;
+	}
+
+	if (log->empty) {
+		log->tailSector = sector;
+		log->tailSectorSeq = header.sectorSeq;
+		log->tailFirstRecordSeq = header.firstRecordSeq;
+		log->tailKeyEpoch = header.keyEpoch;
+		log->empty = false;
+	}
+
+	log->headSector = sector;
+	log->headSectorSeq = header.sectorSeq;
+	log->headKeyEpoch = header.keyEpoch;
+	log->headOffset = sizeof(header);
+
+	return NoError;
+}
+
+/**
+ * \brief Walks the records of the head sector to find the write position.
+ * 			The first uncommitted or corrupt record ends the sector: nothing is
+ * 			ever appended after it, so torn data is discarded the same way on
+ * 			every boot.
+ */
+static void recoverHeadSector(SB_FlashLog *log, uint32_t firstRecordSeq) {
+	SB_FlashLogRecordHeader record;
+	uint32_t sectorAddress = SECTOR_ADDR(log, log->headSector);
+	uint16_t offset = sizeof(SB_FlashLogSectorHeader);
+	bool sealed = false;
+
+	log->nextRecordSeq = firstRecordSeq;
+
+	while (offset + sizeof(record) <= FLASHLOG_SECTOR_SIZE) {
+		if (!extFlashRead(sectorAddress + offset, sizeof(record), (uint8_t*)&record)) {
+			sealed = true;
+			break;
+		}
+
+		if (record.length == FLASHLOG_ERASED_BYTE) {
+			// Clean end, provided nothing was half programmed after it
+			sealed = !tailIsErased(log, offset);
+			break;
+		}
+
+		++log->stats.recordsScanned;
+
+		if (record.length == 0
+				|| record.commit != FLASHLOG_COMMITTED
+				|| offset + sizeof(record) + record.length > FLASHLOG_SECTOR_SIZE
+				|| !payloadCrcValid(sectorAddress + offset + sizeof(record), &record)) {
+			++log->stats.tornRecords;
+			sealed = true;
+			break;
+		}
+
+		offset += sizeof(record) + record.length;
+		++log->nextRecordSeq;
+	}
+
+	// A sealed sector forces the next append to open a fresh sector
+	log->headOffset = sealed ? FLASHLOG_SECTOR_SIZE : offset;
+}
+
+/**
+ * \brief Checks a record payload against its CRC without buffering the whole payload.
+ */
+static bool payloadCrcValid(uint32_t address, const SB_FlashLogRecordHeader *record) {
+	uint16_t crc = 0xFFFF;
+	uint8_t remaining = record->length;
+	uint8_t len;
+
+	while (remaining > 0) {
+		len = (remaining > sizeof(scanBuf)) ? sizeof(scanBuf) : remaining;
+
+		if (!extFlashRead(address, len, scanBuf)) {
+			return false;
+		}
+
+		crc = Util_crc16(crc, scanBuf, len);
+		address += len;
+		remaining -= len;
+	}
+
+	return crc == record->crc;
+}
+
+/**
+ * \brief Verifies that the head sector is erased from offset to its end.
+ */
+static bool tailIsErased(SB_FlashLog *log, uint16_t offset) {
+	uint32_t address = SECTOR_ADDR(log, log->headSector);
+	uint16_t len, i;
+
+	while (offset < FLASHLOG_SECTOR_SIZE) {
+		len = FLASHLOG_SECTOR_SIZE - offset;
+		if (len > sizeof(scanBuf)) {
+			len = sizeof(scanBuf);
+		}
+
+		if (!extFlashRead(address + offset, len, scanBuf)) {
+			return false;
+		}
+
+		for (i = 0; i < len; ++i) {
+			if (scanBuf[i] != FLASHLOG_ERASED_BYTE) {
+				return false;
+			}
+		}
+
+		offset += len;
+	}
+
+	return true;
+}
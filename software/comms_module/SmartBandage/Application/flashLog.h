@@ -0,0 +1,123 @@
+/*
+ * @file flashLog.h
+ * @brief Append-only record log in external flash with crash-consistent recovery.
+ *
+ * Layout: each log owns a contiguous run of erase sectors. Every sector starts
+ * with a header whose commit byte is programmed last; every record carries a
+ * length, a CRC and a commit byte that is also programmed last. Record payloads
+ * are programmed before their header and may be encrypted. Recovery reads
+ * only the sector headers plus the records of the newest sector, so boot time is
+ * bounded by the number of sectors and not the amount of data logged.
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef APPLICATION_FLASHLOG_H_
+#define APPLICATION_FLASHLOG_H_
+
+#include "Board.h"
+#include "../Board/Devices/ext_flash.h"
+#include "../PROFILES/ext_flash_layout.h"
+
+/*****************************************************************
+ * Layout Configuration
+ ****************************************************************/
+#define FLASHLOG_SECTOR_SIZE			EXT_FLASH_PAGE_SIZE
+
+// The unreserved user region of the external flash is split between the raw
+// sample log and the rollup logs.
+#define FLASHLOG_SAMPLES_BASE			EFL_ADDR_USER
+#define FLASHLOG_SAMPLES_NUM_SECTORS	16
+
+// Per-minute rollups: about 22 hours at one record per minute
+#define FLASHLOG_MINUTES_BASE			(FLASHLOG_SAMPLES_BASE + FLASHLOG_SAMPLES_NUM_SECTORS * FLASHLOG_SECTOR_SIZE)
+#define FLASHLOG_MINUTES_NUM_SECTORS	14
+
+// Per-hour rollups: about 8 days at one record per hour
+#define FLASHLOG_HOURS_BASE				(FLASHLOG_MINUTES_BASE + FLASHLOG_MINUTES_NUM_SECTORS * FLASHLOG_SECTOR_SIZE)
+#define FLASHLOG_HOURS_NUM_SECTORS		2
+
+#if (FLASHLOG_HOURS_BASE + FLASHLOG_HOURS_NUM_SECTORS * FLASHLOG_SECTOR_SIZE) > (EFL_ADDR_USER + EFL_SIZE_USER)
+#error "Flash log partitions exceed the user region of the external flash"
+#endif
+
+#define FLASHLOG_MAX_RECORD_LEN			250
+
+// Encrypt the payloads of every application log at rest
+#define FLASHLOG_ENCRYPT_AT_REST		true
+
+/*****************************************************************
+ * On-flash Format
+ ****************************************************************/
+#define FLASHLOG_SECTOR_MAGIC			0x53424C47 // "SBLG"
+#define FLASHLOG_COMMITTED				0x00
+#define FLASHLOG_ERASED_BYTE			0xFF
+
+typedef struct {
+	uint32_t magic;
+	uint32_t sectorSeq;			// Increments each time a sector is opened
+	uint32_t firstRecordSeq;	// Sequence number of the first record in this sector
+	uint32_t keyEpoch;			// Key epoch when the sector was opened, part of the encryption nonce
+	uint8_t  reserved[3];
+	uint8_t  commit;			// Programmed to FLASHLOG_COMMITTED last
+} SB_FlashLogSectorHeader;
+
+typedef struct {
+	uint8_t  length;			// Payload length. FLASHLOG_ERASED_BYTE marks the end of the sector
+	uint8_t  commit;			// Programmed to FLASHLOG_COMMITTED after the payload
+	uint16_t crc;				// CRC16 over the payload as stored
+} SB_FlashLogRecordHeader;
+
+/*****************************************************************
+ * Runtime State
+ ****************************************************************/
+typedef struct {
+	uint32_t recoveryTicks;		// Duration of the last recovery
+	uint16_t headersRead;		// Sector headers read during the last recovery
+	uint16_t recordsScanned;	// Records of the newest sector walked during the last recovery
+	uint16_t tornRecords;		// Uncommitted or corrupt records discarded
+	uint16_t sectorsErased;
+	uint32_t recordsWritten;
+} SB_FlashLogStats;
+
+typedef struct {
+	uint32_t base;				// Flash offset of the first sector
+	uint8_t  numSectors;
+
+	uint8_t  headSector;		// Sector being appended to
+	uint8_t  tailSector;		// Oldest valid sector
+	uint32_t tailSectorSeq;
+	uint32_t tailFirstRecordSeq;// Sequence number of the oldest record
+	uint32_t tailKeyEpoch;
+	uint16_t headOffset;		// Next free byte within the head sector
+	uint32_t headSectorSeq;
+	uint32_t headKeyEpoch;
+	uint32_t nextRecordSeq;
+	bool	 empty;				// No sector has been opened yet
+	bool	 encrypted;			// Payloads are encrypted with the bandage's log key
+
+	SB_FlashLogStats stats;
+} SB_FlashLog;
+
+typedef struct {
+	uint8_t  sector;
+	uint16_t offset;
+	uint32_t sectorSeq;			// Sequence number of the sector under the cursor
+	uint32_t keyEpoch;			// Key epoch of the sector under the cursor
+	uint32_t recordSeq;			// Sequence number of the record at the cursor
+} SB_FlashLogCursor;
+
+// Log of raw sensor samples, written by the peripheral manager
+extern SB_FlashLog SB_sampleLog;
+
+// Logs of closed rollup windows, written by the rollup module
+extern SB_FlashLog SB_minuteRollupLog;
+extern SB_FlashLog SB_hourRollupLog;
+
+SB_Error SB_flashLogInit(SB_FlashLog *log, uint32_t base, uint8_t numSectors, bool encrypted);
+SB_Error SB_flashLogAppend(SB_FlashLog *log, const uint8_t *data, uint8_t length);
+SB_Error SB_flashLogSeek(SB_FlashLog *log, SB_FlashLogCursor *cursor, uint32_t recordSeq);
+SB_Error SB_flashLogRead(SB_FlashLog *log, SB_FlashLogCursor *cursor, uint8_t *buf, uint8_t maxLength, uint8_t *length);
+uint32_t SB_flashLogUsedBytes(SB_FlashLog *log);
+
+#endif /* APPLICATION_FLASHLOG_H_ */
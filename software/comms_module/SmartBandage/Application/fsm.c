@@ -15,37 +15,127 @@ events:
     data change (alert)
     no bandage detected
     error occurs
+    check done (sample taken)
+    transmit done
  */
 
- #include "fsm.h"
+#include "fsm.h"
+#include "advSchedule.h"
+#include "peripheralManager.h"
+#include "settings.h"
+#include "diagnostics.h"
+#include "ble.h"
+#include "util.h"
+#include <ti/sysbios/BIOS.h>
 #include <ti/sysbios/knl/Task.h>
+#include <ti/sysbios/knl/Clock.h>
+#include <ti/sysbios/knl/Semaphore.h>
+#include <ti/sysbios/knl/Swi.h>
+#include <xdc/runtime/System.h>
+#include <xdc/runtime/Timestamp.h>
+#include <string.h>
 //function prototypes
-SB_State SB_checkTimerExpired(void);
-SB_State SB_bleTimerExpired(void);
-SB_State SB_noBandageDetected(void);
-SB_State SB_errorEvent(); //a more permanent error caught
-SB_State SB_dataChanged(void);
-SB_State SB_returnToSleep(void);
 void SB_setError(SB_Error);
+static void SB_accountResidency(void);
+static void SB_traceTransition(SB_State from, SB_State to);
+static void SB_callCallback(SB_State_Transition transition);
+static void SB_fsmTask(UArg a0, UArg a1);
+static bool SB_isPermanent(SB_Error error);
+static bool SB_isPermanentError(void);
+static void SB_enterRunning(void);
+static void SB_enterCheck(void);
+static void SB_enterTransmit(void);
+static void SB_exitTransmit(void);
+static void SB_armCheck(void);
+static bool SB_queueEvent(SB_Event event, uint32_t postedTicks);
+static void SB_fsmClockHandler(UArg event);
+static void SB_fsmHoldoffClockHandler(UArg arg);
+static void SB_recordLatency(SB_Event event, uint32_t postedTicks);
+
+// Entering a state is the transition of the same index
+typedef char SB_TransitionCheck[(NUM_TRANSITIONS == SB_NUM_STATES
+		&& (int)enterSleep == (int)S_SLEEP && (int)enterCheck == (int)S_CHECK
+		&& (int)enterTransmit == (int)S_TRANSMIT && (int)enterTempError == (int)S_ERROR_TEMP
+		&& (int)enterPermError == (int)S_ERROR_PERM && (int)enterInit == (int)S_INIT) ? 1 : -1];
+
+// Callbacks of each transition. Entries below count are never changed, so they are read
+// without locking.
+static transitionTable callbackTable[NUM_TRANSITIONS];
+static SB_FsmCallbackStats callbackStats;
 
-//EDITED HERE
-
-//void SB_registerStateTransitionCallback((void*), SB_State_Transition); // not sure if the (void *) is the correct way of prototyping for void(*function)(void)
-void SB_addCallback(SB_CallbackFunc* );
-transitionTable *callbackTable = NULL;
-UInt taskKey;
-
-//LUT TABLE
-//TODO: If we continue to run out of heap, implement this in a switch statement as with 5 events and 6 states this is 120bytes of memory
-//implemented a "do nothing" function for the events that are not relevent to a particular
-SB_State (*SB_stateTable [SB_NUM_STATES][SB_NUM_EVENTS]) (void) = {
-    {SB_checkTimerExpired, SB_bleTimerExpired, SB_returnToSleep, SB_noBandageDetected, SB_errorEvent }, //procedures for state sleep
-    {SB_checkTimerExpired, SB_bleTimerExpired, SB_dataChanged, SB_noBandageDetected, SB_errorEvent },//procedures for state check
-    {SB_returnToSleep, SB_bleTimerExpired, SB_returnToSleep, SB_noBandageDetected, SB_errorEvent}, //procedure for transmit
-    {SB_checkTimerExpired, SB_bleTimerExpired, SB_dataChanged, SB_noBandageDetected, SB_errorEvent}, //procedures for state error temp
-    {SB_returnToSleep, SB_bleTimerExpired, SB_returnToSleep, SB_returnToSleep, SB_errorEvent}, //procedures for state error perm
-    {SB_returnToSleep, SB_bleTimerExpired, SB_dataChanged, SB_noBandageDetected, SB_errorEvent} //procedures for initialize state
-};
+/*
+ * The transition table
+ *
+ * Each state has an entry and exit action, a super-state and a cell per event. A cell names the
+ * state taken on the event, or, if it has a guard which declines, the state taken instead.
+ * Cells marked SUPER are taken from the row of the super-state, which holds the transitions its
+ * states share. Entry and exit actions of a super-state run only when it is entered or left.
+ */
+typedef struct {
+	bool (*guard)(void);
+	uint8_t target;
+	uint8_t otherwise;
+} SB_Transition;
+
+typedef struct {
+	void (*entry)(void);
+	void (*exit)(void);
+	uint8_t parent;				// SB_SuperState
+	SB_Transition transitions[SB_NUM_EVENTS];
+} SB_StateDescriptor;
+
+typedef enum {
+	SB_SUPER_RUNNING,			// Sampling and sending normally
+
+	SB_NUM_SUPERSTATES,
+	SB_SUPER_NONE = SB_NUM_SUPERSTATES
+} SB_SuperState;
+
+#define SB_NO_TRANSITION	SB_NUM_STATES
+#define SB_INHERIT			(SB_NUM_STATES + 1)
+
+#define GO(state)						{ NULL, state, state }
+#define WHEN(guard, state, otherwise)	{ guard, state, otherwise }
+#define STAY							GO(SB_NO_TRANSITION)
+#define SUPER							GO(SB_INHERIT)
+
+#define SB_TO_ERROR						WHEN(SB_isPermanentError, S_ERROR_PERM, S_ERROR_TEMP)
+#define SB_TO_PERM_ERROR				WHEN(SB_isPermanentError, S_ERROR_PERM, SB_NO_TRANSITION)
+
+// A column per event, in SB_Event order
+#define SB_FSM_STATES(X) \
+/*	  State         Super-state       Entry             Exit             CHECK_TIMER  BLE_TIMER       DATA_CHANGE     NO_BANDAGE        ERROR             CHECK_DONE   TRANSMIT_DONE */ \
+	X(S_SLEEP,      SB_SUPER_RUNNING, SB_armCheck,      NULL,            GO(S_CHECK), SUPER,          SUPER,          SUPER,            SUPER,            STAY,        STAY) \
+	X(S_CHECK,      SB_SUPER_RUNNING, SB_enterCheck,    NULL,            STAY,        SUPER,          SUPER,          SUPER,            SUPER,            GO(S_SLEEP), STAY) \
+	X(S_TRANSMIT,   SB_SUPER_RUNNING, SB_enterTransmit, SB_exitTransmit, GO(S_CHECK), STAY,           STAY,           SUPER,            SUPER,            STAY,        GO(S_SLEEP)) \
+	X(S_ERROR_TEMP, SB_SUPER_NONE,    SB_armCheck,      NULL,            GO(S_CHECK), GO(S_TRANSMIT), GO(S_TRANSMIT), STAY,             SB_TO_PERM_ERROR, STAY,        STAY) \
+	X(S_ERROR_PERM, SB_SUPER_NONE,    NULL,             NULL,            STAY,        STAY,           STAY,           STAY,             STAY,             STAY,        STAY) \
+	X(S_INIT,       SB_SUPER_NONE,    NULL,             NULL,            GO(S_CHECK), GO(S_TRANSMIT), GO(S_TRANSMIT), GO(S_ERROR_TEMP), SB_TO_ERROR,      STAY,        STAY)
+
+#define SB_FSM_SUPERSTATES(X) \
+	X(SB_SUPER_RUNNING, SB_SUPER_NONE, SB_enterRunning, NULL, STAY,    GO(S_TRANSMIT), GO(S_TRANSMIT), GO(S_ERROR_TEMP), SB_TO_ERROR,      STAY,        STAY)
+
+#define SB_FSM_ROW(state, parent, entry, exit, checkTimer, bleTimer, dataChange, noBandage, error, checkDone, transmitDone) \
+	[state] = { entry, exit, parent, { checkTimer, bleTimer, dataChange, noBandage, error, checkDone, transmitDone } },
+#define SB_FSM_COUNT(state, parent, entry, exit, checkTimer, bleTimer, dataChange, noBandage, error, checkDone, transmitDone) \
+	+ 1
+#define SB_FSM_BIT(state, parent, entry, exit, checkTimer, bleTimer, dataChange, noBandage, error, checkDone, transmitDone) \
+	| (1 << (state))
+
+static const SB_StateDescriptor SB_states[SB_NUM_STATES] = { SB_FSM_STATES(SB_FSM_ROW) };
+static const SB_StateDescriptor SB_superStates[SB_NUM_SUPERSTATES] = { SB_FSM_SUPERSTATES(SB_FSM_ROW) };
+
+// Every state and super-state has exactly one row, and every row a cell per event
+typedef char SB_FsmColumnCheck[(SB_NUM_EVENTS == 7) ? 1 : -1];
+typedef char SB_FsmRowCheck[(0 SB_FSM_STATES(SB_FSM_COUNT) == SB_NUM_STATES
+		&& (0 SB_FSM_STATES(SB_FSM_BIT)) == (1 << SB_NUM_STATES) - 1) ? 1 : -1];
+typedef char SB_FsmSuperRowCheck[(0 SB_FSM_SUPERSTATES(SB_FSM_COUNT) == SB_NUM_SUPERSTATES
+		&& (0 SB_FSM_SUPERSTATES(SB_FSM_BIT)) == (1 << SB_NUM_SUPERSTATES) - 1) ? 1 : -1];
+
+// Queued events are also held as a bit each, to find those already waiting
+typedef char SB_FsmEventMaskCheck[(SB_NUM_EVENTS <= 8 && SB_FSM_EVENT_QUEUE_LEN >= SB_NUM_EVENTS) ? 1 : -1];
+
+#define SB_TICKS_TO_US(ticks) ((ticks) * (1000000 / NTICKS_PER_SECOND))
 
 //local variables
 SB_SystemState systemState = {
@@ -55,99 +145,447 @@ SB_SystemState systemState = {
 	.lastError    = NoError,
 	};
 
-//EDITED HERE
-//switch the states
-
-/* ASSUMPTIONS:
- *  - the tasks will have been previously created, and in the function SB_switchState we are using the tasks, but not creating any new ones
- *
- *
- *
+struct {
+	Task_Handle taskHandle;
+	Task_Struct task;
+	Char taskStack[FSM_TASK_STACK_SIZE];
+
+	Semaphore_Handle eventSem;
+	Clock_Struct checkClock;
+	Clock_Struct bleClock;
+	Clock_Struct holdoffClock;
+
+	// Events waiting, in the order first posted
+	uint8_t queue[SB_FSM_EVENT_QUEUE_LEN];
+	uint32_t postedTicks[SB_FSM_EVENT_QUEUE_LEN];
+	uint8_t queueStart;
+	uint8_t queueCount;
+	uint8_t queued;				// A bit per SB_Event in the queue
+
+	bool dataChangeHeld;		// E_DATA_CHANGE posted during the holdoff
+	uint32_t dataChangeHeldTicks;
+
+	uint32_t handlingPostedTicks;	// First post of the event being handled
+
+	bool alertPending;			// S_TRANSMIT entered on E_DATA_CHANGE, and not left since
+	uint32_t alertPostedTicks;
+
+	SB_FsmEventStats stats;
+} FSM;
+
+// Tracer of the state changes, for estimating battery life. Residency is brought up to date
+// when the state changes or is read.
+typedef char SB_TraceLenCheck[((SB_FSM_TRACE_LEN & (SB_FSM_TRACE_LEN - 1)) == 0) ? 1 : -1];
+
+struct {
+	uint64_t residencyTicks[SB_NUM_STATES];
+	uint32_t enteredTicks;
+	uint32_t transitions[SB_NUM_STATES][SB_NUM_STATES];
+	SB_FsmTraceEntry recent[SB_FSM_TRACE_LEN];
+	uint32_t taken;				// Transitions since boot; the next entry of recent is taken % SB_FSM_TRACE_LEN
+} TRACE;
+
+/**
+ * \brief Takes the transition to a new state: the exit action of the current state, then those
+ * 			of the super-states left and entered, then the entry action of the new state and the
+ * 			callbacks registered for the transition. Invalid states are taken as S_ERROR_PERM.
+ * \remark Must only be called from the state machine task.
  */
 SB_State SB_switchState(SB_State newState) {
-	switch (newState) {
-	case S_INIT:
+	SB_State oldState = systemState.currentState;
+	const SB_StateDescriptor *from, *to;
+	UInt key;
+
+	if (newState >= SB_NUM_STATES) {
+		newState = S_ERROR_PERM;
+	}
 
-	case S_SLEEP:
+	if (newState == oldState) {
+		return oldState;
+	}
 
-	case S_CHECK:
+	from = &SB_states[oldState];
+	to = &SB_states[newState];
 
-	case S_TRANSMIT:
-		SB_setError(NoError);
-		// No "break" on purpose
+	if (from->exit != NULL) {
+		from->exit();
+	}
 
-	case S_ERROR_TEMP:
+	if (from->parent != to->parent) {
+		if (from->parent != SB_SUPER_NONE && SB_superStates[from->parent].exit != NULL) {
+			SB_superStates[from->parent].exit();
+		}
 
-		systemState.currentState = newState;
-		break;
+		if (to->parent != SB_SUPER_NONE && SB_superStates[to->parent].entry != NULL) {
+			SB_superStates[to->parent].entry();
+		}
+	}
 
-	default:
+	key = Task_disable();
+	SB_traceTransition(oldState, newState);
+	systemState.lastState = oldState;
+	systemState.currentState = newState;
+	Task_restore(key);
 
-		systemState.currentState = S_ERROR_PERM;
+	if (to->entry != NULL) {
+		to->entry();
 	}
 
-	return systemState.currentState;
+	SB_callCallback((SB_State_Transition)newState);
+
+	return newState;
 }
 
-//action procedures here for now, also might want to put into another file later
-SB_State SB_checkTimerExpired(void){
-    //the timer expired, 
-	return SB_switchState(S_CHECK);
-    //check data from periperal sensors and store it into a register
-    
-    //reset the timer
-    
-    //check new data with previous data (if it exists), if it is outside expected range, send an alert, if not, return to sleep
+/**
+ * \brief Looks up the transition of the current state on an event and takes it.
+ * \remark Must only be called from the state machine task.
+ */
+SB_State SB_handleEvent(SB_Event event) {
+	const SB_Transition *transition;
+	uint8_t parent, target;
+
+	// State or event invalid. A permanent error is kept, and S_ERROR_PERM is not left.
+	if (systemState.currentState >= SB_NUM_STATES || event >= SB_NUM_EVENTS) {
+		if (systemState.currentState == S_ERROR_PERM) {
+			return S_ERROR_PERM;
+		}
+
+		if (!SB_isPermanentError()) {
+			SB_setError(InvalidParameter);
+		}
+		return SB_switchState(SB_isPermanentError() ? S_ERROR_PERM : S_ERROR_TEMP);
+	}
+
+	systemState.lastEvent = event;
+
+	// Alerts are advertised fast, whatever the state
+	if (event == E_DATA_CHANGE) {
+		SB_advScheduleAlert();
+	}
+
+	transition = &SB_states[systemState.currentState].transitions[event];
+
+	parent = SB_states[systemState.currentState].parent;
+	if (transition->target == SB_INHERIT && parent != SB_SUPER_NONE) {
+		transition = &SB_superStates[parent].transitions[event];
+	}
+
+	target = (transition->guard == NULL || transition->guard()) ? transition->target : transition->otherwise;
+
+	// Stay in the current state
+	if (target >= SB_NUM_STATES) {
+		return systemState.currentState;
+	}
+
+	return SB_switchState((SB_State)target);
+}
+
+/**
+ * \brief Queues an event for the state machine task. An event already waiting is not queued again,
+ * 			and E_DATA_CHANGE is held off after another, so a burst is handled once.
+ * \remark May be called from any task or Swi.
+ */
+void SB_fsmPostEvent(SB_Event event) {
+	uint32_t now = Clock_getTicks();
+	bool queued = false;
+	UInt key;
+
+	if (event >= SB_NUM_EVENTS || FSM.eventSem == NULL) {
+		return;
+	}
+
+	key = Swi_disable();
+
+	++FSM.stats.posted[event];
+
+	if (event == E_DATA_CHANGE && Util_isActive(&FSM.holdoffClock)) {
+		// Raised when the holdoff ends, timed from the first post held
+		if (FSM.dataChangeHeld) {
+			++FSM.stats.coalesced[event];
+		} else {
+			FSM.dataChangeHeld = true;
+			FSM.dataChangeHeldTicks = now;
+		}
+	} else {
+		if (event == E_DATA_CHANGE) {
+			Util_startClock(&FSM.holdoffClock);
+		}
+
+		queued = SB_queueEvent(event, now);
+	}
+
+	Swi_restore(key);
+
+	if (queued) {
+		Semaphore_post(FSM.eventSem);
+	}
+}
+
+/**
+ * \brief Records an error and raises E_ERROR. The state machine decides from the error whether
+ * 			it is temporary.
+ * \remark May be called from any task or Swi.
+ */
+void SB_fsmReportError(SB_Error error) {
+	UInt key = Swi_disable();
+
+	// A permanent error is not replaced by a temporary one reported before it is handled
+	if (!SB_isPermanent(systemState.currentError) || SB_isPermanent(error)) {
+		SB_setError(error);
+	}
+
+	Swi_restore(key);
+
+	SB_fsmPostEvent(E_ERROR);
+}
+
+/**
+ * \brief Switches the BLE timer on or off. It runs while a central is connected.
+ */
+void SB_fsmSetBleTimer(bool enable) {
+	if (enable) {
+		Util_startClock(&FSM.bleClock);
+	} else {
+		Util_stopClock(&FSM.bleClock);
+	}
+}
+
+void SB_fsmGetEventStats(SB_FsmEventStats *stats) {
+	UInt key = Swi_disable();
+
+	*stats = FSM.stats;
+
+	Swi_restore(key);
 }
-SB_State SB_bleTimerExpired(void){
-    //the transmit data timer expired
-	return SB_switchState(S_TRANSMIT);
-    //send the data via the bluetooth to the smartphone android application
-    //check if successful - remove previous data(?) and return to sleep
-    //if not, reset timer, and save previous data
+
+/**
+ * \brief Handles the events queued, in the order they were first posted, then waits for more.
+ * 			Between samples every task is blocked, so the device sleeps until a timer expires or
+ * 			an event arrives.
+ */
+static void SB_fsmTask(UArg a0, UArg a1) {
+	uint32_t postedTicks;
+	SB_Event event;
+	UInt key;
+
+	// The first sample is taken at once
+	SB_fsmPostEvent(E_CHECK_TIMER_EXPIRED);
+
+	while (1) {
+		Semaphore_pend(FSM.eventSem, BIOS_WAIT_FOREVER);
+
+		while (1) {
+			key = Swi_disable();
+
+			if (FSM.queueCount == 0) {
+				Swi_restore(key);
+				break;
+			}
+
+			event = (SB_Event)FSM.queue[FSM.queueStart];
+			postedTicks = FSM.postedTicks[FSM.queueStart];
+
+			FSM.queueStart = (FSM.queueStart + 1) % SB_FSM_EVENT_QUEUE_LEN;
+			--FSM.queueCount;
+			FSM.queued &= ~(1 << event);
+
+			Swi_restore(key);
+
+			FSM.handlingPostedTicks = postedTicks;
+			SB_handleEvent(event);
+			SB_recordLatency(event, postedTicks);
+		}
+	}
 }
-SB_State SB_noBandageDetected(void){
-    //no connection between the communications module and the bandage module detected
-    //set the current state to temp error and wait for check timer to expire to see if initialized (?)
-	return SB_switchState(S_ERROR_TEMP);
+
+/**
+ * \brief Creates the state machine task and its timers. The task starts in S_INIT and takes the
+ * 			first sample at once.
+ * \remark Called after the peripheral manager and before the BLE task are initialized.
+ */
+SB_Error SB_fsmInit() {
+	Task_Params taskParams;
+	SB_Settings settings;
+
+	FSM.eventSem = Semaphore_create(0, NULL, NULL);
+	if (FSM.eventSem == NULL) {
+		return OSResourceInitializationError;
+	}
+
+	SB_settingsGet(&settings);
+
+	// The check timer is given the sample period again as each check begins
+	if (NULL == Util_constructClock(&FSM.checkClock, SB_fsmClockHandler,
+			settings.samplePeriodMs, 0, false, E_CHECK_TIMER_EXPIRED)
+		|| NULL == Util_constructClock(&FSM.bleClock, SB_fsmClockHandler,
+			SB_FSM_BLE_PERIOD_MS, SB_FSM_BLE_PERIOD_MS, false, E_BLE_TIMER_EXPIRED)
+		|| NULL == Util_constructClock(&FSM.holdoffClock, SB_fsmHoldoffClockHandler,
+			SB_FSM_DATA_CHANGE_HOLDOFF_MS, 0, false, 0)) {
+
+#ifdef SB_DEBUG
+		System_printf("FSM: Failed to initialize clocks...\n");
+		System_flush();
+#endif
+		return OSResourceInitializationError;
+	}
+
+	Task_Params_init(&taskParams);
+	taskParams.stack = FSM.taskStack;
+	taskParams.stackSize = FSM_TASK_STACK_SIZE;
+	taskParams.priority = FSM_TASK_PRIORITY;
+
+	FSM.taskHandle = Task_create(SB_fsmTask, &taskParams, NULL);
+
+	if (FSM.taskHandle == NULL) {
+		System_printf("FSM: Task creation failed\n");
+		System_flush();
+
+		return OSResourceInitializationError;
+	}
+
+	SB_diagnosticsRegisterTask(SB_DIAGNOSTICS_TASK_FSM, FSM.taskHandle);
+
+	return NoError;
 }
-SB_State SB_errorEvent(){
-    //a more permanent error has occurred, do nothing or else relay problem via bluetooth
 
-	//permanent errors
-	switch (systemState.currentError) {
+/**
+ * \brief Adds an event to the end of the queue unless it is already waiting.
+ * \return true if the event was added
+ * \remark Must be called with Swis disabled.
+ */
+static bool SB_queueEvent(SB_Event event, uint32_t postedTicks) {
+	uint8_t slot;
+
+	if (FSM.queued & (1 << event)) {
+		++FSM.stats.coalesced[event];
+		return false;
+	}
+
+	slot = (FSM.queueStart + FSM.queueCount) % SB_FSM_EVENT_QUEUE_LEN;
+
+	FSM.queue[slot] = event;
+	FSM.postedTicks[slot] = postedTicks;
+	FSM.queued |= (1 << event);
+
+	if (++FSM.queueCount > FSM.stats.maxDepth) {
+		FSM.stats.maxDepth = FSM.queueCount;
+	}
+
+	return true;
+}
+
+// Raises the event of a timer
+static void SB_fsmClockHandler(UArg event) {
+	SB_fsmPostEvent((SB_Event)event);
+}
+
+// Raises the E_DATA_CHANGE held during the holdoff, which starts another
+static void SB_fsmHoldoffClockHandler(UArg arg) {
+	bool queued = false;
+	UInt key = Swi_disable();
+
+	if (FSM.dataChangeHeld) {
+		FSM.dataChangeHeld = false;
+
+		Util_startClock(&FSM.holdoffClock);
+		queued = SB_queueEvent(E_DATA_CHANGE, FSM.dataChangeHeldTicks);
+	}
+
+	Swi_restore(key);
+
+	if (queued) {
+		Semaphore_post(FSM.eventSem);
+	}
+}
+
+/**
+ * \brief Records the time from the first post of an event to the end of its transition.
+ */
+static void SB_recordLatency(SB_Event event, uint32_t postedTicks) {
+	uint32_t now = Clock_getTicks();
+	uint32_t latencyUs = SB_TICKS_TO_US(now - postedTicks);
+	UInt key = Swi_disable();
+
+	if (latencyUs > FSM.stats.maxLatencyUs[event]) {
+		FSM.stats.maxLatencyUs[event] = latencyUs;
+	}
+
+	Swi_restore(key);
+}
+
+// Errors which the device cannot recover from without a reset
+static bool SB_isPermanent(SB_Error error) {
+	switch (error) {
 	case OSResourceInitializationError:
 	case OutOfMemory:
-		return SB_switchState(S_ERROR_PERM);
+		return true;
 
 	// All other errors implied temporary
 	default:
-		return SB_switchState(S_ERROR_TEMP);
+		return false;
 	}
 }
-SB_State SB_dataChanged(void){
-    //data changed prior to the ble_timer expiring
-	return SB_switchState(S_TRANSMIT);
+
+static bool SB_isPermanentError(void) {
+	return SB_isPermanent(systemState.currentError);
 }
 
-//not actually an event, just something that happens when there isn't anything else to do
-SB_State SB_returnToSleep(void){
-	return SB_switchState(S_SLEEP);
+// Leaving an error for normal operation clears it, unless another error is waiting to be handled
+static void SB_enterRunning(void) {
+	UInt key = Swi_disable();
+
+	if (!(FSM.queued & (1 << E_ERROR))) {
+		SB_setError(NoError);
+	}
+
+	Swi_restore(key);
 }
 
-SB_State SB_handleEvent(SB_Event event) {
-	// State or event invalid
-	if (systemState.currentState >= SB_NUM_STATES || event >= SB_NUM_EVENTS) {
-		SB_setError(InvalidParameter);
-		return SB_errorEvent();
+// Samples the sensors, and starts the check timer for the next sample period
+static void SB_enterCheck(void) {
+	SB_Settings settings;
+
+	SB_settingsGet(&settings);
+	Util_restartClock(&FSM.checkClock, settings.samplePeriodMs);
+
+	SB_peripheralRequestSample();
+}
+
+// States which wait for the check timer make sure it runs, as they may be entered before any check
+static void SB_armCheck(void) {
+	SB_Settings settings;
+
+	if (!Util_isActive(&FSM.checkClock)) {
+		SB_settingsGet(&settings);
+		Util_restartClock(&FSM.checkClock, settings.samplePeriodMs);
 	}
+}
 
-	// No action if the pointer is null
-	if (SB_stateTable[systemState.currentState][event] == NULL) {
-		return systemState.currentState;
+// Sends the live stream and the latest readings, at once for an alert. An alert is timed from
+// its first post until this transmit completes.
+static void SB_enterTransmit(void) {
+	UInt key = Swi_disable();
+
+	FSM.alertPending = (systemState.lastEvent == E_DATA_CHANGE);
+	FSM.alertPostedTicks = FSM.handlingPostedTicks;
+	Swi_restore(key);
+
+	SB_bleRequestTransmit(FSM.alertPending);
+}
+
+// An alert transmit left before it completed, as on E_CHECK_TIMER_EXPIRED, is not timed
+static void SB_exitTransmit(void) {
+	UInt key = Swi_disable();
+
+	if (FSM.alertPending && systemState.lastEvent == E_TRANSMIT_DONE) {
+		FSM.stats.alertLatencyUs = SB_TICKS_TO_US(Clock_getTicks() - FSM.alertPostedTicks);
+		if (FSM.stats.alertLatencyUs > FSM.stats.maxAlertLatencyUs) {
+			FSM.stats.maxAlertLatencyUs = FSM.stats.alertLatencyUs;
+		}
 	}
 
-	return SB_stateTable[systemState.currentState][event]();
+	FSM.alertPending = false;
+	Swi_restore(key);
 }
 
 inline void SB_setError(SB_Error error) {
@@ -159,71 +597,193 @@ inline SB_State SB_currentState() {
 	return systemState.currentState;
 }
 
+// Copies the time spent in each state since boot, including the current one
+void SB_fsmGetResidency(uint32_t residencyMs[SB_NUM_STATES]) {
+	uint8_t i;
+	UInt key = Task_disable();
+
+	SB_accountResidency();
+	for (i = 0; i < SB_NUM_STATES; ++i) {
+		residencyMs[i] = TRACE.residencyTicks[i] / (NTICKS_PER_MILLSECOND);
+	}
 
-// Called from within periheral functions to register that the peripheral will need to be revisited when the state changes
-void SB_registerStateTransitionCallback(void function(void), SB_State_Transition peripheral) {
-	//create the callback
-	SB_CallbackFunc *newCallback;
-	newCallback = (SB_CallbackFunc*)malloc( sizeof(SB_CallbackFunc));
-	newCallback->transition = peripheral;
-	newCallback->function = function;
-	newCallback->next = 0; //start with the new callback not pointing to anything
-	//add the callback to the transition table
-	SB_addCallback(newCallback);
+	Task_restore(key);
 }
 
-/*
-void SB_registerEvent(SB_EventHandler eventHandler, SB_State state) {
-	//passes function pointer to be called in the future
-	(*eventHandler)();
-}
-*/
-
-
-// This will be put within the switchstate cases to make sure the peripherals are dealt with correctly
-// This will be put within the switchstate cases to make sure the peripherals are dealt with correctly
-void SB_callCallback( SB_State_Transition state) {
-	//check if the linked list in empty, if it is then don't do anything, if it isn't, then iterate through list and call functions
-    SB_CallbackFunc *current;
-	if(callbackTable == NULL) {
-        return;
-	}
-	current = callbackTable->callbacks ;
-	// disable context switching for other tasks in this section
-	taskKey = Task_disable();
-	while(current->next != NULL) {
-		if(state == current->transition){
-			current->function();
-			current = current->next;
-		} else {
-			current = current->next;
+/**
+ * \brief Copies the transitions into each state and the most recent transitions, oldest first.
+ */
+void SB_fsmGetTraceSummary(SB_FsmTraceSummary *summary) {
+	uint8_t i, from, to;
+	UInt key = Task_disable();
+
+	SB_accountResidency();
+	summary->ticks = TRACE.enteredTicks;
+
+	for (to = 0; to < SB_NUM_STATES; ++to) {
+		summary->entries[to] = 0;
+		for (from = 0; from < SB_NUM_STATES; ++from) {
+			summary->entries[to] += TRACE.transitions[from][to];
 		}
 	}
-	//current = current->next;
-	if(state == current->transition) {
-		current->function();
+
+	for (i = 0; i < SB_FSM_TRACE_LEN; ++i) {
+		if (TRACE.taken + i < SB_FSM_TRACE_LEN) {
+			summary->recent[i].ticks = 0;
+			summary->recent[i].from = SB_NUM_STATES;
+			summary->recent[i].to = SB_NUM_STATES;
+			summary->recent[i].event = SB_NUM_EVENTS;
+		} else {
+			summary->recent[i] = TRACE.recent[(TRACE.taken + i) % SB_FSM_TRACE_LEN];
+		}
 	}
-	// restore context switching for other tasks at this point
-	Task_restore(taskKey);
+
+	Task_restore(key);
 }
 
+// Copies the transitions taken since boot, from the row to the column
+void SB_fsmGetTransitions(uint32_t transitions[SB_NUM_STATES][SB_NUM_STATES]) {
+	UInt key = Task_disable();
 
-// Function to add the callbacks to the list to be used later.
-void SB_addCallback( SB_CallbackFunc *callback ){
-	if(callbackTable == NULL) {
-        callbackTable = malloc(sizeof(transitionTable));
-        callbackTable->callbacks = callback;
-		return;
+	memcpy(transitions, TRACE.transitions, sizeof(TRACE.transitions));
+
+	Task_restore(key);
+}
+
+#ifdef SB_DEBUG
+/**
+ * \brief Prints the tracer, for the debug console and the host build of the state machine.
+ * \remark Takes about 300 bytes of stack.
+ */
+void SB_fsmPrintTrace() {
+	uint32_t residencyMs[SB_NUM_STATES];
+	uint32_t transitions[SB_NUM_STATES][SB_NUM_STATES];
+	SB_FsmTraceSummary summary;
+	uint8_t i, from, to;
+
+	SB_fsmGetResidency(residencyMs);
+	SB_fsmGetTransitions(transitions);
+	SB_fsmGetTraceSummary(&summary);
+
+	System_printf("FSM: residency ms");
+	for (i = 0; i < SB_NUM_STATES; ++i) {
+		System_printf(" %lu", (unsigned long)residencyMs[i]);
 	}
+	System_printf("\n");
 
-	SB_CallbackFunc *current = callbackTable->callbacks;
+	System_printf("FSM: transitions from row to column\n");
+	for (from = 0; from < SB_NUM_STATES; ++from) {
+		System_printf("FSM:");
+		for (to = 0; to < SB_NUM_STATES; ++to) {
+			System_printf(" %8lu", (unsigned long)transitions[from][to]);
+		}
+		System_printf("\n");
+	}
 
-	if ( current != 0 ) {
-		while ( current->next != 0)
-		{
-			current = current->next;
+	for (i = 0; i < SB_FSM_TRACE_LEN; ++i) {
+		if (summary.recent[i].from < SB_NUM_STATES) {
+			System_printf("FSM: %lu ticks ago %d -> %d on %d\n",
+					(unsigned long)(summary.ticks - summary.recent[i].ticks),
+					summary.recent[i].from, summary.recent[i].to, summary.recent[i].event);
 		}
 	}
-	current->next = callback;
+
+	System_flush();
+}
+#endif
+
+// Adds the ticks spent in the current state since it was entered or last accounted.
+// Must be called at least every 11 hours, before the tick count wraps.
+static void SB_accountResidency(void) {
+	uint32_t now = Clock_getTicks();
+
+	TRACE.residencyTicks[systemState.currentState] += now - TRACE.enteredTicks;
+	TRACE.enteredTicks = now;
+}
+
+// Records a state change. Called with the scheduler locked on every transition, so kept to
+// a few loads, adds and stores.
+static void SB_traceTransition(SB_State from, SB_State to) {
+	SB_FsmTraceEntry *entry = &TRACE.recent[TRACE.taken++ % SB_FSM_TRACE_LEN];
+
+	SB_accountResidency();
+	++TRACE.transitions[from][to];
+
+	entry->ticks = TRACE.enteredTicks;
+	entry->from = from;
+	entry->to = to;
+	entry->event = systemState.lastEvent;
 }
 
+/**
+ * \brief Registers a function to be called whenever the state machine takes a transition.
+ * 			Called from within peripheral functions so the peripheral is revisited when the
+ * 			state changes.
+ * \return OutOfMemory if the transition already holds SB_FSM_MAX_CALLBACKS callbacks
+ */
+SB_Error SB_registerStateTransitionCallback(SB_TransitionCallback function, void *context, SB_State_Transition transition) {
+	transitionTable *table;
+	SB_Error result = NoError;
+	uint32_t start, elapsed;
+	UInt key;
+
+	if (function == NULL || transition >= NUM_TRANSITIONS) {
+		return InvalidParameter;
+	}
+
+	table = &callbackTable[transition];
+
+	// Only concurrent registrations are locked out; dispatch reads the entries below count
+	key = Task_disable();
+	start = Timestamp_get32();
+
+	if (table->count == SB_FSM_MAX_CALLBACKS) {
+		++callbackStats.registrationsRejected;
+		result = OutOfMemory;
+	} else {
+		// Fill the entry before counting it, so dispatch never sees it half written
+		table->callbacks[table->count].function = function;
+		table->callbacks[table->count].context = context;
+		++table->count;
+	}
+
+	elapsed = Timestamp_get32() - start;
+	if (elapsed > callbackStats.maxLockTime) {
+		callbackStats.maxLockTime = elapsed;
+	}
+	Task_restore(key);
+
+	return result;
+}
+
+void SB_fsmGetCallbackStats(SB_FsmCallbackStats *stats) {
+	UInt key = Task_disable();
+
+	*stats = callbackStats;
+
+	Task_restore(key);
+}
+
+/**
+ * \brief Calls the callbacks registered for a transition, in the order they were registered,
+ * 			without locking the scheduler.
+ */
+static void SB_callCallback(SB_State_Transition transition) {
+	const transitionTable *table = &callbackTable[transition];
+	uint8_t i, count = table->count;
+	uint32_t start, elapsed;
+
+	start = Timestamp_get32();
+
+	for (i = 0; i < count; ++i) {
+		table->callbacks[i].function(transition, table->callbacks[i].context);
+	}
+
+	elapsed = Timestamp_get32() - start;
+
+	++callbackStats.dispatches;
+	callbackStats.callbacksCalled += count;
+	if (elapsed > callbackStats.maxDispatchTime) {
+		callbackStats.maxDispatchTime = elapsed;
+	}
+}
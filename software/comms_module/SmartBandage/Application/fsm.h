@@ -26,6 +26,8 @@ typedef enum {
 	E_DATA_CHANGE,
 	E_NO_BANDAGE_DETECTED,
 	E_ERROR,
+	E_CHECK_DONE,		// The peripheral manager finished the sample asked for on entering S_CHECK
+	E_TRANSMIT_DONE,	// The stack took what was sent on entering S_TRANSMIT
 
 	// This element should be left -- gives self-correcting code for the correct number of states supported
 	SB_NUM_EVENTS
@@ -43,22 +45,69 @@ typedef enum {
 
 } SB_State_Transition;
 
-//EDITED HERE
-struct SB_CallbackFunc_struct;
-struct SB_CallbackFunc_struct {
-	struct SB_CallbackFunc_struct *next;
-	void(*function)(void);//(SB_State_Transition transition);
-	SB_State_Transition transition;
-};
-typedef struct SB_CallbackFunc_struct SB_CallbackFunc;
+// Called when the state machine takes a transition, with the context given at registration
+typedef void (*SB_TransitionCallback)(SB_State_Transition transition, void *context);
+
+typedef struct {
+	SB_TransitionCallback function;
+	void *context;
+} SB_CallbackFunc;
 
-//EDITED HERE
 #define NUM_TRANSITIONS 6
 
+// Callbacks held for each transition. Registering more fails with OutOfMemory.
+#define SB_FSM_MAX_CALLBACKS 4
+
 typedef struct {
-	SB_CallbackFunc *callbacks;//[NUM_TRANSITIONS]; //?
+	SB_CallbackFunc callbacks[SB_FSM_MAX_CALLBACKS];
+	uint8_t count;
 } transitionTable;
 
+// Times are in Timestamp_get32 counts
+typedef struct {
+	uint32_t dispatches;			// Transitions taken
+	uint32_t callbacksCalled;
+	uint16_t registrationsRejected;	// Transition already held SB_FSM_MAX_CALLBACKS
+	uint32_t maxLockTime;			// Longest the scheduler was locked to register a callback
+	uint32_t maxDispatchTime;		// Longest spent calling the callbacks of one transition
+} SB_FsmCallbackStats;
+
+// Events wait at most once each in the queue of the state machine, so it never overflows
+#define SB_FSM_EVENT_QUEUE_LEN SB_NUM_EVENTS
+
+// E_DATA_CHANGE posted this soon after another is held, and raised once at the end of the wait
+#define SB_FSM_DATA_CHANGE_HOLDOFF_MS 250
+
+// E_BLE_TIMER_EXPIRED is raised at this period while a central is connected
+#define SB_FSM_BLE_PERIOD_MS 5000
+
+typedef struct {
+	uint32_t posted[SB_NUM_EVENTS];
+	uint32_t coalesced[SB_NUM_EVENTS];		// Posts merged into one already waiting or held off
+	uint32_t maxLatencyUs[SB_NUM_EVENTS];	// Longest from the first post to the end of its transition
+	uint32_t alertLatencyUs;				// Last E_DATA_CHANGE that entered S_TRANSMIT, to its E_TRANSMIT_DONE
+	uint32_t maxAlertLatencyUs;
+	uint8_t  maxDepth;						// Most events waiting at once
+} SB_FsmEventStats;
+
+// Recent transitions kept by the tracer, a power of two
+#define SB_FSM_TRACE_LEN 8
+
+// Ticks are Clock ticks. Unused entries have from and to of SB_NUM_STATES.
+typedef struct __attribute__((packed)) {
+	uint32_t ticks;
+	uint8_t  from;						// SB_State
+	uint8_t  to;
+	uint8_t  event;						// SB_Event handled last when it was taken
+} SB_FsmTraceEntry;
+
+// The part of the tracer read over the diagnostics path, packed and little endian
+typedef struct __attribute__((packed)) {
+	uint32_t ticks;						// When read, to age the recent transitions
+	uint32_t entries[SB_NUM_STATES];	// Transitions into each state since boot
+	SB_FsmTraceEntry recent[SB_FSM_TRACE_LEN];	// Oldest first
+} SB_FsmTraceSummary;
+
 typedef struct {
 	SB_State lastState;
 	SB_State currentState;
@@ -73,6 +122,19 @@ SB_State SB_switchState(SB_State); //?
 SB_Event SB_getNewEvent(void);
 SB_State SB_handleEvent(SB_Event);
 SB_State SB_currentState();
+SB_Error SB_fsmInit();
+void SB_fsmPostEvent(SB_Event event);
+void SB_fsmReportError(SB_Error error);
+void SB_fsmSetBleTimer(bool enable);
+void SB_fsmGetEventStats(SB_FsmEventStats *stats);
+void SB_fsmGetResidency(uint32_t residencyMs[SB_NUM_STATES]);
+void SB_fsmGetTraceSummary(SB_FsmTraceSummary *summary);
+void SB_fsmGetTransitions(uint32_t transitions[SB_NUM_STATES][SB_NUM_STATES]);
+#ifdef SB_DEBUG
+void SB_fsmPrintTrace();
+#endif
+SB_Error SB_registerStateTransitionCallback(SB_TransitionCallback function, void *context, SB_State_Transition transition);
+void SB_fsmGetCallbackStats(SB_FsmCallbackStats *stats);
 
 
 #endif
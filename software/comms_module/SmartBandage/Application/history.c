@@ -0,0 +1,561 @@
+/*
+ * history.c
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#include <stddef.h>
+#include <string.h>
+
+#include <ti/sysbios/knl/Clock.h>
+#include <xdc/runtime/System.h>
+
+#include "ICallBleAPIMSG.h"
+
+#include "flashLog.h"
+#include "sampleRecord.h"
+#include "rollup.h"
+#include "systemTime.h"
+#include "history.h"
+
+static void     startTransfer(SB_FlashLog *log, uint32_t recordSeq);
+static void     sendNext();
+static void     sendMessage(uint8_t type, const uint8_t *data, uint8_t length);
+static void     sendError(uint8_t error);
+static void     closeTransfer();
+static uint32_t seekTimestamp(SB_FlashLog *log, uint32_t timestamp);
+static SB_Error seekTimed(SB_FlashLog *log, SB_FlashLogCursor *cursor, uint32_t recordSeq, uint32_t *base, bool *baseValid);
+static bool     recordBefore(SB_FlashLog *log, uint32_t recordSeq, uint32_t timestamp);
+
+// Indexed by SB_HISTORY_LOG_*
+static SB_FlashLog * const logs[SB_HISTORY_NUM_LOGS] = {
+	&SB_sampleLog,
+	&SB_minuteRollupLog,
+	&SB_hourRollupLog,
+};
+
+struct {
+	l2capPsm_t psm;
+
+	bool open;
+	uint16_t CID;
+	uint16_t sduLength;
+
+	// A download is in progress, or was last, from this log
+	bool active;
+	SB_FlashLog *log;
+	SB_FlashLogCursor cursor;
+
+	// Timestamp of the last absolute sample record before the cursor, if known
+	uint32_t base;
+	bool baseValid;
+
+	// Only one SDU may be in flight. Requests arriving meanwhile are started, or refused, once it is sent.
+	bool sduInFlight;
+	uint32_t inFlightNextSeq;
+	bool restartPending;
+	SB_FlashLog *restartLog;
+	uint32_t restartSeq;
+	bool errorPending;
+	uint8_t pendingError;
+
+	// First record not yet completely delivered, for RESUME
+	bool resumable;
+	uint32_t deliveredSeq;
+
+	uint32_t transferStart;
+	uint32_t transferBytes;
+
+	SB_HistoryStats stats;
+} HISTORY;
+
+// Used to read records while searching for a timestamp
+static uint8_t recordBuf[FLASHLOG_MAX_RECORD_LEN];
+
+/**
+ * \brief Registers the history service's PSM.
+ * \remark Must be called from the task registered with ICall, which receives the L2CAP events.
+ */
+SB_Error SB_historyInit(uint8_t entity) {
+	HISTORY.psm.psm = SB_HISTORY_PSM;
+	HISTORY.psm.mtu = SB_HISTORY_RX_MTU;
+	HISTORY.psm.initPeerCredits = SB_HISTORY_PEER_CREDITS;
+	HISTORY.psm.peerCreditThreshold = SB_HISTORY_PEER_CREDIT_THRESHOLD;
+	HISTORY.psm.maxNumChannels = 1;
+	HISTORY.psm.taskId = entity;
+	HISTORY.psm.pfnVerifySecCB = NULL;
+
+	if (SUCCESS != L2CAP_RegisterPsm(&HISTORY.psm)) {
+#ifdef SB_DEBUG
+		System_printf("HISTORY: Failed to register PSM\n");
+		System_flush();
+#endif
+		return OSResourceInitializationError;
+	}
+
+	return NoError;
+}
+
+/**
+ * \brief Handles the L2CAP channel events of the history service.
+ */
+void SB_historyProcessSignal(l2capSignalEvent_t *pMsg) {
+	switch (pMsg->opcode) {
+		case L2CAP_CHANNEL_ESTABLISHED_EVT:
+			if (pMsg->cmd.channelEstEvt.result == L2CAP_CONN_SUCCESS) {
+				HISTORY.open = true;
+				HISTORY.CID = pMsg->cmd.channelEstEvt.CID;
+				HISTORY.sduLength = pMsg->cmd.channelEstEvt.info.peerMtu;
+				if (HISTORY.sduLength > SB_HISTORY_MAX_SDU_LEN) {
+					HISTORY.sduLength = SB_HISTORY_MAX_SDU_LEN;
+				}
+			}
+			break;
+
+		case L2CAP_CHANNEL_TERMINATED_EVT:
+			if (pMsg->cmd.channelTermEvt.CID == HISTORY.CID) {
+				if (HISTORY.sduInFlight) {
+					++HISTORY.stats.aborted;
+				}
+
+				// deliveredSeq is kept for RESUME
+				HISTORY.open = false;
+				HISTORY.active = false;
+				HISTORY.sduInFlight = false;
+				HISTORY.restartPending = false;
+				HISTORY.errorPending = false;
+			}
+			break;
+
+		case L2CAP_OUT_OF_CREDIT_EVT:
+			// The stack continues the SDU when the phone grants more credits
+			++HISTORY.stats.outOfCredit;
+			break;
+
+		case L2CAP_PEER_CREDIT_THRESHOLD_EVT:
+			// Let the phone keep sending requests
+			L2CAP_FlowCtrlCredit(pMsg->cmd.creditEvt.CID, SB_HISTORY_PEER_CREDITS);
+			break;
+
+		case L2CAP_SEND_SDU_DONE_EVT:
+			if (pMsg->cmd.sendSduDoneEvt.CID != HISTORY.CID || !HISTORY.sduInFlight) {
+				break;
+			}
+
+			HISTORY.sduInFlight = false;
+
+			if (pMsg->cmd.sendSduDoneEvt.txLen == pMsg->cmd.sendSduDoneEvt.totalLen) {
+				HISTORY.deliveredSeq = HISTORY.inFlightNextSeq;
+			} else {
+				++HISTORY.stats.aborted;
+				HISTORY.active = false;
+			}
+
+			// The phone is answered first, the transfer goes on once the reply is sent
+			if (HISTORY.errorPending) {
+				HISTORY.errorPending = false;
+				sendError(HISTORY.pendingError);
+			}
+
+			if (HISTORY.sduInFlight) {
+				break;
+			} else if (HISTORY.restartPending) {
+				HISTORY.restartPending = false;
+				startTransfer(HISTORY.restartLog, HISTORY.restartSeq);
+			} else if (HISTORY.active) {
+				sendNext();
+			}
+			break;
+
+		default:
+			break;
+	}
+}
+
+/**
+ * \brief Handles a request SDU from the phone.
+ */
+void SB_historyProcessData(l2capDataEvent_t *pMsg) {
+	uint8_t *payload = pMsg->pkt.pPayload;
+	uint8_t selector = SB_HISTORY_LOG_SAMPLES;
+	uint8_t error = InvalidParameter;
+	uint32_t argument;
+
+	if (pMsg->pkt.CID == HISTORY.CID && pMsg->pkt.len >= SB_HISTORY_REQUEST_LEN) {
+		memcpy(&argument, payload + 1, sizeof(argument));
+
+		if (pMsg->pkt.len > SB_HISTORY_REQUEST_LEN) {
+			selector = payload[SB_HISTORY_REQUEST_LEN];
+		}
+
+		switch (payload[0]) {
+			case SB_HISTORY_OP_FROM_SEQUENCE:
+			case SB_HISTORY_OP_FROM_TIMESTAMP:
+				if (selector >= SB_HISTORY_NUM_LOGS) {
+					sendError(error);
+				} else if (payload[0] == SB_HISTORY_OP_FROM_SEQUENCE) {
+					startTransfer(logs[selector], argument);
+				} else {
+					startTransfer(logs[selector], seekTimestamp(logs[selector], argument));
+				}
+				break;
+
+			case SB_HISTORY_OP_RESUME:
+				if (HISTORY.resumable) {
+					++HISTORY.stats.resumes;
+					startTransfer(HISTORY.log, HISTORY.deliveredSeq);
+				} else {
+					error = NoDataAvailable;
+					sendError(error);
+				}
+				break;
+
+			case SB_HISTORY_OP_STOP:
+				// The SDU in flight completes, nothing follows it
+				HISTORY.active = false;
+				HISTORY.restartPending = false;
+				break;
+
+			default:
+				break;
+		}
+	}
+
+	BM_free(pMsg->pkt.pPayload);
+}
+
+/**
+ * \brief True while a download is being sent.
+ */
+bool SB_historyIsActive() {
+	return HISTORY.active || HISTORY.sduInFlight;
+}
+
+void SB_historyGetStats(SB_HistoryStats *stats) {
+	*stats = HISTORY.stats;
+}
+
+/**
+ * \brief Starts sending from recordSeq, or from the oldest record if it has been overwritten.
+ */
+static void startTransfer(SB_FlashLog *log, uint32_t recordSeq) {
+	SB_FlashLogCursor cursor;
+	SB_Error result;
+
+	if (!HISTORY.open) {
+		return;
+	}
+
+	if (HISTORY.sduInFlight) {
+		HISTORY.restartPending = true;
+		HISTORY.restartLog = log;
+		HISTORY.restartSeq = recordSeq;
+		return;
+	}
+
+	// The log and cursor are only replaced together, as RESUME needs both
+	result = seekTimed(log, &cursor, recordSeq, &HISTORY.base, &HISTORY.baseValid);
+	if (result != NoError) {
+		sendError(result);
+		return;
+	}
+
+	HISTORY.log = log;
+	HISTORY.cursor = cursor;
+
+	++HISTORY.stats.transfers;
+	HISTORY.active = true;
+	HISTORY.resumable = true;
+	HISTORY.deliveredSeq = HISTORY.cursor.recordSeq;
+	HISTORY.transferStart = Clock_getTicks();
+	HISTORY.transferBytes = 0;
+
+	sendNext();
+}
+
+/**
+ * \brief Packs the records at the cursor into one SDU and sends it. Each SDU holds a run of
+ * 			consecutive records, so the phone can tell their sequence numbers from the first,
+ * 			and the base time the timestamp deltas of sample records are relative to.
+ */
+static void sendNext() {
+	l2capPacket_t pkt;
+	uint8_t *sdu, *p;
+	uint8_t length, count = 0;
+	uint16_t room;
+	uint32_t firstSeq = 0, firstBase = 0, seq;
+	bool end = false;
+	SB_Error result;
+
+	sdu = L2CAP_bm_alloc(HISTORY.sduLength);
+	if (sdu == NULL) {
+		// Stop; the phone can RESUME
+		HISTORY.active = false;
+		return;
+	}
+
+	p = sdu + SB_HISTORY_RECORDS_HEADER_LEN;
+
+	while (1) {
+		room = HISTORY.sduLength - (p - sdu);
+		if (room < 2) {
+			break;
+		}
+
+		seq = HISTORY.cursor.recordSeq;
+		result = SB_flashLogRead(HISTORY.log, &HISTORY.cursor, p + 1, (room - 1 > 0xFF) ? 0xFF : room - 1, &length);
+
+		if (result == NoError) {
+			// Rollup records carry their own time
+			if (HISTORY.log == &SB_sampleLog) {
+				if (SB_sampleIsAbsolute(p + 1)) {
+					HISTORY.base = SB_sampleTime(p + 1, 0);
+					HISTORY.baseValid = true;
+				} else if (!HISTORY.baseValid) {
+					// Its absolute record was overwritten or corrupt, so it cannot be timed
+					++HISTORY.stats.untimedRecords;
+					continue;
+				}
+			}
+
+			if (count == 0) {
+				firstSeq = HISTORY.cursor.recordSeq - 1;
+				firstBase = (HISTORY.log == &SB_sampleLog) ? HISTORY.base : 0;
+			}
+
+			*p = length;
+			p += 1 + length;
+			++count;
+		} else if (result == NoDataAvailable) {
+			end = true;
+			break;
+		} else if (result == FlashIOError && HISTORY.cursor.recordSeq != seq) {
+			// Corrupt record, skipped. End the SDU here so its records stay consecutive.
+			// Records after it may be relative to it, so wait for the next absolute one.
+			++HISTORY.stats.badRecords;
+			HISTORY.baseValid = false;
+			if (count > 0) {
+				break;
+			}
+		} else {
+			// Doesn't fit: it starts the next SDU. Any other error ends the transfer.
+			if (result != InvalidParameter || count == 0) {
+				BM_free(sdu);
+				closeTransfer();
+
+				sendError(result);
+				return;
+			}
+			break;
+		}
+	}
+
+	if (count == 0 && end) {
+		BM_free(sdu);
+		closeTransfer();
+
+		seq = HISTORY.cursor.recordSeq;
+		sendMessage(SB_HISTORY_MSG_END, (uint8_t*)&seq, sizeof(seq));
+		HISTORY.inFlightNextSeq = seq;
+		return;
+	}
+
+	sdu[0] = SB_HISTORY_MSG_RECORDS;
+	memcpy(sdu + 1, &firstSeq, sizeof(firstSeq));
+	memcpy(sdu + 5, &firstBase, sizeof(firstBase));
+	sdu[9] = count;
+
+	pkt.CID = HISTORY.CID;
+	pkt.pPayload = sdu;
+	pkt.len = p - sdu;
+
+	if (SUCCESS != L2CAP_SendSDU(&pkt)) {
+		BM_free(sdu);
+		HISTORY.active = false;
+		return;
+	}
+
+	HISTORY.sduInFlight = true;
+	HISTORY.inFlightNextSeq = HISTORY.cursor.recordSeq;
+
+	++HISTORY.stats.sdusSent;
+	HISTORY.stats.recordsSent += count;
+	HISTORY.stats.bytesSent += pkt.len;
+	HISTORY.transferBytes += pkt.len;
+}
+
+/**
+ * \brief Sends a short control message as its own SDU.
+ */
+static void sendMessage(uint8_t type, const uint8_t *data, uint8_t length) {
+	l2capPacket_t pkt;
+	uint8_t *sdu;
+
+	if (!HISTORY.open || HISTORY.sduInFlight) {
+		return;
+	}
+
+	sdu = L2CAP_bm_alloc(1 + length);
+	if (sdu == NULL) {
+		return;
+	}
+
+	sdu[0] = type;
+	memcpy(sdu + 1, data, length);
+
+	pkt.CID = HISTORY.CID;
+	pkt.pPayload = sdu;
+	pkt.len = 1 + length;
+
+	if (SUCCESS != L2CAP_SendSDU(&pkt)) {
+		BM_free(sdu);
+		return;
+	}
+
+	HISTORY.sduInFlight = true;
+	HISTORY.inFlightNextSeq = HISTORY.cursor.recordSeq;
+}
+
+/**
+ * \brief Sends an ERROR message, or holds it until the SDU in flight is sent. Only the last
+ * 			error is held.
+ */
+static void sendError(uint8_t error) {
+	if (HISTORY.sduInFlight) {
+		HISTORY.errorPending = true;
+		HISTORY.pendingError = error;
+		return;
+	}
+
+	sendMessage(SB_HISTORY_MSG_ERROR, &error, sizeof(error));
+}
+
+/**
+ * \brief Ends the transfer and records its throughput.
+ */
+static void closeTransfer() {
+	uint32_t ms = (Clock_getTicks() - HISTORY.transferStart) / (NTICKS_PER_MILLSECOND);
+
+	if (ms == 0) {
+		ms = 1;
+	}
+
+	HISTORY.active = false;
+	HISTORY.stats.lastTransferBytes = HISTORY.transferBytes;
+	HISTORY.stats.lastTransferMs = ms;
+	HISTORY.stats.lastThroughput = (HISTORY.transferBytes * 1000) / ms;
+}
+
+/**
+ * \brief Finds where the records logged since timestamp start. Time steps back when a sync
+ * 			corrects a clock that ran fast, and counts from boot again after a reset until the
+ * 			phone sets it. Times counted from boot are taken as at or after any timestamp, as
+ * 			they were logged after the records before them. The binary search always ends on a
+ * 			record at or after timestamp that follows one before it, even where time is out of
+ * 			order. Where a sync stepped time back across timestamp, that is either such record.
+ */
+static uint32_t seekTimestamp(SB_FlashLog *log, uint32_t timestamp) {
+	uint32_t low = log->tailFirstRecordSeq;
+	uint32_t high = log->nextRecordSeq;
+	uint32_t mid;
+
+	while (low < high) {
+		mid = low + (high - low) / 2;
+
+		if (recordBefore(log, mid, timestamp)) {
+			low = mid + 1;
+		} else {
+			high = mid;
+		}
+	}
+
+	return low;
+}
+
+/**
+ * \brief True if the record was stamped, or its window ended, before timestamp by the phone's
+ * 			time. Records that cannot be timed are sent rather than skipped.
+ */
+static bool recordBefore(SB_FlashLog *log, uint32_t recordSeq, uint32_t timestamp) {
+	SB_FlashLogCursor cursor;
+	uint32_t base, recordTime;
+	uint16_t windowSeconds;
+	uint8_t length;
+	bool baseValid;
+
+	if (NoError != seekTimed(log, &cursor, recordSeq, &base, &baseValid)
+			|| cursor.recordSeq != recordSeq
+			|| NoError != SB_flashLogRead(log, &cursor, recordBuf, sizeof(recordBuf), &length)) {
+		return false;
+	}
+
+	if (log != &SB_sampleLog) {
+		if (length < sizeof(SB_RollupRecord)) {
+			return false;
+		}
+
+		memcpy(&recordTime, recordBuf + offsetof(SB_RollupRecord, windowStart), sizeof(recordTime));
+		memcpy(&windowSeconds, recordBuf + offsetof(SB_RollupRecord, windowSeconds), sizeof(windowSeconds));
+		recordTime += windowSeconds - 1;
+	} else if (SB_sampleLength(recordBuf, length) == 0) {
+		return false;
+	} else if (SB_sampleIsAbsolute(recordBuf)) {
+		recordTime = SB_sampleTime(recordBuf, 0);
+	} else if (baseValid) {
+		recordTime = SB_sampleTime(recordBuf, base);
+	} else {
+		return false;
+	}
+
+	return recordTime >= SB_SYSTEMTIME_SET_MIN && recordTime < timestamp;
+}
+
+/**
+ * \brief Positions the cursor on recordSeq, or on the oldest record if it has been overwritten.
+ * 			In the sample log, also finds the timestamp the relative records from there are
+ * 			based on. The encoder writes an absolute record at least every
+ * 			SB_SAMPLE_ABSOLUTE_INTERVAL records, so the log is sought once, that far back, and
+ * 			read forward into recordBuf.
+ * \param baseValid Set false if the absolute record has been overwritten or cannot be read
+ */
+static SB_Error seekTimed(SB_FlashLog *log, SB_FlashLogCursor *cursor, uint32_t recordSeq, uint32_t *base, bool *baseValid) {
+	uint32_t start = log->tailFirstRecordSeq;
+	uint32_t seq;
+	uint8_t length;
+	SB_Error result;
+
+	*baseValid = false;
+
+	if (log != &SB_sampleLog) {
+		return SB_flashLogSeek(log, cursor, recordSeq);
+	}
+
+	if (recordSeq > start + (SB_SAMPLE_ABSOLUTE_INTERVAL - 1)) {
+		start = recordSeq - (SB_SAMPLE_ABSOLUTE_INTERVAL - 1);
+	}
+
+	if (NoError != (result = SB_flashLogSeek(log, cursor, start))) {
+		return result;
+	}
+
+	while (cursor->recordSeq < recordSeq) {
+		seq = cursor->recordSeq;
+		result = SB_flashLogRead(log, cursor, recordBuf, sizeof(recordBuf), &length);
+
+		if (result == NoError && SB_sampleLength(recordBuf, length) != 0) {
+			if (SB_sampleIsAbsolute(recordBuf)) {
+				*base = SB_sampleTime(recordBuf, 0);
+				*baseValid = true;
+			}
+		} else if (result == NoError || (result == FlashIOError && cursor->recordSeq != seq)) {
+			// Records after a corrupt one may be relative to it
+			*baseValid = false;
+		} else if (result == NoDataAvailable) {
+			break;
+		} else {
+			return result;
+		}
+	}
+
+	return NoError;
+}
@@ -0,0 +1,97 @@
+/*
+ * @file history.h
+ * @brief Bulk download of the sample and rollup logs over an L2CAP connection oriented channel.
+ *
+ * The phone opens a channel to SB_HISTORY_PSM and sends a request SDU. The bandage
+ * answers with SDUs packed with as many log records as the peer's MTU allows. The
+ * stack segments each SDU into LE-frames and only sends as many as the phone has
+ * given credits for, so the phone paces the transfer. The next SDU is built once
+ * the previous one is completely sent.
+ *
+ * The sequence number of the first record not yet delivered is kept across
+ * disconnects, so a RESUME request continues an interrupted download.
+ *
+ * Request (phone to bandage):
+ *   uint8_t  opcode     SB_HISTORY_OP_*
+ *   uint32_t argument   First record sequence number or timestamp, unused otherwise
+ *   uint8_t  log        SB_HISTORY_LOG_*. Optional, the sample log if left out.
+ *
+ * Responses (bandage to phone), little endian:
+ *   SB_HISTORY_MSG_RECORDS  uint32_t firstRecordSeq, uint32_t baseTime, uint8_t count,
+ *                           count x { uint8_t length, sample record }
+ *   SB_HISTORY_MSG_END      uint32_t nextRecordSeq
+ *   SB_HISTORY_MSG_ERROR    uint8_t  SB_Error
+ *
+ * The sample records are described in sampleRecord.h. baseTime is the timestamp of the
+ * last absolute record before the first one, which that and any following relative
+ * records are timed from. Records that cannot be timed, because their absolute record
+ * was overwritten, are left out.
+ *
+ * The rollup logs hold one SB_RollupRecord, described in rollup.h, per closed window.
+ * Each carries the start of its window, so baseTime is 0 in their RECORDS messages.
+ *
+ * FROM_TIMESTAMP starts with the records logged since the given time, and with the
+ * first window that ends after it. Records stamped with time counted from boot, before
+ * the phone set the clock, are taken as logged since any time, so none logged after a
+ * reset are left out. RESUME continues the log last downloaded.
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef APPLICATION_HISTORY_H_
+#define APPLICATION_HISTORY_H_
+
+#include "bcomdef.h"
+#include "l2cap.h"
+
+#include "Board.h"
+
+// LE PSM of the history service, from the dynamic range
+#define SB_HISTORY_PSM					0x0080
+
+// Largest SDU sent, further limited by the peer's MTU
+#define SB_HISTORY_MAX_SDU_LEN			L2CAP_SDU_SIZE
+
+// Requests are short: receive them in a single LE-frame
+#define SB_HISTORY_RX_MTU				L2CAP_MTU_SIZE
+#define SB_HISTORY_PEER_CREDITS			4
+#define SB_HISTORY_PEER_CREDIT_THRESHOLD 1
+
+#define SB_HISTORY_OP_FROM_SEQUENCE		0x01
+#define SB_HISTORY_OP_FROM_TIMESTAMP	0x02
+#define SB_HISTORY_OP_RESUME			0x03
+#define SB_HISTORY_OP_STOP				0x04
+#define SB_HISTORY_REQUEST_LEN			5
+
+#define SB_HISTORY_LOG_SAMPLES			0x00
+#define SB_HISTORY_LOG_MINUTE_ROLLUPS	0x01
+#define SB_HISTORY_LOG_HOUR_ROLLUPS		0x02
+#define SB_HISTORY_NUM_LOGS				3
+
+#define SB_HISTORY_MSG_RECORDS			0x81
+#define SB_HISTORY_MSG_END				0x82
+#define SB_HISTORY_MSG_ERROR			0x83
+#define SB_HISTORY_RECORDS_HEADER_LEN	10
+
+typedef struct {
+	uint16_t transfers;
+	uint16_t resumes;
+	uint16_t aborted;			// SDUs not completely sent, to be resent on resume
+	uint16_t outOfCredit;		// Times the phone let its credits run out
+	uint16_t badRecords;		// Records skipped for failing their CRC
+	uint16_t untimedRecords;	// Records skipped for want of their absolute timestamp
+	uint32_t sdusSent;
+	uint32_t recordsSent;
+	uint32_t bytesSent;
+	uint32_t lastTransferBytes;
+	uint32_t lastTransferMs;
+	uint32_t lastThroughput;	// Bytes per second of the last completed transfer
+} SB_HistoryStats;
+
+SB_Error SB_historyInit(uint8_t entity);
+void     SB_historyProcessSignal(l2capSignalEvent_t *pMsg);
+void     SB_historyProcessData(l2capDataEvent_t *pMsg);
+bool     SB_historyIsActive();
+void     SB_historyGetStats(SB_HistoryStats *stats);
+
+#endif /* APPLICATION_HISTORY_H_ */
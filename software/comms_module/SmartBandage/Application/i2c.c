@@ -8,6 +8,8 @@
 #include <ti/sysbios/BIOS.h>
 #include <ti/sysbios/knl/Task.h>
 #include <ti/sysbios/knl/Queue.h>
+#include <ti/sysbios/knl/Swi.h>
+#include <ti/sysbios/knl/Clock.h>
 #include <ti/drivers/I2C.h>
 #include <ti/drivers/i2c/I2CCC26XX.h>
 #include <driverlib/i2c.h>
@@ -17,12 +19,9 @@
 
 #include "i2c.h"
 #include "util.h"
+#include "diagnostics.h"
 #include "Devices/mcp9808.h"
 
-#ifdef I2C_ENABLE_TIMEOUT
-#include <ti/sysbios/knl/Clock.h>
-#endif
-
 struct {
 	I2C_Handle handle;
 	Task_Handle i2cTaskHandle;
@@ -36,6 +35,10 @@ struct {
 	Semaphore_Handle i2cProcSem;
 
 	SB_i2cTransaction* currentTransaction;
+	uint32_t currentQueuedAt;
+
+	// Depth is counted under i2cQueueSem, the rest by the transfer callback
+	SB_i2cStats stats;
 
 #ifdef I2C_ENABLE_TIMEOUT
 	Clock_Struct timeoutClock;
@@ -45,11 +48,13 @@ struct {
 typedef struct {
 	Queue_Elem elem;
 	SB_i2cTransaction* transaction;
+	uint32_t queuedAt;
 } I2C_queuedTransaction;
 
 static bool initialized = false;
 
 void SB_i2cTransferCompleteHandler(I2C_Handle handle, I2C_Transaction *transac, bool result);
+static void accountTransfer(uint32_t latencyTicks, bool result);
 
 #ifdef I2C_ENABLE_TIMEOUT
 void SB_i2cTransactionTimeoutHandler(UArg arg);
@@ -98,6 +103,10 @@ static void SB_i2cTask(UArg a0, UArg a1) {
 
 		qp = (I2C_queuedTransaction*) Queue_get(I2C_Core.i2cQueue);
 
+		if (NULL != qp) {
+			--I2C_Core.stats.depth;
+		}
+
 		Semaphore_post(I2C_Core.i2cQueueSem);
 
 		if (NULL == qp) {
@@ -106,6 +115,7 @@ static void SB_i2cTask(UArg a0, UArg a1) {
 		}
 
 		I2C_Core.currentTransaction = (SB_i2cTransaction*)qp->transaction;
+		I2C_Core.currentQueuedAt = qp->queuedAt;
 		free(qp);
 		qp = NULL;
 
@@ -195,6 +205,8 @@ SB_Error SB_i2cInit(I2C_BitRate bitRate) {
 		return I2CInitializationFailedError;
 	}
 
+	SB_diagnosticsRegisterTask(SB_DIAGNOSTICS_TASK_I2C, I2C_Core.i2cTaskHandle);
+
 	// This sem ultimately controls execution and access to the I2C_Core struct. It's initialized to 0
 	// to ensure exclusivity to that variable in this constructor. Post to it to enable execution.
 	Semaphore_post(I2C_Core.i2cProcSem);
@@ -230,15 +242,31 @@ SB_Error SB_i2cQueueTransaction(SB_i2cTransaction* transaction, uint32_t timeout
 	}
 
 	qp->transaction = transaction;
+	qp->queuedAt = Clock_getTicks();
 
 	Queue_enqueue(I2C_Core.i2cQueue, &qp->elem);
 
+	if (++I2C_Core.stats.depth > I2C_Core.stats.maxDepth) {
+		I2C_Core.stats.maxDepth = I2C_Core.stats.depth;
+	}
+
 	Semaphore_post(I2C_Core.i2cDataAvailSem);
 	Semaphore_post(I2C_Core.i2cQueueSem);
 
 	return result;
 }
 
+/**
+ * \brief Copies the transfer counters and the latency histogram.
+ */
+void SB_i2cGetStats(SB_i2cStats *stats) {
+	UInt key = Swi_disable();
+
+	*stats = I2C_Core.stats;
+
+	Swi_restore(key);
+}
+
 void SB_i2cTransferCompleteHandler(I2C_Handle handle, I2C_Transaction *transac, bool result) {
 	Semaphore_post(I2C_Core.i2cProcSem);
 
@@ -247,6 +275,8 @@ void SB_i2cTransferCompleteHandler(I2C_Handle handle, I2C_Transaction *transac,
 #endif
 
 	if (I2C_Core.currentTransaction != NULL) {
+		accountTransfer(Clock_getTicks() - I2C_Core.currentQueuedAt, result);
+
 		I2C_Core.currentTransaction->completionResult = ((result != false) ? NoError : UnknownError);
 
 		if (I2C_Core.currentTransaction->completionSemaphore != NULL) {
@@ -285,3 +315,27 @@ void SB_i2cTransactionTimeoutHandler(UArg arg) {
 //	I2CCC26XX_completeTransfer(I2C_Core.handle);
 }
 #endif
+
+/**
+ * \brief Counts a completed transfer in the latency histogram.
+ * \param latencyTicks Time from queueing the transaction to its completion
+ */
+static void accountTransfer(uint32_t latencyTicks, bool result) {
+	uint32_t latencyMs = latencyTicks / (NTICKS_PER_MILLSECOND);
+	uint8_t bucket = 0;
+
+	while (latencyMs >> bucket && bucket < SB_I2C_LATENCY_BUCKETS - 1) {
+		++bucket;
+	}
+
+	++I2C_Core.stats.transactions;
+	++I2C_Core.stats.latency[bucket];
+
+	if (!result) {
+		++I2C_Core.stats.failures;
+	}
+
+	if (latencyMs > I2C_Core.stats.maxLatencyMs) {
+		I2C_Core.stats.maxLatencyMs = (latencyMs > 0xFFFF) ? 0xFFFF : latencyMs;
+	}
+}
@@ -20,8 +20,21 @@ typedef struct {
 	SB_Error completionResult;
 } SB_i2cTransaction;
 
+// Latency buckets, from queueing to completion: under 1ms, then powers of two up to 64ms and over
+#define SB_I2C_LATENCY_BUCKETS 8
+
+typedef struct {
+	uint32_t transactions;		// Completed transfers
+	uint16_t failures;			// Transfers completed with an error, including timeouts
+	uint8_t  depth;				// Transactions queued and not yet started
+	uint8_t  maxDepth;
+	uint16_t maxLatencyMs;
+	uint16_t latency[SB_I2C_LATENCY_BUCKETS];
+} SB_i2cStats;
+
 SB_Error SB_i2cQueueTransaction(SB_i2cTransaction* transaction, uint32_t timeout);
 SB_Error SB_i2cInit(I2C_BitRate bitRate);
 void SB_i2cSleep();
+void SB_i2cGetStats(SB_i2cStats *stats);
 
 #endif /* APPLICATION_I2C_H_ */
@@ -0,0 +1,740 @@
+/*
+ * liveStream.c
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#include <string.h>
+
+#include <ti/sysbios/knl/Task.h>
+#include <ti/sysbios/knl/Clock.h>
+#include <xdc/runtime/System.h>
+
+#include "att.h"
+#include "linkdb.h"
+
+#include "util.h"
+#include "connEvent.h"
+#include "liveStream.h"
+
+// Queue positions count up and wrap; the slot of a position is taken modulo the queue length
+typedef char SB_LiveStreamQueueCheck[((SB_LIVESTREAM_QUEUE_LEN & (SB_LIVESTREAM_QUEUE_LEN - 1)) == 0) ? 1 : -1];
+
+#define SLOT(position)		((position) % SB_LIVESTREAM_QUEUE_LEN)
+
+typedef struct {
+	uint16_t connHandle;			// INVALID_CONNHANDLE while the link is free
+	uint16_t mtu;
+	uint32_t connectedSince;
+
+	// Position of the next record to send, and the bytes from there to the end of the queue
+	uint16_t cursor;
+	uint16_t queuedBytes;
+	uint16_t sequence;
+
+	uint16_t eventBytes;
+
+	SB_LiveStreamStats stats;
+} SB_LiveStreamLink;
+
+static void     SB_liveStreamClockHandler(UArg arg);
+static SB_LiveStreamLink *findLink(uint16_t connHandle);
+static bool     sendLink(SB_LiveStreamLink *link);
+static uint16_t packetRoom(const SB_LiveStreamLink *link);
+static uint16_t queuedBytes(const SB_LiveStreamLink *link);
+static uint8_t  buildPacket(SB_LiveStreamLink *link, uint16_t room);
+static void     consume(SB_LiveStreamLink *link, uint16_t from, uint8_t count, bool sent);
+static void     dropOldest();
+static void     releaseSent();
+static void     enableConnEventNotice(const SB_LiveStreamLink *link);
+static void     accountConnected(SB_LiveStreamLink *link);
+static void     addStats(SB_LiveStreamStats *total, const SB_LiveStreamStats *stats);
+
+struct {
+	// Records held for the links, oldest first. queueStart is the oldest position still
+	// held and queueEnd the position the next record is written to.
+	uint8_t queue[SB_LIVESTREAM_QUEUE_LEN][SB_SAMPLE_MAX_LEN];
+	uint8_t queueLength[SB_LIVESTREAM_QUEUE_LEN];
+	uint32_t queuedAt[SB_LIVESTREAM_QUEUE_LEN];
+	uint32_t queueBase[SB_LIVESTREAM_QUEUE_LEN];	// Time the delta of each record is relative to
+	uint16_t queueStart;
+	uint16_t queueEnd;
+
+	// Time of the last absolute record pushed
+	uint32_t base;
+	bool baseValid;
+
+	SB_LiveStreamLink links[SB_LIVESTREAM_MAX_LINKS];
+	uint8_t numLinks;
+
+	// Link served first by the next send, so one central cannot take every buffer
+	uint8_t nextLink;
+
+	// Packet built from the queue for one link at a time
+	uint8_t packet[SB_BLE_LIVESTREAM_LEN];
+	uint16_t packetLength;
+	uint32_t packetQueuedAt[SB_LIVESTREAM_MAX_SAMPLES];
+
+	// Set when the oldest queued sample has waited too long for its packet to fill
+	bool flushDue;
+	Clock_Struct latencyClock;
+
+	// Set when the stack ran out of buffers during the last send
+	bool starved;
+
+	// Set while the stream asks for connection event notices, on the link it last sent to
+	bool connEventNotice;
+	uint16_t noticeHandle;
+
+	SB_LiveStreamPendingCB pendingCB;
+
+	// Links that have closed, and records dropped while nobody was connected
+	SB_LiveStreamStats retired;
+} LIVESTREAM = {
+	.noticeHandle = INVALID_CONNHANDLE,
+};
+
+/**
+ * \brief Prepares the live stream.
+ * \param pendingCB Called from task or SWI context when packets are ready. The BLE task
+ * 			should respond by calling SB_liveStreamSend.
+ */
+SB_Error SB_liveStreamInit(SB_LiveStreamPendingCB pendingCB) {
+	uint8_t i;
+
+	LIVESTREAM.pendingCB = pendingCB;
+
+	for (i = 0; i < SB_LIVESTREAM_MAX_LINKS; ++i) {
+		LIVESTREAM.links[i].connHandle = INVALID_CONNHANDLE;
+	}
+
+	if (NULL == Util_constructClock(
+			&LIVESTREAM.latencyClock,
+			SB_liveStreamClockHandler,
+			SB_LIVESTREAM_MAX_LATENCY_MS,
+			0,
+			false,
+			0)) {
+#ifdef SB_DEBUG
+		System_printf("LSTREAM: Failed to initialize latency clock\n");
+		System_flush();
+#endif
+		return OSResourceInitializationError;
+	}
+
+	return NoError;
+}
+
+/**
+ * \brief Queues a sample record for every link. The oldest queued record is dropped if
+ * 			the queue is full.
+ * \return InvalidParameter if the record is malformed, or relative to an absolute record
+ * 			that was never pushed, so it could not be timed
+ */
+SB_Error SB_liveStreamPush(const uint8_t *record, uint8_t length) {
+	SB_LiveStreamLink *link;
+	bool ready = false, first = false;
+	uint8_t i, slot;
+	UInt key;
+
+	if (record == NULL || SB_sampleLength(record, length) != length) {
+		return InvalidParameter;
+	}
+
+	key = Task_disable();
+	if (SB_sampleIsAbsolute(record)) {
+		LIVESTREAM.base = SB_sampleTime(record, 0);
+		LIVESTREAM.baseValid = true;
+	} else if (!LIVESTREAM.baseValid) {
+		Task_restore(key);
+		return InvalidParameter;
+	}
+
+	if ((uint16_t)(LIVESTREAM.queueEnd - LIVESTREAM.queueStart) == SB_LIVESTREAM_QUEUE_LEN) {
+		dropOldest();
+	}
+
+	slot = SLOT(LIVESTREAM.queueEnd);
+	memcpy(LIVESTREAM.queue[slot], record, length);
+	LIVESTREAM.queueLength[slot] = length;
+	LIVESTREAM.queuedAt[slot] = Clock_getTicks();
+	LIVESTREAM.queueBase[slot] = LIVESTREAM.base;
+	++LIVESTREAM.queueEnd;
+
+	for (i = 0; i < SB_LIVESTREAM_MAX_LINKS; ++i) {
+		link = &LIVESTREAM.links[i];
+		if (link->connHandle == INVALID_CONNHANDLE) {
+			continue;
+		}
+
+		link->queuedBytes += length;
+
+		first |= (link->queuedBytes == length);
+		ready |= (link->queuedBytes + SB_SAMPLE_MAX_LEN > packetRoom(link));
+	}
+	Task_restore(key);
+
+	if (first && !Util_isActive(&LIVESTREAM.latencyClock)) {
+		Util_startClock(&LIVESTREAM.latencyClock);
+	}
+
+	if (ready && LIVESTREAM.pendingCB != NULL) {
+		LIVESTREAM.pendingCB();
+	}
+
+	return NoError;
+}
+
+/**
+ * \brief Starts streaming to a new connection at the default MTU, from the oldest record
+ * 			still queued.
+ */
+void SB_liveStreamConnected(uint16_t connHandle) {
+	SB_LiveStreamLink *link = findLink(INVALID_CONNHANDLE);
+	uint16_t position;
+	UInt key;
+
+	if (link == NULL) {
+#ifdef SB_DEBUG
+		System_printf("LSTREAM: No free link for connection %d\n", connHandle);
+		System_flush();
+#endif
+		return;
+	}
+
+	key = Task_disable();
+	memset(link, 0, sizeof(SB_LiveStreamLink));
+	link->mtu = ATT_MTU_SIZE;
+	link->stats.mtu = ATT_MTU_SIZE;
+	link->connectedSince = Clock_getTicks();
+
+	link->cursor = LIVESTREAM.queueStart;
+	for (position = LIVESTREAM.queueStart; position != LIVESTREAM.queueEnd; ++position) {
+		link->queuedBytes += LIVESTREAM.queueLength[SLOT(position)];
+	}
+
+	link->connHandle = connHandle;
+	++LIVESTREAM.numLinks;
+	Task_restore(key);
+
+	if (link->queuedBytes > 0 && !Util_isActive(&LIVESTREAM.latencyClock)) {
+		Util_startClock(&LIVESTREAM.latencyClock);
+	}
+}
+
+/**
+ * \brief Stops streaming to a connection. Records only it had yet to send leave the queue,
+ * 			unless it was the last link: queued samples are kept for the next connection.
+ */
+void SB_liveStreamDisconnected(uint16_t connHandle) {
+	SB_LiveStreamLink *link = findLink(connHandle);
+	UInt key;
+
+	if (link == NULL) {
+		return;
+	}
+
+	accountConnected(link);
+
+	key = Task_disable();
+	addStats(&LIVESTREAM.retired, &link->stats);
+	link->connHandle = INVALID_CONNHANDLE;
+	--LIVESTREAM.numLinks;
+
+	releaseSent();
+	Task_restore(key);
+
+	// The stack stops connection event notices for a closed link, see SB_connEventDisconnected
+	if (LIVESTREAM.noticeHandle == connHandle) {
+		LIVESTREAM.connEventNotice = false;
+		LIVESTREAM.noticeHandle = INVALID_CONNHANDLE;
+		SB_connEventRelease(SB_CONN_EVENT_LIVESTREAM);
+	}
+
+	if (LIVESTREAM.numLinks == 0) {
+		LIVESTREAM.flushDue = false;
+		LIVESTREAM.starved = false;
+
+		Util_stopClock(&LIVESTREAM.latencyClock);
+	} else if ((LIVESTREAM.flushDue || LIVESTREAM.starved) && LIVESTREAM.pendingCB != NULL) {
+		// The sends left waiting may have relied on the notices of this link
+		LIVESTREAM.pendingCB();
+	}
+}
+
+void SB_liveStreamSetMTU(uint16_t connHandle, uint16_t mtu) {
+	SB_LiveStreamLink *link = findLink(connHandle);
+
+	if (link != NULL) {
+		link->mtu = mtu;
+		link->stats.mtu = mtu;
+	}
+}
+
+/**
+ * \brief Sends every full packet to each link, and a partial one if the latency limit was
+ * 			reached.
+ * \remark Must be called from the task registered with ICall.
+ */
+void SB_liveStreamSend() {
+	SB_LiveStreamLink *link;
+	uint8_t i, first = LIVESTREAM.nextLink;
+	bool queued = false;
+
+	if (LIVESTREAM.numLinks == 0) {
+		return;
+	}
+
+	LIVESTREAM.starved = false;
+
+	for (i = 0; i < SB_LIVESTREAM_MAX_LINKS; ++i) {
+		link = &LIVESTREAM.links[(first + i) % SB_LIVESTREAM_MAX_LINKS];
+		if (link->connHandle == INVALID_CONNHANDLE) {
+			continue;
+		}
+
+		// The buffers are shared by every link: once they run out the rest wait too
+		if (!sendLink(link)) {
+			LIVESTREAM.starved = true;
+			break;
+		}
+	}
+
+	LIVESTREAM.nextLink = (first + 1) % SB_LIVESTREAM_MAX_LINKS;
+
+	if (!LIVESTREAM.starved) {
+		LIVESTREAM.flushDue = false;
+
+		for (i = 0; i < SB_LIVESTREAM_MAX_LINKS; ++i) {
+			link = &LIVESTREAM.links[i];
+			queued |= (link->connHandle != INVALID_CONNHANDLE && queuedBytes(link) > 0);
+		}
+
+		// Bound the latency of the samples left over
+		if (queued && !Util_isActive(&LIVESTREAM.latencyClock)) {
+			Util_startClock(&LIVESTREAM.latencyClock);
+		}
+	}
+}
+
+/**
+ * \brief Sends every queued record to each link now, in partial packets if need be.
+ * 			Whatever the stack has no buffers for is sent after the following connection
+ * 			events, until SB_liveStreamIsPending returns false.
+ * \remark Must be called from the task registered with ICall.
+ */
+void SB_liveStreamFlush() {
+	if (LIVESTREAM.numLinks == 0) {
+		return;
+	}
+
+	LIVESTREAM.flushDue = true;
+	SB_liveStreamSend();
+}
+
+/**
+ * \brief Accounts for the bytes sent during a connection event and continues streaming.
+ * \remark Must be called from the task registered with ICall at the end of each connection event.
+ */
+void SB_liveStreamConnEvent() {
+	SB_LiveStreamLink *link;
+	bool busy = LIVESTREAM.starved;
+	uint8_t i;
+
+	if (!LIVESTREAM.connEventNotice) {
+		return;
+	}
+
+	// Notices come from a single link, which another user of them may have chosen; the
+	// events of the others are not seen
+	link = findLink(SB_connEventHandle());
+	if (link != NULL) {
+		++link->stats.connectionEvents;
+		link->stats.connectionEventBytes += link->eventBytes;
+		if (link->eventBytes > link->stats.maxBytesPerEvent) {
+			link->stats.maxBytesPerEvent = link->eventBytes;
+		}
+	}
+
+	for (i = 0; i < SB_LIVESTREAM_MAX_LINKS; ++i) {
+		busy |= (LIVESTREAM.links[i].eventBytes > 0);
+		LIVESTREAM.links[i].eventBytes = 0;
+	}
+
+	// Only keep the notice while there is traffic to measure
+	if (!busy) {
+		LIVESTREAM.connEventNotice = false;
+		LIVESTREAM.noticeHandle = INVALID_CONNHANDLE;
+		SB_connEventRelease(SB_CONN_EVENT_LIVESTREAM);
+	}
+
+	SB_liveStreamSend();
+}
+
+/**
+ * \brief True while a link has more records queued than fit in its next packet, or the
+ * 			stack could not take the last one.
+ */
+bool SB_liveStreamIsBacklogged() {
+	SB_LiveStreamLink *link;
+	uint8_t i;
+
+	if (LIVESTREAM.numLinks == 0) {
+		return false;
+	}
+
+	if (LIVESTREAM.starved) {
+		return true;
+	}
+
+	for (i = 0; i < SB_LIVESTREAM_MAX_LINKS; ++i) {
+		link = &LIVESTREAM.links[i];
+		if (link->connHandle != INVALID_CONNHANDLE && queuedBytes(link) > packetRoom(link)) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/**
+ * \brief True until the stack has taken the packets due: a send waits for buffers, or a
+ * 			flush has yet to run.
+ */
+bool SB_liveStreamIsPending() {
+	return LIVESTREAM.flushDue || LIVESTREAM.starved;
+}
+
+/**
+ * \brief Brings the connected time up to date and copies the statistics of every link
+ * 			since boot.
+ * \remark Must be called from the task registered with ICall.
+ */
+void SB_liveStreamGetStats(SB_LiveStreamStats *stats) {
+	SB_LiveStreamLink *link;
+	uint8_t i;
+	UInt key;
+
+	for (i = 0; i < SB_LIVESTREAM_MAX_LINKS; ++i) {
+		accountConnected(&LIVESTREAM.links[i]);
+	}
+
+	key = Task_disable();
+	*stats = LIVESTREAM.retired;
+
+	for (i = 0; i < SB_LIVESTREAM_MAX_LINKS; ++i) {
+		link = &LIVESTREAM.links[i];
+		if (link->connHandle != INVALID_CONNHANDLE) {
+			addStats(stats, &link->stats);
+		}
+	}
+	Task_restore(key);
+}
+
+/**
+ * \brief Brings the connected time up to date and copies the statistics of one link since
+ * 			it connected.
+ * \remark Must be called from the task registered with ICall.
+ * \param link Index of the link, below SB_LIVESTREAM_MAX_LINKS
+ * \return Connection handle of the link, or INVALID_CONNHANDLE if it is not in use
+ */
+uint16_t SB_liveStreamGetLinkStats(uint8_t link, SB_LiveStreamStats *stats) {
+	if (link >= SB_LIVESTREAM_MAX_LINKS || LIVESTREAM.links[link].connHandle == INVALID_CONNHANDLE) {
+		memset(stats, 0, sizeof(SB_LiveStreamStats));
+		return INVALID_CONNHANDLE;
+	}
+
+	accountConnected(&LIVESTREAM.links[link]);
+
+	*stats = LIVESTREAM.links[link].stats;
+
+	return LIVESTREAM.links[link].connHandle;
+}
+
+static void SB_liveStreamClockHandler(UArg arg) {
+	LIVESTREAM.flushDue = true;
+
+	if (LIVESTREAM.pendingCB != NULL) {
+		LIVESTREAM.pendingCB();
+	}
+}
+
+static SB_LiveStreamLink *findLink(uint16_t connHandle) {
+	uint8_t i;
+
+	for (i = 0; i < SB_LIVESTREAM_MAX_LINKS; ++i) {
+		if (LIVESTREAM.links[i].connHandle == connHandle) {
+			return &LIVESTREAM.links[i];
+		}
+	}
+
+	return NULL;
+}
+
+/**
+ * \brief Sends the packets due on one link.
+ * \return False if the stack ran out of buffers
+ */
+static bool sendLink(SB_LiveStreamLink *link) {
+	bStatus_t status;
+	uint16_t room, queued, from;
+	uint32_t now, latencyMs;
+	uint8_t i, count;
+
+	while (true) {
+		room = packetRoom(link);
+		queued = queuedBytes(link);
+
+		// Wait for the packet to fill, unless another record would not fit anyway
+		if (queued == 0 || (queued + SB_SAMPLE_MAX_LEN <= room && !LIVESTREAM.flushDue)) {
+			return true;
+		}
+
+		// Nobody is listening on this link: leave the samples queued for when they subscribe
+		if (!SB_Profile_NotificationsEnabled(SB_CHARACTERISTIC_LIVESTREAM, link->connHandle)) {
+			return true;
+		}
+
+		from = link->cursor;
+		count = buildPacket(link, room);
+
+		status = SB_Profile_Notify(SB_CHARACTERISTIC_LIVESTREAM, link->connHandle,
+				LIVESTREAM.packet, LIVESTREAM.packetLength);
+
+		if (status == SUCCESS) {
+			consume(link, from, count, true);
+
+			++link->stats.packetsSent;
+			link->stats.samplesSent += count;
+			link->stats.bytesSent += LIVESTREAM.packetLength;
+			link->eventBytes += LIVESTREAM.packetLength;
+
+			now = Clock_getTicks();
+			for (i = 0; i < count; ++i) {
+				latencyMs = (now - LIVESTREAM.packetQueuedAt[i]) / (NTICKS_PER_MILLSECOND);
+
+				link->stats.latencyTotalMs += latencyMs;
+				if (latencyMs > link->stats.maxLatencyMs) {
+					link->stats.maxLatencyMs = latencyMs;
+				}
+			}
+
+			enableConnEventNotice(link);
+		} else if (status == MSG_BUFFER_NOT_AVAIL || status == blePending) {
+			// The stack's buffers are full: build the packet again once a connection event
+			// has drained them
+			++link->stats.sendRetries;
+
+			enableConnEventNotice(link);
+			return false;
+		} else {
+			// Dropped. The client sees the gap in the sequence numbers.
+#ifdef SB_DEBUG
+			System_printf("LSTREAM: Packet %d to %d dropped: %d\n", link->sequence, link->connHandle, status);
+			System_flush();
+#endif
+			consume(link, from, count, false);
+			return true;
+		}
+	}
+}
+
+/**
+ * \brief Bytes of records that fit in one notification at the MTU of a link.
+ */
+static uint16_t packetRoom(const SB_LiveStreamLink *link) {
+	uint16_t payload = link->mtu - 3;
+
+	if (payload > SB_BLE_LIVESTREAM_LEN) {
+		payload = SB_BLE_LIVESTREAM_LEN;
+	}
+
+	return payload - SB_LIVESTREAM_HEADER_LEN;
+}
+
+static uint16_t queuedBytes(const SB_LiveStreamLink *link) {
+	uint16_t bytes;
+	UInt key = Task_disable();
+
+	bytes = link->queuedBytes;
+	Task_restore(key);
+
+	return bytes;
+}
+
+/**
+ * \brief Copies as many records from the cursor of a link into the packet as fit in room
+ * 			bytes. A record is always taken, as the smallest MTU fits the largest record.
+ * 			The records are encoded again for the packet, starting with an absolute one,
+ * 			so the packet can be timed whatever the client missed before it.
+ * \return Number of records in the packet
+ */
+static uint8_t buildPacket(SB_LiveStreamLink *link, uint16_t room) {
+	uint8_t *p = LIVESTREAM.packet + SB_LIVESTREAM_HEADER_LEN;
+	uint8_t record[SB_SAMPLE_MAX_LEN];
+	SB_SampleCodec queued, packed;
+	SB_Sample sample;
+	uint8_t slot, length, count = 0;
+	uint16_t position;
+	UInt key;
+
+	memset(&packed, 0, sizeof(packed));
+
+	key = Task_disable();
+	for (position = link->cursor; position != LIVESTREAM.queueEnd; ++position) {
+		slot = SLOT(position);
+
+		queued.base = LIVESTREAM.queueBase[slot];
+		queued.sinceAbsolute = 0;
+		queued.valid = true;
+		SB_sampleDecode(&queued, LIVESTREAM.queue[slot], LIVESTREAM.queueLength[slot], &sample);
+
+		length = SB_sampleEncode(&packed, &sample, record);
+		if (count > 0 && (p - LIVESTREAM.packet) - SB_LIVESTREAM_HEADER_LEN + length > room) {
+			break;
+		}
+
+		memcpy(p, record, length);
+		p += length;
+		LIVESTREAM.packetQueuedAt[count] = LIVESTREAM.queuedAt[slot];
+		++count;
+	}
+
+	// Drops in SB_liveStreamPush also advance the sequence
+	LIVESTREAM.packet[0] = LO_UINT16(link->sequence);
+	LIVESTREAM.packet[1] = HI_UINT16(link->sequence);
+	Task_restore(key);
+
+	LIVESTREAM.packet[2] = count;
+
+	LIVESTREAM.packetLength = p - LIVESTREAM.packet;
+
+	return count;
+}
+
+/**
+ * \brief Moves the cursor of a link past the records of a packet built from position from,
+ * 			and releases the records every link has now sent.
+ * \remark Records dropped from the queue while the packet was with the stack have already
+ * 			moved the cursor, and are skipped.
+ */
+static void consume(SB_LiveStreamLink *link, uint16_t from, uint8_t count, bool sent) {
+	uint16_t end = from + count;
+	UInt key;
+
+	key = Task_disable();
+	while ((int16_t)(end - link->cursor) > 0) {
+		link->queuedBytes -= LIVESTREAM.queueLength[SLOT(link->cursor)];
+		++link->cursor;
+	}
+
+	++link->sequence;
+
+	if (!sent) {
+		link->stats.samplesDropped += count;
+	}
+
+	releaseSent();
+	Task_restore(key);
+}
+
+/**
+ * \brief Makes room for a record by dropping the oldest. Links yet to send it see a gap.
+ * \remark Must be called with tasks disabled.
+ */
+static void dropOldest() {
+	SB_LiveStreamLink *link;
+	uint8_t length = LIVESTREAM.queueLength[SLOT(LIVESTREAM.queueStart)];
+	uint8_t i;
+
+	if (LIVESTREAM.numLinks == 0) {
+		++LIVESTREAM.retired.samplesDropped;
+	}
+
+	for (i = 0; i < SB_LIVESTREAM_MAX_LINKS; ++i) {
+		link = &LIVESTREAM.links[i];
+		if (link->connHandle != INVALID_CONNHANDLE && link->cursor == LIVESTREAM.queueStart) {
+			link->queuedBytes -= length;
+			++link->cursor;
+			++link->stats.samplesDropped;
+
+			// Tells the client that records are missing
+			++link->sequence;
+		}
+	}
+
+	++LIVESTREAM.queueStart;
+}
+
+/**
+ * \brief Releases the records every link has sent. With no link connected they are kept.
+ * \remark Must be called with tasks disabled.
+ */
+static void releaseSent() {
+	SB_LiveStreamLink *link;
+	uint16_t behind, oldest = LIVESTREAM.queueEnd - LIVESTREAM.queueStart;
+	uint8_t i;
+
+	if (LIVESTREAM.numLinks == 0) {
+		return;
+	}
+
+	for (i = 0; i < SB_LIVESTREAM_MAX_LINKS; ++i) {
+		link = &LIVESTREAM.links[i];
+		if (link->connHandle == INVALID_CONNHANDLE) {
+			continue;
+		}
+
+		behind = link->cursor - LIVESTREAM.queueStart;
+		if (behind < oldest) {
+			oldest = behind;
+		}
+	}
+
+	LIVESTREAM.queueStart += oldest;
+}
+
+static void enableConnEventNotice(const SB_LiveStreamLink *link) {
+	if (!LIVESTREAM.connEventNotice) {
+		LIVESTREAM.connEventNotice = true;
+		LIVESTREAM.noticeHandle = link->connHandle;
+		SB_connEventRequest(SB_CONN_EVENT_LIVESTREAM, link->connHandle);
+	}
+}
+
+/**
+ * \brief Adds the time connected since the last call to the statistics of a link.
+ */
+static void accountConnected(SB_LiveStreamLink *link) {
+	uint32_t elapsedMs;
+
+	if (link->connHandle == INVALID_CONNHANDLE) {
+		return;
+	}
+
+	elapsedMs = (Clock_getTicks() - link->connectedSince) / (NTICKS_PER_MILLSECOND);
+	link->stats.connectedMs += elapsedMs;
+	link->connectedSince += elapsedMs * (NTICKS_PER_MILLSECOND);
+}
+
+static void addStats(SB_LiveStreamStats *total, const SB_LiveStreamStats *stats) {
+	total->packetsSent += stats->packetsSent;
+	total->samplesSent += stats->samplesSent;
+	total->bytesSent += stats->bytesSent;
+	total->samplesDropped += stats->samplesDropped;
+	total->sendRetries += stats->sendRetries;
+	total->connectionEvents += stats->connectionEvents;
+	total->connectionEventBytes += stats->connectionEventBytes;
+	total->connectedMs += stats->connectedMs;
+	total->latencyTotalMs += stats->latencyTotalMs;
+
+	if (stats->maxLatencyMs > total->maxLatencyMs) {
+		total->maxLatencyMs = stats->maxLatencyMs;
+	}
+	if (stats->maxBytesPerEvent > total->maxBytesPerEvent) {
+		total->maxBytesPerEvent = stats->maxBytesPerEvent;
+	}
+	if (stats->mtu > total->mtu) {
+		total->mtu = stats->mtu;
+	}
+}
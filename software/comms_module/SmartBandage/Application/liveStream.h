@@ -0,0 +1,87 @@
+/*
+ * @file liveStream.h
+ * @brief Batches sample records into MTU sized notifications of the live stream characteristic.
+ *
+ * Records are queued by the peripheral manager and sent by the BLE task. A packet is
+ * only sent once it is full for the negotiated MTU or its oldest record has waited
+ * SB_LIVESTREAM_MAX_LATENCY_MS, so the radio carries many samples per notification.
+ *
+ * Each connected central has its own cursor into the one queue of encoded records,
+ * along with its own MTU, sequence numbers and statistics. A record is copied into
+ * a packet for every subscribed link, and leaves the queue once every link has sent
+ * it. A link only moves its cursor when the stack accepts the packet, so a send
+ * deferred for lack of buffers is simply built again later.
+ *
+ * Packet layout (little endian):
+ *   uint16_t sequence   Incremented for every packet, so the client can detect gaps
+ *   uint8_t  count      Number of sample records that follow
+ *   count x sample record, as described in sampleRecord.h. The first is always absolute.
+ *
+ * Records lost from a full queue also skip a sequence number of every link that had
+ * not sent them. As every packet starts with an absolute record, the client still
+ * times every packet it does receive.
+ *
+ * The statistics measure the link as the application sees it, so the effect of the
+ * MTU, the connection parameters and the packing can be compared on the device:
+ * throughput is bytesSent over connectedMs, the mean latency from queueing a sample
+ * to handing it to the stack is latencyTotalMs over samplesSent, and the radio
+ * events used are counted in connectionEvents. They are kept for each link, and
+ * summed over every link since boot. live_stream/testLiveStream.c in the host
+ * tests drives this module and the profile over a simulated ATT bearer and
+ * reports the same figures for a set of MTUs, intervals and buffer limits.
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef APPLICATION_LIVESTREAM_H_
+#define APPLICATION_LIVESTREAM_H_
+
+#include "bcomdef.h"
+
+#include "Board.h"
+#include "sampleRecord.h"
+#include "../PROFILES/smartBandageProfile.h"
+
+#define SB_LIVESTREAM_HEADER_LEN		3
+#define SB_LIVESTREAM_MAX_SAMPLES		((SB_BLE_LIVESTREAM_LEN - SB_LIVESTREAM_HEADER_LEN) / SB_SAMPLE_MIN_LEN)
+
+// Records held while waiting for a packet to fill. The oldest is dropped on overflow.
+#define SB_LIVESTREAM_QUEUE_LEN			32
+
+// Longest a sample waits for its packet to fill before a partial packet is sent
+#define SB_LIVESTREAM_MAX_LATENCY_MS	10000
+
+// Centrals streamed to at once
+#define SB_LIVESTREAM_MAX_LINKS			MAX_NUM_BLE_CONNS
+
+typedef struct {
+	uint32_t packetsSent;
+	uint32_t samplesSent;
+	uint32_t bytesSent;
+	uint32_t samplesDropped;		// Overwritten in the queue before they could be sent
+	uint32_t sendRetries;			// Sends deferred for lack of stack buffers
+	uint32_t connectionEvents;		// Connection events observed while streaming
+	uint32_t connectionEventBytes;	// Bytes queued to the stack over those events
+	uint32_t connectedMs;			// Time spent connected
+	uint32_t latencyTotalMs;		// Sum over sent samples of the time from queueing to sending
+	uint32_t maxLatencyMs;
+	uint16_t maxBytesPerEvent;
+	uint16_t mtu;					// Largest over the links in the totals
+} SB_LiveStreamStats;
+
+typedef void (*SB_LiveStreamPendingCB)(void);
+
+SB_Error SB_liveStreamInit(SB_LiveStreamPendingCB pendingCB);
+SB_Error SB_liveStreamPush(const uint8_t *record, uint8_t length);
+void     SB_liveStreamConnected(uint16_t connHandle);
+void     SB_liveStreamDisconnected(uint16_t connHandle);
+void     SB_liveStreamSetMTU(uint16_t connHandle, uint16_t mtu);
+void     SB_liveStreamSend();
+void     SB_liveStreamFlush();
+void     SB_liveStreamConnEvent();
+bool     SB_liveStreamIsBacklogged();
+bool     SB_liveStreamIsPending();
+void     SB_liveStreamGetStats(SB_LiveStreamStats *stats);
+uint16_t SB_liveStreamGetLinkStats(uint8_t link, SB_LiveStreamStats *stats);
+
+#endif /* APPLICATION_LIVESTREAM_H_ */
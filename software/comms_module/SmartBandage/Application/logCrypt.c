@@ -0,0 +1,359 @@
+/*
+ * logCrypt.c
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#include <string.h>
+
+#include <ti/sysbios/BIOS.h>
+#include <ti/sysbios/knl/Clock.h>
+#include <ti/sysbios/knl/Semaphore.h>
+#include <ti/drivers/crypto/CryptoCC26XX.h>
+#include <xdc/runtime/System.h>
+
+#include <inc/hw_types.h>
+#include <inc/hw_memmap.h>
+#include <inc/hw_fcfg1.h>
+
+#include "osal_snv.h"
+
+#include "util.h"
+#include "logCrypt.h"
+
+// Constant words of the counter block and key derivation input
+#define SB_LOGCRYPT_COUNTER_LABEL		0x43524C53 // "SLRC"
+#define SB_LOGCRYPT_KEY_LABEL			0x4B4C4253 // "SBLK"
+
+static SB_Error aesEncryptBlock(int keyIndex, uint32_t *in, uint32_t *out);
+static SB_Error deriveKey(uint32_t *key);
+static SB_Error nextEpoch(void);
+static SB_Error xorKeystream(uint32_t address, uint8_t *data, uint16_t length, uint32_t epoch, uint32_t nonce);
+static SB_Error encryptChunk(uint32_t address, const uint8_t *data, uint16_t length, uint32_t epoch, uint32_t nonce, uint16_t *crc);
+static uint16_t chunkLength(uint32_t address, uint16_t length);
+
+struct {
+	CryptoCC26XX_Handle handle;
+	int keyIndex;
+	bool keyReady;
+	uint32_t epoch;
+
+	// Posted by the BLE task once the key has been loaded, or failed to load
+	Semaphore_Struct keyLoaded;
+
+	// Protects the pipeline buffer
+	Semaphore_Handle lock;
+
+	uint8_t buffer[SB_LOGCRYPT_CHUNK_LEN];
+
+	SB_LogCryptStats stats;
+} LOGCRYPT;
+
+/**
+ * \brief Opens the crypto engine. The key is loaded later by SB_logCryptLoadKey.
+ */
+SB_Error SB_logCryptInit() {
+	Semaphore_Params semParams;
+
+	Semaphore_Params_init(&semParams);
+	semParams.mode = Semaphore_Mode_BINARY;
+	Semaphore_construct(&LOGCRYPT.keyLoaded, 0, &semParams);
+
+	// Initialize the pipeline semaphore with 1 free resource (use as mutex)
+	LOGCRYPT.lock = Semaphore_create(1, NULL, NULL);
+	if (LOGCRYPT.lock == NULL) {
+		return OSResourceInitializationError;
+	}
+
+	CryptoCC26XX_init();
+
+	LOGCRYPT.handle = CryptoCC26XX_open(Board_CRYPTO, false, NULL);
+	if (LOGCRYPT.handle == NULL) {
+#ifdef SB_DEBUG
+		System_printf("LCRYPT: Failed to open crypto engine\n");
+		System_flush();
+#endif
+		return OSResourceInitializationError;
+	}
+
+	return NoError;
+}
+
+/**
+ * \brief Loads the bandage's log key from SNV, deriving and storing it on first boot, and
+ * 			starts a new key epoch.
+ * \remark Must be called from a task registered with ICall. Wakes any task waiting in
+ * 			SB_logCryptWaitKey whether or not the key could be loaded.
+ */
+SB_Error SB_logCryptLoadKey() {
+	uint32_t key[SB_LOGCRYPT_KEY_LEN / sizeof(uint32_t)];
+	SB_Error result = NoError;
+
+	if (LOGCRYPT.handle == NULL) {
+		result = ResourceNotInitialized;
+	} else if (SUCCESS != osal_snv_read(SB_LOGCRYPT_KEY_NV_ID, SB_LOGCRYPT_KEY_LEN, key)) {
+		// No key yet: this is the first boot of the bandage
+		if (NoError == (result = deriveKey(key))
+				&& SUCCESS != osal_snv_write(SB_LOGCRYPT_KEY_NV_ID, SB_LOGCRYPT_KEY_LEN, key)) {
+			result = UnknownError;
+		}
+
+		LOGCRYPT.stats.keyDerived = (result == NoError);
+	}
+
+	// The key is only usable once this boot's epoch is stored
+	if (result == NoError) {
+		result = nextEpoch();
+	}
+
+	if (result == NoError) {
+		LOGCRYPT.keyIndex = CryptoCC26XX_allocateKey(LOGCRYPT.handle, CRYPTOCC26XX_KEY_ANY, key);
+		LOGCRYPT.keyReady = (LOGCRYPT.keyIndex != CRYPTOCC26XX_STATUS_ERROR);
+		if (!LOGCRYPT.keyReady) {
+			result = OutOfMemory;
+		}
+	}
+
+	memset(key, 0, sizeof(key));
+
+#ifdef SB_DEBUG
+	if (result != NoError) {
+		System_printf("LCRYPT: Log key unavailable: %d\n", result);
+		System_flush();
+	}
+#endif
+
+	Semaphore_post(Semaphore_handle(&LOGCRYPT.keyLoaded));
+
+	return result;
+}
+
+/**
+ * \brief Blocks until SB_logCryptLoadKey has run.
+ */
+SB_Error SB_logCryptWaitKey(uint32_t timeout) {
+	Semaphore_Handle keyLoaded = Semaphore_handle(&LOGCRYPT.keyLoaded);
+
+	if (!Semaphore_pend(keyLoaded, timeout)) {
+		return SemaphorePendTimeout;
+	}
+
+	// Leave it posted for the next waiter
+	Semaphore_post(keyLoaded);
+
+	return LOGCRYPT.keyReady ? NoError : ResourceNotInitialized;
+}
+
+/**
+ * \brief The key epoch of this boot, to be stored with the data it encrypts.
+ */
+uint32_t SB_logCryptGetEpoch() {
+	return LOGCRYPT.epoch;
+}
+
+/**
+ * \brief Encrypts and programs data. Once the DMA has moved a program page into the flash,
+ * 			the next page is encrypted into the same buffer while the part programs.
+ * \param epoch The key epoch when the flash at address was last erased
+ * \param nonce Must change every time the flash at address is erased within an epoch
+ * \param crc Updated with the CRC16 of the ciphertext
+ */
+SB_Error SB_logCryptWrite(uint32_t address, const uint8_t *data, uint16_t length, uint32_t epoch, uint32_t nonce, uint16_t *crc) {
+	SB_Error result = NoError;
+	uint32_t start, mark;
+	uint16_t chunk;
+
+	if (data == NULL || length == 0 || crc == NULL) {
+		return InvalidParameter;
+	}
+
+	if (!LOGCRYPT.keyReady) {
+		return ResourceNotInitialized;
+	}
+
+	if (!Semaphore_pend(LOGCRYPT.lock, BIOS_WAIT_FOREVER)) {
+		return SemaphorePendTimeout;
+	}
+
+	start = Clock_getTicks();
+
+	chunk = chunkLength(address, length);
+	result = encryptChunk(address, data, chunk, epoch, nonce, crc);
+
+	while (result == NoError) {
+		// Waits for the previous page to finish programming, then starts the DMA
+		mark = Clock_getTicks();
+		if (!extFlashWriteAsync(address, chunk, LOGCRYPT.buffer, NULL) || !extFlashWaitAsync()) {
+			result = FlashIOError;
+			break;
+		}
+		LOGCRYPT.stats.flashWaitTicks += Clock_getTicks() - mark;
+		++LOGCRYPT.stats.chunksWritten;
+
+		address += chunk;
+		data += chunk;
+		length -= chunk;
+
+		if (length == 0) {
+			break;
+		}
+
+		// Encrypt the next page while this one programs
+		chunk = chunkLength(address, length);
+		result = encryptChunk(address, data, chunk, epoch, nonce, crc);
+	}
+
+	LOGCRYPT.stats.writeTicks += Clock_getTicks() - start;
+
+	Semaphore_post(LOGCRYPT.lock);
+
+	return result;
+}
+
+/**
+ * \brief Encrypts or decrypts data in place, as stored at address.
+ */
+SB_Error SB_logCryptApply(uint32_t address, uint8_t *data, uint16_t length, uint32_t epoch, uint32_t nonce) {
+	if (data == NULL) {
+		return InvalidParameter;
+	}
+
+	if (!LOGCRYPT.keyReady) {
+		return ResourceNotInitialized;
+	}
+
+	return xorKeystream(address, data, length, epoch, nonce);
+}
+
+void SB_logCryptGetStats(SB_LogCryptStats *stats) {
+	*stats = LOGCRYPT.stats;
+}
+
+static SB_Error aesEncryptBlock(int keyIndex, uint32_t *in, uint32_t *out) {
+	CryptoCC26XX_AESECB_Transaction transaction;
+
+	CryptoCC26XX_Transac_init((CryptoCC26XX_Transaction *)&transaction, CRYPTOCC26XX_OP_AES_ECB_ENCRYPT);
+
+	transaction.keyIndex = keyIndex;
+	transaction.msgIn = in;
+	transaction.msgOut = out;
+
+	if (CRYPTOCC26XX_STATUS_SUCCESS != CryptoCC26XX_transactPolling(LOGCRYPT.handle, (CryptoCC26XX_Transaction *)&transaction)) {
+		return UnknownError;
+	}
+
+	return NoError;
+}
+
+/**
+ * \brief Derives the bandage's key from the root key and the chip's unique BLE address.
+ */
+static SB_Error deriveKey(uint32_t *key) {
+	static const uint8_t rootKeyBytes[SB_LOGCRYPT_KEY_LEN] = SB_LOGCRYPT_ROOT_KEY;
+	uint32_t rootKey[SB_LOGCRYPT_KEY_LEN / sizeof(uint32_t)];
+	uint32_t input[SB_LOGCRYPT_BLOCK_LEN / sizeof(uint32_t)];
+	SB_Error result;
+	int rootIndex;
+
+	memcpy(rootKey, rootKeyBytes, sizeof(rootKey));
+
+	input[0] = HWREG(FCFG1_BASE + FCFG1_O_MAC_BLE_0);
+	input[1] = HWREG(FCFG1_BASE + FCFG1_O_MAC_BLE_1);
+	input[2] = Clock_getTicks();
+	input[3] = SB_LOGCRYPT_KEY_LABEL;
+
+	rootIndex = CryptoCC26XX_allocateKey(LOGCRYPT.handle, CRYPTOCC26XX_KEY_ANY, rootKey);
+	memset(rootKey, 0, sizeof(rootKey));
+
+	if (rootIndex == CRYPTOCC26XX_STATUS_ERROR) {
+		return OutOfMemory;
+	}
+
+	result = aesEncryptBlock(rootIndex, input, key);
+
+	CryptoCC26XX_releaseKey(LOGCRYPT.handle, &rootIndex);
+
+	return result;
+}
+
+/**
+ * \brief Advances the key epoch stored in SNV. A failed write leaves the key unusable
+ * 			rather than risk reusing an epoch.
+ */
+static SB_Error nextEpoch(void) {
+	uint32_t epoch;
+
+	// No epoch yet on the first boot
+	if (SUCCESS != osal_snv_read(SB_LOGCRYPT_EPOCH_NV_ID, sizeof(epoch), &epoch)) {
+		epoch = 0;
+	}
+
+	++epoch;
+
+	if (SUCCESS != osal_snv_write(SB_LOGCRYPT_EPOCH_NV_ID, sizeof(epoch), &epoch)) {
+		return UnknownError;
+	}
+
+	LOGCRYPT.epoch = epoch;
+
+	return NoError;
+}
+
+/**
+ * \brief XORs data with the keystream of the flash bytes it occupies. Each keystream block
+ * 			is AES(key, nonce | block address | label | epoch) for a 16 byte aligned flash block.
+ */
+static SB_Error xorKeystream(uint32_t address, uint8_t *data, uint16_t length, uint32_t epoch, uint32_t nonce) {
+	uint32_t counter[SB_LOGCRYPT_BLOCK_LEN / sizeof(uint32_t)];
+	uint32_t keystream[SB_LOGCRYPT_BLOCK_LEN / sizeof(uint32_t)];
+	uint8_t offset, count, i;
+
+	while (length > 0) {
+		offset = address % SB_LOGCRYPT_BLOCK_LEN;
+		count = SB_LOGCRYPT_BLOCK_LEN - offset;
+		if (count > length) {
+			count = length;
+		}
+
+		counter[0] = nonce;
+		counter[1] = address / SB_LOGCRYPT_BLOCK_LEN;
+		counter[2] = SB_LOGCRYPT_COUNTER_LABEL;
+		counter[3] = epoch;
+
+		if (NoError != aesEncryptBlock(LOGCRYPT.keyIndex, counter, keystream)) {
+			return UnknownError;
+		}
+
+		for (i = 0; i < count; ++i) {
+			data[i] ^= ((uint8_t*)keystream)[offset + i];
+		}
+
+		address += count;
+		data += count;
+		length -= count;
+	}
+
+	return NoError;
+}
+
+static SB_Error encryptChunk(uint32_t address, const uint8_t *data, uint16_t length, uint32_t epoch, uint32_t nonce, uint16_t *crc) {
+	uint32_t start = Clock_getTicks();
+	SB_Error result;
+
+	memcpy(LOGCRYPT.buffer, data, length);
+	result = xorKeystream(address, LOGCRYPT.buffer, length, epoch, nonce);
+	*crc = Util_crc16(*crc, LOGCRYPT.buffer, length);
+
+	LOGCRYPT.stats.encryptTicks += Clock_getTicks() - start;
+
+	return result;
+}
+
+/**
+ * \brief Length of the next pipeline chunk: up to the end of the program page at address.
+ */
+static uint16_t chunkLength(uint32_t address, uint16_t length) {
+	uint16_t chunk = SB_LOGCRYPT_CHUNK_LEN - (address % SB_LOGCRYPT_CHUNK_LEN);
+
+	return (length < chunk) ? length : chunk;
+}
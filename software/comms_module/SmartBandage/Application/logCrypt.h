@@ -0,0 +1,61 @@
+/*
+ * @file logCrypt.h
+ * @brief AES-CTR encryption of log data at rest in the external flash.
+ *
+ * The keystream for a byte depends on its flash address, on the sequence
+ * number of the sector holding it and on the key epoch the sector was opened
+ * in. Sector sequence numbers increase every time a sector is erased and
+ * reopened, but start over when a log recovers empty. The key epoch counts
+ * boots in SNV next to the key, so a keystream block is never reused.
+ * Writes are split at program page boundaries: once the DMA has moved a page
+ * into the flash, the next page is encrypted while the part programs.
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef APPLICATION_LOGCRYPT_H_
+#define APPLICATION_LOGCRYPT_H_
+
+#include "bcomdef.h"
+
+#include "Board.h"
+#include "../Board/Devices/ext_flash.h"
+
+// SNV item holding the bandage's log key
+#define SB_LOGCRYPT_KEY_NV_ID			(BLE_NVID_CUST_START + 1)
+
+// SNV item holding the key epoch, incremented each time the key is loaded
+#define SB_LOGCRYPT_EPOCH_NV_ID			(BLE_NVID_CUST_START + 2)
+
+#define SB_LOGCRYPT_KEY_LEN				16
+#define SB_LOGCRYPT_BLOCK_LEN			16
+
+// Pipeline stage size. Chunks never cross a program page.
+#define SB_LOGCRYPT_CHUNK_LEN			EXT_FLASH_PROGRAM_PAGE_SIZE
+
+// Root used to derive the key of each bandage on its first boot. Override at provisioning.
+#ifndef SB_LOGCRYPT_ROOT_KEY
+#define SB_LOGCRYPT_ROOT_KEY			{ 0x53, 0x6D, 0x61, 0x72, 0x74, 0x42, 0x61, 0x6E, \
+										  0x64, 0x61, 0x67, 0x65, 0x4C, 0x6F, 0x67, 0x4B }
+#endif
+
+// How long log initialization waits for the BLE task to load the key
+#define SB_LOGCRYPT_KEY_TIMEOUT			(5 * NTICKS_PER_SECOND)
+
+typedef struct {
+	uint32_t chunksWritten;
+	uint32_t encryptTicks;		// Time spent generating keystream on the write path
+	uint32_t flashWaitTicks;	// Time spent blocked on the flash on the write path
+	uint32_t writeTicks;		// Total time of encrypted writes
+	bool     keyDerived;		// The key was derived on this boot rather than loaded
+} SB_LogCryptStats;
+
+SB_Error SB_logCryptInit();
+SB_Error SB_logCryptLoadKey();
+SB_Error SB_logCryptWaitKey(uint32_t timeout);
+uint32_t SB_logCryptGetEpoch();
+SB_Error SB_logCryptWrite(uint32_t address, const uint8_t *data, uint16_t length, uint32_t epoch, uint32_t nonce, uint16_t *crc);
+SB_Error SB_logCryptApply(uint32_t address, uint8_t *data, uint16_t length, uint32_t epoch, uint32_t nonce);
+void     SB_logCryptGetStats(SB_LogCryptStats *stats);
+
+#endif /* APPLICATION_LOGCRYPT_H_ */
@@ -22,6 +22,8 @@
 #include "peripheralManager.h"
 #include "Board.h"
 #include "ble.h"
+#include "logCrypt.h"
+#include "fsm.h"
 
 /* Header files required to enable instruction fetch cache */
 #include <inc/hw_memmap.h>
@@ -104,6 +106,31 @@ int main()
 	System_flush();
 #endif
 
+	/* start the state machine, which drives the peripheral manager */
+	if (NoError != (error = SB_fsmInit())) {
+#ifdef SB_DEBUG
+		System_printf("Error No: %d\n", error);
+		System_printf("SB application initialization failed while initializing the state machine. This is a code error.\n");
+		System_flush();
+#endif
+
+		while(1);
+	}
+
+#ifdef SB_DEBUG
+	System_printf("State Machine Initialized.\n");
+	System_flush();
+#endif
+
+	/* Open the crypto engine for log encryption. The key is loaded by the BLE task. */
+	if (NoError != (error = SB_logCryptInit())) {
+#ifdef SB_DEBUG
+		System_printf("Error No: %d\n", error);
+		System_printf("Log encryption unavailable. Logs will not be stored.\n");
+		System_flush();
+#endif
+	}
+
 	/* Configure BLE */
 	SB_bleInit();
 #ifdef SB_DEBUG
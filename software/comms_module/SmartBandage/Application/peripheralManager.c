@@ -9,6 +9,7 @@
 #include <ti/sysbios/knl/Task.h>
 #include <xdc/runtime/System.h>
 #include <ti/drivers/PIN.h>
+#include <string.h>
 
 #include "i2c.h"
 #include "util.h"
@@ -16,6 +17,15 @@
 #include "Devices/hdc1050.h"
 #include "Devices/tca9554a.h"
 #include "peripheralManager.h"
+#include "flashLog.h"
+#include "rollup.h"
+#include "settings.h"
+#include "liveStream.h"
+#include "sampleRecord.h"
+#include "systemTime.h"
+#include "reportPolicy.h"
+#include "diagnostics.h"
+#include "fsm.h"
 #include "../PROFILES/smartBandageProfile.h"
 
 SB_Error applyTempSensorConfiguration(uint8_t deviceNo);
@@ -26,6 +36,8 @@ SB_Error _applyFullMuxState(SB_MUXState muxState);
 void     SB_sysdisblClockHandler(UArg arg);
 
 SB_Error readSensorData();
+SB_Error logSensorData();
+uint8_t  validSensorChannels();
 
 struct {
 	Semaphore_Handle i2cDeviceSem;
@@ -43,12 +55,18 @@ struct {
 	Task_Handle taskHandle;
 	Task_Struct task;
 	Char taskStack[PMGR_TASK_STACK_SIZE];
+	Semaphore_Handle sampleSem;		// Posted by the state machine for each sample
 
 	PIN_State PeripheralPower;
 	PIN_State MUXPins;
 	PIN_State AnalogPins;
 	Semaphore_Handle muxSemaphore;
 	Clock_Struct sysdisblClock;
+
+	bool sampleLogReady;
+
+	// Encoder state of the sample records, shared by the live stream and the sample log
+	SB_SampleCodec sampleCodec;
 } PMGR;
 
 SB_Error applyTempSensorConfiguration(uint8_t deviceNo) {
@@ -191,6 +209,7 @@ SB_Error initPeripherals() {
 # ifdef SB_DEBUG
 		System_printf("IO Expander config failed: %d...\n", PMGR.ioexpanderDeviceState.lastError);
 # endif
+		++PMGR.ioexpanderDeviceState.errors;
 		PMGR.ioexpanderDeviceState.currentState = PState_FailedConfig;
 		return PMGR.ioexpanderDeviceState.lastError;
 	}
@@ -206,6 +225,7 @@ SB_Error initPeripherals() {
 			if (NoError == PMGR.mcp9808DeviceStates[i].lastError) {
 				PMGR.mcp9808DeviceStates[i].currentState = PState_OK;
 			} else {
+				++PMGR.mcp9808DeviceStates[i].errors;
 				PMGR.mcp9808DeviceStates[i].currentState = PState_Intermittent;
 				if (++PMGR.mcp9808DeviceStates[i].numReadAttempts > PERIPHERAL_MAX_READ_ATTEMPTS) {
 					PMGR.mcp9808DeviceStates[i].currentState = PState_Failed;
@@ -235,6 +255,7 @@ SB_Error initPeripherals() {
 		System_printf("Humidity sensor config failed: %d...\n", PMGR.hdc1050DeviceState.lastError);
 		System_flush();
 # endif
+		++PMGR.hdc1050DeviceState.errors;
 		PMGR.hdc1050DeviceState.currentState = PState_FailedConfig;
 	}
 	PMANAGER_TASK_YIELD_HIGHERPRI();
@@ -244,6 +265,7 @@ SB_Error initPeripherals() {
 	if (PMGR.hdc1050DeviceState.lastError == NoError) {
 		PMGR.hdc1050Device.readReadyTime = HDC1050_READ_WAIT_TICKS + Clock_getTicks();
 	} else {
+		++PMGR.hdc1050DeviceState.errors;
 		if (++PMGR.hdc1050DeviceState.numReadAttempts > PERIPHERAL_MAX_READ_ATTEMPTS) {
 			PMGR.hdc1050DeviceState.currentState = PState_Failed;
 #ifdef SB_DEBUG
@@ -263,10 +285,13 @@ SB_Error initPeripherals() {
 SB_Error readSensorData() {
 	SB_i2cTransaction taTransaction;
 	I2C_Transaction taBaseTransaction;
+	SB_Settings settings;
 	uint8_t txBuf[1];
 	uint8_t rxBuf[2];
 	uint8_t i;
 
+	SB_settingsGet(&settings);
+
 	// The configuration transaction
 	taBaseTransaction.writeCount   = 1;
 	taBaseTransaction.writeBuf     = txBuf;
@@ -276,6 +301,9 @@ SB_Error readSensorData() {
 	taTransaction.baseTransaction = &taBaseTransaction;
 	taTransaction.completionSemaphore = &PMGR.i2cDeviceSem;
 
+	// Readers see the new temperatures and humidity together, once all sensors have been read
+	SB_Profile_BeginUpdate();
+
 	// Read temperature sensors
 	{
 		for (i = 0; i < SB_NUM_MCP9808_SENSORS; ++i) {
@@ -316,9 +344,10 @@ SB_Error readSensorData() {
 					System_printf("PMGR: Temperature read: %d\n", PMGR.mcp9808Devices[i].Temperature>>4);
 #endif
 
-					// TODO: Calls like this should likely be protected with a semaphore
-					SB_Profile_Set16bParameter( SB_CHARACTERISTIC_TEMPERATURE, PMGR.mcp9808Devices[i].Temperature, i );
+					SB_reportPolicySet16bParameter( SB_CHARACTERISTIC_TEMPERATURE, PMGR.mcp9808Devices[i].Temperature + settings.temperatureOffset[i], i );
 				} else {
+					++PMGR.mcp9808DeviceStates[i].errors;
+					PMGR.mcp9808DeviceStates[i].lastError = taTransaction.completionResult;
 					PMGR.mcp9808DeviceStates[i].currentState = PState_Intermittent;
 					if (++PMGR.mcp9808DeviceStates[i].numReadAttempts > PERIPHERAL_MAX_READ_ATTEMPTS) {
 						PMGR.mcp9808DeviceStates[i].currentState = PState_Failed;
@@ -365,10 +394,10 @@ SB_Error readSensorData() {
 				System_printf("PMGR: HTemp read:  %d\n", PMGR.hdc1050Device.temperature/16);
 #endif
 
-				// TODO: Calls like this should likely be protected with a semaphore
-				SB_Profile_Set16bParameter( SB_CHARACTERISTIC_HUMIDITY, PMGR.hdc1050Device.humidity, 0 );
-				SB_Profile_Set16bParameter( SB_CHARACTERISTIC_TEMPERATURE, PMGR.hdc1050Device.temperature, 3 );
+				SB_reportPolicySet16bParameter( SB_CHARACTERISTIC_HUMIDITY, PMGR.hdc1050Device.humidity + settings.humidityOffset, 0 );
+				SB_reportPolicySet16bParameter( SB_CHARACTERISTIC_TEMPERATURE, PMGR.hdc1050Device.temperature + settings.temperatureOffset[3], 3 );
 			} else {
+				++PMGR.hdc1050DeviceState.errors;
 				if (++PMGR.hdc1050DeviceState.numReadAttempts > PERIPHERAL_MAX_READ_ATTEMPTS) {
 					PMGR.hdc1050DeviceState.currentState = PState_Failed;
 #ifdef SB_DEBUG
@@ -392,9 +421,63 @@ SB_Error readSensorData() {
 		}
 	}
 
+	SB_Profile_EndUpdate();
+
 	return NoError;
 }
 
+/**
+ * \brief Adds the latest sensor values to the rollups, and encodes them once as a sample record
+ * 			which is queued for the live stream and appended to the sample log in external flash.
+ */
+SB_Error logSensorData() {
+	uint8_t record[SB_SAMPLE_MAX_LEN];
+	uint8_t length;
+	SB_Sample sample;
+	SB_Error result;
+
+	// The temperatures are followed by the humidity, in sample channel order
+	SB_Profile_GetParameter(SB_CHARACTERISTIC_TEMPERATURE, &sample.values[SB_SAMPLE_CHANNEL_TEMPERATURE0], SB_BLE_TEMPERATURE_LEN);
+	SB_Profile_GetParameter(SB_CHARACTERISTIC_HUMIDITY, &sample.values[SB_SAMPLE_CHANNEL_HUMIDITY], SB_BLE_HUMIDITY_LEN);
+	sample.channels = validSensorChannels();
+	sample.timestamp = SB_systemTimeGet();
+
+	SB_rollupAddSample(sample.values, sample.channels, sample.timestamp);
+
+	length = SB_sampleEncode(&PMGR.sampleCodec, &sample, record);
+	SB_liveStreamPush(record, length);
+
+	result = PMGR.sampleLogReady ? SB_flashLogAppend(&SB_sampleLog, record, length) : ResourceNotInitialized;
+
+	// Records in the log must find their absolute timestamp there: start the next one afresh
+	if (result != NoError) {
+		PMGR.sampleCodec.valid = false;
+	}
+
+	return result;
+}
+
+/**
+ * \brief Returns a bit per rollup channel whose sensor is currently producing readings.
+ */
+uint8_t validSensorChannels() {
+	uint8_t valid = 0;
+	uint8_t i;
+
+	for (i = 0; i < SB_NUM_MCP9808_SENSORS; ++i) {
+		if (PMGR.mcp9808DeviceStates[i].currentState == PState_OK) {
+			valid |= (1 << i);
+		}
+	}
+
+	// The humidity sensor also reports the last temperature slot
+	if (PMGR.hdc1050DeviceState.currentState == PState_OK) {
+		valid |= (1 << (SB_ROLLUP_NUM_TEMPERATURE_CHANNELS - 1)) | (1 << SB_ROLLUP_HUMIDITY_CHANNEL);
+	}
+
+	return valid;
+}
+
 static void SB_peripheralManagerTask(UArg a0, UArg a1) {
 	SB_Error result;
 
@@ -403,24 +486,41 @@ static void SB_peripheralManagerTask(UArg a0, UArg a1) {
 		System_flush();
 #endif
 
+	// Each sample initializes the peripherals again, so a failure here is retried by the next
 	if (NoError != (result = initPeripherals())) {
 #ifdef SB_DEBUG
-		System_printf("Peripheral initialization failure: %d. Peripheral Manager stalled.\n", result);
+		System_printf("Peripheral initialization failure: %d.\n", result);
 		System_flush();
 #endif
-		Task_exit();
+		SB_fsmReportError(result);
 	}
 
 #ifdef SB_DEBUG
 		System_printf("PMGR: Peripherals initialized.\n", result);
 		System_flush();
 #endif
+
+	// Recover the sample log. Sampling continues without logging if the flash is unavailable.
+	result = SB_flashLogInit(&SB_sampleLog, FLASHLOG_SAMPLES_BASE, FLASHLOG_SAMPLES_NUM_SECTORS, FLASHLOG_ENCRYPT_AT_REST);
+	PMGR.sampleLogReady = (result == NoError);
+#ifdef SB_DEBUG
+	if (!PMGR.sampleLogReady) {
+		System_printf("PMGR: Sample log unavailable: %d\n", result);
+		System_flush();
+	}
+#endif
+
+	// Recover the rollup logs
+	SB_rollupInit();
+
 #ifdef LAUNCHPAD
 	PIN_State sbpPins;
 	PIN_Handle statusPin = PIN_open(&sbpPins, pinConfigTable);
 #endif
 
 	while (1) {
+		// Sleep until the state machine enters S_CHECK
+		Semaphore_pend(PMGR.sampleSem, BIOS_WAIT_FOREVER);
 
 		// Enable peripherals
 		SB_setPeripheralsEnable(true);
@@ -434,6 +534,10 @@ static void SB_peripheralManagerTask(UArg a0, UArg a1) {
 		readSensorData();
 		PMANAGER_TASK_YIELD_HIGHERPRI();
 
+		// Store it
+		logSensorData();
+		PMANAGER_TASK_YIELD_HIGHERPRI();
+
 #ifdef SB_DEBUG
 		Task_sleep(NTICKS_PER_MILLSECOND);
 		System_flush();
@@ -442,7 +546,8 @@ static void SB_peripheralManagerTask(UArg a0, UArg a1) {
 		// Disable peripherals
 		SB_setPeripheralsEnable(false);
 
-		Task_sleep(100000);
+		// Without a single sensor answering the bandage is taken to be disconnected
+		SB_fsmPostEvent(validSensorChannels() ? E_CHECK_DONE : E_NO_BANDAGE_DETECTED);
 	}
 }
 
@@ -450,6 +555,7 @@ SB_Error SB_peripheralInit() {
 	int i;
 
 	PMGR.i2cDeviceSem = Semaphore_create(0, NULL, NULL);
+	PMGR.sampleSem = Semaphore_create(0, NULL, NULL);
 
 	for (i = 0; i < SB_NUM_MCP9808_SENSORS; ++i) {
 #ifdef SB_DEBUG
@@ -548,9 +654,37 @@ SB_Error SB_peripheralInit() {
 		return OSResourceInitializationError;
 	}
 
+	SB_diagnosticsRegisterTask(SB_DIAGNOSTICS_TASK_PMGR, PMGR.taskHandle);
+
 	return NoError;
 }
 
+/**
+ * \brief Wakes the peripheral manager task to take a sample. E_CHECK_DONE is posted to the state
+ * 			machine once it is logged, or E_NO_BANDAGE_DETECTED if no sensor could be read.
+ */
+void SB_peripheralRequestSample() {
+	Semaphore_post(PMGR.sampleSem);
+}
+
+/**
+ * \brief Copies the state of each device: the temperature sensors, the humidity sensor and the
+ * 			IO expander, which is left unknown if not present.
+ */
+void SB_peripheralGetStates(SB_PeripheralState states[SB_PERIPHERAL_NUM_DEVICES]) {
+	UInt key = Task_disable();
+
+	memcpy(states, PMGR.mcp9808DeviceStates, sizeof(PMGR.mcp9808DeviceStates));
+	states[SB_PERIPHERAL_HDC1050] = PMGR.hdc1050DeviceState;
+#ifdef IOEXPANDER_PRESENT
+	states[SB_PERIPHERAL_IOEXPANDER] = PMGR.ioexpanderDeviceState;
+#else
+	memset(&states[SB_PERIPHERAL_IOEXPANDER], 0, sizeof(SB_PeripheralState));
+#endif
+
+	Task_restore(key);
+}
+
 /**
  * \brief Enables or disables power to external PCB peripherals
  */
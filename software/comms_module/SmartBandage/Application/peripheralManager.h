@@ -41,8 +41,14 @@ typedef struct {
 	SB_Error lastError;
 	SB_PeripheralFunctionalState currentState;
 	uint8_t numReadAttempts;
+	uint16_t errors;			// Failed configurations and reads since boot
 } SB_PeripheralState;
 
+// Devices in the order SB_peripheralGetStates reports them
+#define SB_PERIPHERAL_HDC1050		SB_NUM_MCP9808_SENSORS
+#define SB_PERIPHERAL_IOEXPANDER	(SB_NUM_MCP9808_SENSORS + 1)
+#define SB_PERIPHERAL_NUM_DEVICES	(SB_NUM_MCP9808_SENSORS + 2)
+
 typedef struct {
 	MUX_OUTPUT pwrmuxOutput;
 	MUX_OUTPUT_ENABLE pwrmuxOutputEnable;
@@ -51,7 +57,9 @@ typedef struct {
 
 SB_Error SB_peripheralInit();
 SB_Error SB_setPeripheralsEnable(bool enable);
+void     SB_peripheralRequestSample();
 SB_Error SB_sysDisableRefresh(uint32 semaphoreTimeout);
 SB_Error SB_sysDisableShutdown();
+void     SB_peripheralGetStates(SB_PeripheralState states[SB_PERIPHERAL_NUM_DEVICES]);
 
 #endif /* APPLICATION_PERIPHERALMANAGER_H_ */
@@ -0,0 +1,181 @@
+/*
+ * reportPolicy.c
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#include <string.h>
+
+#include <ti/sysbios/knl/Task.h>
+#include <ti/sysbios/knl/Clock.h>
+#include <xdc/runtime/System.h>
+
+#include "reportPolicy.h"
+#include "fsm.h"
+
+struct {
+	SB_ReportPolicy policies[SB_REPORT_NUM_POLICIES];
+
+	// The last notified value of each channel, and the ticks at which it was set
+	struct {
+		uint16_t value;
+		uint32_t since;
+		bool     reported;
+	} channels[SB_REPORT_NUM_CHANNELS];
+
+	SB_ReportPolicyStats stats;
+} REPORTPOLICY;
+
+/**
+ * \brief Loads the policies from the settings and publishes them in the profile.
+ * \remark Must be called after SB_settingsInit.
+ */
+void SB_reportPolicyInit() {
+	SB_Settings settings;
+	UInt key;
+
+	SB_settingsGet(&settings);
+
+	key = Task_disable();
+	memcpy(REPORTPOLICY.policies, settings.reportPolicy, sizeof(REPORTPOLICY.policies));
+	Task_restore(key);
+
+	SB_Profile_SetParameter(SB_CHARACTERISTIC_REPORTPOLICY, SB_BLE_REPORTPOLICY_LEN, settings.reportPolicy);
+}
+
+/**
+ * \brief Applies new policies and saves them in the settings.
+ * \remark Invalid policies are refused, and the profile goes back to showing the current ones.
+ * \param policies SB_REPORT_NUM_POLICIES policies, in the order of SB_ReportSensor.
+ */
+SB_Error SB_reportPolicyConfigure(const SB_ReportPolicy *policies) {
+	SB_Settings settings;
+	UInt key;
+	uint8_t i;
+
+	for (i = 0; i < SB_REPORT_NUM_POLICIES; ++i) {
+		if (policies[i].maxSilenceS != 0 && policies[i].minIntervalS > policies[i].maxSilenceS) {
+			key = Task_disable();
+			++REPORTPOLICY.stats.rejected;
+			Task_restore(key);
+
+			SB_settingsGet(&settings);
+			SB_Profile_SetParameter(SB_CHARACTERISTIC_REPORTPOLICY, SB_BLE_REPORTPOLICY_LEN, settings.reportPolicy);
+#ifdef SB_DEBUG
+			System_printf("RPOLICY: Rejected policy %d: minimum interval %d s exceeds maximum silence %d s\n",
+					i, policies[i].minIntervalS, policies[i].maxSilenceS);
+			System_flush();
+#endif
+			return InvalidParameter;
+		}
+	}
+
+	key = Task_disable();
+	memcpy(REPORTPOLICY.policies, policies, sizeof(REPORTPOLICY.policies));
+	Task_restore(key);
+
+	SB_settingsGet(&settings);
+	memcpy(settings.reportPolicy, policies, sizeof(settings.reportPolicy));
+
+	return SB_settingsSet(&settings);
+}
+
+/**
+ * \brief Stores a sensor reading in the profile, notifying it only if the policy allows.
+ * \remark Takes the place of SB_Profile_Set16bParameter for sensor readings. Characteristics
+ * 			without a policy are always notified. Must be called from a single task.
+ */
+SB_Error SB_reportPolicySet16bParameter(SB_CHARACTERISTIC param, uint16_t value, uint8_t valueIndex) {
+	SB_ReportPolicy policy;
+	SB_ReportSensor sensor;
+	uint32_t now, elapsedMs;
+	int32_t delta;
+	uint8_t channel;
+	bool notify, alert = false;
+	UInt key;
+
+	switch (param) {
+		case SB_CHARACTERISTIC_TEMPERATURE:
+			sensor = SB_REPORT_TEMPERATURE;
+			channel = valueIndex;
+			if (valueIndex >= SB_SETTINGS_NUM_TEMPERATURES) {
+				return InvalidParameter;
+			}
+			break;
+
+		case SB_CHARACTERISTIC_HUMIDITY:
+			sensor = SB_REPORT_HUMIDITY;
+			channel = SB_SETTINGS_NUM_TEMPERATURES;
+			if (valueIndex != 0) {
+				return InvalidParameter;
+			}
+			break;
+
+		default:
+			return SUCCESS == SB_Profile_Set16bParameter(param, value, valueIndex) ? NoError : InvalidParameter;
+	}
+
+	key = Task_disable();
+	policy = REPORTPOLICY.policies[sensor];
+	Task_restore(key);
+
+	now = Clock_getTicks();
+
+	if (!REPORTPOLICY.channels[channel].reported) {
+		notify = true;
+	} else if (value == REPORTPOLICY.channels[channel].value) {
+		// Back to what was last sent, which the client already has
+		SB_Profile_Store16bParameter(param, value, valueIndex);
+		return NoError;
+	} else {
+		// Readings are signed, so a change across zero is measured correctly
+		delta = (int32_t)(int16_t)value - (int16_t)REPORTPOLICY.channels[channel].value;
+		if (delta < 0) {
+			delta = -delta;
+		}
+
+		elapsedMs = (now - REPORTPOLICY.channels[channel].since) / (NTICKS_PER_MILLSECOND);
+
+		notify = (delta >= policy.deadband && elapsedMs >= (uint32_t)policy.minIntervalS * 1000)
+				|| (policy.maxSilenceS != 0 && elapsedMs >= (uint32_t)policy.maxSilenceS * 1000);
+
+		// Only a jump is urgent; drift and keep-alives wait for the next transmit
+		alert = notify && policy.deadband != 0
+				&& delta >= (int32_t)policy.deadband * SB_REPORT_ALERT_DEADBANDS;
+	}
+
+	if (notify) {
+		SB_Profile_Set16bParameter(param, value, valueIndex);
+
+		REPORTPOLICY.channels[channel].value = value;
+		REPORTPOLICY.channels[channel].since = now;
+		REPORTPOLICY.channels[channel].reported = true;
+
+		if (alert) {
+			SB_fsmPostEvent(E_DATA_CHANGE);
+		}
+	} else {
+		SB_Profile_Store16bParameter(param, value, valueIndex);
+	}
+
+	key = Task_disable();
+	if (notify) {
+		++REPORTPOLICY.stats.sent[sensor];
+		if (alert) {
+			++REPORTPOLICY.stats.alerts[sensor];
+		}
+	} else {
+		++REPORTPOLICY.stats.suppressed[sensor];
+	}
+	Task_restore(key);
+
+	return NoError;
+}
+
+void SB_reportPolicyGetStats(SB_ReportPolicyStats *stats) {
+	UInt key = Task_disable();
+
+	*stats = REPORTPOLICY.stats;
+
+	Task_restore(key);
+}
@@ -0,0 +1,50 @@
+/*
+ * @file reportPolicy.h
+ * @brief Decides which sensor readings are worth a notification.
+ *
+ * Every reading is stored in the profile, so reads, the sample log and the live
+ * stream always see the latest value. A notification, and the advertising data
+ * update that follows it, is only sent once a value has moved by at least the
+ * deadband from what was last sent and the minimum interval has passed, or once
+ * a changed value has been held back for the maximum silence. Small ADC noise
+ * then costs no radio time, while slow drift is still reported eventually.
+ *
+ * Those notifications are routine: the live stream and the advertising carry on at
+ * their own pace. Only a jump of SB_REPORT_ALERT_DEADBANDS deadbands from the last
+ * notified value is an alert, which the state machine transmits at once and which
+ * brings back fast advertising.
+ *
+ * The policies are part of the settings and can be changed over GATT through
+ * the ReportPolicy characteristic.
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef APPLICATION_REPORTPOLICY_H_
+#define APPLICATION_REPORTPOLICY_H_
+
+#include "bcomdef.h"
+
+#include "Board.h"
+#include "settings.h"
+#include "../PROFILES/smartBandageProfile.h"
+
+// Values followed for each policy: the four temperatures, then the humidity
+#define SB_REPORT_NUM_CHANNELS		(SB_SETTINGS_NUM_TEMPERATURES + 1)
+
+// Change from the last notified value, in deadbands, that raises an alert
+#define SB_REPORT_ALERT_DEADBANDS	4
+
+typedef struct {
+	uint32_t sent[SB_REPORT_NUM_POLICIES];			// Changed values that were notified
+	uint32_t suppressed[SB_REPORT_NUM_POLICIES];	// Changed values stored without a notification
+	uint32_t alerts[SB_REPORT_NUM_POLICIES];		// Notified values that raised an alert
+	uint16_t rejected;								// Invalid policies written over GATT
+} SB_ReportPolicyStats;
+
+void     SB_reportPolicyInit();
+SB_Error SB_reportPolicyConfigure(const SB_ReportPolicy *policies);
+SB_Error SB_reportPolicySet16bParameter(SB_CHARACTERISTIC param, uint16_t value, uint8_t valueIndex);
+void     SB_reportPolicyGetStats(SB_ReportPolicyStats *stats);
+
+#endif /* APPLICATION_REPORTPOLICY_H_ */
@@ -0,0 +1,165 @@
+/*
+ * rollup.c
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#include <string.h>
+
+#include <xdc/runtime/System.h>
+
+#include "rollup.h"
+
+static const uint16_t windowSeconds[SB_NUM_ROLLUP_RESOLUTIONS] = {
+	SB_ROLLUP_MINUTE_SECONDS,
+	SB_ROLLUP_HOUR_SECONDS,
+};
+
+static SB_FlashLog * const rollupLogs[SB_NUM_ROLLUP_RESOLUTIONS] = {
+	&SB_minuteRollupLog,
+	&SB_hourRollupLog,
+};
+
+static void resetWindow(SB_RollupResolution resolution, uint32_t windowStart);
+static SB_Error closeWindow(SB_RollupResolution resolution);
+
+struct {
+	SB_RollupAccumulator accumulators[SB_NUM_ROLLUP_RESOLUTIONS][SB_ROLLUP_NUM_CHANNELS];
+	uint32_t windowStart[SB_NUM_ROLLUP_RESOLUTIONS];
+	bool windowOpen[SB_NUM_ROLLUP_RESOLUTIONS];
+	bool logReady[SB_NUM_ROLLUP_RESOLUTIONS];
+
+	// Kept off the caller's stack
+	SB_RollupRecord record;
+} ROLLUP;
+
+/**
+ * \brief Recovers the rollup logs. Rollups are still accumulated if a log is unavailable.
+ */
+SB_Error SB_rollupInit() {
+	SB_Error result = NoError;
+	SB_Error logResult;
+
+	memset(&ROLLUP, 0, sizeof(ROLLUP));
+
+	logResult = SB_flashLogInit(&SB_minuteRollupLog, FLASHLOG_MINUTES_BASE, FLASHLOG_MINUTES_NUM_SECTORS, FLASHLOG_ENCRYPT_AT_REST);
+	ROLLUP.logReady[Rollup_Minute] = (logResult == NoError);
+	if (logResult != NoError) {
+		result = logResult;
+	}
+
+	logResult = SB_flashLogInit(&SB_hourRollupLog, FLASHLOG_HOURS_BASE, FLASHLOG_HOURS_NUM_SECTORS, FLASHLOG_ENCRYPT_AT_REST);
+	ROLLUP.logReady[Rollup_Hour] = (logResult == NoError);
+	if (logResult != NoError) {
+		result = logResult;
+	}
+
+#ifdef SB_DEBUG
+	if (result != NoError) {
+		System_printf("ROLLUP: Rollup logs unavailable: %d\n", result);
+		System_flush();
+	}
+#endif
+
+	return result;
+}
+
+/**
+ * \brief Adds one sample of every channel to the open window of each resolution.
+ * 			Closes and stores any window the timestamp has moved past.
+ * \param values One value per channel, see SB_ROLLUP_NUM_CHANNELS
+ * \param validChannels Bit n is set if values[n] holds a fresh reading
+ * \param timestamp Time of the sample in seconds
+ */
+SB_Error SB_rollupAddSample(const uint16_t *values, uint8_t validChannels, uint32_t timestamp) {
+	SB_RollupAccumulator *accumulator;
+	SB_Error result = NoError;
+	SB_Error closeResult;
+	uint32_t windowStart;
+	uint8_t r, ch;
+
+	if (values == NULL) {
+		return InvalidParameter;
+	}
+
+	for (r = 0; r < SB_NUM_ROLLUP_RESOLUTIONS; ++r) {
+		windowStart = timestamp - (timestamp % windowSeconds[r]);
+
+		if (ROLLUP.windowOpen[r] && ROLLUP.windowStart[r] != windowStart) {
+			closeResult = closeWindow((SB_RollupResolution)r);
+			if (closeResult != NoError) {
+				result = closeResult;
+			}
+		}
+
+		if (!ROLLUP.windowOpen[r]) {
+			resetWindow((SB_RollupResolution)r, windowStart);
+		}
+
+		for (ch = 0; ch < SB_ROLLUP_NUM_CHANNELS; ++ch) {
+			if (!(validChannels & (1 << ch))) {
+				continue;
+			}
+
+			accumulator = &ROLLUP.accumulators[r][ch];
+
+			if (accumulator->count == 0 || values[ch] < accumulator->min) {
+				accumulator->min = values[ch];
+			}
+
+			if (accumulator->count == 0 || values[ch] > accumulator->max) {
+				accumulator->max = values[ch];
+			}
+
+			accumulator->sum += values[ch];
+			++accumulator->count;
+		}
+	}
+
+	return result;
+}
+
+static void resetWindow(SB_RollupResolution resolution, uint32_t windowStart) {
+	memset(ROLLUP.accumulators[resolution], 0, sizeof(ROLLUP.accumulators[resolution]));
+	ROLLUP.windowStart[resolution] = windowStart;
+	ROLLUP.windowOpen[resolution] = true;
+}
+
+/**
+ * \brief Summarizes the open window of a resolution and appends it to its log.
+ * 			Windows without any valid sample are not stored.
+ */
+static SB_Error closeWindow(SB_RollupResolution resolution) {
+	SB_RollupAccumulator *accumulator;
+	SB_RollupRecord *record = &ROLLUP.record;
+	uint8_t ch;
+
+	ROLLUP.windowOpen[resolution] = false;
+
+	memset(record, 0, sizeof(SB_RollupRecord));
+	record->windowStart = ROLLUP.windowStart[resolution];
+	record->windowSeconds = windowSeconds[resolution];
+
+	for (ch = 0; ch < SB_ROLLUP_NUM_CHANNELS; ++ch) {
+		accumulator = &ROLLUP.accumulators[resolution][ch];
+
+		if (accumulator->count == 0) {
+			continue;
+		}
+
+		record->validChannels |= (1 << ch);
+		record->channels[ch].min = accumulator->min;
+		record->channels[ch].max = accumulator->max;
+		record->channels[ch].mean = (uint16_t)((accumulator->sum + accumulator->count / 2) / accumulator->count);
+	}
+
+	if (record->validChannels == 0) {
+		return NoError;
+	}
+
+	if (!ROLLUP.logReady[resolution]) {
+		return ResourceNotInitialized;
+	}
+
+	return SB_flashLogAppend(rollupLogs[resolution], (const uint8_t*)record, sizeof(SB_RollupRecord));
+}
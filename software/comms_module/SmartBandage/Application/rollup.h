@@ -0,0 +1,56 @@
+/*
+ * @file rollup.h
+ * @brief Per-minute and per-hour min/max/mean rollups of the sensor channels.
+ *
+ * Every sample updates one accumulator per channel and resolution in constant
+ * time. When a window closes its summary is appended to the flash log of that
+ * resolution, so a multi-day overview can be synced without the raw samples.
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef APPLICATION_ROLLUP_H_
+#define APPLICATION_ROLLUP_H_
+
+#include "Board.h"
+#include "flashLog.h"
+#include "../PROFILES/smartBandageProfile.h"
+
+// One channel per temperature slot followed by the humidity channel
+#define SB_ROLLUP_NUM_TEMPERATURE_CHANNELS	(SB_BLE_TEMPERATURE_LEN / sizeof(uint16_t))
+#define SB_ROLLUP_HUMIDITY_CHANNEL			SB_ROLLUP_NUM_TEMPERATURE_CHANNELS
+#define SB_ROLLUP_NUM_CHANNELS				(SB_ROLLUP_NUM_TEMPERATURE_CHANNELS + SB_BLE_HUMIDITY_LEN / sizeof(uint16_t))
+
+#define SB_ROLLUP_MINUTE_SECONDS			60
+#define SB_ROLLUP_HOUR_SECONDS				3600
+
+typedef enum {
+	Rollup_Minute,
+	Rollup_Hour,
+	SB_NUM_ROLLUP_RESOLUTIONS
+} SB_RollupResolution;
+
+typedef struct {
+	uint16_t min;
+	uint16_t max;
+	uint32_t sum;
+	uint16_t count;
+} SB_RollupAccumulator;
+
+// The record appended to the rollup logs when a window closes
+typedef struct {
+	uint32_t windowStart;		// Timestamp of the start of the window, in seconds
+	uint16_t windowSeconds;
+	uint8_t  validChannels;		// Bit n is set if channel n had at least one sample
+	uint8_t  reserved;
+	struct {
+		uint16_t min;
+		uint16_t max;
+		uint16_t mean;
+	} channels[SB_ROLLUP_NUM_CHANNELS];
+} SB_RollupRecord;
+
+SB_Error SB_rollupInit();
+SB_Error SB_rollupAddSample(const uint16_t *values, uint8_t validChannels, uint32_t timestamp);
+
+#endif /* APPLICATION_ROLLUP_H_ */
@@ -0,0 +1,178 @@
+/*
+ * sampleRecord.c
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#include "sampleRecord.h"
+
+#define SB_SAMPLE_CHANNEL_NAME( name, unit )	#name,
+#define SB_SAMPLE_CHANNEL_UNIT( name, unit )	unit,
+
+const char * const SB_sampleChannelNames[SB_SAMPLE_NUM_CHANNELS] = {
+	SB_SAMPLE_CHANNELS( SB_SAMPLE_CHANNEL_NAME )
+};
+
+const char * const SB_sampleChannelUnits[SB_SAMPLE_NUM_CHANNELS] = {
+	SB_SAMPLE_CHANNELS( SB_SAMPLE_CHANNEL_UNIT )
+};
+
+static uint8_t *put16(uint8_t *p, uint16_t value);
+static uint8_t *put32(uint8_t *p, uint32_t value);
+static uint16_t get16(const uint8_t *p);
+static uint32_t get32(const uint8_t *p);
+static uint8_t  countChannels(uint8_t channels);
+
+/**
+ * \brief Writes a sample as a record. Channels without their bit set in sample->channels are
+ * 			left out.
+ * \param codec State carried between the records of one stream, zeroed before the first
+ * \param buf At least SB_SAMPLE_MAX_LEN bytes
+ * \return The length of the record
+ */
+uint8_t SB_sampleEncode(SB_SampleCodec *codec, const SB_Sample *sample, uint8_t *buf) {
+	uint8_t *p = buf;
+	uint8_t channels = sample->channels & ((1 << SB_SAMPLE_NUM_CHANNELS) - 1);
+	bool absolute;
+	uint8_t i;
+
+	absolute = !codec->valid
+			|| codec->sinceAbsolute + 1 >= SB_SAMPLE_ABSOLUTE_INTERVAL
+			|| sample->timestamp < codec->base
+			|| sample->timestamp - codec->base > 0xFFFF;
+
+	*p++ = (SB_SAMPLE_FORMAT_VERSION << 4) | (absolute ? SB_SAMPLE_FLAG_ABSOLUTE : 0);
+	*p++ = channels;
+
+	if (absolute) {
+		p = put32(p, sample->timestamp);
+
+		codec->base = sample->timestamp;
+		codec->sinceAbsolute = 0;
+		codec->valid = true;
+	} else {
+		p = put16(p, sample->timestamp - codec->base);
+
+		++codec->sinceAbsolute;
+	}
+
+	for (i = 0; i < SB_SAMPLE_NUM_CHANNELS; ++i) {
+		if (channels & (1 << i)) {
+			p = put16(p, sample->values[i]);
+		}
+	}
+
+	return p - buf;
+}
+
+/**
+ * \brief Reads a record into a sample. Channels not present read as 0.
+ * \param codec State carried between the records of one stream. Set base and valid to decode
+ * 			from the base time given in a packet header.
+ * \return The length of the record, or 0 if it is malformed, of another format version, or
+ * 			relative to an absolute record that has not been seen
+ */
+uint8_t SB_sampleDecode(SB_SampleCodec *codec, const uint8_t *buf, uint16_t length, SB_Sample *sample) {
+	const uint8_t *p;
+	uint8_t recordLength = SB_sampleLength(buf, length);
+	uint8_t i;
+
+	if (recordLength == 0) {
+		return 0;
+	}
+
+	if (SB_sampleIsAbsolute(buf)) {
+		codec->base = get32(buf + SB_SAMPLE_HEADER_LEN);
+		codec->sinceAbsolute = 0;
+		codec->valid = true;
+		p = buf + SB_SAMPLE_HEADER_LEN + sizeof(uint32_t);
+	} else if (codec->valid) {
+		++codec->sinceAbsolute;
+		p = buf + SB_SAMPLE_HEADER_LEN + sizeof(uint16_t);
+	} else {
+		return 0;
+	}
+
+	sample->timestamp = SB_sampleTime(buf, codec->base);
+	sample->channels = buf[1];
+
+	for (i = 0; i < SB_SAMPLE_NUM_CHANNELS; ++i) {
+		if (sample->channels & (1 << i)) {
+			sample->values[i] = get16(p);
+			p += sizeof(uint16_t);
+		} else {
+			sample->values[i] = 0;
+		}
+	}
+
+	return recordLength;
+}
+
+/**
+ * \brief Length of the record at the start of buf, from its header.
+ * \return 0 if the record is of another format version, names unknown channels or does not
+ * 			fit in length bytes
+ */
+uint8_t SB_sampleLength(const uint8_t *buf, uint16_t length) {
+	uint8_t recordLength;
+
+	if (length < SB_SAMPLE_HEADER_LEN
+			|| (buf[0] >> 4) != SB_SAMPLE_FORMAT_VERSION
+			|| (buf[1] >> SB_SAMPLE_NUM_CHANNELS) != 0) {
+		return 0;
+	}
+
+	recordLength = SB_SAMPLE_HEADER_LEN
+			+ (SB_sampleIsAbsolute(buf) ? sizeof(uint32_t) : sizeof(uint16_t))
+			+ countChannels(buf[1]) * sizeof(uint16_t);
+
+	return (recordLength <= length) ? recordLength : 0;
+}
+
+bool SB_sampleIsAbsolute(const uint8_t *buf) {
+	return (buf[0] & SB_SAMPLE_FLAG_ABSOLUTE) != 0;
+}
+
+/**
+ * \brief Timestamp of a record.
+ * \param base Timestamp of the last absolute record, used if this one holds a delta
+ */
+uint32_t SB_sampleTime(const uint8_t *buf, uint32_t base) {
+	if (SB_sampleIsAbsolute(buf)) {
+		return get32(buf + SB_SAMPLE_HEADER_LEN);
+	}
+
+	return base + get16(buf + SB_SAMPLE_HEADER_LEN);
+}
+
+static uint8_t *put16(uint8_t *p, uint16_t value) {
+	*p++ = value & 0xFF;
+	*p++ = value >> 8;
+
+	return p;
+}
+
+static uint8_t *put32(uint8_t *p, uint32_t value) {
+	p = put16(p, value & 0xFFFF);
+
+	return put16(p, value >> 16);
+}
+
+static uint16_t get16(const uint8_t *p) {
+	return p[0] | ((uint16_t)p[1] << 8);
+}
+
+static uint32_t get32(const uint8_t *p) {
+	return get16(p) | ((uint32_t)get16(p + 2) << 16);
+}
+
+static uint8_t countChannels(uint8_t channels) {
+	uint8_t count = 0;
+
+	while (channels) {
+		channels &= channels - 1;
+		++count;
+	}
+
+	return count;
+}
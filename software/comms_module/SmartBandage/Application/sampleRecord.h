@@ -0,0 +1,71 @@
+/*
+ * @file sampleRecord.h
+ * @brief Encodes and decodes sample records, the one format samples are kept and sent in.
+ *
+ * A sample is encoded once, by the peripheral manager, and the same bytes are queued
+ * for the live stream, appended to the sample log and sent by the history download.
+ * The live stream encodes the records of each packet again, starting from an absolute one.
+ *
+ * Record layout (little endian):
+ *   uint8_t  header     Bits 7-4 SB_SAMPLE_FORMAT_VERSION, bit 0 SB_SAMPLE_FLAG_ABSOLUTE
+ *   uint8_t  channels   Bit n is set if channel n is present
+ *   uint32_t timestamp  If SB_SAMPLE_FLAG_ABSOLUTE: seconds
+ *   uint16_t delta      Otherwise: seconds since the last absolute record
+ *   uint16_t values     One per present channel, in channel order
+ *
+ * Every SB_SAMPLE_ABSOLUTE_INTERVAL records, and whenever the delta would not fit, the
+ * timestamp is written in full. A reader that joins part way through, or misses records,
+ * takes the time from the first record of the next live stream packet, which is always
+ * absolute, or from the history download message header.
+ *
+ * Only standard C is used, so host tools build this file and sampleRecord.c as they are.
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef APPLICATION_SAMPLERECORD_H_
+#define APPLICATION_SAMPLERECORD_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "sampleSchema.h"
+
+#define SB_SAMPLE_CHANNEL_ENUM( name, unit )	SB_SAMPLE_CHANNEL_##name,
+
+typedef enum {
+	SB_SAMPLE_CHANNELS( SB_SAMPLE_CHANNEL_ENUM )
+	SB_SAMPLE_NUM_CHANNELS
+} SB_SampleChannel;
+
+#define SB_SAMPLE_FLAG_ABSOLUTE			0x01
+
+#define SB_SAMPLE_HEADER_LEN			2
+#define SB_SAMPLE_MIN_LEN				(SB_SAMPLE_HEADER_LEN + sizeof(uint16_t))
+#define SB_SAMPLE_MAX_LEN				(SB_SAMPLE_HEADER_LEN + sizeof(uint32_t) + SB_SAMPLE_NUM_CHANNELS * sizeof(uint16_t))
+
+#define SB_SAMPLE_ABSOLUTE_INTERVAL		16
+
+typedef struct {
+	uint32_t timestamp;
+	uint8_t  channels;						// Bit n is set if values[n] is valid
+	uint16_t values[SB_SAMPLE_NUM_CHANNELS];
+} SB_Sample;
+
+// Timestamp of the last absolute record, shared by consecutive encodes or decodes
+typedef struct {
+	uint32_t base;
+	uint8_t  sinceAbsolute;
+	bool     valid;
+} SB_SampleCodec;
+
+extern const char * const SB_sampleChannelNames[SB_SAMPLE_NUM_CHANNELS];
+extern const char * const SB_sampleChannelUnits[SB_SAMPLE_NUM_CHANNELS];
+
+uint8_t  SB_sampleEncode(SB_SampleCodec *codec, const SB_Sample *sample, uint8_t *buf);
+uint8_t  SB_sampleDecode(SB_SampleCodec *codec, const uint8_t *buf, uint16_t length, SB_Sample *sample);
+uint8_t  SB_sampleLength(const uint8_t *buf, uint16_t length);
+bool     SB_sampleIsAbsolute(const uint8_t *buf);
+uint32_t SB_sampleTime(const uint8_t *buf, uint32_t base);
+
+#endif /* APPLICATION_SAMPLERECORD_H_ */
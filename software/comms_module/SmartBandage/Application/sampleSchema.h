@@ -0,0 +1,29 @@
+/*
+ * @file sampleSchema.h
+ * @brief The schema of sample records: the format version and the channels they carry.
+ *
+ * This is the one place the sample format is described. sampleRecord.h and
+ * sampleRecord.c expand it into the channel numbering, the channel names and the
+ * encoder and decoder, which build unchanged in the firmware and in host tools.
+ *
+ * Channels are only ever appended. Changing the meaning or width of a channel, or
+ * the record layout in sampleRecord.h, needs a new SB_SAMPLE_FORMAT_VERSION.
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef APPLICATION_SAMPLESCHEMA_H_
+#define APPLICATION_SAMPLESCHEMA_H_
+
+// Carried in every record, so readers can tell the layout apart. 4 bits.
+#define SB_SAMPLE_FORMAT_VERSION		1
+
+// X( name, unit ): one 16 bit value per channel, in channel bitmap order
+#define SB_SAMPLE_CHANNELS( X ) \
+	X( TEMPERATURE0, "1/16 C" ) \
+	X( TEMPERATURE1, "1/16 C" ) \
+	X( TEMPERATURE2, "1/16 C" ) \
+	X( TEMPERATURE3, "1/16 C" ) \
+	X( HUMIDITY,     "1/16 %RH" )
+
+#endif /* APPLICATION_SAMPLESCHEMA_H_ */
@@ -0,0 +1,226 @@
+/*
+ * settings.c
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#include <stddef.h>
+#include <string.h>
+
+#include <ti/sysbios/knl/Task.h>
+#include <ti/sysbios/knl/Clock.h>
+#include <xdc/runtime/System.h>
+
+#include "osal_snv.h"
+
+#include "util.h"
+#include "settings.h"
+
+static void     SB_settingsClockHandler(UArg arg);
+static uint16_t blockCrc(const SB_SettingsBlock *block);
+
+struct {
+	SB_SettingsBlock block;
+	bool dirty;
+
+	bool initialized;
+	Clock_Struct writeClock;
+	SB_SettingsFlushRequestCB flushRequestCB;
+
+	SB_SettingsStats stats;
+} SETTINGS = {
+	.block = {
+		.version = SB_SETTINGS_VERSION,
+		.length = sizeof(SB_Settings),
+		// Defaults, used until a valid block is loaded from SNV
+		.settings = {
+			.samplePeriodMs = 1000,
+			.temperatureOffset = { 0 },
+			.humidityOffset = 0,
+			.reportPolicy = {
+				// 0.25 C, held back for at most 5 minutes
+				[SB_REPORT_TEMPERATURE] = { .deadband = 4,  .minIntervalS = 5, .maxSilenceS = 300 },
+				// 1 %RH
+				[SB_REPORT_HUMIDITY]    = { .deadband = 16, .minIntervalS = 5, .maxSilenceS = 300 },
+			},
+		},
+	},
+};
+
+/**
+ * \brief Loads the configuration block from SNV, falling back to defaults if it is missing,
+ * 			from another version or corrupt.
+ * \remark Must be called from a task registered with ICall.
+ * \param flushRequestCB Called from SWI context once changes have settled. The owner of the
+ * 			ICall task should respond by calling SB_settingsFlush when it is idle.
+ */
+SB_Error SB_settingsInit(SB_SettingsFlushRequestCB flushRequestCB) {
+	SB_SettingsBlock stored;
+	UInt key;
+
+	SETTINGS.flushRequestCB = flushRequestCB;
+
+	if (NULL == Util_constructClock(
+			&SETTINGS.writeClock,
+			SB_settingsClockHandler,
+			SB_SETTINGS_WRITE_DELAY_MS,
+			0,
+			false,
+			0)) {
+#ifdef SB_DEBUG
+		System_printf("SETTINGS: Failed to initialize write clock\n");
+		System_flush();
+#endif
+		return OSResourceInitializationError;
+	}
+
+	if (SUCCESS == osal_snv_read(SB_SETTINGS_NV_ID, sizeof(SB_SettingsBlock), &stored)
+			&& stored.version == SB_SETTINGS_VERSION
+			&& stored.length == sizeof(SB_Settings)
+			&& stored.crc == blockCrc(&stored)) {
+		key = Task_disable();
+		SETTINGS.block = stored;
+		SETTINGS.stats.loadedFromNV = true;
+		Task_restore(key);
+	} else {
+#ifdef SB_DEBUG
+		System_printf("SETTINGS: No valid configuration stored, using defaults\n");
+		System_flush();
+#endif
+	}
+
+	key = Task_disable();
+	SETTINGS.initialized = true;
+	Task_restore(key);
+
+	// Changes made before the clock existed still need to be written
+	if (SETTINGS.dirty) {
+		Util_startClock(&SETTINGS.writeClock);
+	}
+
+	return NoError;
+}
+
+/**
+ * \brief Copies the current configuration.
+ */
+void SB_settingsGet(SB_Settings *settings) {
+	UInt key = Task_disable();
+	*settings = SETTINGS.block.settings;
+	Task_restore(key);
+}
+
+/**
+ * \brief Replaces the configuration in RAM. The block is written to SNV once no further
+ * 			change has been made for SB_SETTINGS_WRITE_DELAY_MS.
+ */
+SB_Error SB_settingsSet(const SB_Settings *settings) {
+	bool initialized;
+	UInt key;
+
+	if (settings == NULL) {
+		return InvalidParameter;
+	}
+
+	key = Task_disable();
+	if (memcmp(&SETTINGS.block.settings, settings, sizeof(SB_Settings)) == 0) {
+		Task_restore(key);
+		return NoError;
+	}
+
+	SETTINGS.block.settings = *settings;
+	SETTINGS.dirty = true;
+	initialized = SETTINGS.initialized;
+	Task_restore(key);
+
+	if (initialized) {
+		Util_restartClock(&SETTINGS.writeClock, SB_SETTINGS_WRITE_DELAY_MS);
+	}
+
+	return NoError;
+}
+
+bool SB_settingsIsDirty() {
+	return SETTINGS.dirty;
+}
+
+/**
+ * \brief Writes the configuration block to SNV if it has changed.
+ * \remark Must be called from a task registered with ICall. The write may compact the
+ * 			SNV page and stall the stack, so callers should only flush when idle.
+ */
+SB_Error SB_settingsFlush() {
+	static SB_SettingsBlock pending;
+	uint32_t start, elapsed;
+	uint8_t status;
+	UInt key;
+
+	if (!SETTINGS.initialized) {
+		return ResourceNotInitialized;
+	}
+
+	key = Task_disable();
+	if (!SETTINGS.dirty) {
+		Task_restore(key);
+		return NoError;
+	}
+
+	pending = SETTINGS.block;
+	SETTINGS.dirty = false;
+	Task_restore(key);
+
+	pending.crc = blockCrc(&pending);
+
+	start = Clock_getTicks();
+	status = osal_snv_write(SB_SETTINGS_NV_ID, sizeof(SB_SettingsBlock), &pending);
+	elapsed = Clock_getTicks() - start;
+
+	SETTINGS.stats.lastWriteTicks = elapsed;
+	SETTINGS.stats.totalWriteTicks += elapsed;
+	if (elapsed > SETTINGS.stats.maxWriteTicks) {
+		SETTINGS.stats.maxWriteTicks = elapsed;
+	}
+
+	if (elapsed > SB_SETTINGS_COMPACTION_TICKS) {
+		++SETTINGS.stats.compactions;
+	}
+
+	if (status != SUCCESS) {
+		++SETTINGS.stats.writeFailures;
+
+		// Try again after another settle period
+		key = Task_disable();
+		SETTINGS.dirty = true;
+		Task_restore(key);
+		Util_restartClock(&SETTINGS.writeClock, SB_SETTINGS_WRITE_DELAY_MS);
+
+#ifdef SB_DEBUG
+		System_printf("SETTINGS: SNV write failed: %d\n", status);
+		System_flush();
+#endif
+		return UnknownError;
+	}
+
+	++SETTINGS.stats.writes;
+
+#ifdef SB_DEBUG
+	System_printf("SETTINGS: Written in %d ticks\n", elapsed);
+	System_flush();
+#endif
+
+	return NoError;
+}
+
+void SB_settingsGetStats(SB_SettingsStats *stats) {
+	*stats = SETTINGS.stats;
+}
+
+static void SB_settingsClockHandler(UArg arg) {
+	if (SETTINGS.flushRequestCB != NULL) {
+		SETTINGS.flushRequestCB();
+	}
+}
+
+static uint16_t blockCrc(const SB_SettingsBlock *block) {
+	return Util_crc16(0xFFFF, (const uint8_t*)block, offsetof(SB_SettingsBlock, crc));
+}
@@ -0,0 +1,86 @@
+/*
+ * @file settings.h
+ * @brief Application configuration cached in RAM and persisted as a single SNV item.
+ *
+ * Changes are applied to the RAM copy immediately and marked dirty. The whole
+ * block is written to SNV in one osal_snv_write once changes have settled, so
+ * a burst of field updates costs one write and at most one compaction.
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef APPLICATION_SETTINGS_H_
+#define APPLICATION_SETTINGS_H_
+
+#include "bcomdef.h"
+
+#include "Board.h"
+#include "../PROFILES/smartBandageProfile.h"
+
+// SNV item holding the configuration block. Application items must use the customer range.
+#define SB_SETTINGS_NV_ID				BLE_NVID_CUST_START
+
+// Bump whenever SB_Settings changes layout. Blocks of another version are discarded.
+#define SB_SETTINGS_VERSION				2
+
+// Time a change must settle before the block is written
+#define SB_SETTINGS_WRITE_DELAY_MS		2000
+
+// A write taking longer than this is counted as having compacted the SNV page
+#define SB_SETTINGS_COMPACTION_TICKS	(5 * NTICKS_PER_MILLSECOND)
+
+#define SB_SETTINGS_NUM_TEMPERATURES	(SB_BLE_TEMPERATURE_LEN / sizeof(uint16_t))
+
+// Sensors with their own reporting policy, in the order of the ReportPolicy characteristic
+typedef enum {
+	SB_REPORT_TEMPERATURE = 0,
+	SB_REPORT_HUMIDITY,
+	SB_REPORT_NUM_POLICIES
+} SB_ReportSensor;
+
+// When a new sensor value is notified. See reportPolicy.h.
+typedef struct {
+	uint16_t deadband;			// Smallest change worth sending, in sensor LSBs
+	uint16_t minIntervalS;		// Shortest time between two notifications of a value
+	uint16_t maxSilenceS;		// Longest a changed value is held back, 0 for no limit
+} SB_ReportPolicy;
+
+typedef struct {
+	// Time between sensor reads
+	uint32_t samplePeriodMs;
+
+	// Calibration offsets added to the raw sensor readings, in sensor LSBs
+	int16_t  temperatureOffset[SB_SETTINGS_NUM_TEMPERATURES];
+	int16_t  humidityOffset;
+
+	SB_ReportPolicy reportPolicy[SB_REPORT_NUM_POLICIES];
+} SB_Settings;
+
+// The block stored in SNV
+typedef struct {
+	uint16_t    version;
+	uint16_t    length;
+	SB_Settings settings;
+	uint16_t    crc;			// CRC16 over every preceding byte of the block
+} SB_SettingsBlock;
+
+typedef struct {
+	uint16_t writes;
+	uint16_t writeFailures;
+	uint16_t compactions;		// Writes slower than SB_SETTINGS_COMPACTION_TICKS
+	uint32_t lastWriteTicks;
+	uint32_t maxWriteTicks;
+	uint32_t totalWriteTicks;
+	bool     loadedFromNV;		// False if defaults were used at boot
+} SB_SettingsStats;
+
+typedef void (*SB_SettingsFlushRequestCB)(void);
+
+SB_Error SB_settingsInit(SB_SettingsFlushRequestCB flushRequestCB);
+void     SB_settingsGet(SB_Settings *settings);
+SB_Error SB_settingsSet(const SB_Settings *settings);
+bool     SB_settingsIsDirty();
+SB_Error SB_settingsFlush();
+void     SB_settingsGetStats(SB_SettingsStats *stats);
+
+#endif /* APPLICATION_SETTINGS_H_ */
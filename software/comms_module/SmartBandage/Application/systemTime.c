@@ -0,0 +1,181 @@
+/*
+ * systemTime.c
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#include <ti/sysbios/knl/Swi.h>
+#include <ti/sysbios/knl/Clock.h>
+#include <xdc/runtime/System.h>
+
+#include "util.h"
+#include "systemTime.h"
+
+typedef struct {
+	uint32_t ticks;
+	uint64_t time;			// Corrected time at ticks, in 1/65536ths of a second
+	uint64_t rawTime;		// Time at the nominal tick rate, for measuring drift
+	uint32_t scale;			// Corrected time units per tick, as a fraction of 2^32
+} SB_SystemTimeAnchor;
+
+static void     SB_systemTimeClockHandler(UArg arg);
+static void     setAnchor(uint32_t ticks, uint64_t time, uint64_t rawTime, uint32_t scale);
+static uint64_t elapsed(uint32_t fromTicks, uint32_t toTicks, uint32_t scale);
+
+struct {
+	// Readers use anchors[current]. Writers fill the other one and then switch.
+	SB_SystemTimeAnchor anchors[2];
+	volatile uint8_t current;
+
+	// Raw time and phone time of the sync drift is measured from
+	uint64_t referenceRawTime;
+	UTCTime referenceTime;
+	bool driftKnown;
+
+	Clock_Struct anchorClock;
+
+	SB_SystemTimeStats stats;
+} SYSTIME = {
+	// Counts from boot until the first sync
+	.anchors = {
+		{ .scale = SB_SYSTEMTIME_NOMINAL_SCALE },
+		{ .scale = SB_SYSTEMTIME_NOMINAL_SCALE },
+	},
+};
+
+/**
+ * \brief Starts moving the anchor forward periodically. The time can be read before this.
+ */
+SB_Error SB_systemTimeInit() {
+	if (NULL == Util_constructClock(
+			&SYSTIME.anchorClock,
+			SB_systemTimeClockHandler,
+			SB_SYSTEMTIME_ANCHOR_PERIOD_MS,
+			SB_SYSTEMTIME_ANCHOR_PERIOD_MS,
+			true,
+			0)) {
+#ifdef SB_DEBUG
+		System_printf("SYSTIME: Failed to initialize anchor clock\n");
+		System_flush();
+#endif
+		return OSResourceInitializationError;
+	}
+
+	return NoError;
+}
+
+/**
+ * \brief Sets the time from the phone, and measures the drift of the local clock since an
+ * 			earlier sync.
+ * \remark Must be called from a task.
+ */
+void SB_systemTimeSet(UTCTime time) {
+	const SB_SystemTimeAnchor *anchor;
+	uint64_t local, raw, rawElapsed;
+	int64_t error, limit, measuredPpb;
+	int32_t driftPpb;
+	uint32_t now;
+	UInt key;
+
+	key = Swi_disable();
+
+	now = Clock_getTicks();
+	anchor = &SYSTIME.anchors[SYSTIME.current];
+	local = anchor->time + elapsed(anchor->ticks, now, anchor->scale);
+	raw = anchor->rawTime + elapsed(anchor->ticks, now, SB_SYSTEMTIME_NOMINAL_SCALE);
+
+	SYSTIME.stats.lastOffsetMs = ((((int64_t)time << SB_SYSTEMTIME_FRAC_BITS) - (int64_t)local) * 1000) >> SB_SYSTEMTIME_FRAC_BITS;
+	driftPpb = SYSTIME.stats.driftPpb;
+
+	if (!SYSTIME.stats.set) {
+		SYSTIME.referenceRawTime = raw;
+		SYSTIME.referenceTime = time;
+	} else if (raw - SYSTIME.referenceRawTime >= ((uint64_t)SB_SYSTEMTIME_MIN_DRIFT_INTERVAL_S << SB_SYSTEMTIME_FRAC_BITS)) {
+		// How much further the phone's clock went than the local clock at its nominal rate
+		rawElapsed = raw - SYSTIME.referenceRawTime;
+		error = ((int64_t)(time - SYSTIME.referenceTime) << SB_SYSTEMTIME_FRAC_BITS) - (int64_t)rawElapsed;
+
+		limit = rawElapsed / (1000000000 / SB_SYSTEMTIME_MAX_DRIFT_PPB);
+
+		if (error > limit || -error > limit) {
+			// Far beyond any crystal: the phone's time was changed. Measure from here.
+			++SYSTIME.stats.driftRejected;
+		} else {
+			measuredPpb = (error * 1000000000) / (int64_t)rawElapsed;
+
+			// Average with the previous estimate to smooth the phone's whole second steps
+			driftPpb = SYSTIME.driftKnown ? (driftPpb + (int32_t)measuredPpb) / 2 : (int32_t)measuredPpb;
+			SYSTIME.driftKnown = true;
+			++SYSTIME.stats.driftMeasurements;
+		}
+
+		SYSTIME.referenceRawTime = raw;
+		SYSTIME.referenceTime = time;
+	}
+
+	setAnchor(now, (uint64_t)time << SB_SYSTEMTIME_FRAC_BITS, raw,
+			SB_SYSTEMTIME_NOMINAL_SCALE + (int32_t)(((int64_t)SB_SYSTEMTIME_NOMINAL_SCALE * driftPpb) / 1000000000));
+
+	SYSTIME.stats.driftPpb = driftPpb;
+	SYSTIME.stats.set = true;
+	++SYSTIME.stats.syncs;
+
+	Swi_restore(key);
+}
+
+/**
+ * \brief The corrected time in seconds.
+ * \remark May be called from any context.
+ */
+UTCTime SB_systemTimeGet() {
+	const SB_SystemTimeAnchor *anchor = &SYSTIME.anchors[SYSTIME.current];
+
+	return (anchor->time + elapsed(anchor->ticks, Clock_getTicks(), anchor->scale)) >> SB_SYSTEMTIME_FRAC_BITS;
+}
+
+void SB_systemTimeGetStats(SB_SystemTimeStats *stats) {
+	UInt key = Swi_disable();
+
+	*stats = SYSTIME.stats;
+
+	Swi_restore(key);
+}
+
+/**
+ * \brief Moves the anchor to the current tick, so the tick count since the anchor never wraps.
+ */
+static void SB_systemTimeClockHandler(UArg arg) {
+	const SB_SystemTimeAnchor *anchor;
+	uint32_t now;
+	UInt key;
+
+	key = Swi_disable();
+
+	now = Clock_getTicks();
+	anchor = &SYSTIME.anchors[SYSTIME.current];
+	setAnchor(now,
+			anchor->time + elapsed(anchor->ticks, now, anchor->scale),
+			anchor->rawTime + elapsed(anchor->ticks, now, SB_SYSTEMTIME_NOMINAL_SCALE),
+			anchor->scale);
+
+	Swi_restore(key);
+}
+
+/**
+ * \brief Fills the anchor not in use and switches readers to it.
+ * \remark Must be called with SWIs disabled.
+ */
+static void setAnchor(uint32_t ticks, uint64_t time, uint64_t rawTime, uint32_t scale) {
+	SB_SystemTimeAnchor *next = &SYSTIME.anchors[SYSTIME.current ^ 1];
+
+	next->ticks = ticks;
+	next->time = time;
+	next->rawTime = rawTime;
+	next->scale = scale;
+
+	SYSTIME.current ^= 1;
+}
+
+static uint64_t elapsed(uint32_t fromTicks, uint32_t toTicks, uint32_t scale) {
+	return ((uint64_t)(toTicks - fromTicks) * scale) >> 32;
+}
@@ -0,0 +1,60 @@
+/*
+ * @file systemTime.h
+ * @brief Wall clock time, set by the phone and corrected for the drift of the local clock.
+ *
+ * Time is kept as the OSAL clock keeps it, in UTCTime seconds since 00:00:00 on
+ * 1 January 2000, and counts from boot until the phone first writes the SystemTime
+ * characteristic. The OSAL clock itself lives in the stack image and cannot be
+ * reached from the application, so it is mirrored here on the TI-RTOS tick.
+ *
+ * Each sync measures how far the local clock ran fast or slow since the previous
+ * one, and the rate of the clock is adjusted by that drift.
+ *
+ * Internally time is counted in 1/65536ths of a second from an anchor: a tick count
+ * and the time at that tick. Reading the time costs one tick read, a multiply, a
+ * shift and an add, so it is cheap enough to stamp every sample. Anchors are double
+ * buffered and only switched by writers, which never leaves a reader with half of one.
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef APPLICATION_SYSTEMTIME_H_
+#define APPLICATION_SYSTEMTIME_H_
+
+#include "bcomdef.h"
+#include "OSAL_Clock.h"
+
+#include "Board.h"
+
+// Time units per tick, as a fraction of 2^32, at the nominal tick rate
+#define SB_SYSTEMTIME_FRAC_BITS				16
+#define SB_SYSTEMTIME_NOMINAL_SCALE			((uint32_t)(((uint64_t)1 << (32 + SB_SYSTEMTIME_FRAC_BITS)) / NTICKS_PER_SECOND))
+
+// The anchor is moved forward well before the 32 bit tick count wraps
+#define SB_SYSTEMTIME_ANCHOR_PERIOD_MS		(60UL * 60 * 1000)
+
+// Syncs closer together than this are applied but not used to measure drift, as
+// the one second resolution of the phone's time would swamp it
+#define SB_SYSTEMTIME_MIN_DRIFT_INTERVAL_S	3600
+
+// Drift measurements beyond this are taken as the phone's clock having been changed
+#define SB_SYSTEMTIME_MAX_DRIFT_PPB			1000000
+
+// Times before 1 January 2016 were counted from boot, not set by the phone
+#define SB_SYSTEMTIME_SET_MIN				((UTCTime)(16 * 365 + 4) * 24 * 60 * 60)
+
+typedef struct {
+	uint16_t syncs;
+	uint16_t driftMeasurements;
+	uint16_t driftRejected;			// Measurements beyond SB_SYSTEMTIME_MAX_DRIFT_PPB
+	int32_t  driftPpb;				// Applied correction, positive if the local clock ran slow
+	int32_t  lastOffsetMs;			// Phone time minus local time at the last sync
+	bool     set;					// The phone has set the time since boot
+} SB_SystemTimeStats;
+
+SB_Error SB_systemTimeInit();
+void     SB_systemTimeSet(UTCTime time);
+UTCTime  SB_systemTimeGet();
+void     SB_systemTimeGetStats(SB_SystemTimeStats *stats);
+
+#endif /* APPLICATION_SYSTEMTIME_H_ */
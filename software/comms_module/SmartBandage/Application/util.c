@@ -376,5 +376,33 @@ char *Util_convertBdAddr2Str(uint8_t *pAddr)
   return str;
 }
 
+/*********************************************************************
+ * @fn      Util_crc16
+ *
+ * @brief   Update a CRC-16/CCITT (polynomial 0x1021) over a buffer.
+ *
+ * @param   crc  - running CRC. Start with 0xFFFF.
+ * @param   pBuf - data to add to the CRC
+ * @param   len  - number of bytes in pBuf
+ *
+ * @return  the updated CRC
+ */
+uint16_t Util_crc16(uint16_t crc, const uint8_t *pBuf, uint16_t len)
+{
+  uint8_t bit;
+
+  while (len--)
+  {
+    crc ^= (uint16_t)(*pBuf++) << 8;
+
+    for (bit = 0; bit < 8; bit++)
+    {
+      crc = (crc & 0x8000) ? ((crc << 1) ^ 0x1021) : (crc << 1);
+    }
+  }
+
+  return crc;
+}
+
 /*********************************************************************
 *********************************************************************/
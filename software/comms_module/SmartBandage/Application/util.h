@@ -208,6 +208,19 @@ extern uint8_t *Util_dequeueMsg(Queue_Handle msgQueue);
  */
 extern char *Util_convertBdAddr2Str(uint8_t *pAddr);
 
+/*********************************************************************
+ * @fn      Util_crc16
+ *
+ * @brief   Update a CRC-16/CCITT (polynomial 0x1021) over a buffer.
+ *
+ * @param   crc  - running CRC. Start with 0xFFFF.
+ * @param   pBuf - data to add to the CRC
+ * @param   len  - number of bytes in pBuf
+ *
+ * @return  the updated CRC
+ */
+extern uint16_t Util_crc16(uint16_t crc, const uint8_t *pBuf, uint16_t len);
+
 /*********************************************************************
 *********************************************************************/  
 
@@ -35,6 +35,8 @@
 *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 *
 *******************************************************************************/
+#include <ti/sysbios/knl/Clock.h>
+
 #include "Board.h"
 #include "bsp_spi.h"
 #include "ext_flash.h"
@@ -48,6 +50,7 @@
 
 #define BLS_CODE_PROGRAM          0x02 /**< Page Program */
 #define BLS_CODE_READ             0x03 /**< Read Data */
+#define BLS_CODE_FAST_READ        0x0B /**< Fast Read (one dummy byte) */
 #define BLS_CODE_READ_STATUS      0x05 /**< Read Status Register */
 #define BLS_CODE_WRITE_ENABLE     0x06 /**< Write Enable */
 #define BLS_CODE_SECTOR_ERASE     0x20 /**< Sector Erase */
@@ -74,6 +77,9 @@
 #define BLS_PROGRAM_PAGE_SIZE     256
 #define BLS_ERASE_SECTOR_SIZE     4096
 
+/* Fast read header: instruction, 24 bit address, dummy byte */
+#define BLS_FAST_READ_HDR_SIZE    5
+
 // Private functions
 static int extFlashWaitReady(void);
 static int extFlashWaitPowerDown(void);
@@ -92,6 +98,12 @@ static PIN_Config BoardFlashPinTable[] =
 static PIN_Handle hFlashPin = NULL;
 static PIN_State pinState;
 
+/* Completion callback of the outstanding asynchronous transfer */
+static extFlashCallback_t asyncCallback = NULL;
+
+/* Transfer statistics */
+static extFlashStats_t stats;
+
 /*******************************************************************************
  * @fn          extFlashSelect
  *
@@ -208,6 +220,9 @@ static int extFlashWaitReady(void)
   const uint8_t wbuf[1] = { BLS_CODE_READ_STATUS };
   int ret;
 
+  /* An asynchronous transfer may still own the chip select */
+  bspSpiWait();
+
   /* Throw away all garbage */
   extFlashSelect();
   bspSpiFlush();
@@ -314,25 +329,49 @@ void extFlashClose(void)
   }
 }
 
-/* See ext_flash.h file for description */
-bool extFlashRead(size_t offset, size_t length, uint8_t *buf)
+/*******************************************************************************
+* @fn       extFlashAsyncDone
+*
+* @brief    Releases the chip select once the DMA has moved the payload of an
+*           asynchronous read or program. Called from SWI context.
+*
+* @param    success - true if the transfer completed
+*
+* @return   none
+*******************************************************************************/
+static void extFlashAsyncDone(bool success)
 {
-  uint8_t wbuf[4];
+  extFlashCallback_t callback = asyncCallback;
+
+  extFlashDeselect();
+
+  asyncCallback = NULL;
+  if (callback != NULL)
+  {
+    callback(success);
+  }
+}
+
+/**
+ * Issue a fast read header and leave the part selected.
+ * @return Zero when successful.
+ */
+static int extFlashStartFastRead(size_t offset)
+{
+  uint8_t wbuf[BLS_FAST_READ_HDR_SIZE];
 
   /* Wait till previous erase/program operation completes */
   int ret = extFlashWaitReady();
   if (ret)
   {
-    return false;
+    return ret;
   }
 
-  /* SPI is driven with very low frequency (1MHz < 33MHz fR spec)
-   * in this temporary implementation.
-   * and hence it is not necessary to use fast read. */
-  wbuf[0] = BLS_CODE_READ;
+  wbuf[0] = BLS_CODE_FAST_READ;
   wbuf[1] = (offset >> 16) & 0xff;
   wbuf[2] = (offset >> 8) & 0xff;
   wbuf[3] = offset & 0xff;
+  wbuf[4] = 0x00; /* dummy */
 
   extFlashSelect();
 
@@ -340,6 +379,23 @@ bool extFlashRead(size_t offset, size_t length, uint8_t *buf)
   {
     /* failure */
     extFlashDeselect();
+    return -1;
+  }
+
+  return 0;
+}
+
+/* See ext_flash.h file for description */
+bool extFlashRead(size_t offset, size_t length, uint8_t *buf)
+{
+  int ret;
+  uint32_t start = Clock_getTicks();
+
+  /* The whole range is read under a single fast read instruction. The SPI
+   * layer moves it as back-to-back DMA transactions so page boundaries do
+   * not cost another command header. */
+  if (extFlashStartFastRead(offset))
+  {
     return false;
   }
 
@@ -347,13 +403,104 @@ bool extFlashRead(size_t offset, size_t length, uint8_t *buf)
 
   extFlashDeselect();
 
+  if (ret == 0)
+  {
+    stats.bytesRead += length;
+    stats.readTicks += Clock_getTicks() - start;
+  }
+
   return ret == 0;
 }
 
+/* See ext_flash.h file for description */
+bool extFlashReadAsync(size_t offset, size_t length, uint8_t *buf,
+                       extFlashCallback_t callback)
+{
+  if (extFlashStartFastRead(offset))
+  {
+    return false;
+  }
+
+  asyncCallback = callback;
+
+  if (bspSpiReadAsync(buf, length, extFlashAsyncDone))
+  {
+    asyncCallback = NULL;
+    extFlashDeselect();
+    return false;
+  }
+
+  stats.bytesRead += length;
+
+  return true;
+}
+
+/* See ext_flash.h file for description */
+bool extFlashWriteAsync(size_t offset, size_t length, const uint8_t *buf,
+                        extFlashCallback_t callback)
+{
+  uint8_t wbuf[4];
+
+  /* A single program instruction cannot cross a page boundary */
+  if (length == 0 ||
+      (offset % BLS_PROGRAM_PAGE_SIZE) + length > BLS_PROGRAM_PAGE_SIZE)
+  {
+    return false;
+  }
+
+  /* Wait till previous erase/program operation completes */
+  if (extFlashWaitReady() || extFlashWriteEnable())
+  {
+    return false;
+  }
+
+  wbuf[0] = BLS_CODE_PROGRAM;
+  wbuf[1] = (offset >> 16) & 0xff;
+  wbuf[2] = (offset >> 8) & 0xff;
+  wbuf[3] = offset & 0xff;
+
+  extFlashSelect();
+
+  if (bspSpiWrite(wbuf, sizeof(wbuf)))
+  {
+    /* failure */
+    extFlashDeselect();
+    return false;
+  }
+
+  asyncCallback = callback;
+
+  if (bspSpiWriteAsync(buf, length, extFlashAsyncDone))
+  {
+    asyncCallback = NULL;
+    extFlashDeselect();
+    return false;
+  }
+
+  stats.bytesWritten += length;
+
+  return true;
+}
+
+/* See ext_flash.h file for description */
+bool extFlashWaitAsync(void)
+{
+  return bspSpiWait() == 0;
+}
+
+/* See ext_flash.h file for description */
+void extFlashGetStats(extFlashStats_t *pStats)
+{
+  *pStats = stats;
+}
+
 /* See ext_flash.h file for description */
 bool extFlashWrite(size_t offset, size_t length, const uint8_t *buf)
 {
   uint8_t wbuf[4];
+  uint32_t start = Clock_getTicks();
+
+  stats.bytesWritten += length;
 
   while (length > 0)
   {
@@ -410,6 +557,8 @@ bool extFlashWrite(size_t offset, size_t length, const uint8_t *buf)
     extFlashDeselect();
   }
 
+  stats.writeTicks += Clock_getTicks() - start;
+
   return true;
 }
 
@@ -40,14 +40,33 @@
 
 #include <stdlib.h>
 #include <stdbool.h>
+#include <stdint.h>
 
 #define EXT_FLASH_PAGE_SIZE   4096
+#define EXT_FLASH_PROGRAM_PAGE_SIZE 256
 
 #ifdef __cplusplus
 extern "C"
 {
 #endif
 
+/**
+* Asynchronous transfer completion callback. Called from SWI context and
+* must not start another transfer.
+*/
+typedef void (*extFlashCallback_t)(bool success);
+
+/**
+* Cumulative transfer statistics. Ticks are in units of the system clock.
+*/
+typedef struct
+{
+  uint32_t bytesRead;
+  uint32_t bytesWritten;
+  uint32_t readTicks;
+  uint32_t writeTicks;
+} extFlashStats_t;
+
 /**
 * Initialize storage driver.
 *
@@ -67,6 +86,38 @@ extern void extFlashClose(void);
 */
 extern bool extFlashRead(size_t offset, size_t length, uint8_t *buf);
 
+/**
+* Start reading storage content using fast read. The whole range is moved
+* by the DMA under a single read instruction; buf must remain valid until
+* the callback has been called.
+*
+* @return True when the transfer was started.
+*/
+extern bool extFlashReadAsync(size_t offset, size_t length, uint8_t *buf,
+                              extFlashCallback_t callback);
+
+/**
+* Start programming up to one program page. The range must not cross a
+* program page boundary; buf must remain valid until the callback has been
+* called.
+*
+* @return True when the transfer was started.
+*/
+extern bool extFlashWriteAsync(size_t offset, size_t length, const uint8_t *buf,
+                               extFlashCallback_t callback);
+
+/**
+* Wait for the outstanding asynchronous transfer to complete.
+*
+* @return True when the last transfer was successful.
+*/
+extern bool extFlashWaitAsync(void);
+
+/**
+* Read the cumulative transfer statistics.
+*/
+extern void extFlashGetStats(extFlashStats_t *pStats);
+
 /**
 * Erase storage sectors corresponding to the range.
 *
@@ -42,6 +42,8 @@
  */
 #include <ti/sysbios/family/arm/cc26xx/Power.h>
 #include <ti/sysbios/knl/Task.h>
+#include <ti/sysbios/knl/Semaphore.h>
+#include <ti/sysbios/BIOS.h>
 #include <ti/drivers/spi/SPICC26XXDMA.h>
 #include <ti/drivers/dma/UDMACC26XX.h>
 
@@ -55,12 +57,37 @@
  * GLOBAL variables
  */
 
+/*******************************************************************************
+ * CONSTANTS
+ */
+
+// SSI master bit rate. The W25X20CL accepts up to 104MHz for fast read, so
+// the CC26xx SSI is the limit here.
+#define BSP_SPI_BIT_RATE          4000000
+
+// The UDMA controller can move at most 1024 frames per transaction. Longer
+// transfers are chained from the transfer callback.
+#define BSP_SPI_MAX_DMA_FRAMES    1024
+
 /*******************************************************************************
  * LOCAL variables
  */
 static SPI_Handle spiHandle = NULL;
 static SPI_Params spiParams;
 
+// State of the transfer currently owned by the DMA. Only one transfer can
+// be outstanding at a time; callers serialize through the chip select.
+static struct {
+  SPI_Transaction transaction;
+  const uint8_t *txBuf;
+  uint8_t *rxBuf;
+  size_t remaining;
+  bool success;
+  bspSpiCallback_t callback;
+  Semaphore_Struct doneSemStruct;
+  Semaphore_Handle doneSem;
+} xfer;
+
 static PIN_Handle hSpiPin = NULL;
 static PIN_State pinState;
 
@@ -75,6 +102,158 @@ static PIN_Config BoardSpiInitTable[] = {
 
 static uint8_t nUsers = 0;
 
+/*******************************************************************************
+ * @fn          bspSpiStartChunk
+ *
+ * @brief       Hand the next chunk of the current transfer to the DMA
+ *
+ * @param       none
+ *
+ * @return      true if the chunk was accepted by the driver
+ */
+static bool bspSpiStartChunk(void)
+{
+  size_t count = xfer.remaining;
+
+  if (count > BSP_SPI_MAX_DMA_FRAMES)
+  {
+    count = BSP_SPI_MAX_DMA_FRAMES;
+  }
+
+  xfer.transaction.count = count;
+  xfer.transaction.txBuf = (void*)xfer.txBuf;
+  xfer.transaction.rxBuf = xfer.rxBuf;
+  xfer.transaction.arg   = NULL;
+
+  if (xfer.txBuf != NULL)
+  {
+    xfer.txBuf += count;
+  }
+
+  if (xfer.rxBuf != NULL)
+  {
+    xfer.rxBuf += count;
+  }
+
+  xfer.remaining -= count;
+
+  return SPI_transfer(spiHandle, &xfer.transaction);
+}
+
+/*******************************************************************************
+ * @fn          bspSpiFinish
+ *
+ * @brief       Complete the current transfer and notify the owner
+ *
+ * @param       success - whether all chunks completed
+ *
+ * @return      none
+ */
+static void bspSpiFinish(bool success)
+{
+  bspSpiCallback_t callback = xfer.callback;
+
+  xfer.success = success;
+  xfer.callback = NULL;
+
+  if (callback != NULL)
+  {
+    callback(success);
+  }
+
+  Semaphore_post(xfer.doneSem);
+}
+
+/*******************************************************************************
+ * @fn          bspSpiTransferCallback
+ *
+ * @brief       SPI driver callback. Chains the next DMA chunk, or completes
+ *              the transfer when nothing remains.
+ *
+ * @param       handle - SPI driver handle
+ * @param       transaction - the transaction that completed
+ *
+ * @return      none
+ */
+static void bspSpiTransferCallback(SPI_Handle handle, SPI_Transaction *transaction)
+{
+  if (transaction->status != SPI_TRANSFER_COMPLETED)
+  {
+    bspSpiFinish(false);
+    return;
+  }
+
+  if (xfer.remaining > 0)
+  {
+    if (!bspSpiStartChunk())
+    {
+      bspSpiFinish(false);
+    }
+    return;
+  }
+
+  bspSpiFinish(true);
+}
+
+/*******************************************************************************
+ * @fn          bspSpiTransferAsync
+ *
+ * @brief       Start a transfer of any length. Transfers longer than the
+ *              UDMA limit are chained in the driver callback so that the
+ *              whole buffer moves without returning to the calling task.
+ *
+ * @param       txBuf - data to send, or NULL to clock out the default value
+ * @param       rxBuf - receive buffer, or NULL to discard received data
+ * @param       len - number of bytes to transfer
+ * @param       callback - called from SWI context on completion (may be NULL)
+ *
+ * @return      '0' if the transfer was started, -1 if failed
+ */
+static int bspSpiTransferAsync(const uint8_t *txBuf, uint8_t *rxBuf,
+                               size_t len, bspSpiCallback_t callback)
+{
+  // Claim the DMA. Posted again when the previous transfer has completed.
+  Semaphore_pend(xfer.doneSem, BIOS_WAIT_FOREVER);
+
+  xfer.txBuf = txBuf;
+  xfer.rxBuf = rxBuf;
+  xfer.remaining = len;
+  xfer.callback = callback;
+
+  if (len == 0)
+  {
+    bspSpiFinish(true);
+    return 0;
+  }
+
+  if (!bspSpiStartChunk())
+  {
+    xfer.callback = NULL;
+    xfer.success = false;
+    Semaphore_post(xfer.doneSem);
+    return -1;
+  }
+
+  return 0;
+}
+
+/*******************************************************************************
+ * @fn          bspSpiTransfer
+ *
+ * @brief       Blocking transfer built on the callback mode driver
+ *
+ * @return      '0' if success, -1 if failed
+ */
+static int bspSpiTransfer(const uint8_t *txBuf, uint8_t *rxBuf, size_t len)
+{
+  if (bspSpiTransferAsync(txBuf, rxBuf, len, NULL))
+  {
+    return -1;
+  }
+
+  return bspSpiWait();
+}
+
 /*******************************************************************************
  * @fn          bspSpiWrite
  *
@@ -87,14 +266,7 @@ static uint8_t nUsers = 0;
  */
 int bspSpiWrite(const uint8_t *buf, size_t len)
 {
-  SPI_Transaction masterTransaction;
-
-  masterTransaction.count  = len;
-  masterTransaction.txBuf  = (void*)buf;
-  masterTransaction.arg    = NULL;
-  masterTransaction.rxBuf  = NULL;
-
-  return SPI_transfer(spiHandle, &masterTransaction) ? 0 : -1;
+  return bspSpiTransfer(buf, NULL, len);
 }
 
 
@@ -110,16 +282,60 @@ int bspSpiWrite(const uint8_t *buf, size_t len)
  */
 int bspSpiRead(uint8_t *buf, size_t len)
 {
-  SPI_Transaction masterTransaction;
+  return bspSpiTransfer(NULL, buf, len);
+}
 
-  masterTransaction.count  = len;
-  masterTransaction.txBuf  = NULL;
-  masterTransaction.arg    = NULL;
-  masterTransaction.rxBuf  = buf;
+/*******************************************************************************
+ * @fn          bspSpiWriteAsync
+ *
+ * @brief       Start writing to an SPI device without waiting for the DMA
+ *
+ * @param       buf - pointer to data buffer. Must stay valid until callback.
+ * @param       len - number of bytes to write
+ * @param       callback - completion callback, called from SWI context
+ *
+ * @return      '0' if the transfer was started, -1 if failed
+ */
+int bspSpiWriteAsync(const uint8_t *buf, size_t len, bspSpiCallback_t callback)
+{
+  return bspSpiTransferAsync(buf, NULL, len, callback);
+}
 
-  return SPI_transfer(spiHandle, &masterTransaction) ? 0 : -1;
+/*******************************************************************************
+ * @fn          bspSpiReadAsync
+ *
+ * @brief       Start reading from an SPI device without waiting for the DMA
+ *
+ * @param       buf - pointer to data buffer. Must stay valid until callback.
+ * @param       len - number of bytes to read
+ * @param       callback - completion callback, called from SWI context
+ *
+ * @return      '0' if the transfer was started, -1 if failed
+ */
+int bspSpiReadAsync(uint8_t *buf, size_t len, bspSpiCallback_t callback)
+{
+  return bspSpiTransferAsync(NULL, buf, len, callback);
 }
 
+/*******************************************************************************
+ * @fn          bspSpiWait
+ *
+ * @brief       Wait for the outstanding transfer (if any) to complete
+ *
+ * @return      '0' if the last transfer succeeded, -1 if failed
+ */
+int bspSpiWait(void)
+{
+  bool success;
+
+  Semaphore_pend(xfer.doneSem, BIOS_WAIT_FOREVER);
+
+  /* Once the DMA is released another transfer may overwrite the result */
+  success = xfer.success;
+  Semaphore_post(xfer.doneSem);
+
+  return success ? 0 : -1;
+}
 
 /*******************************************************************************
  * @fn          bspSpiWriteRead
@@ -134,15 +350,9 @@ int bspSpiRead(uint8_t *buf, size_t len)
  */
 int bspSpiWriteRead(uint8_t *buf, uint8_t wlen, uint8_t rlen)
 {
-  SPI_Transaction masterTransaction;
   bool success;
 
-  masterTransaction.count  = wlen + rlen;
-  masterTransaction.txBuf  = buf;
-  masterTransaction.arg    = NULL;
-  masterTransaction.rxBuf  = buf;
-
-  success = SPI_transfer(spiHandle, &masterTransaction);
+  success = bspSpiTransfer(buf, buf, wlen + rlen) == 0;
   if (success)
   {
     memcpy(buf,buf+wlen,rlen);
@@ -172,11 +382,21 @@ void bspSpiOpen(void)
 
   if (spiHandle == NULL)
   {
-    /*  Configure SPI as master, 1 mHz bit rate*/
+    /* Completion semaphore doubles as the DMA ownership token */
+    Semaphore_Params semParams;
+    Semaphore_Params_init(&semParams);
+    semParams.mode = Semaphore_Mode_BINARY;
+    Semaphore_construct(&xfer.doneSemStruct, 1, &semParams);
+    xfer.doneSem = Semaphore_handle(&xfer.doneSemStruct);
+    xfer.success = true;
+
+    /*  Configure SPI as master in callback mode so long transfers can be
+     *  chained in the DMA completion callback */
     SPI_Params_init(&spiParams);
-    spiParams.bitRate = 1000000;
+    spiParams.bitRate = BSP_SPI_BIT_RATE;
     spiParams.mode         = SPI_MASTER;
-    spiParams.transferMode = SPI_MODE_BLOCKING;
+    spiParams.transferMode = SPI_MODE_CALLBACK;
+    spiParams.transferCallbackFxn = bspSpiTransferCallback;
 
     /* Attempt to open SPI. */
     spiHandle = SPI_open(Board_SPI0, &spiParams);
@@ -209,9 +429,12 @@ void bspSpiClose(void)
 
   if (spiHandle != NULL)
   {
-    // Close the RTOS driver
+    // Let any outstanding DMA transfer drain before closing the RTOS driver
+    bspSpiWait();
     SPI_close(spiHandle);
     spiHandle = NULL;
+
+    Semaphore_destruct(&xfer.doneSemStruct);
   }
 
   if (hSpiPin == NULL)
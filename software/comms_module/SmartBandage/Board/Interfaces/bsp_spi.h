@@ -47,6 +47,13 @@ extern "C"
 {
 #endif
 
+  /**
+  * Transfer completion callback. Called from SWI context.
+  *
+  * @param success - true when every byte was transferred
+  */
+  typedef void (*bspSpiCallback_t)(bool success);
+
   /**
   * Open SPI interface
   *
@@ -89,6 +96,29 @@ extern "C"
   */
   extern  int bspSpiWriteRead(uint8_t *buf, uint8_t wlen, uint8_t rlen);
 
+  /**
+  * Start a read from an SPI device. Any length is moved in UDMA sized
+  * chunks without returning to the caller.
+  *
+  * @return 0 when the transfer was started.
+  */
+  extern int bspSpiReadAsync(uint8_t *buf, size_t length, bspSpiCallback_t callback);
+
+  /**
+  * Start a write to an SPI device. Any length is moved in UDMA sized
+  * chunks without returning to the caller.
+  *
+  * @return 0 when the transfer was started.
+  */
+  extern int bspSpiWriteAsync(const uint8_t *buf, size_t length, bspSpiCallback_t callback);
+
+  /**
+  * Wait for the outstanding asynchronous transfer to complete
+  *
+  * @return 0 when the last transfer was successful.
+  */
+  extern int bspSpiWait(void);
+
 #ifdef __cplusplus
 }
 #endif
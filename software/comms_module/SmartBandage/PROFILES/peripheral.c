@@ -184,6 +184,11 @@ static uint8_t  gapRole_AdvFilterPolicy;
 
 static uint16_t gapRole_ConnectionHandle = INVALID_CONNHANDLE;
 
+// Every open link. gapRole_ConnectionHandle is the most recent of them, and the
+// one the connection parameter procedures apply to.
+static uint16_t gapRole_LinkHandles[MAX_NUM_BLE_CONNS];
+static uint8_t  gapRole_NumLinks = 0;
+
 static uint8_t  gapRole_ConnectedDevAddr[B_ADDR_LEN] = {0};
 
 static uint8_t  gapRole_ParamUpdateEnable = FALSE;
@@ -216,6 +221,8 @@ static gapRolesParamUpdateCB_t *pGapRoles_ParamUpdateCB = NULL;
  * LOCAL FUNCTIONS
  */
 static void gapRole_init(void);
+static void gapRole_addLink(uint16_t connHandle);
+static uint8_t gapRole_removeLink(uint16_t connHandle);
 static void gapRole_taskFxn(UArg a0, UArg a1);
 
 static void      gapRole_processStackMsg(ICall_Hdr *pMsg);
@@ -291,6 +298,7 @@ bStatus_t GAPRole_SetParameter(uint16_t param, uint8_t len, void *pValue)
           {
             // Turn off advertising.
             if ((gapRole_state == GAPROLE_ADVERTISING)
+                || (gapRole_state == GAPROLE_CONNECTED_ADV)
                 || (gapRole_state == GAPROLE_WAITING_AFTER_TIMEOUT))
             {
               VOID GAP_EndDiscoverable(selfEntity);
@@ -298,10 +306,12 @@ bStatus_t GAPRole_SetParameter(uint16_t param, uint8_t len, void *pValue)
           }
           else if ((oldAdvEnabled == FALSE) && (gapRole_AdvEnabled))
           {
-            // Turn on advertising.
+            // Turn on advertising, also while another central can still connect.
             if ((gapRole_state == GAPROLE_STARTED)
                 || (gapRole_state == GAPROLE_WAITING)
-                || (gapRole_state == GAPROLE_WAITING_AFTER_TIMEOUT))
+                || (gapRole_state == GAPROLE_WAITING_AFTER_TIMEOUT)
+                || ((gapRole_state == GAPROLE_CONNECTED)
+                    && (gapRole_NumLinks < MAX_NUM_BLE_CONNS)))
             {
               gapRole_setEvent(START_ADVERTISING_EVT);
             }
@@ -816,6 +826,7 @@ static void gapRole_init(void)
   
   gapRole_state = GAPROLE_INIT;
   gapRole_ConnectionHandle = INVALID_CONNHANDLE;
+  gapRole_NumLinks = 0;
   
   // Get link DB maximum number of connections
   linkDBNumConns = linkDB_NumConns();
@@ -1073,7 +1084,8 @@ static void gapRole_processGAPMsg(gapEventHdr_t *pMsg)
           else if ((gapRole_state != GAPROLE_ADVERTISING)   &&
                    (gapRole_state != GAPROLE_CONNECTED_ADV) &&
                    (gapRole_state != GAPROLE_CONNECTED || 
-                    gapRole_AdvNonConnEnabled == TRUE)      &&
+                    gapRole_AdvNonConnEnabled == TRUE       ||
+                    gapRole_NumLinks < MAX_NUM_BLE_CONNS)   &&
                    (Util_isActive(&startAdvClock) == FALSE))
           {
             // Start advertising
@@ -1168,6 +1180,7 @@ static void gapRole_processGAPMsg(gapEventHdr_t *pMsg)
           VOID memcpy(gapRole_ConnectedDevAddr, pPkt->devAddr, B_ADDR_LEN);
           gapRole_ConnectionHandle = pPkt->connectionHandle;
           gapRole_state = GAPROLE_CONNECTED;
+          gapRole_addLink(pPkt->connectionHandle);
 
           // Store connection information
           gapRole_ConnInterval = pPkt->connInterval;
@@ -1188,6 +1201,18 @@ static void gapRole_processGAPMsg(gapEventHdr_t *pMsg)
           // Notify the Bond Manager to the connection
           VOID GAPBondMgr_LinkEst(pPkt->devAddrType, pPkt->devAddr, 
                                   pPkt->connectionHandle, GAP_PROFILE_PERIPHERAL);
+
+          if (pGapRoles_AppCGs && pGapRoles_AppCGs->pfnLinkChange)
+          {
+            pGapRoles_AppCGs->pfnLinkChange(pPkt->connectionHandle, TRUE);
+          }
+
+          // The controller stops advertising when a central connects. Keep
+          // accepting centrals until every link is in use.
+          if ((gapRole_NumLinks < MAX_NUM_BLE_CONNS) && gapRole_AdvEnabled)
+          {
+            gapRole_setEvent(START_ADVERTISING_EVT);
+          }
         }
         else if (pPkt->hdr.status == bleGAPConnNotAcceptable)
         {
@@ -1211,6 +1236,38 @@ static void gapRole_processGAPMsg(gapEventHdr_t *pMsg)
         gapTerminateLinkEvent_t *pPkt = (gapTerminateLinkEvent_t *)pMsg;
 
         GAPBondMgr_LinkTerm(pPkt->connectionHandle);
+
+        gapRole_ConnTermReason = pPkt->reason;
+
+        if (pGapRoles_AppCGs && pGapRoles_AppCGs->pfnLinkChange)
+        {
+          pGapRoles_AppCGs->pfnLinkChange(pPkt->connectionHandle, FALSE);
+        }
+
+        // Other centrals are still connected: stay connected, and
+        // advertise for the link that became free
+        if (gapRole_removeLink(pPkt->connectionHandle))
+        {
+          if (pPkt->connectionHandle == gapRole_ConnectionHandle)
+          {
+            // The parameters of the remaining link are known again at its
+            // next update
+            gapRole_ConnectionHandle = gapRole_LinkHandles[gapRole_NumLinks - 1];
+            memset(gapRole_ConnectedDevAddr, 0, B_ADDR_LEN);
+            gapRole_ConnInterval = 0;
+            gapRole_ConnSlaveLatency = 0;
+            gapRole_ConnTimeout = 0;
+
+            Util_stopClock(&startUpdateClock);
+            Util_stopClock(&updateTimeoutClock);
+          }
+
+          if ((gapRole_state == GAPROLE_CONNECTED) && gapRole_AdvEnabled)
+          {
+            gapRole_setEvent(START_ADVERTISING_EVT);
+          }
+          break;
+        }
         
         memset(gapRole_ConnectedDevAddr, 0, B_ADDR_LEN);
 
@@ -1218,7 +1275,6 @@ static void gapRole_processGAPMsg(gapEventHdr_t *pMsg)
         gapRole_ConnInterval = 0;
         gapRole_ConnSlaveLatency = 0;
         gapRole_ConnTimeout = 0;
-        gapRole_ConnTermReason = pPkt->reason;
 
         // Cancel all connection parameter update timers (if any active)
         Util_stopClock(&startUpdateClock);
@@ -1234,6 +1290,11 @@ static void gapRole_processGAPMsg(gapEventHdr_t *pMsg)
           // Continue advertising.
           gapRole_state = GAPROLE_ADVERTISING_NONCONN;
         }
+        // Still advertising for another central
+        else if (gapRole_state == GAPROLE_CONNECTED_ADV)
+        {
+          gapRole_state = GAPROLE_ADVERTISING;
+        }
         // Else go to WAITING state.
         else
         {
@@ -1256,6 +1317,12 @@ static void gapRole_processGAPMsg(gapEventHdr_t *pMsg)
       {
         gapLinkUpdateEvent_t *pPkt = (gapLinkUpdateEvent_t *)pMsg;
 
+        // Only the most recent link is followed
+        if (pPkt->connectionHandle != gapRole_ConnectionHandle)
+        {
+          break;
+        }
+
         // Cancel connection param update timeout timer (if active)
         Util_stopClock(&updateTimeoutClock);
         
@@ -1433,7 +1500,8 @@ bStatus_t GAPRole_SendUpdateParam(uint16_t minConnInterval,
                                   uint8_t handleFailure)
 {    
   // If there is no existing connection no update need be sent
-  if (gapRole_state != GAPROLE_CONNECTED)
+  if ((gapRole_state != GAPROLE_CONNECTED) &&
+      (gapRole_state != GAPROLE_CONNECTED_ADV))
   {
     return (bleNotConnected);
   }
@@ -1481,6 +1549,49 @@ static void gapRole_setEvent(uint32_t event)
   Semaphore_post(sem);
 }
 
+/*********************************************************************
+ * @fn      gapRole_addLink
+ *
+ * @brief   Remember a newly established link.
+ *
+ * @param   connHandle - connection handle of the link
+ *
+ * @return  none
+ */
+static void gapRole_addLink(uint16_t connHandle)
+{
+  if (gapRole_NumLinks < MAX_NUM_BLE_CONNS)
+  {
+    gapRole_LinkHandles[gapRole_NumLinks++] = connHandle;
+  }
+}
+
+/*********************************************************************
+ * @fn      gapRole_removeLink
+ *
+ * @brief   Forget a terminated link.
+ *
+ * @param   connHandle - connection handle of the link
+ *
+ * @return  TRUE if other links are still open, FALSE otherwise
+ */
+static uint8_t gapRole_removeLink(uint16_t connHandle)
+{
+  uint8_t i;
+
+  for (i = 0; i < gapRole_NumLinks; i++)
+  {
+    if (gapRole_LinkHandles[i] == connHandle)
+    {
+      // Order does not matter: move the last link into the gap
+      gapRole_LinkHandles[i] = gapRole_LinkHandles[--gapRole_NumLinks];
+      break;
+    }
+  }
+
+  return (gapRole_NumLinks > 0);
+}
+
 /*********************************************************************
  * @fn      gapRole_clockHandler
  *
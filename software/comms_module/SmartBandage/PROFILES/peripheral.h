@@ -144,6 +144,13 @@ typedef void (*gapRolesParamUpdateCB_t)(uint16_t connInterval,
  */
 typedef void (*gapRolesStateNotify_t)(gaprole_States_t newState);
 
+/**
+ * Callback when a link is established or terminated. With several centrals
+ * connected the state only changes for the first and the last link, so this
+ * is how each one is followed.
+ */
+typedef void (*gapRolesLinkNotify_t)(uint16_t connHandle, uint8_t established);
+
 /**
  * Callback structure - must be setup by the application and used when 
  *                      GAPRole_StartDevice() is called.
@@ -151,6 +158,7 @@ typedef void (*gapRolesStateNotify_t)(gaprole_States_t newState);
 typedef struct
 {
   gapRolesStateNotify_t    pfnStateChange;  //!< Whenever the device changes state
+  gapRolesLinkNotify_t     pfnLinkChange;   //!< Whenever a link is established or terminated
 } gapRolesCBs_t;
 
 /*-------------------------------------------------------------------
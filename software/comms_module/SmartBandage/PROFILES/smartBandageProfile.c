@@ -42,6 +42,8 @@
  */
 #include <string.h>
 
+#include <ti/sysbios/knl/Task.h>
+
 #include "bcomdef.h"
 #include "OSAL.h"
 #include "linkdb.h"
@@ -89,6 +91,9 @@ CONST uint8 simpleProfileServUUID[ATT_BT_UUID_SIZE] =
 
 static simpleProfileCBs_t *simpleProfile_AppCBs = NULL;
 
+// Bit mask of characteristics changed since notifications were last sent
+static uint16 pendingNotifications = 0;
+
 /*********************************************************************
  * Profile Attributes - variables
  */
@@ -96,111 +101,90 @@ static simpleProfileCBs_t *simpleProfile_AppCBs = NULL;
 // Simple Profile Service attribute
 static CONST gattAttrType_t simpleProfileService = { ATT_BT_UUID_SIZE, simpleProfileServUUID };
 
-// Characteristic values
-static uint8 charValTemperature[SB_BLE_TEMPERATURE_LEN];
-static uint8 charValHumidity[SB_BLE_HUMIDITY_LEN];
-static uint8 charValBandageID[SB_BLE_BANDAGEID_LEN];
-static uint8 charValBandageState[SB_BLE_BANDAGESTATE_LEN];
-static uint8 charValBattCharge[SB_BLE_BATTCHARGE_LEN];
-static uint8 charValExtPower[SB_BLE_EXTPOWER_LEN];
-static uint8 charValMoistureMap[SB_BLE_MOISTUREMAP_LEN];
-static uint8 charValSystemTime[SB_BLE_SYSTEMTIME_LEN];
-
-// Characteristic structs
-static SB_PROFILE_CHARACTERISTIC characteristics[SB_NUM_CHARACTERISTICS] = {
-	// Temperature characteristic
-	{
-		.uuid   	 = SB_BLE_TEMPERATURE_UUID,
-		.uuidptr	 = { LO_UINT16(SB_BLE_TEMPERATURE_UUID), HI_UINT16(SB_BLE_TEMPERATURE_UUID) },
-		.props 		 = GATT_PROP_READ,
-		.perms		 = GATT_PERMIT_READ,
-		.value 		 = charValTemperature,
-		.length		 = SB_BLE_TEMPERATURE_LEN,
-		.description = "Temperature",
-	},
-
-	// Humidity characteristic
-	{
-		.uuid   	 = SB_BLE_HUMIDITY_UUID,
-		.uuidptr	 = { LO_UINT16(SB_BLE_HUMIDITY_UUID), HI_UINT16(SB_BLE_HUMIDITY_UUID) },
-		.props  	 = GATT_PROP_READ,
-		.perms		 = GATT_PERMIT_READ,
-		.value  	 = charValHumidity,
-		.length 	 = SB_BLE_HUMIDITY_LEN,
-		.description = "Humidity",
-	},
-
-	// BandageID characteristic
-	{
-		.uuid   	 = SB_BLE_BANDAGEID_UUID,
-		.uuidptr	 = { LO_UINT16(SB_BLE_BANDAGEID_UUID), HI_UINT16(SB_BLE_BANDAGEID_UUID) },
-		.props  	 = GATT_PROP_READ,
-		.perms		 = GATT_PERMIT_READ,
-		.value  	 = charValBandageID,
-		.length 	 = SB_BLE_BANDAGEID_LEN,
-		.description = "BandageID",
-	},
-
-	// BandageState characteristic
-	{
-		.uuid   	 = SB_BLE_BANDAGESTATE_UUID,
-		.uuidptr	 = { LO_UINT16(SB_BLE_BANDAGESTATE_UUID), HI_UINT16(SB_BLE_BANDAGESTATE_UUID) },
-		.props  	 = GATT_PROP_READ,
-		.perms		 = GATT_PERMIT_READ,
-		.value  	 = charValBandageState,
-		.length 	 = SB_BLE_BANDAGESTATE_LEN,
-		.description = "BandageState",
+// Characteristic values shared between tasks
+typedef struct {
+	uint8 temperature[SB_BLE_TEMPERATURE_LEN];
+	uint8 humidity[SB_BLE_HUMIDITY_LEN];
+	uint8 bandageID[SB_BLE_BANDAGEID_LEN];
+	uint8 bandageState[SB_BLE_BANDAGESTATE_LEN];
+	uint8 battCharge[SB_BLE_BATTCHARGE_LEN];
+	uint8 extPower[SB_BLE_EXTPOWER_LEN];
+	uint8 moistureMap[SB_BLE_MOISTUREMAP_LEN];
+	uint8 systemTime[SB_BLE_SYSTEMTIME_LEN];
+	uint8 reportPolicy[SB_BLE_REPORTPOLICY_LEN];
+	uint8 diagnostics[SB_BLE_DIAGNOSTICS_LEN];
+} SB_PROFILE_VALUES;
+
+// Two copies of the shared values, selected by the low bit of valueSeq. Writers
+// update charVals[0] while valueSeq is odd and readers use charVals[1], which
+// holds the last complete update. Ending the update makes valueSeq even, so
+// readers move to charVals[0], and brings charVals[1] up to date. A reader
+// preempted by a writer sees valueSeq change and reads again.
+static SB_PROFILE_VALUES charVals[2];
+static volatile uint16 valueSeq = 0;
+static uint8 updateDepth = 0;
+
+// Only written and read by the task registered with ICall
+static uint8 charValLiveStream[SB_BLE_LIVESTREAM_LEN];
+
+// Every characteristic of the service, in SB_CHARACTERISTIC order: name, user
+// description, properties, permissions and value. The UUID and length follow
+// from the name, and the description is stored as written.
+#define SB_PROFILE_CHARACTERISTICS( X ) \
+	X( TEMPERATURE,  Temperature,   GATT_PROP_READ | GATT_PROP_NOTIFY,                  GATT_PERMIT_READ,                     charVals[0].temperature ) \
+	X( HUMIDITY,     Humidity,      GATT_PROP_READ | GATT_PROP_NOTIFY,                  GATT_PERMIT_READ,                     charVals[0].humidity ) \
+	X( BANDAGEID,    BandageID,     GATT_PROP_READ | GATT_PROP_NOTIFY,                  GATT_PERMIT_READ,                     charVals[0].bandageID ) \
+	X( BANDAGESTATE, BandageState,  GATT_PROP_READ | GATT_PROP_NOTIFY,                  GATT_PERMIT_READ,                     charVals[0].bandageState ) \
+	X( BATTCHARGE,   BattCharge,    GATT_PROP_READ | GATT_PROP_NOTIFY,                  GATT_PERMIT_READ,                     charVals[0].battCharge ) \
+	X( EXTPOWER,     ExternalPower, GATT_PROP_READ | GATT_PROP_NOTIFY,                  GATT_PERMIT_READ,                     charVals[0].extPower ) \
+	X( MOISTUREMAP,  MoistureMap,   GATT_PROP_READ | GATT_PROP_NOTIFY,                  GATT_PERMIT_READ,                     charVals[0].moistureMap ) \
+	X( SYSTEMTIME,   SystemTime,    GATT_PROP_READ | GATT_PROP_WRITE | GATT_PROP_NOTIFY, GATT_PERMIT_READ | GATT_PERMIT_WRITE, charVals[0].systemTime ) \
+	/* Notify only: packets are sent with SB_Profile_Notify */ \
+	X( LIVESTREAM,   LiveStream,    GATT_PROP_NOTIFY,                                   0,                                    charValLiveStream ) \
+	X( REPORTPOLICY, ReportPolicy,  GATT_PROP_READ | GATT_PROP_WRITE | GATT_PROP_NOTIFY, GATT_PERMIT_READ | GATT_PERMIT_WRITE, charVals[0].reportPolicy ) \
+	X( DIAGNOSTICS,  Diagnostics,   GATT_PROP_READ | GATT_PROP_NOTIFY,                  GATT_PERMIT_READ,                     charVals[0].diagnostics )
+
+// Characteristic structs, constant and kept in flash
+#define SB_PROFILE_CHARACTERISTIC_ENTRY( NAME, DESC, PROPS, PERMS, VALUE ) \
+	[SB_CHARACTERISTIC_##NAME] = { \
+		.uuidptr = { LO_UINT16(SB_BLE_##NAME##_UUID), HI_UINT16(SB_BLE_##NAME##_UUID) }, \
+		.props   = (PROPS), \
+		.perms   = (PERMS), \
+		.value   = (VALUE), \
+		.length  = SB_BLE_##NAME##_LEN, \
 	},
 
-	// BattCharge characteristic
-	{
-		.uuid   	 = SB_BLE_BATTCHARGE_UUID,
-		.uuidptr	 = { LO_UINT16(SB_BLE_BATTCHARGE_UUID), HI_UINT16(SB_BLE_BATTCHARGE_UUID) },
-		.props  	 = GATT_PROP_READ,
-		.perms		 = GATT_PERMIT_READ,
-		.value  	 = charValBattCharge,
-		.length 	 = SB_BLE_BATTCHARGE_LEN,
-		.description = "BattCharge",
-	},
+static CONST SB_PROFILE_CHARACTERISTIC characteristics[SB_NUM_CHARACTERISTICS] = {
+	SB_PROFILE_CHARACTERISTICS( SB_PROFILE_CHARACTERISTIC_ENTRY )
+};
 
-	// ExtPower characteristic
-	{
-		.uuid   	 = SB_BLE_EXTPOWER_UUID,
-		.uuidptr	 = { LO_UINT16(SB_BLE_EXTPOWER_UUID), HI_UINT16(SB_BLE_EXTPOWER_UUID) },
-		.props  	 = GATT_PROP_READ,
-		.perms		 = GATT_PERMIT_READ,
-		.value  	 = charValExtPower,
-		.length 	 = SB_BLE_EXTPOWER_LEN,
-		.description = "ExternalPower",
-	},
+// Client Characteristic Configuration of each characteristic, one entry per connection
+static gattCharCfg_t charConfigTables[SB_NUM_CHARACTERISTICS][MAX_NUM_BLE_CONNS];
 
-	// MoistureMap characteristic
-	{
-		.uuid   	 = SB_BLE_MOISTUREMAP_UUID,
-		.uuidptr	 = { LO_UINT16(SB_BLE_MOISTUREMAP_UUID), HI_UINT16(SB_BLE_MOISTUREMAP_UUID) },
-		.props  	 = GATT_PROP_READ,
-		.perms		 = GATT_PERMIT_READ,
-		.value  	 = charValMoistureMap,
-		.length 	 = SB_BLE_MOISTUREMAP_LEN,
-		.description = "MoistureMap",
-	},
+#define SB_PROFILE_CHARACTERISTIC_CONFIG( NAME, DESC, PROPS, PERMS, VALUE ) \
+	[SB_CHARACTERISTIC_##NAME] = charConfigTables[SB_CHARACTERISTIC_##NAME],
 
-	// SystemTime characteristic
-	{
-		.uuid   	 = SB_BLE_SYSTEMTIME_UUID,
-		.uuidptr	 = { LO_UINT16(SB_BLE_SYSTEMTIME_UUID), HI_UINT16(SB_BLE_SYSTEMTIME_UUID) },
-		.props  	 = GATT_PROP_READ | GATT_PROP_WRITE,
-		.perms		 = GATT_PERMIT_READ | GATT_PERMIT_WRITE,
-		.value  	 = charValSystemTime,
-		.length 	 = SB_BLE_SYSTEMTIME_LEN,
-		.description = "SystemTime",
-	},
+// The configuration attributes point at these, as GATTServApp expects
+static gattCharCfg_t * CONST charConfigs[SB_NUM_CHARACTERISTICS] = {
+	SB_PROFILE_CHARACTERISTICS( SB_PROFILE_CHARACTERISTIC_CONFIG )
 };
 
 /*********************************************************************
  * Profile Attributes - Table
  */
 
+// Declaration, value, user description and client configuration of a characteristic
+#define SB_PROFILE_CHARACTERISTIC_ATTRS( NAME, DESC, PROPS, PERMS, VALUE ) \
+	{ { ATT_BT_UUID_SIZE, characterUUID }, GATT_PERMIT_READ, 0, \
+	  (uint8 *)&characteristics[SB_CHARACTERISTIC_##NAME].props }, \
+	{ { ATT_BT_UUID_SIZE, characteristics[SB_CHARACTERISTIC_##NAME].uuidptr }, (PERMS), 0, \
+	  (VALUE) }, \
+	{ { ATT_BT_UUID_SIZE, charUserDescUUID }, GATT_PERMIT_READ, 0, \
+	  (uint8 *)#DESC }, \
+	{ { ATT_BT_UUID_SIZE, clientCharCfgUUID }, GATT_PERMIT_READ | GATT_PERMIT_WRITE, 0, \
+	  (uint8 *)&charConfigs[SB_CHARACTERISTIC_##NAME] },
+
+// Only the handles are filled in, by GATTServApp_RegisterService
 static gattAttribute_t simpleProfileAttrTbl[SERVAPP_NUM_ATTR_SUPPORTED] =
 {
   // Simple Profile Service
@@ -210,6 +194,8 @@ static gattAttribute_t simpleProfileAttrTbl[SERVAPP_NUM_ATTR_SUPPORTED] =
     0,                                        /* handle */
     (uint8 *)&simpleProfileService            /* pValue */
   },
+
+  SB_PROFILE_CHARACTERISTICS( SB_PROFILE_CHARACTERISTIC_ATTRS )
 };
 
 /*********************************************************************
@@ -224,6 +210,9 @@ static bStatus_t simpleProfile_WriteAttrCB(uint16_t connHandle,
                                            gattAttribute_t *pAttr,
                                            uint8_t *pValue, uint16_t len,
                                            uint16_t offset, uint8_t method);
+static void simpleProfile_SetPending( SB_CHARACTERISTIC param );
+static bStatus_t simpleProfile_Set16b( SB_CHARACTERISTIC param, uint16 value, uint8 valueIndex, uint8 notify );
+static void simpleProfile_ReadValue( SB_CHARACTERISTIC param, uint16 offset, uint16 len, uint8 *value );
 
 /*********************************************************************
  * PROFILE CALLBACKS
@@ -253,31 +242,12 @@ CONST gattServiceCBs_t simpleProfileCBs =
  */
 bStatus_t SB_Profile_AddService( uint32 services )
 {
-	uint8 status, i = 1;
+	uint8 status;
 	SB_CHARACTERISTIC c;
 
-	// Init the profile attribute table
+	// Initialize Client Characteristic Configuration attributes
 	for (c = (SB_CHARACTERISTIC)0; c < SB_NUM_CHARACTERISTICS; ++c) {
-		// Declare the characteristic
-		simpleProfileAttrTbl[i  ].type.len    = ATT_BT_UUID_SIZE;
-		simpleProfileAttrTbl[i  ].type.uuid   = characterUUID;
-		simpleProfileAttrTbl[i  ].permissions = GATT_PERMIT_READ;
-		simpleProfileAttrTbl[i  ].handle 	  = NULL;
-		simpleProfileAttrTbl[i++].pValue 	  = &characteristics[c].props;
-
-		// Characteristic value
-		simpleProfileAttrTbl[i  ].type.len    = ATT_BT_UUID_SIZE;
-		simpleProfileAttrTbl[i  ].type.uuid   = characteristics[c].uuidptr;
-		simpleProfileAttrTbl[i  ].permissions = characteristics[c].perms;
-		simpleProfileAttrTbl[i  ].handle 	  = NULL;
-		simpleProfileAttrTbl[i++].pValue 	  = characteristics[c].value;
-
-		// Characteristic description
-		simpleProfileAttrTbl[i  ].type.len    = ATT_BT_UUID_SIZE;
-		simpleProfileAttrTbl[i  ].type.uuid   = charUserDescUUID;
-		simpleProfileAttrTbl[i  ].permissions = GATT_PERMIT_READ;
-		simpleProfileAttrTbl[i  ].handle 	  = NULL;
-		simpleProfileAttrTbl[i++].pValue 	  = (uint8*)characteristics[c].description;
+		GATTServApp_InitCharCfg( INVALID_CONNHANDLE, charConfigs[c] );
 	}
 
 	if ( services & SB_BLE_SERVICE )
@@ -334,14 +304,21 @@ bStatus_t SB_Profile_RegisterAppCBs( simpleProfileCBs_t *appCallbacks )
  *
  * @return  bStatus_t
  */
-bStatus_t SB_Profile_SetParameter( SB_CHARACTERISTIC param, uint8 len, void *value )
+bStatus_t SB_Profile_SetParameter( SB_CHARACTERISTIC param, uint16 len, void *value )
 {
 	if ( len != characteristics[param].length ) {
 		return bleInvalidRange;
 	}
 
-	VOID memcpy( characteristics[param].value, value, characteristics[param].length );
+	SB_Profile_BeginUpdate();
 
+	if ( memcmp( characteristics[param].value, value, characteristics[param].length ) != 0 ) {
+		VOID memcpy( characteristics[param].value, value, characteristics[param].length );
+
+		simpleProfile_SetPending( param );
+	}
+
+	SB_Profile_EndUpdate();
 
 	return SUCCESS;
 }
@@ -359,13 +336,25 @@ bStatus_t SB_Profile_SetParameter( SB_CHARACTERISTIC param, uint8 len, void *val
  */
 bStatus_t SB_Profile_Set16bParameter( SB_CHARACTERISTIC param, uint16 value, uint8 valueIndex )
 {
-	if ( sizeof(uint16)*valueIndex >= characteristics[param].length ) {
-		return bleInvalidRange;
-	}
-
-	VOID memcpy( characteristics[param].value + valueIndex*sizeof(uint16), &value, sizeof(uint16) );
+	return simpleProfile_Set16b( param, value, valueIndex, TRUE );
+}
 
-	return SUCCESS;
+/*********************************************************************
+ * @fn      SB_Profile_Store16bParameter
+ *
+ * @brief   Set a 16bit parameter within an array of 16bit parameters,
+ *          without notifying subscribed clients. The value goes out
+ *          with the next notification of the characteristic.
+ *
+ * @param   param - Profile parameter ID
+ * @param   value - 16bit value to write
+ * @param   valueIndex - Index of the 16bit parameter within the array to write to.
+ *
+ * @return  bStatus_t
+ */
+bStatus_t SB_Profile_Store16bParameter( SB_CHARACTERISTIC param, uint16 value, uint8 valueIndex )
+{
+	return simpleProfile_Set16b( param, value, valueIndex, FALSE );
 }
 
 /*********************************************************************
@@ -387,11 +376,248 @@ bStatus_t SB_Profile_GetParameter( SB_CHARACTERISTIC param, void *value, int max
 	  return bleInvalidRange;
 	}
 
-	memcpy(value, characteristics[param].value, characteristics[param].length);
+	simpleProfile_ReadValue( param, 0, characteristics[param].length, value );
 
 	return SUCCESS;
 }
 
+/*********************************************************************
+ * @fn      SB_Profile_BeginUpdate
+ *
+ * @brief   Start changing characteristic values. Readers keep seeing
+ *          the values as they were until the matching
+ *          SB_Profile_EndUpdate, so several values set in between
+ *          appear together. Updates may nest and never block.
+ *
+ * @return  none
+ */
+void SB_Profile_BeginUpdate( void )
+{
+	UInt key = Task_disable();
+
+	if ( updateDepth++ == 0 ) {
+		++valueSeq;
+	}
+
+	Task_restore(key);
+}
+
+/*********************************************************************
+ * @fn      SB_Profile_EndUpdate
+ *
+ * @brief   Publish the values set since SB_Profile_BeginUpdate, and
+ *          wake the application if any need to be notified.
+ *
+ * @return  none
+ */
+void SB_Profile_EndUpdate( void )
+{
+	uint8 wake = FALSE;
+	UInt key = Task_disable();
+
+	if ( --updateDepth == 0 ) {
+		++valueSeq;
+		charVals[1] = charVals[0];
+		wake = ( pendingNotifications != 0 );
+	}
+
+	Task_restore(key);
+
+	if ( wake && simpleProfile_AppCBs && simpleProfile_AppCBs->pfnNotifyPending ) {
+		simpleProfile_AppCBs->pfnNotifyPending();
+	}
+}
+
+/*********************************************************************
+ * @fn      SB_Profile_SendNotifications
+ *
+ * @brief   Send a notification of every characteristic changed since
+ *          the last call to each client that enabled them. Only call
+ *          this function from the task registered with ICall.
+ *
+ * @return  none
+ */
+void SB_Profile_SendNotifications( void )
+{
+	uint16 pending;
+	UInt key;
+	SB_CHARACTERISTIC c;
+
+	key = Task_disable();
+	pending = pendingNotifications;
+	pendingNotifications = 0;
+	Task_restore(key);
+
+	for (c = (SB_CHARACTERISTIC)0; c < SB_NUM_CHARACTERISTICS; ++c) {
+		if ( pending & (1 << c) ) {
+			VOID GATTServApp_ProcessCharCfg( charConfigs[c], characteristics[c].value, FALSE,
+											 simpleProfileAttrTbl, GATT_NUM_ATTRS( simpleProfileAttrTbl ),
+											 INVALID_TASK_ID, simpleProfile_ReadAttrCB );
+		}
+	}
+}
+
+/*********************************************************************
+ * @fn      SB_Profile_NotificationsEnabled
+ *
+ * @brief   Check whether a client enabled notifications of a
+ *          characteristic.
+ *
+ * @param   param - Profile parameter ID
+ * @param   connHandle - connection of the client
+ *
+ * @return  TRUE if notifications are enabled
+ */
+uint8 SB_Profile_NotificationsEnabled( SB_CHARACTERISTIC param, uint16 connHandle )
+{
+	return ( GATTServApp_ReadCharCfg( connHandle, charConfigs[param] ) & GATT_CLIENT_CFG_NOTIFY ) ? TRUE : FALSE;
+}
+
+/*********************************************************************
+ * @fn      SB_Profile_Notify
+ *
+ * @brief   Send a variable length value of a characteristic to one
+ *          client in a single notification. Only call this function
+ *          from the task registered with ICall.
+ *
+ * @param   param - Profile parameter ID
+ * @param   connHandle - connection of the client
+ * @param   value - value to send
+ * @param   len - length of the value
+ *
+ * @return  SUCCESS, bleIncorrectMode if the client has not enabled
+ *          notifications, or MSG_BUFFER_NOT_AVAIL/blePending if the
+ *          stack is out of buffers and the send should be retried
+ */
+bStatus_t SB_Profile_Notify( SB_CHARACTERISTIC param, uint16 connHandle, void *value, uint16 len )
+{
+	attHandleValueNoti_t noti;
+	gattAttribute_t *pAttr;
+	bStatus_t status;
+
+	if ( len > characteristics[param].length || len > ATT_GetMTU( connHandle ) - 3 ) {
+		return bleInvalidRange;
+	}
+
+	if ( !SB_Profile_NotificationsEnabled( param, connHandle ) ) {
+		return bleIncorrectMode;
+	}
+
+	pAttr = GATTServApp_FindAttr( simpleProfileAttrTbl, GATT_NUM_ATTRS( simpleProfileAttrTbl ),
+								  characteristics[param].value );
+	if ( pAttr == NULL ) {
+		return bleInvalidRange;
+	}
+
+	// Keep the last value sent for SB_Profile_GetParameter
+	VOID memcpy( characteristics[param].value, value, len );
+
+	noti.pValue = (uint8 *)GATT_bm_alloc( connHandle, ATT_HANDLE_VALUE_NOTI, len, NULL );
+	if ( noti.pValue == NULL ) {
+		return MSG_BUFFER_NOT_AVAIL;
+	}
+
+	noti.handle = pAttr->handle;
+	noti.len = len;
+	VOID memcpy( noti.pValue, value, len );
+
+	status = GATT_Notification( connHandle, &noti, FALSE );
+	if ( status != SUCCESS ) {
+		GATT_bm_free( (gattMsg_t *)&noti, ATT_HANDLE_VALUE_NOTI );
+	}
+
+	return status;
+}
+
+/*********************************************************************
+ * @fn      simpleProfile_Set16b
+ *
+ * @brief   Write a 16bit parameter within an array of 16bit parameters.
+ *
+ * @param   param - Profile parameter ID
+ * @param   value - 16bit value to write
+ * @param   valueIndex - Index of the 16bit parameter within the array to write to.
+ * @param   notify - TRUE to mark the characteristic for notification if it changed
+ *
+ * @return  bStatus_t
+ */
+static bStatus_t simpleProfile_Set16b( SB_CHARACTERISTIC param, uint16 value, uint8 valueIndex, uint8 notify )
+{
+	if ( sizeof(uint16)*valueIndex >= characteristics[param].length ) {
+		return bleInvalidRange;
+	}
+
+	SB_Profile_BeginUpdate();
+
+	if ( memcmp( characteristics[param].value + valueIndex*sizeof(uint16), &value, sizeof(uint16) ) != 0 ) {
+		VOID memcpy( characteristics[param].value + valueIndex*sizeof(uint16), &value, sizeof(uint16) );
+
+		if ( notify ) {
+			simpleProfile_SetPending( param );
+		}
+	}
+
+	SB_Profile_EndUpdate();
+
+	return SUCCESS;
+}
+
+/*********************************************************************
+ * @fn      simpleProfile_SetPending
+ *
+ * @brief   Mark a characteristic as changed. The application is woken
+ *          once the update is published, since values may be set from
+ *          tasks that can't call into the stack.
+ *
+ * @param   param - Profile parameter ID
+ *
+ * @return  none
+ */
+static void simpleProfile_SetPending( SB_CHARACTERISTIC param )
+{
+	UInt key;
+
+	if ( !(characteristics[param].props & GATT_PROP_NOTIFY) ) {
+		return;
+	}
+
+	key = Task_disable();
+	pendingNotifications |= (1 << param);
+	Task_restore(key);
+}
+
+/*********************************************************************
+ * @fn      simpleProfile_ReadValue
+ *
+ * @brief   Copy part of the last published value of a characteristic.
+ *          The copy is only repeated if a writer ran in the middle of it.
+ *
+ * @param   param - Profile parameter ID
+ * @param   offset - first byte of the value to copy
+ * @param   len - number of bytes to copy, within the characteristic length
+ * @param   value - buffer of at least len bytes
+ *
+ * @return  none
+ */
+static void simpleProfile_ReadValue( SB_CHARACTERISTIC param, uint16 offset, uint16 len, uint8 *value )
+{
+	uint8 *bank0 = (uint8 *)&charVals[0];
+	uint16 seq;
+
+	// Values outside the shared copies have a single reader and writer
+	if ( characteristics[param].value < bank0 || characteristics[param].value >= bank0 + sizeof(SB_PROFILE_VALUES) ) {
+		memcpy( value, characteristics[param].value + offset, len );
+		return;
+	}
+
+	offset += characteristics[param].value - bank0;
+
+	do {
+		seq = valueSeq;
+		memcpy( value, (uint8 *)&charVals[seq & 1] + offset, len );
+	} while ( seq != valueSeq );
+}
+
 /*********************************************************************
  * @fn          simpleProfile_ReadAttrCB
  *
@@ -421,12 +647,6 @@ static bStatus_t simpleProfile_ReadAttrCB(uint16_t connHandle,
 		return ( ATT_ERR_INSUFFICIENT_AUTHOR );
 	}
 
-	// Make sure it's not a blob operation (no attributes in the profile are long)
-	if ( offset > 0 )
-	{
-		return ( ATT_ERR_ATTR_NOT_LONG );
-	}
-
 	if ( pAttr->type.len == ATT_BT_UUID_SIZE ) {
 		uint16 uuid = BUILD_UINT16( pAttr->type.uuid[0], pAttr->type.uuid[1]);
 		uint8 c = uuid - SB_BLE_SERV_UUID - 1;
@@ -434,9 +654,20 @@ static bStatus_t simpleProfile_ReadAttrCB(uint16_t connHandle,
 			// Invalid characteristic
 			*pLen = 0;
 			status = ATT_ERR_ATTR_NOT_FOUND;
+		} else if ( offset > 0 && characteristics[c].length <= ATT_GetMTU( connHandle ) - 1 ) {
+			// Values that fit in one read response, MTU - 1 bytes, are not long
+			*pLen = 0;
+			status = ATT_ERR_ATTR_NOT_LONG;
+		} else if ( offset > characteristics[c].length ) {
+			*pLen = 0;
+			status = ATT_ERR_INVALID_OFFSET;
 		} else {
-			*pLen = characteristics[c].length;
-			memcpy( pValue, pAttr->pValue, characteristics[c].length );
+			// Long values are read in parts, each as much as fits
+			*pLen = characteristics[c].length - offset;
+			if ( *pLen > maxLen ) {
+				*pLen = maxLen;
+			}
+			simpleProfile_ReadValue( (SB_CHARACTERISTIC)c, offset, *pLen, pValue );
 		}
 	} else {
 		// 128-bit UUID
@@ -490,7 +721,9 @@ static bStatus_t simpleProfile_WriteAttrCB(uint16_t connHandle,
 
 				//Write the value
 				if ( status == SUCCESS ) {
+					SB_Profile_BeginUpdate();
 					memcpy(pAttr->pValue + offset, pValue, len);
+					SB_Profile_EndUpdate();
 
 					// Notify the application that system time changed
 					notifyApp = SB_CHARACTERISTIC_SYSTEMTIME;
@@ -498,7 +731,25 @@ static bStatus_t simpleProfile_WriteAttrCB(uint16_t connHandle,
 
 				break;
 
+			case SB_BLE_REPORTPOLICY_UUID:
+				// The policies are applied together, so only accept a complete value
+				if ( offset != 0 || len != characteristics[c].length ) {
+					status = ATT_ERR_INVALID_VALUE_SIZE;
+				}
+
+				if ( status == SUCCESS ) {
+					SB_Profile_BeginUpdate();
+					memcpy(pAttr->pValue, pValue, len);
+					SB_Profile_EndUpdate();
+
+					notifyApp = SB_CHARACTERISTIC_REPORTPOLICY;
+				}
+
+				break;
+
 			case GATT_CLIENT_CHAR_CFG_UUID:
+				// The stack keeps the configuration of bonded clients in their bond record
+				// and restores it through the table when they reconnect.
 				status = GATTServApp_ProcessCCCWriteReq( connHandle, pAttr, pValue, len,
 														 offset, GATT_CLIENT_CFG_NOTIFY );
 				break;
@@ -516,9 +767,12 @@ static bStatus_t simpleProfile_WriteAttrCB(uint16_t connHandle,
 		status = ATT_ERR_INVALID_HANDLE;
 	}
 
-	// If a characteristic value changed then callback function to notify application of change
+	// If a characteristic value changed then callback function to notify application of change.
+	// The value is taken from the copy just written, as a write made while another task is in
+	// the middle of an update is only published when that update ends.
 	if ( (notifyApp != 0xFF ) && simpleProfile_AppCBs && simpleProfile_AppCBs->pfnSimpleProfileChange ) {
-		simpleProfile_AppCBs->pfnSimpleProfileChange( notifyApp );
+		simpleProfile_AppCBs->pfnSimpleProfileChange( notifyApp, characteristics[notifyApp].value,
+													  characteristics[notifyApp].length );
 	}
 
 	return ( status );
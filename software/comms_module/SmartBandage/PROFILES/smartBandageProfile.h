@@ -42,6 +42,7 @@
 
 #include "hci_tl.h"
 #include "gatt.h"
+#include "gattservapp.h"
 
 
 #ifdef __cplusplus
@@ -69,9 +70,13 @@ extern "C"
 #define SB_BLE_EXTPOWER_UUID    	        (SB_BLE_SERV_UUID +1+ SB_CHARACTERISTIC_EXTPOWER)
 #define SB_BLE_MOISTUREMAP_UUID	            (SB_BLE_SERV_UUID +1+ SB_CHARACTERISTIC_MOISTUREMAP)
 #define SB_BLE_SYSTEMTIME_UUID	            (SB_BLE_SERV_UUID +1+ SB_CHARACTERISTIC_SYSTEMTIME)
+#define SB_BLE_LIVESTREAM_UUID	            (SB_BLE_SERV_UUID +1+ SB_CHARACTERISTIC_LIVESTREAM)
+#define SB_BLE_REPORTPOLICY_UUID            (SB_BLE_SERV_UUID +1+ SB_CHARACTERISTIC_REPORTPOLICY)
+#define SB_BLE_DIAGNOSTICS_UUID             (SB_BLE_SERV_UUID +1+ SB_CHARACTERISTIC_DIAGNOSTICS)
 
-// For each characteristic the server has three entries, plus on for the service
-#define SERVAPP_NUM_PROP_PER_CHARACTERISTIC 3
+// For each characteristic the server has four entries (declaration, value,
+// description and client configuration), plus one for the service
+#define SERVAPP_NUM_PROP_PER_CHARACTERISTIC 4
 #define SERVAPP_NUM_ATTR_SUPPORTED         (SB_NUM_CHARACTERISTICS*SERVAPP_NUM_PROP_PER_CHARACTERISTIC + 1)
 
 // Simple Keys Profile Services bit fields
@@ -87,6 +92,16 @@ extern "C"
 #define SB_BLE_MOISTUREMAP_LEN           10
 #define SB_BLE_SYSTEMTIME_LEN            4
 
+// Deadband, minimum interval and maximum silence (uint16 each) for temperature, then humidity
+#define SB_BLE_REPORTPOLICY_LEN          12
+
+// SB_DiagnosticsSnapshot, see diagnostics.h. Longer than the default MTU allows, so it
+// may be read in parts with Read Blob requests.
+#define SB_BLE_DIAGNOSTICS_LEN           344
+
+// Largest live stream packet, sent in one notification when the MTU allows (ATT MTU 247)
+#define SB_BLE_LIVESTREAM_LEN            243
+
 /*********************************************************************
  * TYPEDEFS
  */
@@ -99,8 +114,11 @@ typedef enum {
 	SB_CHARACTERISTIC_EXTPOWER = 5,
 	SB_CHARACTERISTIC_MOISTUREMAP = 6,
 	SB_CHARACTERISTIC_SYSTEMTIME = 7,
+	SB_CHARACTERISTIC_LIVESTREAM = 8,
+	SB_CHARACTERISTIC_REPORTPOLICY = 9,
+	SB_CHARACTERISTIC_DIAGNOSTICS = 10,
 
-	SB_NUM_CHARACTERISTICS = 8
+	SB_NUM_CHARACTERISTICS = 11
 } SB_CHARACTERISTIC;
   
 /*********************************************************************
@@ -111,24 +129,27 @@ typedef enum {
  * Profile Callbacks
  */
 
-// Callback when a characteristic value has changed
-typedef void (*simpleProfileChange_t)( uint8 paramID );
+// Callback when a client has written a characteristic value. The value is passed as
+// written, since it is not published to other readers while an update is in progress.
+typedef void (*simpleProfileChange_t)( uint8 paramID, uint8 *pValue, uint8 len );
+
+// Callback when notifications are waiting to be sent by SB_Profile_SendNotifications
+typedef void (*simpleProfileNotifyPending_t)( void );
 
 typedef struct
 {
   simpleProfileChange_t        pfnSimpleProfileChange;  // Called when characteristic value changes
+  simpleProfileNotifyPending_t pfnNotifyPending;        // Called when a notification becomes pending
 } simpleProfileCBs_t;
 
 #define SB_PROFILE_UUID_LEN ATT_BT_UUID_SIZE
 
 typedef struct {
-	uint16 uuid;
 	uint8 uuidptr[SB_PROFILE_UUID_LEN];
 	uint8 props;
 	uint8 perms;
 	uint8*value;
-	uint8 length;
-	char* description;
+	uint16 length;
 } SB_PROFILE_CHARACTERISTIC;
     
 
@@ -165,10 +186,16 @@ extern bStatus_t SB_Profile_RegisterAppCBs( simpleProfileCBs_t *appCallbacks );
  *          data type (example: data type of uint16 will be cast to 
  *          uint16 pointer).
  */
-extern bStatus_t SB_Profile_SetParameter( SB_CHARACTERISTIC param, uint8 len, void *value );
+extern bStatus_t SB_Profile_SetParameter( SB_CHARACTERISTIC param, uint16 len, void *value );
 
 extern bStatus_t SB_Profile_Set16bParameter( SB_CHARACTERISTIC param, uint16 value, uint8 valueIndex );
 
+/*
+ * SB_Profile_Store16bParameter - As SB_Profile_Set16bParameter, but the new
+ *          value is only seen by reads and is not notified.
+ */
+extern bStatus_t SB_Profile_Store16bParameter( SB_CHARACTERISTIC param, uint16 value, uint8 valueIndex );
+
 /*
  * SimpleProfile_GetParameter - Get a Simple GATT Profile parameter.
  *
@@ -180,6 +207,37 @@ extern bStatus_t SB_Profile_Set16bParameter( SB_CHARACTERISTIC param, uint16 val
  */
 extern bStatus_t SB_Profile_GetParameter( SB_CHARACTERISTIC param, void *value, int maxlength );
 
+/*
+ * SB_Profile_BeginUpdate/SB_Profile_EndUpdate - Bracket a group of Set*Parameter
+ *          calls so readers see either none or all of the new values. Calls may
+ *          nest; the values are published when the outermost update ends.
+ */
+extern void SB_Profile_BeginUpdate( void );
+extern void SB_Profile_EndUpdate( void );
+
+/*
+ * SB_Profile_SendNotifications - Notify subscribed clients of every characteristic
+ *          changed since the last call. Must be called from the task registered
+ *          with ICall.
+ */
+extern void SB_Profile_SendNotifications( void );
+
+/*
+ * SB_Profile_NotificationsEnabled - Whether the client on connHandle enabled
+ *          notifications of a characteristic.
+ */
+extern uint8 SB_Profile_NotificationsEnabled( SB_CHARACTERISTIC param, uint16 connHandle );
+
+/*
+ * SB_Profile_Notify - Send a variable length value of a characteristic to one
+ *          client as a single notification. Must be called from the task
+ *          registered with ICall.
+ *
+ *    len - length of the value, at most the characteristic length and the
+ *          connection's ATT MTU less 3
+ */
+extern bStatus_t SB_Profile_Notify( SB_CHARACTERISTIC param, uint16 connHandle, void *value, uint16 len );
+
 
 /*********************************************************************
 *********************************************************************/
@@ -0,0 +1,181 @@
+/*
+ * testExtFlash.c
+ *
+ * Host throughput benchmark for the external flash driver. It links the real bsp_spi.c and
+ * ext_flash.c against the W25X20CL emulator and the simulated kernel in host/, so transfers
+ * take the time they would take on the device: the SPI bit rate, the setup of each UDMA
+ * transaction, and the program and erase times of the part.
+ *
+ * Each case moves the same amount of data, checks it landed intact, and reports throughput in
+ * simulated time next to the bound set by the SPI bit rate. Reads compare the fast read of a
+ * whole range under one instruction with reads issued a program page at a time. Writes compare
+ * the blocking extFlashWrite with extFlashWriteAsync issued a program page at a time.
+ *
+ * Build and run from this directory, or with make in the parent directory:
+ *
+ *   gcc -std=gnu99 -O2 -Wall -DTI_DRIVERS_SPI_INCLUDED -I../host \
+ *       -I../comms_module/SmartBandage/Application -I../comms_module/SmartBandage/Board/Interfaces \
+ *       testExtFlash.c ../host/hostSim.c ../host/flashEmulator.c \
+ *       ../comms_module/SmartBandage/Board/Interfaces/bsp_spi.c \
+ *       ../comms_module/SmartBandage/Board/Devices/ext_flash.c -o testExtFlash
+ *   ./testExtFlash
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "hostSim.h"
+#include "flashEmulator.h"
+#include "../comms_module/SmartBandage/Board/Devices/ext_flash.h"
+
+// Matches BSP_SPI_BIT_RATE in bsp_spi.c
+#define SPI_BIT_RATE		4000000
+
+#define BENCH_BASE			0x40000
+#define BENCH_LEN			(64 * 1024)
+
+#define CHECK(condition, message) do { \
+		if (!(condition)) { \
+			fprintf(stderr, "FAIL: %s (%s:%d)\n", message, __FILE__, __LINE__); \
+			exit(1); \
+		} \
+	} while (0)
+
+static uint8_t memory[FLASHEMU_SIZE];
+static uint8_t pattern[BENCH_LEN];
+static uint8_t readBack[BENCH_LEN];
+
+static struct {
+	bool done;
+	bool success;
+} async;
+
+static void asyncDone(bool success) {
+	async.done = true;
+	async.success = success;
+}
+
+static void fillPattern(uint32_t seed) {
+	uint32_t i;
+
+	for (i = 0; i < BENCH_LEN; ++i) {
+		seed = seed * 1103515245 + 12345;
+		pattern[i] = seed >> 16;
+	}
+}
+
+static void eraseRange(void) {
+	CHECK(extFlashErase(BENCH_BASE, BENCH_LEN), "erase failed");
+}
+
+// Prints one case: simulated time for BENCH_LEN bytes and its share of the SPI bound
+static void report(const char *name, uint64_t startNs, const FlashEmuStats *before) {
+	uint64_t elapsedNs = hostSimNow() - startNs;
+	double kbps = BENCH_LEN / 1024.0 / (elapsedNs / 1e9);
+	double boundKbps = SPI_BIT_RATE / 8 / 1024.0;
+	FlashEmuStats after;
+
+	flashEmuGetStats(&after);
+
+	printf("  %-34s %8.1f ms %7.1f KB/s %5.1f%% of SPI  %6u commands %5u DMA\n", name,
+			elapsedNs / 1e6, kbps, 100.0 * kbps / boundKbps,
+			after.commands - before->commands, after.transactions - before->transactions);
+}
+
+static void benchReads(void) {
+	FlashEmuStats before;
+	uint64_t start;
+	uint32_t offset;
+
+	// One fast read instruction for the whole range
+	memset(readBack, 0, sizeof(readBack));
+	flashEmuGetStats(&before);
+	start = hostSimNow();
+	CHECK(extFlashRead(BENCH_BASE, BENCH_LEN, readBack), "bulk read failed");
+	report("extFlashRead, one call", start, &before);
+	CHECK(memcmp(readBack, pattern, BENCH_LEN) == 0, "bulk read returned wrong data");
+
+	// One instruction per program page, as the driver read before bulk transfers
+	memset(readBack, 0, sizeof(readBack));
+	flashEmuGetStats(&before);
+	start = hostSimNow();
+	for (offset = 0; offset < BENCH_LEN; offset += EXT_FLASH_PROGRAM_PAGE_SIZE) {
+		CHECK(extFlashRead(BENCH_BASE + offset, EXT_FLASH_PROGRAM_PAGE_SIZE, readBack + offset),
+				"page read failed");
+	}
+	report("extFlashRead, per program page", start, &before);
+	CHECK(memcmp(readBack, pattern, BENCH_LEN) == 0, "page reads returned wrong data");
+
+	// Asynchronous, waited for at once
+	memset(readBack, 0, sizeof(readBack));
+	async.done = false;
+	flashEmuGetStats(&before);
+	start = hostSimNow();
+	CHECK(extFlashReadAsync(BENCH_BASE, BENCH_LEN, readBack, asyncDone), "async read failed to start");
+	CHECK(extFlashWaitAsync(), "async read failed");
+	report("extFlashReadAsync", start, &before);
+	CHECK(async.done && async.success, "async read callback missing");
+	CHECK(memcmp(readBack, pattern, BENCH_LEN) == 0, "async read returned wrong data");
+}
+
+static void benchWrites(void) {
+	FlashEmuStats before;
+	uint64_t start;
+	uint32_t offset;
+
+	fillPattern(1);
+	eraseRange();
+	flashEmuGetStats(&before);
+	start = hostSimNow();
+	CHECK(extFlashWrite(BENCH_BASE, BENCH_LEN, pattern), "write failed");
+	report("extFlashWrite, one call", start, &before);
+	CHECK(extFlashRead(BENCH_BASE, BENCH_LEN, readBack) && memcmp(readBack, pattern, BENCH_LEN) == 0,
+			"write did not land");
+
+	fillPattern(2);
+	eraseRange();
+	flashEmuGetStats(&before);
+	start = hostSimNow();
+	for (offset = 0; offset < BENCH_LEN; offset += EXT_FLASH_PROGRAM_PAGE_SIZE) {
+		CHECK(extFlashWriteAsync(BENCH_BASE + offset, EXT_FLASH_PROGRAM_PAGE_SIZE, pattern + offset, NULL),
+				"async write failed to start");
+	}
+	CHECK(extFlashWaitAsync(), "async write failed");
+	report("extFlashWriteAsync, per page", start, &before);
+	CHECK(extFlashRead(BENCH_BASE, BENCH_LEN, readBack) && memcmp(readBack, pattern, BENCH_LEN) == 0,
+			"async write did not land");
+}
+
+int main(int argc, char **argv) {
+	FlashEmuStats stats;
+	uint64_t programNs;
+
+	hostSimReset();
+	memset(memory, 0xFF, sizeof(memory));
+	flashEmuInit(memory);
+
+	CHECK(extFlashOpen(), "extFlashOpen failed");
+
+	printf("External flash, %u KB at %u MHz SPI (%.1f KB/s bound), program page %u us, sector erase %u ms\n",
+			BENCH_LEN / 1024, SPI_BIT_RATE / 1000000, SPI_BIT_RATE / 8 / 1024.0,
+			FLASHEMU_PROGRAM_NS / 1000, FLASHEMU_ERASE_NS / 1000000);
+
+	benchWrites();
+	benchReads();
+
+	flashEmuGetStats(&stats);
+	CHECK(stats.busyViolations == 0, "instruction sent while the flash was busy");
+
+	// Writing cannot beat the program time of the part
+	programNs = (uint64_t)(BENCH_LEN / EXT_FLASH_PROGRAM_PAGE_SIZE) * FLASHEMU_PROGRAM_NS;
+	printf("  program time alone bounds writes at %.1f KB/s\n", BENCH_LEN / 1024.0 / (programNs / 1e9));
+
+	extFlashClose();
+
+	printf("PASS\n");
+
+	return 0;
+}
@@ -1,37 +1,833 @@
-// Test program to test the states of the Finite State Machine
+/*
+ * testFSM.c
+ *
+ * Host model checker, fuzzer and benchmark for the state machine of the comms module. It links
+ * the real fsm.c against the stand-ins for TI-RTOS and the BLE stack in ../host/, and fakes the
+ * modules the state machine drives.
+ *
+ *  - Every sequence of events up to the given depth is taken from S_INIT, checking each step.
+ *  - Long random runs go through the event queue, the timers and the state machine task, with
+ *    the peripheral manager and BLE task answering after random delays.
+ *  - SB_handleEvent is timed with and without a transition.
+ *
+ * The tracer of the state machine is printed after the random runs.
+ *
+ * Invariants checked:
+ *  - S_ERROR_PERM is absorbing, and a permanent error reaches it from any state, also when it
+ *    waits in the queue behind an event that returns to normal operation, or a temporary error
+ *  - An invalid event leads to an error state without replacing a permanent error, and is not
+ *    queued when posted
+ *  - Every dispatch lands in a valid state; a NULL action would be caught as a fault
+ *  - Each transition runs its callbacks once, and the entry actions of S_CHECK and S_TRANSMIT.
+ *    A transmit started by an alert is flushed.
+ *  - An alert is timed over the one transmit it started: at most its wait to be handled plus
+ *    the longest time an alert transmit was outstanding
+ *  - A waiting state always has a timer or a request outstanding to leave it
+ *  - The event queue stays within SB_FSM_EVENT_QUEUE_LEN and no heap is used
+ *  - The tracer counts every transition, accounts all the time elapsed, and its recent
+ *    transitions chain up to the current state
+ *
+ * Build and run from this directory, or with make in the parent directory:
+ *
+ *   gcc -std=gnu99 -O2 -Wall -I../host -I../comms_module/SmartBandage/Application \
+ *       -I../comms_module/SmartBandage/PROFILES testFSM.c \
+ *       ../comms_module/SmartBandage/Application/fsm.c -o testFSM
+ *   ./testFSM [depth] [seed] [runs]
+ *
+ *  Created on: Oct 18, 2026
+ */
 
-#include <stdbool.h>
 #include <stdio.h>
-#include "fsm.c"
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+#include <ucontext.h>
+#include <unistd.h>
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
 
+#include "fsm.h"
+#include "util.h"
+#include "settings.h"
+#include "advSchedule.h"
+#include "peripheralManager.h"
+#include "diagnostics.h"
+#include "ble.h"
 
-//where things will actually be happening
-void main(void) {
-//start out in the initialize state
-    currentState = S_INIT;
+#define DEFAULT_DEPTH		7
+#define DEFAULT_SEED		1
+#define DEFAULT_RUNS		200
+#define STEPS_PER_RUN		5000
+#define BENCHMARK_CALLS		10000000
 
-    // iterate through the states
-    for(int i = 0; i < STATES; i++) {
+#define MAX_DEPTH			12
+#define MAX_CLOCKS			8
+#define TASK_STACK_SIZE		(64 * 1024)
 
-        //iterate through each event 
-        for(int j = 0; j <EVENTS; j++) {
-            if (((j >= 0) && (j < EVENTS)) && ((i >= 0) && (i < STATES))) {
-                state_table[i][j] ();
-            
-                printf("\n%d %d", i, j);
-                printf("\ncurrent state: ");
-                printf("%d", currentState);
-                
-            }
-            else {
-            // value outside range of LUT. call error - not necessarily same as error from bandage
-            errorEvent();
-            }
-        }
-    }   
+// Defined in fsm.c
+extern SB_SystemState systemState;
+
+static const char *stateNames[SB_NUM_STATES] = {
+	"SLEEP", "CHECK", "TRANSMIT", "ERROR_TEMP", "ERROR_PERM", "INIT",
+};
+
+static const char *eventNames[SB_NUM_EVENTS] = {
+	"CHECK_TIMER", "BLE_TIMER", "DATA_CHANGE", "NO_BANDAGE", "ERROR", "CHECK_DONE", "TRANSMIT_DONE",
+};
+
+// The inputs explored: each event, with E_ERROR raised for a temporary and a permanent error,
+// and an event out of range
+typedef struct {
+	SB_Event event;
+	SB_Error error;
+} Input;
+
+static const Input inputs[] = {
+	{ E_CHECK_TIMER_EXPIRED, NoError },
+	{ E_BLE_TIMER_EXPIRED, NoError },
+	{ E_DATA_CHANGE, NoError },
+	{ E_NO_BANDAGE_DETECTED, NoError },
+	{ E_ERROR, OperationTimeout },
+	{ E_ERROR, OutOfMemory },
+	{ E_CHECK_DONE, NoError },
+	{ E_TRANSMIT_DONE, NoError },
+	{ SB_NUM_EVENTS, NoError },
+};
+
+#define NUM_INPUTS (sizeof(inputs) / sizeof(inputs[0]))
+
+/*
+ * What the fakes have seen
+ */
+static struct {
+	uint32_t ticks;
+	uint64_t elapsed;				// Ticks since start, without wrapping
+
+	// Modules driven by the state machine
+	uint32_t samplesRequested;
+	uint32_t samplesPending;
+	uint32_t transmitsRequested;
+	uint32_t transmitsPending;
+	bool lastTransmitFlush;
+	uint32_t alerts;
+	bool alertTransmit;				// S_TRANSMIT entered for an alert, and not left since
+	uint32_t alertTransmitStart;
+	uint32_t maxAlertTransmit;
+
+	// Transition callbacks
+	uint32_t callbacks;
+	SB_State_Transition lastTransition;
+	bool callbackStateMismatch;
+
+	// Timers, found by the event they raise
+	Clock_Struct *clocks[MAX_CLOCKS];
+	uint8_t numClocks;
+
+	// The state machine task, run as a coroutine
+	Task_FuncPtr taskFunction;
+	ucontext_t taskContext;
+	ucontext_t mainContext;
+	bool taskStarted;
+	bool inTask;
+	Semaphore_Struct semaphores[4];
+	uint8_t numSemaphores;
+} HOST;
+
+static char taskStack[TASK_STACK_SIZE];
+
+// The sequence being checked, printed when an invariant fails
+static const Input *trace[MAX_DEPTH];
+static uint8_t traceDepth;
+static const char *phase = "setup";
+
+// Where a random run failed, to repeat it
+static uint32_t fuzzSeed, fuzzRun, fuzzStep;
+
+/*
+ * Failure reporting
+ */
+static void printTrace(void) {
+	uint8_t i;
+
+	if (traceDepth == 0) {
+		fprintf(stderr, "  during %s", phase);
+		if (fuzzSeed != 0) {
+			fprintf(stderr, ": seed %u, run %u, step %u", fuzzSeed, fuzzRun, fuzzStep);
+		}
+		fprintf(stderr, "\n");
+		return;
+	}
+
+	fprintf(stderr, "  during %s, from S_INIT:", phase);
+	for (i = 0; i < traceDepth; ++i) {
+		fprintf(stderr, " %s", (trace[i]->event < SB_NUM_EVENTS) ? eventNames[trace[i]->event] : "INVALID");
+		if (trace[i]->event == E_ERROR) {
+			fprintf(stderr, "(%d)", trace[i]->error);
+		}
+	}
+	fprintf(stderr, "\n");
+}
+
+static void fail(const char *message) {
+	fprintf(stderr, "FAIL: %s, in state %d\n", message, systemState.currentState);
+	printTrace();
+	exit(1);
+}
+
+#define CHECK(condition, message) do { if (!(condition)) fail(message); } while (0)
+
+// A NULL or wild action pointer lands here
+static void faultHandler(int signal) {
+	fprintf(stderr, "FAIL: fault %d dispatching an event, in state %d\n", signal, systemState.currentState);
+	printTrace();
+	_exit(1);
+}
+
+static size_t heapInUse(void) {
+#ifdef __GLIBC__
+	return mallinfo2().uordblks;
+#else
+	return 0;
+#endif
+}
+
+/*
+ * TI-RTOS stand-ins. Everything runs on one thread, so the locks have nothing to do.
+ */
+void Task_Params_init(Task_Params *params) {
+	memset(params, 0, sizeof(Task_Params));
+}
+
+static void taskEntry(void) {
+	HOST.taskFunction(0, 0);
+}
+
+Task_Handle Task_create(Task_FuncPtr function, const Task_Params *params, void *eb) {
+	static Task_Struct task;
+
+	// The target stack is far too small for host frames; the task gets its own
+	HOST.taskFunction = function;
+
+	getcontext(&HOST.taskContext);
+	HOST.taskContext.uc_stack.ss_sp = taskStack;
+	HOST.taskContext.uc_stack.ss_size = sizeof(taskStack);
+	HOST.taskContext.uc_link = NULL;
+	makecontext(&HOST.taskContext, taskEntry, 0);
+
+	return &task;
+}
+
+UInt Task_disable(void) { return 0; }
+void Task_restore(UInt key) { }
+void Task_sleep(uint32_t ticks) { }
+void Task_stat(Task_Handle handle, Task_Stat *stat) { memset(stat, 0, sizeof(Task_Stat)); }
+UInt Swi_disable(void) { return 0; }
+void Swi_restore(UInt key) { }
+
+uint32_t Clock_getTicks(void) { return HOST.ticks; }
+uint32_t Timestamp_get32(void) { return HOST.ticks; }
+
+Semaphore_Handle Semaphore_create(int count, void *params, void *eb) {
+	Semaphore_Handle handle;
+
+	if (HOST.numSemaphores == sizeof(HOST.semaphores) / sizeof(HOST.semaphores[0])) {
+		return NULL;
+	}
+
+	handle = &HOST.semaphores[HOST.numSemaphores++];
+	handle->count = count;
+
+	return handle;
+}
+
+// The task gives the processor back to the test whenever it would block
+bool Semaphore_pend(Semaphore_Handle handle, uint32_t timeout) {
+	while (handle->count == 0) {
+		if (timeout == 0 || !HOST.inTask) {
+			return false;
+		}
+
+		HOST.inTask = false;
+		swapcontext(&HOST.taskContext, &HOST.mainContext);
+	}
+
+	--handle->count;
+	return true;
+}
+
+void Semaphore_post(Semaphore_Handle handle) {
+	++handle->count;
+}
+
+/*
+ * Clocks, fired by advanceTime
+ */
+Clock_Handle Util_constructClock(Clock_Struct *pClock, Clock_FuncPtr clockCB, uint32_t clockDuration,
+								 uint32_t clockPeriod, uint8_t startFlag, UArg arg) {
+	if (HOST.numClocks == MAX_CLOCKS) {
+		return NULL;
+	}
+
+	memset(pClock, 0, sizeof(Clock_Struct));
+	pClock->function = clockCB;
+	pClock->arg = arg;
+	pClock->timeout = clockDuration * (NTICKS_PER_MILLSECOND);
+	pClock->period = clockPeriod * (NTICKS_PER_MILLSECOND);
+
+	HOST.clocks[HOST.numClocks++] = pClock;
+
+	if (startFlag) {
+		Util_startClock(pClock);
+	}
+
+	return pClock;
+}
+
+void Util_startClock(Clock_Struct *pClock) {
+	pClock->active = true;
+	pClock->due = HOST.ticks + pClock->timeout;
+}
+
+void Util_restartClock(Clock_Struct *pClock, uint32_t clockTimeout) {
+	pClock->timeout = clockTimeout * (NTICKS_PER_MILLSECOND);
+	Util_startClock(pClock);
+}
+
+bool Util_isActive(Clock_Struct *pClock) {
+	return pClock->active;
+}
+
+void Util_stopClock(Clock_Struct *pClock) {
+	pClock->active = false;
+}
+
+static Clock_Struct *findClock(UArg arg, Clock_FuncPtr exclude) {
+	uint8_t i;
+
+	for (i = 0; i < HOST.numClocks; ++i) {
+		if (HOST.clocks[i]->arg == arg && HOST.clocks[i]->function != exclude) {
+			return HOST.clocks[i];
+		}
+	}
+
+	return NULL;
+}
+
+/*
+ * The modules driven by the state machine
+ */
+void SB_settingsGet(SB_Settings *settings) {
+	memset(settings, 0, sizeof(SB_Settings));
+	settings->samplePeriodMs = 1000;
+}
+
+void SB_advScheduleAlert() {
+	++HOST.alerts;
+}
+
+void SB_peripheralRequestSample() {
+	++HOST.samplesRequested;
+	++HOST.samplesPending;
+}
+
+void SB_bleRequestTransmit(bool flush) {
+	HOST.lastTransmitFlush = flush;
+	HOST.alertTransmit = flush;
+	HOST.alertTransmitStart = HOST.ticks;
+	++HOST.transmitsRequested;
+	++HOST.transmitsPending;
+}
+
+void SB_diagnosticsRegisterTask(SB_DiagnosticsTask task, Task_Handle handle) {
+}
+
+static void transitionCallback(SB_State_Transition transition, void *context) {
+	++HOST.callbacks;
+	HOST.lastTransition = transition;
+
+	if (systemState.lastState == S_TRANSMIT && HOST.alertTransmit) {
+		HOST.alertTransmit = false;
+		if (HOST.ticks - HOST.alertTransmitStart > HOST.maxAlertTransmit) {
+			HOST.maxAlertTransmit = HOST.ticks - HOST.alertTransmitStart;
+		}
+	}
+
+	// Callbacks run once the new state is current
+	if ((int)transition != (int)SB_currentState()) {
+		HOST.callbackStateMismatch = true;
+	}
+}
+
+/*
+ * Exhaustive exploration
+ */
+static struct {
+	uint8_t depth;
+	uint64_t paths;
+	uint64_t steps;
+	bool reached[SB_NUM_STATES];
+	bool handled[SB_NUM_STATES][SB_NUM_EVENTS];
+	bool moved[SB_NUM_STATES][SB_NUM_EVENTS];
+} EXPLORE;
+
+/**
+ * \brief Dispatches one input straight to SB_handleEvent and checks what it did.
+ */
+static void step(const Input *input) {
+	SB_State before = systemState.currentState;
+	SB_Error error = systemState.currentError;
+	SB_State after;
+	uint32_t callbacks = HOST.callbacks;
+	uint32_t samples = HOST.samplesRequested;
+	uint32_t transmits = HOST.transmitsRequested;
+	uint32_t alerts = HOST.alerts;
+
+	if (input->event == E_ERROR) {
+		SB_fsmReportError(input->error);
+	}
+
+	after = SB_handleEvent(input->event);
+	++EXPLORE.steps;
+
+	CHECK(after == systemState.currentState, "SB_handleEvent returned another state than the current one");
+	CHECK(after < SB_NUM_STATES, "invalid state");
+	CHECK(!HOST.callbackStateMismatch, "callback ran before the state changed");
+	CHECK(HOST.alerts - alerts == (input->event == E_DATA_CHANGE), "E_DATA_CHANGE not alerted exactly once");
+
+	if (before == S_ERROR_PERM) {
+		CHECK(after == S_ERROR_PERM, "S_ERROR_PERM left");
+	}
+
+	if (input->event == E_ERROR && input->error == OutOfMemory) {
+		CHECK(after == S_ERROR_PERM, "permanent error did not reach S_ERROR_PERM");
+	}
+
+	// OutOfMemory is the only permanent error raised
+	if (input->event >= SB_NUM_EVENTS) {
+		CHECK(after == ((error == OutOfMemory || before == S_ERROR_PERM) ? S_ERROR_PERM : S_ERROR_TEMP),
+				"invalid event did not lead to an error state");
+		CHECK(error != OutOfMemory || systemState.currentError == OutOfMemory,
+				"invalid event replaced a permanent error");
+		EXPLORE.reached[after] = true;
+		return;
+	}
+
+	if (after != before) {
+		CHECK(HOST.callbacks - callbacks == 1, "transition did not run its callback once");
+		CHECK((int)HOST.lastTransition == (int)after, "callback given the wrong transition");
+		CHECK(systemState.lastState == before, "lastState not kept");
+		EXPLORE.moved[before][input->event] = true;
+	} else {
+		CHECK(HOST.callbacks == callbacks, "callback without a transition");
+	}
+
+	CHECK(HOST.samplesRequested - samples == (after == S_CHECK && after != before), "sample not requested once on entering S_CHECK");
+	CHECK(HOST.transmitsRequested - transmits == (after == S_TRANSMIT && after != before), "transmit not requested once on entering S_TRANSMIT");
+	if (HOST.transmitsRequested != transmits) {
+		CHECK(HOST.lastTransmitFlush == (input->event == E_DATA_CHANGE), "transmit flushed other than for an alert");
+	}
+
+	EXPLORE.reached[after] = true;
+	EXPLORE.handled[before][input->event] = true;
+}
+
+static void explore(uint8_t depth) {
+	SB_SystemState saved;
+	uint8_t i;
+
+	if (depth == EXPLORE.depth) {
+		++EXPLORE.paths;
+		return;
+	}
+
+	saved = systemState;
+
+	for (i = 0; i < NUM_INPUTS; ++i) {
+		trace[depth] = &inputs[i];
+		traceDepth = depth + 1;
+
+		step(&inputs[i]);
+		explore(depth + 1);
+
+		systemState = saved;
+	}
+}
+
+static void runExhaustive(uint8_t depth) {
+	size_t heap;
+	uint8_t s, e;
+	uint32_t unhandled = 0;
+
+	phase = "exhaustive exploration";
+	EXPLORE.depth = depth;
+	EXPLORE.reached[S_INIT] = true;
+
+	heap = heapInUse();
+	explore(0);
+	traceDepth = 0;
+	CHECK(heapInUse() == heap, "heap grew during exploration");
+
+	printf("Exhaustive: depth %u, %llu sequences, %llu dispatches\n", depth,
+			(unsigned long long)EXPLORE.paths, (unsigned long long)EXPLORE.steps);
+
+	for (s = 0; s < SB_NUM_STATES; ++s) {
+		printf("  %-10s %s  moves on:", stateNames[s], EXPLORE.reached[s] ? "reached  " : "UNREACHED");
+		for (e = 0; e < SB_NUM_EVENTS; ++e) {
+			if (EXPLORE.moved[s][e]) {
+				printf(" %s", eventNames[e]);
+			}
+			if (EXPLORE.reached[s] && !EXPLORE.handled[s][e]) {
+				++unhandled;
+			}
+		}
+		printf("\n");
+	}
+
+	// Every event must have been tried in every state reached, or the depth is too small
+	CHECK(unhandled == 0 || depth < 3, "reached states not tried with every event");
+}
+
+/*
+ * Random runs through the queue, the timers and the task
+ */
+static uint32_t randomState;
+
+static uint32_t nextRandom(void) {
+	// xorshift32
+	randomState ^= randomState << 13;
+	randomState ^= randomState >> 17;
+	randomState ^= randomState << 5;
+	return randomState;
+}
+
+// Lets the state machine task handle everything queued
+static void runTask(void) {
+	Semaphore_Handle sem = &HOST.semaphores[0];
+
+	while (HOST.taskFunction != NULL && (!HOST.taskStarted || sem->count > 0)) {
+		HOST.taskStarted = true;
+		HOST.inTask = true;
+		swapcontext(&HOST.mainContext, &HOST.taskContext);
+	}
+}
+
+// Moves time on, firing the clocks due in order
+static void advanceTime(uint32_t ticks) {
+	uint32_t end = HOST.ticks + ticks;
+	Clock_Struct *next;
+	uint8_t i;
+
+	HOST.elapsed += ticks;
+
+	// The task runs as soon as an event is posted, before time moves on
+	runTask();
+
+	while (1) {
+		next = NULL;
+		for (i = 0; i < HOST.numClocks; ++i) {
+			if (HOST.clocks[i]->active && (int32_t)(end - HOST.clocks[i]->due) >= 0
+					&& (next == NULL || (int32_t)(next->due - HOST.clocks[i]->due) > 0)) {
+				next = HOST.clocks[i];
+			}
+		}
+
+		if (next == NULL) {
+			break;
+		}
+
+		HOST.ticks = next->due;
+		if (next->period != 0) {
+			next->due += next->period;
+		} else {
+			next->active = false;
+		}
+
+		next->function(next->arg);
+		runTask();
+	}
+
+	HOST.ticks = end;
+}
+
+static void checkLiveness(Clock_Struct *checkClock) {
+	SB_FsmEventStats stats;
+	uint8_t e;
+
+	SB_fsmGetEventStats(&stats);
+	CHECK(stats.maxDepth <= SB_FSM_EVENT_QUEUE_LEN, "event queue deeper than its length");
+	for (e = 0; e < SB_NUM_EVENTS; ++e) {
+		CHECK(stats.coalesced[e] <= stats.posted[e], "more posts merged than made");
+	}
+
+	CHECK(systemState.currentState < SB_NUM_STATES, "invalid state");
+
+	switch (systemState.currentState) {
+	case S_SLEEP:
+	case S_ERROR_TEMP:
+		CHECK(checkClock->active, "waiting for a check without the check timer running");
+		break;
+
+	case S_CHECK:
+		CHECK(HOST.samplesPending > 0, "in S_CHECK without a sample outstanding");
+		break;
+
+	case S_TRANSMIT:
+		CHECK(HOST.transmitsPending > 0, "in S_TRANSMIT without a transmit outstanding");
+		break;
+
+	default:
+		break;
+	}
+}
+
+static void runFuzzer(uint32_t seed, uint32_t runs) {
+	uint32_t residencyMs[SB_NUM_STATES];
+	SB_FsmEventStats stats;
+	Clock_Struct *checkClock;
+	uint32_t run, i, actions, choice, permErrors = 0;
+	uint64_t transitions = 0;
+	uint32_t callbacks;
+	size_t heap;
+	bool permanent;
+	uint8_t e;
+
+	phase = "random runs";
+	randomState = fuzzSeed = seed ? seed : 1;
+
+	CHECK(SB_fsmInit() == NoError, "SB_fsmInit failed");
+	checkClock = findClock(E_CHECK_TIMER_EXPIRED, NULL);
+	CHECK(checkClock != NULL, "no check timer constructed");
+
+	heap = heapInUse();
+	callbacks = HOST.callbacks;
+
+	for (run = 0; run < runs; ++run) {
+		fuzzRun = run;
+
+		// Charges the time so far to the state left, before it is forced back
+		SB_fsmGetResidency(residencyMs);
+		systemState.currentState = S_INIT;
+		systemState.lastState = S_INIT;
+		systemState.currentError = NoError;
+
+		// The task raises the first check as it starts; later runs raise it here
+		if (HOST.taskStarted) {
+			SB_fsmPostEvent(E_CHECK_TIMER_EXPIRED);
+		}
+		runTask();
+
+		permanent = false;
+
+		for (i = 0; i < STEPS_PER_RUN; ++i) {
+			fuzzStep = i;
+
+			// Several events may be posted before the task runs, to be merged in the queue
+			for (actions = 1 + nextRandom() % 4; actions > 0; --actions) {
+				choice = nextRandom() % 100;
+
+				if (choice < 30) {
+					advanceTime(nextRandom() % (2000 * (NTICKS_PER_MILLSECOND)));
+				} else if (choice < 50) {
+					if (HOST.samplesPending > 0) {
+						--HOST.samplesPending;
+						SB_fsmPostEvent((nextRandom() % 10) ? E_CHECK_DONE : E_NO_BANDAGE_DETECTED);
+					}
+				} else if (choice < 65) {
+					if (HOST.transmitsPending > 0) {
+						--HOST.transmitsPending;
+						SB_fsmPostEvent(E_TRANSMIT_DONE);
+					}
+				} else if (choice < 80) {
+					SB_fsmPostEvent(E_DATA_CHANGE);
+				} else if (choice < 85) {
+					SB_fsmSetBleTimer(nextRandom() & 1);
+				} else if (choice < 90) {
+					// Rarely permanent, so most runs are long
+					SB_fsmReportError((nextRandom() % 1000) ? OperationTimeout : OutOfMemory);
+				} else if (choice < 98) {
+					// Spurious events must be harmless too
+					SB_fsmPostEvent((SB_Event)(nextRandom() % SB_NUM_EVENTS));
+				} else {
+					// As must invalid ones, which are not queued
+					SB_fsmPostEvent((SB_Event)(SB_NUM_EVENTS + nextRandom() % 8));
+				}
+			}
+
+			runTask();
+
+			if (permanent) {
+				CHECK(systemState.currentState == S_ERROR_PERM, "S_ERROR_PERM left");
+			} else if (systemState.currentState == S_ERROR_PERM) {
+				permanent = true;
+				++permErrors;
+			}
+
+			checkLiveness(checkClock);
+		}
+	}
+
+	fuzzSeed = 0;
+	CHECK(heapInUse() == heap, "heap grew during random runs");
+
+	transitions = HOST.callbacks - callbacks;
+	SB_fsmGetEventStats(&stats);
+
+	printf("Random: seed %u, %u runs of %u steps, %llu transitions, %u ended in S_ERROR_PERM\n",
+			seed, runs, STEPS_PER_RUN, (unsigned long long)transitions, permErrors);
+	printf("  queue deepest %u of %u; alert to radio %u us at most, alert transmits outstanding %u us at most\n",
+			stats.maxDepth, SB_FSM_EVENT_QUEUE_LEN, stats.maxAlertLatencyUs,
+			HOST.maxAlertTransmit * (1000000 / NTICKS_PER_SECOND));
+
+	// A tick of rounding in each of the two figures
+	CHECK(stats.maxAlertLatencyUs <= stats.maxLatencyUs[E_DATA_CHANGE]
+			+ HOST.maxAlertTransmit * (1000000 / NTICKS_PER_SECOND) + 2 * (1000000 / NTICKS_PER_SECOND),
+			"alert timed over more than the transmit it started");
+	for (e = 0; e < SB_NUM_EVENTS; ++e) {
+		printf("  %-13s posted %8u  merged %8u  max latency %8u us\n", eventNames[e],
+				stats.posted[e], stats.coalesced[e], stats.maxLatencyUs[e]);
+	}
+}
+
+// The tracer after the random runs, which end in the last transition they traced
+static void checkTracer(void) {
+	uint32_t residencyMs[SB_NUM_STATES];
+	uint32_t transitions[SB_NUM_STATES][SB_NUM_STATES];
+	SB_FsmTraceSummary summary;
+	uint64_t counted = 0, totalMs = 0;
+	uint32_t entries;
+	uint8_t i, from, to;
+
+	phase = "tracer";
+
+	SB_fsmGetResidency(residencyMs);
+	SB_fsmGetTransitions(transitions);
+	SB_fsmGetTraceSummary(&summary);
+
+	for (to = 0; to < SB_NUM_STATES; ++to) {
+		entries = 0;
+		for (from = 0; from < SB_NUM_STATES; ++from) {
+			CHECK(from != to || transitions[from][to] == 0, "transition to the same state traced");
+			entries += transitions[from][to];
+		}
+		CHECK(summary.entries[to] == entries, "entries do not match the transitions");
+
+		counted += entries;
+		totalMs += residencyMs[to];
+	}
+
+	CHECK(counted == HOST.callbacks, "tracer missed transitions");
+	CHECK(totalMs <= HOST.elapsed / (NTICKS_PER_MILLSECOND)
+			&& totalMs + SB_NUM_STATES >= HOST.elapsed / (NTICKS_PER_MILLSECOND),
+			"residency does not add up to the time elapsed");
+
+	CHECK(summary.recent[SB_FSM_TRACE_LEN - 1].to == systemState.currentState,
+			"last traced transition is not to the current state");
+	for (i = 0; i + 1 < SB_FSM_TRACE_LEN; ++i) {
+		CHECK(summary.recent[i].to == summary.recent[i + 1].from, "recent transitions do not chain");
+		CHECK(summary.ticks - summary.recent[i].ticks >= summary.ticks - summary.recent[i + 1].ticks,
+				"recent transitions out of order");
+	}
+
+	SB_fsmPrintTrace();
 }
 
+/*
+ * Dispatch cost
+ */
+static double secondsNow(void) {
+	struct timespec now;
 
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+static void runBenchmark(void) {
+	double start, stay, move;
+	uint32_t i;
+
+	phase = "benchmark";
+
+	systemState.currentState = S_SLEEP;
+	systemState.currentError = NoError;
+
+	// E_CHECK_DONE is ignored in S_SLEEP: the table lookup alone
+	start = secondsNow();
+	for (i = 0; i < BENCHMARK_CALLS; ++i) {
+		SB_handleEvent(E_CHECK_DONE);
+	}
+	stay = secondsNow() - start;
+
+	// S_SLEEP and S_CHECK in turn: lookup, exit and entry actions, residency and callbacks
+	start = secondsNow();
+	for (i = 0; i < BENCHMARK_CALLS; ++i) {
+		SB_handleEvent((i & 1) ? E_CHECK_DONE : E_CHECK_TIMER_EXPIRED);
+	}
+	move = secondsNow() - start;
+
+	CHECK(systemState.currentState == S_SLEEP, "benchmark ended in the wrong state");
+
+	printf("Benchmark: SB_handleEvent %.1f ns without a transition, %.1f ns with one\n",
+			stay * 1e9 / BENCHMARK_CALLS, move * 1e9 / BENCHMARK_CALLS);
+}
+
+/**
+ * \brief A permanent error posted behind an event that leaves S_ERROR_TEMP, and followed by a
+ * 			temporary one, is still permanent when its E_ERROR is handled.
+ */
+static void checkQueuedError(void) {
+	uint32_t residencyMs[SB_NUM_STATES];
+
+	phase = "queued error";
 
+	// Charges the time so far to the state left, before it is forced back
+	SB_fsmGetResidency(residencyMs);
+	systemState.currentState = S_INIT;
+	systemState.lastState = S_INIT;
+	systemState.currentError = NoError;
 
-    
+	SB_fsmReportError(OperationTimeout);
+	runTask();
+	CHECK(systemState.currentState == S_ERROR_TEMP, "temporary error did not reach S_ERROR_TEMP");
+
+	// All three wait in the queue before the task runs
+	SB_fsmPostEvent(E_CHECK_TIMER_EXPIRED);
+	SB_fsmReportError(OutOfMemory);
+	SB_fsmReportError(OperationTimeout);
+	runTask();
+	CHECK(systemState.currentState == S_ERROR_PERM, "permanent error lost while queued");
+
+	printf("Queued error: permanent after leaving S_ERROR_TEMP\n");
+}
+
+int main(int argc, char **argv) {
+	uint8_t depth = (argc > 1) ? atoi(argv[1]) : DEFAULT_DEPTH;
+	uint32_t seed = (argc > 2) ? strtoul(argv[2], NULL, 0) : DEFAULT_SEED;
+	uint32_t runs = (argc > 3) ? strtoul(argv[3], NULL, 0) : DEFAULT_RUNS;
+	uint8_t t;
+
+	if (depth > MAX_DEPTH) {
+		depth = MAX_DEPTH;
+	}
+
+	signal(SIGSEGV, faultHandler);
+	signal(SIGBUS, faultHandler);
+	signal(SIGILL, faultHandler);
+
+	for (t = 0; t < NUM_TRANSITIONS; ++t) {
+		CHECK(SB_registerStateTransitionCallback(transitionCallback, NULL, (SB_State_Transition)t) == NoError,
+				"callback registration failed");
+	}
+
+	// Explored before the task exists, so nothing posted is queued
+	runExhaustive(depth);
+	runFuzzer(seed, runs);
+	checkTracer();
+	checkQueuedError();
+	runBenchmark();
+
+	printf("PASS\n");
+
+	return 0;
+}
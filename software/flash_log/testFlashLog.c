@@ -0,0 +1,333 @@
+/*
+ * testFlashLog.c
+ *
+ * Power loss test for the flash log. It links the real flashLog.c, util.c, bsp_spi.c and
+ * ext_flash.c against the W25X20CL emulator in ../host/, whose memory is shared between
+ * processes. Every boot is a fresh child process: it recovers the log with SB_flashLogInit,
+ * checks what it finds, then appends records until power is cut at a random program or erase.
+ * The parent boots the next child on the same memory.
+ *
+ * Power is cut at page granularity, where a torn program is lost and a torn erase clears whole
+ * program pages, and at byte granularity, where a torn program lands a prefix of its bytes and
+ * a torn erase leaves the cells of the sector in any state between programmed and erased.
+ *
+ * Invariants checked on every boot:
+ *  - No acknowledged record is lost. The records read back are contiguous, end with the last
+ *    record acknowledged or the one in flight when power was cut, and have their contents.
+ *  - The sequence number of every record read back is the one it was appended under
+ *  - Torn records are sealed: whatever follows the recovered write position is erased, so
+ *    nothing is ever programmed on top of torn data
+ *  - Recovery reads no more than every sector header and one sector of records
+ *
+ * Build and run from this directory, or with make in the parent directory:
+ *
+ *   gcc -std=gnu99 -O2 -Wall -DTI_DRIVERS_SPI_INCLUDED -I../host \
+ *       -I../comms_module/SmartBandage/Application -I../comms_module/SmartBandage/PROFILES \
+ *       -I../comms_module/SmartBandage/Board/Interfaces testFlashLog.c \
+ *       ../host/hostSim.c ../host/flashEmulator.c \
+ *       ../comms_module/SmartBandage/Board/Interfaces/bsp_spi.c \
+ *       ../comms_module/SmartBandage/Board/Devices/ext_flash.c \
+ *       ../comms_module/SmartBandage/Application/flashLog.c \
+ *       ../comms_module/SmartBandage/Application/util.c -o testFlashLog
+ *   ./testFlashLog [boots] [seed]
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "hostSim.h"
+#include "flashEmulator.h"
+#include "flashLog.h"
+#include "logCrypt.h"
+
+#define DEFAULT_BOOTS		400
+#define DEFAULT_SEED		1
+
+// Records appended by a boot that is not cut short
+#define RECORDS_PER_BOOT	80
+
+// Power is cut within this many programs and erases of the boot starting
+#define CUT_WINDOW			(RECORDS_PER_BOOT * 3)
+
+#define LOG_BASE			FLASHLOG_SAMPLES_BASE
+#define LOG_NUM_SECTORS		FLASHLOG_SAMPLES_NUM_SECTORS
+
+#define ID_LEN				4
+#define MIN_RECORD_LEN		ID_LEN
+
+// Exit status of a boot that found the log broken
+#define BOOT_FAILED			1
+
+#define CHECK(condition, message) do { \
+		if (!(condition)) { \
+			fprintf(stderr, "FAIL: %s (%s:%d)\n", message, __FILE__, __LINE__); \
+			exit(BOOT_FAILED); \
+		} \
+	} while (0)
+
+// Survives power cuts: the flash, and what the boots have told each other
+typedef struct {
+	uint8_t flash[FLASHEMU_SIZE];
+
+	uint32_t acked;				// Records acknowledged by SB_flashLogAppend, across boots
+
+	// Totals over the boots, for the report
+	uint32_t inFlightKept;		// Records whose append was cut but that committed anyway
+	uint32_t tornRecords;
+	uint32_t sealedBoots;
+	uint32_t wrapped;
+	uint32_t maxReadBytes;
+	uint32_t maxReadCommands;
+	uint32_t maxRecoveryTicks;
+} Shared;
+
+static Shared *shared;
+static uint32_t randomState;
+
+/*
+ * The log is stored in the clear here, so its encryption is never called
+ */
+SB_Error SB_logCryptWaitKey(uint32_t timeout) {
+	return ResourceNotInitialized;
+}
+
+uint32_t SB_logCryptGetEpoch() {
+	return 0;
+}
+
+SB_Error SB_logCryptWrite(uint32_t address, const uint8_t *data, uint16_t length, uint32_t epoch, uint32_t nonce, uint16_t *crc) {
+	return ResourceNotInitialized;
+}
+
+SB_Error SB_logCryptApply(uint32_t address, uint8_t *data, uint16_t length, uint32_t epoch, uint32_t nonce) {
+	return ResourceNotInitialized;
+}
+
+static uint32_t nextRandom(void) {
+	randomState ^= randomState << 13;
+	randomState ^= randomState >> 17;
+	randomState ^= randomState << 5;
+	return randomState;
+}
+
+// Length and contents of a record follow from its id, so any record read back can be checked
+static uint8_t recordLength(uint32_t id) {
+	return MIN_RECORD_LEN + (id * 2654435761u >> 8) % (FLASHLOG_MAX_RECORD_LEN - MIN_RECORD_LEN + 1);
+}
+
+static void fillRecord(uint32_t id, uint8_t *buf) {
+	uint8_t length = recordLength(id), i;
+
+	memcpy(buf, &id, ID_LEN);
+	for (i = ID_LEN; i < length; ++i) {
+		buf[i] = (uint8_t)(id * 31 + i * 7);
+	}
+}
+
+/**
+ * \brief The write position must be followed by erased flash, or nothing may be appended to the head sector.
+ */
+static void checkSealed(SB_FlashLog *log) {
+	uint32_t address = log->base + (uint32_t)log->headSector * FLASHLOG_SECTOR_SIZE;
+	uint32_t i;
+
+	if (log->empty || log->headOffset >= FLASHLOG_SECTOR_SIZE) {
+		++shared->sealedBoots;
+		return;
+	}
+
+	for (i = log->headOffset; i < FLASHLOG_SECTOR_SIZE; ++i) {
+		CHECK(shared->flash[address + i] == FLASHLOG_ERASED_BYTE, "write position is not followed by erased flash");
+	}
+}
+
+/**
+ * \brief Reads the whole log back and returns the id after the newest record.
+ */
+static uint32_t checkRecords(SB_FlashLog *log) {
+	SB_FlashLogCursor cursor;
+	uint8_t buf[FLASHLOG_MAX_RECORD_LEN], expected[FLASHLOG_MAX_RECORD_LEN];
+	uint32_t id, next = 0, count = 0;
+	uint8_t length;
+	SB_Error result;
+
+	result = SB_flashLogSeek(log, &cursor, 0);
+	if (result == NoDataAvailable) {
+		CHECK(shared->acked == 0, "acknowledged records lost with the whole log");
+		return 0;
+	}
+	CHECK(result == NoError, "seek failed");
+
+	while (NoDataAvailable != (result = SB_flashLogRead(log, &cursor, buf, sizeof(buf), &length))) {
+		CHECK(result == NoError, "committed record failed to read");
+		CHECK(length >= ID_LEN, "record too short");
+
+		memcpy(&id, buf, ID_LEN);
+		CHECK(count == 0 || id == next, "records are not contiguous");
+		CHECK(cursor.recordSeq == id + 1, "record read under another sequence number");
+		CHECK(length == recordLength(id), "record has the wrong length");
+
+		fillRecord(id, expected);
+		CHECK(memcmp(buf, expected, length) == 0, "record has the wrong contents");
+
+		next = id + 1;
+		++count;
+	}
+
+	CHECK(count > 0, "log recovered with no records");
+	CHECK(next >= shared->acked, "acknowledged records lost");
+	CHECK(next <= shared->acked + 1, "records found that were never appended");
+
+	if (next > shared->acked) {
+		++shared->inFlightKept;
+	}
+
+	return next;
+}
+
+/**
+ * \brief One boot: recovers and checks the log, then appends until power is cut.
+ */
+static void boot(uint32_t seed, FlashEmuCutMode mode, bool cut) {
+	FlashEmuStats stats;
+	SB_FlashLog log;
+	uint8_t buf[FLASHLOG_MAX_RECORD_LEN];
+	uint32_t next, i;
+
+	randomState = seed;
+	hostSimReset();
+	flashEmuInit(shared->flash);
+
+	CHECK(NoError == SB_flashLogInit(&log, LOG_BASE, LOG_NUM_SECTORS, false), "recovery failed");
+
+	// Recovery is bounded by the sector headers and one sector of records
+	flashEmuGetStats(&stats);
+	CHECK(stats.readBytes <= LOG_NUM_SECTORS * sizeof(SB_FlashLogSectorHeader) + FLASHLOG_SECTOR_SIZE,
+			"recovery read more than the sector headers and the head sector");
+	CHECK(log.stats.headersRead == LOG_NUM_SECTORS, "recovery did not read every sector header");
+
+	if (stats.readBytes > shared->maxReadBytes) {
+		shared->maxReadBytes = stats.readBytes;
+	}
+	if (stats.readCommands > shared->maxReadCommands) {
+		shared->maxReadCommands = stats.readCommands;
+	}
+	if (log.stats.recoveryTicks > shared->maxRecoveryTicks) {
+		shared->maxRecoveryTicks = log.stats.recoveryTicks;
+	}
+	shared->tornRecords += log.stats.tornRecords;
+
+	checkSealed(&log);
+
+	next = checkRecords(&log);
+
+	// What was read back is committed and must survive from now on
+	shared->acked = next;
+
+	if (!log.empty && log.tailFirstRecordSeq > 0) {
+		shared->wrapped = 1;
+	}
+
+	if (cut) {
+		flashEmuCutPower(nextRandom() % CUT_WINDOW, mode, nextRandom());
+	}
+
+	for (i = 0; i < RECORDS_PER_BOOT; ++i) {
+		fillRecord(next, buf);
+		CHECK(NoError == SB_flashLogAppend(&log, buf, recordLength(next)), "append failed");
+		shared->acked = ++next;
+	}
+}
+
+// Runs one boot in a child process. True if power was cut.
+static bool runBoot(uint32_t seed, FlashEmuCutMode mode, bool cut) {
+	pid_t pid;
+	int status;
+
+	fflush(stdout);
+
+	pid = fork();
+	if (pid < 0) {
+		perror("fork");
+		exit(2);
+	}
+
+	if (pid == 0) {
+		// The log reports every recovery; keep that out of the summary
+		if (freopen("/dev/null", "w", stdout) == NULL) {
+			_exit(2);
+		}
+		boot(seed, mode, cut);
+		_exit(0);
+	}
+
+	if (waitpid(pid, &status, 0) != pid || !WIFEXITED(status)) {
+		fprintf(stderr, "FAIL: boot %u crashed\n", seed);
+		exit(1);
+	}
+
+	if (WEXITSTATUS(status) == FLASHEMU_POWER_CUT_EXIT) {
+		return true;
+	}
+
+	if (WEXITSTATUS(status) != 0) {
+		fprintf(stderr, "FAIL: boot %u\n", seed);
+		exit(1);
+	}
+
+	return false;
+}
+
+static void runMode(FlashEmuCutMode mode, const char *name, uint32_t boots, uint32_t seed) {
+	uint32_t cuts = 0, i;
+
+	memset(shared, 0, sizeof(Shared));
+	memset(shared->flash, 0xFF, sizeof(shared->flash));
+
+	for (i = 0; i < boots; ++i) {
+		cuts += runBoot(seed * 100003 + i + 1, mode, true);
+	}
+
+	// A last boot without a cut checks what the others left
+	runBoot(seed * 100003 + boots + 1, mode, false);
+
+	printf("  %-5s %4u boots, %4u cut: %6u records acked, %3u kept from a cut append, %3u torn records, "
+			"%3u sealed heads, log %s\n",
+			name, boots + 1, cuts, shared->acked, shared->inFlightKept, shared->tornRecords, shared->sealedBoots,
+			shared->wrapped ? "wrapped" : "did not wrap");
+	printf("        recovery: at most %u bytes in %u reads, %.2f ms (bound %u bytes)\n",
+			shared->maxReadBytes, shared->maxReadCommands,
+			shared->maxRecoveryTicks * (Clock_tickPeriod / 1000.0),
+			(unsigned)(LOG_NUM_SECTORS * sizeof(SB_FlashLogSectorHeader) + FLASHLOG_SECTOR_SIZE));
+
+	if (cuts == 0 || !shared->wrapped) {
+		fprintf(stderr, "FAIL: the %s run did not exercise power cuts across a wrapped log\n", name);
+		exit(1);
+	}
+}
+
+int main(int argc, char **argv) {
+	uint32_t boots = (argc > 1) ? strtoul(argv[1], NULL, 0) : DEFAULT_BOOTS;
+	uint32_t seed = (argc > 2) ? strtoul(argv[2], NULL, 0) : DEFAULT_SEED;
+
+	shared = mmap(NULL, sizeof(Shared), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (shared == MAP_FAILED) {
+		perror("mmap");
+		return 2;
+	}
+
+	printf("Flash log power loss, %u sectors of %u bytes, seed %u\n", LOG_NUM_SECTORS, FLASHLOG_SECTOR_SIZE, seed);
+
+	runMode(FLASHEMU_CUT_PAGE, "page", boots, seed);
+	runMode(FLASHEMU_CUT_BYTE, "byte", boots, seed);
+
+	printf("PASS\n");
+
+	return 0;
+}
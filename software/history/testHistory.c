@@ -0,0 +1,902 @@
+/*
+ * testHistory.c
+ *
+ * Host test of the history download. It links the real history.c, sampleRecord.c, flashLog.c,
+ * logCrypt.c and the flash driver against the W25X20CL emulator and the simulated kernel in
+ * ../host/, and stands in for the BLE stack and the phone. The stack is modeled as far as the
+ * service sees it: each SDU is segmented into LE-frames, a few of which are sent per connection
+ * event as long as the phone has given credits for them. The phone decodes every SDU the way
+ * the app does and checks it against what was logged.
+ *
+ * The sample log is filled with the times a bandage logs: time counted from boot, a sync, a
+ * clock that ran fast stepped back by the next sync, a reset, and a later sync. The log wraps,
+ * so its oldest records are gone. Every minute of samples closes a window in the minute rollup
+ * log on the same flash. The peripheral manager keeps appending to both while downloads run.
+ *
+ * Checked:
+ *  - Every record sent decodes to the sample logged under its sequence number, the records of
+ *    a download are consecutive, and END gives the next sequence number of the log
+ *  - FROM_TIMESTAMP starts at a record at or after the time that follows one before it, the
+ *    only such record where there is one, and no record logged at or after the time is left out.
+ *    In a rollup log, at a window ending after the time.
+ *  - Requests without a log selector download the sample log; an unknown log is refused
+ *  - A download cut by a disconnect continues without a gap on RESUME
+ *  - STOP ends a download once the SDU in flight is sent
+ *  - The phone never sends a request without a credit for it
+ *
+ * Reports the time and flash reads each timestamp search takes, and the throughput of a whole
+ * download next to the bound set by the link.
+ *
+ * Build and run from this directory, or with make in the parent directory:
+ *
+ *   gcc -std=gnu99 -O2 -Wall -DTI_DRIVERS_SPI_INCLUDED -I../host \
+ *       -I../comms_module/SmartBandage/Application -I../comms_module/SmartBandage/PROFILES \
+ *       -I../comms_module/SmartBandage/Board/Interfaces testHistory.c \
+ *       ../host/hostSim.c ../host/flashEmulator.c ../host/cryptoHost.c ../host/snvHost.c \
+ *       ../comms_module/SmartBandage/Board/Interfaces/bsp_spi.c \
+ *       ../comms_module/SmartBandage/Board/Devices/ext_flash.c \
+ *       ../comms_module/SmartBandage/Application/flashLog.c \
+ *       ../comms_module/SmartBandage/Application/logCrypt.c \
+ *       ../comms_module/SmartBandage/Application/util.c \
+ *       ../comms_module/SmartBandage/Application/sampleRecord.c \
+ *       ../comms_module/SmartBandage/Application/history.c -o testHistory
+ *   ./testHistory
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "hostSim.h"
+#include "flashEmulator.h"
+#include "osal_snv.h"
+#include "flashLog.h"
+#include "logCrypt.h"
+#include "sampleRecord.h"
+#include "rollup.h"
+#include "systemTime.h"
+#include "history.h"
+
+// The link: LE-frames of 23 bytes, as many per connection event as fit in one
+#define CONN_INTERVAL_NS		30000000ULL
+#define FRAMES_PER_EVENT		6
+#define PEER_MPS				23
+#define SDU_LENGTH_LEN			2
+
+// The phone takes SDUs of up to its MTU and gives back fewer credits per event than the
+// link could use, so it runs out of them
+#define PHONE_MTU				512
+#define PHONE_INIT_CREDITS		8
+#define PHONE_CREDITS_PER_EVENT	4
+
+#define CHANNEL_ID				0x0040
+
+#define SAMPLE_PERIOD_S			10
+#define SAMPLE_PERIOD_NS		(SAMPLE_PERIOD_S * 1000000000ULL)
+
+// 18 October 2026, in UTCTime
+#define SYNC_TIME				845683200UL
+
+// Samples of each part of the timeline
+#define BOOT_SAMPLES			900
+#define SYNC_SAMPLES			1100
+#define STEP_SAMPLES			800
+#define RESET_SAMPLES			200
+#define RESYNC_SAMPLES			800
+
+// The clock runs this fast by the second sync, which steps it back
+#define FAST_S					30
+
+// Samples per rollup window
+#define ROLLUP_SAMPLES			(60 / SAMPLE_PERIOD_S)
+
+#define MAX_RECORDS				6000
+#define MAX_ROLLUPS				(MAX_RECORDS / ROLLUP_SAMPLES + 1)
+#define MAX_WORK				32
+
+#define DOWNLOAD_TIMEOUT_NS		(600 * 1000000000ULL)
+
+#define CHECK(condition, message) do { \
+		if (!(condition)) { \
+			fprintf(stderr, "FAIL: %s (%s:%d)\n", message, __FILE__, __LINE__); \
+			exit(1); \
+		} \
+	} while (0)
+
+typedef enum {
+	WORK_SIGNAL,
+	WORK_DATA,
+	WORK_APPEND
+} WorkType;
+
+// Messages for the BLE task, and samples for the peripheral manager. Events run in place of
+// a Swi and cannot touch the flash, so they queue work for the tasks.
+typedef struct {
+	WorkType type;
+	l2capSignalEvent_t signal;
+	l2capDataEvent_t data;
+} Work;
+
+static uint8_t memory[FLASHEMU_SIZE];
+static SnvHostStore snv;
+
+static struct {
+	Work items[MAX_WORK];
+	uint8_t first;
+	uint8_t count;
+} WORK;
+
+// What was logged under each sequence number
+static struct {
+	SB_Sample samples[MAX_RECORDS];
+	uint32_t trueTimes[MAX_RECORDS];
+	bool absolute[MAX_RECORDS];
+	uint32_t count;
+
+	SB_SampleCodec codec;
+	uint32_t lastStamp;
+	uint32_t lastTrueTime;
+
+	// What was logged under each sequence number of the minute rollup log
+	uint32_t windowStarts[MAX_ROLLUPS];
+	uint32_t windowTrueEnds[MAX_ROLLUPS];
+	uint32_t rollups;
+} LOGGED;
+
+static struct {
+	bool registered;
+	bool connected;
+	uint32_t generation;
+
+	// SDU being segmented
+	uint8_t *sdu;
+	uint16_t sduLen;
+	uint16_t sent;
+	bool outOfCreditSignalled;
+
+	uint16_t credits;			// LE-frames the phone lets the bandage send
+	uint16_t peerCredits;		// LE-frames the bandage lets the phone send
+	uint16_t creditThreshold;
+
+	uint32_t frames;
+} LINK;
+
+static struct {
+	uint8_t log;				// SB_HISTORY_LOG_* being downloaded
+	bool haveFirst;
+	uint32_t firstSeq;			// First record of the download
+	uint32_t nextSeq;			// Record the next RECORDS message must start with
+	uint32_t records;
+	uint32_t bytes;
+	uint32_t sdus;
+	bool ended;
+	uint32_t endSeq;
+	bool error;
+	uint8_t errorCode;
+
+	uint64_t startNs;
+	uint64_t endNs;
+
+	// Cost of handling the last request
+	uint64_t requestNs;
+	uint32_t requestReads;
+} PHONE;
+
+static bool appending = false;
+
+static void queueWork(const Work *item) {
+	CHECK(WORK.count < MAX_WORK, "work queue full");
+	WORK.items[(WORK.first + WORK.count) % MAX_WORK] = *item;
+	++WORK.count;
+}
+
+static void queueSignal(uint8_t opcode, const l2capSignalCmd_t *cmd) {
+	Work item;
+
+	memset(&item, 0, sizeof(item));
+	item.type = WORK_SIGNAL;
+	item.signal.opcode = opcode;
+	item.signal.cmd = *cmd;
+	queueWork(&item);
+}
+
+/*
+ * Stack stand-ins
+ */
+bStatus_t L2CAP_RegisterPsm(l2capPsm_t *pPsm) {
+	CHECK(pPsm->psm == SB_HISTORY_PSM && pPsm->maxNumChannels == 1, "unexpected PSM registration");
+
+	LINK.registered = true;
+	LINK.creditThreshold = pPsm->peerCreditThreshold;
+
+	return SUCCESS;
+}
+
+bStatus_t L2CAP_FlowCtrlCredit(uint16 CID, uint16 peerCredits) {
+	if (!LINK.connected || CID != CHANNEL_ID) {
+		return FAILURE;
+	}
+
+	LINK.peerCredits += peerCredits;
+
+	return SUCCESS;
+}
+
+void *L2CAP_bm_alloc(uint16 size) {
+	return malloc(size);
+}
+
+void BM_free(void *payload_ptr) {
+	free(payload_ptr);
+}
+
+bStatus_t L2CAP_SendSDU(l2capPacket_t *pPkt) {
+	if (!LINK.connected || pPkt->CID != CHANNEL_ID) {
+		return FAILURE;
+	}
+
+	CHECK(LINK.sdu == NULL, "SDU sent while another is in flight");
+	CHECK(pPkt->len <= PHONE_MTU, "SDU larger than the phone's MTU");
+
+	LINK.sdu = pPkt->pPayload;
+	LINK.sduLen = pPkt->len;
+	LINK.sent = 0;
+	LINK.outOfCreditSignalled = false;
+
+	return SUCCESS;
+}
+
+/*
+ * The phone
+ */
+static uint32_t get32(const uint8_t *p) {
+	uint32_t value;
+
+	memcpy(&value, p, sizeof(value));
+
+	return value;
+}
+
+static void phoneReceiveRollup(const uint8_t *record, uint8_t length, uint32_t seq) {
+	SB_RollupRecord rollup;
+
+	CHECK(length == sizeof(rollup), "rollup record of the wrong length");
+	CHECK(seq < LOGGED.rollups, "rollup sent that was never logged");
+
+	memcpy(&rollup, record, sizeof(rollup));
+	CHECK(rollup.windowStart == LOGGED.windowStarts[seq], "rollup has the wrong window");
+	CHECK(rollup.channels[0].mean == (uint16_t)seq, "rollup has the wrong values");
+}
+
+static void phoneReceive(const uint8_t *sdu, uint16_t length) {
+	SB_SampleCodec codec;
+	SB_Sample sample;
+	const uint8_t *p;
+	uint32_t seq;
+	uint8_t count, i, recordLength;
+
+	++PHONE.sdus;
+	PHONE.bytes += length;
+
+	switch (sdu[0]) {
+		case SB_HISTORY_MSG_RECORDS:
+			CHECK(length >= SB_HISTORY_RECORDS_HEADER_LEN, "short RECORDS message");
+			CHECK(!PHONE.ended, "RECORDS after END");
+
+			seq = get32(sdu + 1);
+			codec.base = get32(sdu + 5);
+			codec.valid = true;
+			codec.sinceAbsolute = 0;
+			count = sdu[9];
+
+			if (PHONE.haveFirst) {
+				CHECK(seq == PHONE.nextSeq, "records of a download are not consecutive");
+			} else {
+				PHONE.haveFirst = true;
+				PHONE.firstSeq = seq;
+			}
+
+			p = sdu + SB_HISTORY_RECORDS_HEADER_LEN;
+			for (i = 0; i < count; ++i, ++seq) {
+				CHECK(p < sdu + length && p + 1 + p[0] <= sdu + length, "record overruns its SDU");
+
+				if (PHONE.log != SB_HISTORY_LOG_SAMPLES) {
+					CHECK(codec.base == 0, "rollups sent with a base time");
+					phoneReceiveRollup(p + 1, p[0], seq);
+					p += 1 + p[0];
+					continue;
+				}
+
+				CHECK(seq < LOGGED.count, "record sent that was never logged");
+
+				recordLength = SB_sampleDecode(&codec, p + 1, p[0], &sample);
+				CHECK(recordLength == p[0], "record does not decode");
+				CHECK(sample.timestamp == LOGGED.samples[seq].timestamp, "record has the wrong time");
+				CHECK(sample.channels == LOGGED.samples[seq].channels
+						&& memcmp(sample.values, LOGGED.samples[seq].values, sizeof(sample.values)) == 0,
+						"record has the wrong values");
+
+				p += 1 + p[0];
+			}
+			CHECK(p == sdu + length, "RECORDS message longer than its records");
+
+			PHONE.nextSeq = seq;
+			PHONE.records += count;
+			break;
+
+		case SB_HISTORY_MSG_END:
+			CHECK(length == 5, "END message of the wrong length");
+			PHONE.ended = true;
+			PHONE.endSeq = get32(sdu + 1);
+			PHONE.endNs = hostSimNow();
+			break;
+
+		case SB_HISTORY_MSG_ERROR:
+			CHECK(length == 2, "ERROR message of the wrong length");
+			PHONE.error = true;
+			PHONE.errorCode = sdu[1];
+			break;
+
+		default:
+			CHECK(false, "unknown message");
+	}
+}
+
+/**
+ * Sends a request for the given log, leaving the selector out for the sample log. Unless
+ * resuming or asking for a log that does not exist, the phone starts a new download.
+ */
+static void phoneRequestLog(uint8_t opcode, uint32_t argument, uint8_t log) {
+	Work item;
+	l2capSignalCmd_t cmd;
+	uint8_t *payload;
+	uint8_t length = (log == SB_HISTORY_LOG_SAMPLES) ? SB_HISTORY_REQUEST_LEN : SB_HISTORY_REQUEST_LEN + 1;
+
+	CHECK(LINK.peerCredits > 0, "phone has no credit for its request");
+	--LINK.peerCredits;
+
+	if (LINK.peerCredits <= LINK.creditThreshold) {
+		memset(&cmd, 0, sizeof(cmd));
+		cmd.creditEvt.CID = CHANNEL_ID;
+		cmd.creditEvt.credits = LINK.peerCredits;
+		queueSignal(L2CAP_PEER_CREDIT_THRESHOLD_EVT, &cmd);
+	}
+
+	payload = malloc(length);
+	payload[0] = opcode;
+	memcpy(payload + 1, &argument, sizeof(argument));
+	payload[SB_HISTORY_REQUEST_LEN] = log;
+
+	memset(&item, 0, sizeof(item));
+	item.type = WORK_DATA;
+	item.data.pkt.CID = CHANNEL_ID;
+	item.data.pkt.pPayload = payload;
+	item.data.pkt.len = length;
+	queueWork(&item);
+
+	if (opcode != SB_HISTORY_OP_RESUME && opcode != SB_HISTORY_OP_STOP && log < SB_HISTORY_NUM_LOGS) {
+		PHONE.log = log;
+		PHONE.haveFirst = false;
+		PHONE.records = 0;
+		PHONE.bytes = 0;
+		PHONE.sdus = 0;
+	}
+
+	PHONE.ended = false;
+	PHONE.error = false;
+	PHONE.startNs = hostSimNow();
+}
+
+static void phoneRequest(uint8_t opcode, uint32_t argument) {
+	phoneRequestLog(opcode, argument, SB_HISTORY_LOG_SAMPLES);
+}
+
+/*
+ * The link
+ */
+static void connectionEvent(void *arg) {
+	l2capSignalCmd_t cmd;
+	uint16_t frame;
+	uint8_t frames = 0;
+
+	if (!LINK.connected || (uintptr_t)arg != LINK.generation) {
+		return;
+	}
+
+	while (LINK.sdu != NULL && frames < FRAMES_PER_EVENT) {
+		if (LINK.credits == 0) {
+			if (!LINK.outOfCreditSignalled) {
+				LINK.outOfCreditSignalled = true;
+				memset(&cmd, 0, sizeof(cmd));
+				cmd.creditEvt.CID = CHANNEL_ID;
+				queueSignal(L2CAP_OUT_OF_CREDIT_EVT, &cmd);
+			}
+			break;
+		}
+
+		// The first LE-frame of an SDU carries its length
+		frame = (LINK.sent == 0) ? PEER_MPS - SDU_LENGTH_LEN : PEER_MPS;
+		if (frame > LINK.sduLen - LINK.sent) {
+			frame = LINK.sduLen - LINK.sent;
+		}
+
+		LINK.sent += frame;
+		--LINK.credits;
+		++LINK.frames;
+		++frames;
+
+		if (LINK.sent == LINK.sduLen) {
+			phoneReceive(LINK.sdu, LINK.sduLen);
+
+			memset(&cmd, 0, sizeof(cmd));
+			cmd.sendSduDoneEvt.CID = CHANNEL_ID;
+			cmd.sendSduDoneEvt.totalLen = LINK.sduLen;
+			cmd.sendSduDoneEvt.txLen = LINK.sent;
+			queueSignal(L2CAP_SEND_SDU_DONE_EVT, &cmd);
+
+			free(LINK.sdu);
+			LINK.sdu = NULL;
+		}
+	}
+
+	// The phone hands back credits as its app reads the frames
+	LINK.credits += PHONE_CREDITS_PER_EVENT;
+	if (LINK.credits > PHONE_INIT_CREDITS) {
+		LINK.credits = PHONE_INIT_CREDITS;
+	}
+
+	hostSimSchedule(hostSimNow() + CONN_INTERVAL_NS, connectionEvent, arg);
+}
+
+static void linkConnect(void) {
+	l2capSignalCmd_t cmd;
+
+	LINK.connected = true;
+	++LINK.generation;
+	LINK.credits = PHONE_INIT_CREDITS;
+	LINK.peerCredits = SB_HISTORY_PEER_CREDITS;
+
+	memset(&cmd, 0, sizeof(cmd));
+	cmd.channelEstEvt.result = L2CAP_CONN_SUCCESS;
+	cmd.channelEstEvt.CID = CHANNEL_ID;
+	cmd.channelEstEvt.info.psm = SB_HISTORY_PSM;
+	cmd.channelEstEvt.info.peerMtu = PHONE_MTU;
+	cmd.channelEstEvt.info.peerMps = PEER_MPS;
+	cmd.channelEstEvt.info.credits = PHONE_INIT_CREDITS;
+	queueSignal(L2CAP_CHANNEL_ESTABLISHED_EVT, &cmd);
+
+	hostSimSchedule(hostSimNow() + CONN_INTERVAL_NS, connectionEvent, (void*)(uintptr_t)LINK.generation);
+}
+
+static void linkDrop(void) {
+	l2capSignalCmd_t cmd;
+
+	LINK.connected = false;
+	++LINK.generation;
+
+	// The SDU in flight is lost with the link
+	free(LINK.sdu);
+	LINK.sdu = NULL;
+
+	memset(&cmd, 0, sizeof(cmd));
+	cmd.channelTermEvt.CID = CHANNEL_ID;
+	queueSignal(L2CAP_CHANNEL_TERMINATED_EVT, &cmd);
+}
+
+/*
+ * The peripheral manager
+ */
+
+// Closes the window of the last sample. Only what the phone checks is filled in.
+static void logRollup(uint32_t stamp, uint32_t trueTime) {
+	SB_RollupRecord rollup;
+
+	CHECK(LOGGED.rollups < MAX_ROLLUPS, "too many rollups for the test");
+
+	memset(&rollup, 0, sizeof(rollup));
+	rollup.windowStart = stamp - stamp % SB_ROLLUP_MINUTE_SECONDS;
+	rollup.windowSeconds = SB_ROLLUP_MINUTE_SECONDS;
+	rollup.validChannels = 0x01;
+	rollup.channels[0].mean = (uint16_t)LOGGED.rollups;
+
+	CHECK(NoError == SB_flashLogAppend(&SB_minuteRollupLog, (const uint8_t*)&rollup, sizeof(rollup)),
+			"rollup append failed");
+
+	LOGGED.windowStarts[LOGGED.rollups] = rollup.windowStart;
+	LOGGED.windowTrueEnds[LOGGED.rollups] = trueTime;
+	++LOGGED.rollups;
+}
+
+static void logSample(uint32_t stamp, uint32_t trueTime) {
+	SB_Sample *sample = &LOGGED.samples[LOGGED.count];
+	uint8_t record[SB_SAMPLE_MAX_LEN];
+	uint8_t length, i;
+
+	CHECK(LOGGED.count < MAX_RECORDS, "too many records for the test");
+
+	sample->timestamp = stamp;
+	sample->channels = (LOGGED.count % 7 == 0) ? 0x0F : 0x1F;
+	for (i = 0; i < SB_SAMPLE_NUM_CHANNELS; ++i) {
+		sample->values[i] = (sample->channels & (1 << i)) ? (uint16_t)(LOGGED.count * 31 + i * 977) : 0;
+	}
+
+	length = SB_sampleEncode(&LOGGED.codec, sample, record);
+	CHECK(NoError == SB_flashLogAppend(&SB_sampleLog, record, length), "sample append failed");
+
+	LOGGED.trueTimes[LOGGED.count] = trueTime;
+	LOGGED.absolute[LOGGED.count] = SB_sampleIsAbsolute(record);
+	LOGGED.lastStamp = stamp;
+	LOGGED.lastTrueTime = trueTime;
+	++LOGGED.count;
+
+	if (LOGGED.count % ROLLUP_SAMPLES == 0) {
+		logRollup(stamp, trueTime);
+	}
+}
+
+static void appendLive(void) {
+	logSample(LOGGED.lastStamp + SAMPLE_PERIOD_S, LOGGED.lastTrueTime + SAMPLE_PERIOD_S);
+}
+
+static void sampleClock(void *arg) {
+	Work item;
+
+	if (appending) {
+		memset(&item, 0, sizeof(item));
+		item.type = WORK_APPEND;
+		queueWork(&item);
+	}
+
+	hostSimSchedule(hostSimNow() + SAMPLE_PERIOD_NS, sampleClock, NULL);
+}
+
+/**
+ * Logs the timeline: time counted from boot, a sync, the step back of a clock that ran fast,
+ * a reset and a later sync.
+ */
+static void fillLog(void) {
+	uint32_t syncTrue = SYNC_TIME;
+	uint32_t i;
+
+	for (i = 0; i < BOOT_SAMPLES; ++i) {
+		logSample(i * SAMPLE_PERIOD_S, syncTrue - (BOOT_SAMPLES - i) * SAMPLE_PERIOD_S);
+	}
+
+	for (i = 0; i < SYNC_SAMPLES; ++i) {
+		logSample(SYNC_TIME + i * SAMPLE_PERIOD_S,
+				SYNC_TIME + i * SAMPLE_PERIOD_S - (uint32_t)((uint64_t)FAST_S * i / SYNC_SAMPLES));
+	}
+
+	for (i = 0; i < STEP_SAMPLES; ++i) {
+		logSample(LOGGED.lastTrueTime + SAMPLE_PERIOD_S, LOGGED.lastTrueTime + SAMPLE_PERIOD_S);
+	}
+
+	// Counts from boot again, and the codec starts over
+	memset(&LOGGED.codec, 0, sizeof(LOGGED.codec));
+	syncTrue = LOGGED.lastTrueTime;
+	for (i = 0; i < RESET_SAMPLES; ++i) {
+		logSample(i * SAMPLE_PERIOD_S, syncTrue + (i + 1) * SAMPLE_PERIOD_S);
+	}
+
+	for (i = 0; i < RESYNC_SAMPLES; ++i) {
+		logSample(LOGGED.lastTrueTime + SAMPLE_PERIOD_S, LOGGED.lastTrueTime + SAMPLE_PERIOD_S);
+	}
+}
+
+/*
+ * Running the tasks
+ */
+static void runTasks(void) {
+	FlashEmuStats before, after;
+	Work item;
+	uint64_t start;
+
+	while (WORK.count > 0) {
+		item = WORK.items[WORK.first];
+		WORK.first = (WORK.first + 1) % MAX_WORK;
+		--WORK.count;
+
+		switch (item.type) {
+			case WORK_SIGNAL:
+				SB_historyProcessSignal(&item.signal);
+				break;
+
+			case WORK_DATA:
+				flashEmuGetStats(&before);
+				start = hostSimNow();
+				SB_historyProcessData(&item.data);
+				PHONE.requestNs = hostSimNow() - start;
+				flashEmuGetStats(&after);
+				PHONE.requestReads = after.readCommands - before.readCommands;
+				break;
+
+			case WORK_APPEND:
+				appendLive();
+				break;
+		}
+	}
+}
+
+static void runFor(uint64_t ns) {
+	uint64_t end = hostSimNow() + ns;
+
+	runTasks();
+	while (hostSimNow() < end && hostSimRunNext()) {
+		runTasks();
+	}
+}
+
+static void runToEnd(void) {
+	uint64_t deadline = hostSimNow() + DOWNLOAD_TIMEOUT_NS;
+
+	runTasks();
+	while (!PHONE.ended && !PHONE.error && hostSimNow() < deadline && hostSimRunNext()) {
+		runTasks();
+	}
+
+	CHECK(!PHONE.error, "download failed");
+	CHECK(PHONE.ended, "download did not end");
+
+	// Let the END message complete
+	runFor(2 * CONN_INTERVAL_NS);
+	CHECK(!SB_historyIsActive(), "download still active after END");
+}
+
+/*
+ * Checks
+ */
+
+// Whether the search takes the record as before the time, as the history service does
+static bool recordBefore(uint8_t log, uint32_t seq, uint32_t timestamp) {
+	uint32_t time;
+
+	if (log == SB_HISTORY_LOG_SAMPLES) {
+		time = LOGGED.samples[seq].timestamp;
+	} else {
+		time = LOGGED.windowStarts[seq] + SB_ROLLUP_MINUTE_SECONDS - 1;
+	}
+
+	return time >= SB_SYSTEMTIME_SET_MIN && time < timestamp;
+}
+
+// When the record was really logged, or its window really ended
+static uint32_t trueTime(uint8_t log, uint32_t seq) {
+	return (log == SB_HISTORY_LOG_SAMPLES) ? LOGGED.trueTimes[seq] : LOGGED.windowTrueEnds[seq];
+}
+
+// Records at the oldest end of the sample log that cannot be timed, as their absolute record is gone
+static uint32_t firstTimed(uint8_t log, uint32_t seq) {
+	while (log == SB_HISTORY_LOG_SAMPLES && seq < LOGGED.count && !LOGGED.absolute[seq]) {
+		++seq;
+	}
+
+	return seq;
+}
+
+static void checkDownloadEnd(const SB_FlashLog *log) {
+	CHECK(PHONE.endSeq == log->nextRecordSeq, "END is not the head of the log");
+	CHECK(!PHONE.haveFirst || PHONE.nextSeq == PHONE.endSeq, "records missing before END");
+}
+
+static void reportThroughput(const char *name) {
+	SB_HistoryStats stats;
+	double seconds = (PHONE.endNs - PHONE.startNs) / 1e9;
+	double bound = (double)FRAMES_PER_EVENT * PEER_MPS / (CONN_INTERVAL_NS / 1e9);
+	double phoneBound = (double)PHONE_CREDITS_PER_EVENT * PEER_MPS / (CONN_INTERVAL_NS / 1e9);
+
+	SB_historyGetStats(&stats);
+
+	printf("  %-32s %6u records %6.1f KB in %6.2f s: %5.0f B/s (bandage counted %u B/s), "
+			"link %.0f B/s, phone credits %.0f B/s\n",
+			name, PHONE.records, PHONE.bytes / 1024.0, seconds, PHONE.bytes / seconds,
+			stats.lastThroughput, bound, phoneBound);
+}
+
+/**
+ * Downloads the whole log while samples keep being appended.
+ */
+static void checkFullDownload(void) {
+	uint32_t tail = SB_sampleLog.tailFirstRecordSeq;
+	SB_HistoryStats stats;
+
+	appending = true;
+	phoneRequest(SB_HISTORY_OP_FROM_SEQUENCE, 0);
+	runToEnd();
+	appending = false;
+
+	CHECK(PHONE.firstSeq == firstTimed(SB_HISTORY_LOG_SAMPLES, tail), "download did not start at the oldest timed record");
+	checkDownloadEnd(&SB_sampleLog);
+	CHECK(PHONE.records == PHONE.endSeq - PHONE.firstSeq, "record count does not match");
+
+	SB_historyGetStats(&stats);
+	CHECK(stats.outOfCredit > 0, "the phone never ran out of credits");
+	CHECK(stats.lastTransferBytes == PHONE.bytes - 5, "bandage counted other bytes than the phone received");
+
+	reportThroughput("FROM_SEQUENCE 0");
+}
+
+/**
+ * Searches for one timestamp, downloads from there and checks where it started.
+ */
+static void checkTimestamp(const char *name, uint8_t log, uint32_t timestamp) {
+	const SB_FlashLog *flashLog = (log == SB_HISTORY_LOG_SAMPLES) ? &SB_sampleLog : &SB_minuteRollupLog;
+	uint32_t tail = flashLog->tailFirstRecordSeq;
+	uint32_t next = flashLog->nextRecordSeq;
+	uint32_t start, seq, crossings = 0, onlyCrossing = 0;
+
+	phoneRequestLog(SB_HISTORY_OP_FROM_TIMESTAMP, timestamp, log);
+	runToEnd();
+	checkDownloadEnd(flashLog);
+
+	// Records at the tail that cannot be timed are not sent
+	start = PHONE.haveFirst ? PHONE.firstSeq : PHONE.endSeq;
+	if (start == firstTimed(log, tail)) {
+		start = tail;
+	}
+
+	for (seq = tail; seq <= next; ++seq) {
+		if ((seq == tail || recordBefore(log, seq - 1, timestamp))
+				&& (seq == next || !recordBefore(log, seq, timestamp))) {
+			onlyCrossing = seq;
+			++crossings;
+		}
+	}
+
+	CHECK((start == tail || recordBefore(log, start - 1, timestamp))
+			&& (start == next || !recordBefore(log, start, timestamp)),
+			"search did not end where time crosses the timestamp");
+	CHECK(crossings != 1 || start == onlyCrossing, "search missed the only place time crosses the timestamp");
+
+	for (seq = tail; seq < start; ++seq) {
+		CHECK(trueTime(log, seq) < timestamp, "a record logged at or after the timestamp was left out");
+	}
+
+	printf("  %-32s record %5u of %5u-%5u, %u places time crosses it, search %5.1f ms, %4u flash reads\n",
+			name, start, tail, next, crossings, PHONE.requestNs / 1e6, PHONE.requestReads);
+}
+
+static void checkTimestamps(void) {
+	uint32_t firstSync = BOOT_SAMPLES;
+	uint32_t step = BOOT_SAMPLES + SYNC_SAMPLES;
+	uint32_t resync = step + STEP_SAMPLES + RESET_SAMPLES;
+
+	checkTimestamp("before the first sync", SB_HISTORY_LOG_SAMPLES, SYNC_TIME - 1000);
+	checkTimestamp("after the first sync", SB_HISTORY_LOG_SAMPLES, LOGGED.samples[firstSync + SYNC_SAMPLES / 2].timestamp + 1);
+	checkTimestamp("across the step back", SB_HISTORY_LOG_SAMPLES, LOGGED.samples[step].timestamp + 5);
+	checkTimestamp("after the step back", SB_HISTORY_LOG_SAMPLES, LOGGED.samples[step + STEP_SAMPLES / 2].timestamp);
+	checkTimestamp("after the reset", SB_HISTORY_LOG_SAMPLES, LOGGED.samples[resync + RESYNC_SAMPLES / 2].timestamp - 3);
+	checkTimestamp("in the future", SB_HISTORY_LOG_SAMPLES, LOGGED.lastStamp + 1000);
+
+	checkTimestamp("minutes, before the first sync", SB_HISTORY_LOG_MINUTE_ROLLUPS, SYNC_TIME - 1000);
+	checkTimestamp("minutes, after the first sync", SB_HISTORY_LOG_MINUTE_ROLLUPS,
+			LOGGED.samples[firstSync + SYNC_SAMPLES / 2].timestamp + 1);
+	checkTimestamp("minutes, after the step back", SB_HISTORY_LOG_MINUTE_ROLLUPS,
+			LOGGED.samples[step + STEP_SAMPLES / 2].timestamp);
+}
+
+/**
+ * A log that does not exist is refused.
+ */
+static void checkUnknownLog(void) {
+	phoneRequestLog(SB_HISTORY_OP_FROM_SEQUENCE, 0, SB_HISTORY_NUM_LOGS);
+	runFor(4 * CONN_INTERVAL_NS);
+
+	CHECK(PHONE.error && PHONE.errorCode == InvalidParameter, "unknown log not refused");
+	CHECK(!SB_historyIsActive(), "download started from an unknown log");
+}
+
+/**
+ * A request refused while an SDU is in flight is answered once it is sent, and the download
+ * goes on.
+ */
+static void checkErrorDuringDownload(void) {
+	phoneRequest(SB_HISTORY_OP_FROM_SEQUENCE, SB_sampleLog.tailFirstRecordSeq);
+	runFor(20 * CONN_INTERVAL_NS);
+	while (LINK.sdu == NULL) {
+		runFor(CONN_INTERVAL_NS / 2);
+	}
+	CHECK(PHONE.haveFirst && !PHONE.ended, "download not under way");
+
+	phoneRequestLog(SB_HISTORY_OP_FROM_SEQUENCE, 0, SB_HISTORY_NUM_LOGS);
+	runTasks();
+	CHECK(LINK.sdu != NULL, "request not handled while an SDU was in flight");
+
+	runFor(10 * CONN_INTERVAL_NS);
+	CHECK(PHONE.error && PHONE.errorCode == InvalidParameter, "unknown log not refused during a download");
+
+	PHONE.error = false;
+	runToEnd();
+	checkDownloadEnd(&SB_sampleLog);
+}
+
+/**
+ * Drops the link part way through a download and resumes it on a new one.
+ */
+static void checkResume(void) {
+	SB_HistoryStats stats;
+	uint32_t before;
+
+	phoneRequest(SB_HISTORY_OP_FROM_SEQUENCE, SB_sampleLog.tailFirstRecordSeq + 500);
+
+	// Drop it with an SDU part way sent
+	runFor(40 * CONN_INTERVAL_NS);
+	while (LINK.sdu == NULL || LINK.sent == 0) {
+		runFor(CONN_INTERVAL_NS / 2);
+	}
+	CHECK(PHONE.haveFirst && !PHONE.ended, "download ended before the link was dropped");
+
+	before = PHONE.nextSeq;
+	linkDrop();
+	runFor(CONN_INTERVAL_NS);
+	CHECK(!SB_historyIsActive(), "download still active without a link");
+
+	linkConnect();
+	runFor(CONN_INTERVAL_NS);
+	phoneRequest(SB_HISTORY_OP_RESUME, 0);
+	runToEnd();
+
+	CHECK(PHONE.nextSeq > before, "nothing resumed");
+	checkDownloadEnd(&SB_sampleLog);
+
+	SB_historyGetStats(&stats);
+	CHECK(stats.resumes == 1 && stats.aborted >= 1, "resume not counted");
+
+	printf("  resumed at record %u after the link dropped\n", before);
+}
+
+/**
+ * Stops a download. Only the SDU in flight arrives after it.
+ */
+static void checkStop(void) {
+	uint32_t sdus;
+
+	phoneRequest(SB_HISTORY_OP_FROM_SEQUENCE, SB_sampleLog.tailFirstRecordSeq);
+	runFor(20 * CONN_INTERVAL_NS);
+	CHECK(PHONE.haveFirst && !PHONE.ended, "download not under way");
+
+	sdus = PHONE.sdus;
+	phoneRequest(SB_HISTORY_OP_STOP, 0);
+	runFor(50 * CONN_INTERVAL_NS);
+
+	CHECK(PHONE.sdus <= sdus + 1, "records sent after STOP");
+	CHECK(!PHONE.ended && !SB_historyIsActive(), "download did not stop");
+}
+
+int main(int argc, char **argv) {
+	hostSimReset();
+	memset(memory, 0xFF, sizeof(memory));
+	flashEmuInit(memory);
+	snvHostInit(&snv);
+
+	CHECK(NoError == SB_logCryptInit() && NoError == SB_logCryptLoadKey(), "log key not loaded");
+	CHECK(NoError == SB_flashLogInit(&SB_sampleLog, FLASHLOG_SAMPLES_BASE, FLASHLOG_SAMPLES_NUM_SECTORS,
+			FLASHLOG_ENCRYPT_AT_REST), "sample log init failed");
+	CHECK(NoError == SB_flashLogInit(&SB_minuteRollupLog, FLASHLOG_MINUTES_BASE, FLASHLOG_MINUTES_NUM_SECTORS,
+			FLASHLOG_ENCRYPT_AT_REST), "rollup log init failed");
+
+	fillLog();
+	CHECK(SB_sampleLog.tailFirstRecordSeq > 0 && SB_sampleLog.tailFirstRecordSeq < BOOT_SAMPLES,
+			"log did not wrap within the records counted from boot");
+
+	CHECK(NoError == SB_historyInit(0) && LINK.registered, "history service not registered");
+
+	printf("History download over %u byte LE-frames, %u per %.1f ms connection event, phone MTU %u\n",
+			PEER_MPS, FRAMES_PER_EVENT, CONN_INTERVAL_NS / 1e6, PHONE_MTU);
+
+	hostSimSchedule(hostSimNow() + SAMPLE_PERIOD_NS, sampleClock, NULL);
+	linkConnect();
+	runFor(CONN_INTERVAL_NS);
+
+	checkTimestamps();
+	checkUnknownLog();
+	checkFullDownload();
+	checkErrorDuringDownload();
+	checkResume();
+	checkStop();
+
+	printf("PASS\n");
+
+	return 0;
+}
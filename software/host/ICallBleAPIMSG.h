@@ -0,0 +1,2 @@
+// Host stand-in, see l2cap.h
+#include "l2cap.h"
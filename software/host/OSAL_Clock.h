@@ -0,0 +1,9 @@
+// Host stand-in, see bleHost.h
+#ifndef HOST_OSAL_CLOCK_H_
+#define HOST_OSAL_CLOCK_H_
+
+#include "bleHost.h"
+
+typedef uint32 UTCTime;
+
+#endif /* HOST_OSAL_CLOCK_H_ */
@@ -0,0 +1,120 @@
+/*
+ * att.h
+ *
+ * The parts of the stack's ATT and GATT interfaces used by the profile and the live stream,
+ * with the stack's names, values and field layout, so smartBandageProfile.c and liveStream.c
+ * build on a host. gatt.h, gattservapp.h and gatt_uuid.h include this one. The functions are
+ * defined by the test program, which stands in for the stack, the link and the phone.
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef HOST_ATT_H_
+#define HOST_ATT_H_
+
+#include "bleHost.h"
+
+#define ATT_MTU_SIZE					23
+
+#define ATT_HANDLE_VALUE_NOTI			0x1B
+
+#define ATT_ERR_INVALID_HANDLE			0x01
+#define ATT_ERR_READ_NOT_PERMITTED		0x02
+#define ATT_ERR_WRITE_NOT_PERMITTED		0x03
+#define ATT_ERR_INVALID_OFFSET			0x07
+#define ATT_ERR_INSUFFICIENT_AUTHOR		0x08
+#define ATT_ERR_ATTR_NOT_FOUND			0x0A
+#define ATT_ERR_ATTR_NOT_LONG			0x0B
+#define ATT_ERR_INVALID_VALUE_SIZE		0x0D
+
+// Attribute permissions
+#define GATT_PERMIT_READ				0x01
+#define GATT_PERMIT_WRITE				0x02
+#define GATT_PERMIT_AUTHEN_READ			0x04
+#define GATT_PERMIT_AUTHEN_WRITE		0x08
+#define GATT_PERMIT_AUTHOR_READ			0x10
+#define GATT_PERMIT_AUTHOR_WRITE		0x20
+
+#define gattPermitAuthorRead(a)			((a) & GATT_PERMIT_AUTHOR_READ)
+#define gattPermitAuthorWrite(a)		((a) & GATT_PERMIT_AUTHOR_WRITE)
+
+// Characteristic properties
+#define GATT_PROP_READ					0x02
+#define GATT_PROP_WRITE_NO_RSP			0x04
+#define GATT_PROP_WRITE					0x08
+#define GATT_PROP_NOTIFY				0x10
+
+#define GATT_CLIENT_CFG_NOTIFY			0x0001
+#define GATT_CFG_NO_OPERATION			0x0000
+
+#define GATT_MAX_ENCRYPT_KEY_SIZE		16
+
+// Attribute types
+#define GATT_PRIMARY_SERVICE_UUID		0x2800
+#define GATT_CHARACTER_UUID				0x2803
+#define GATT_CHAR_USER_DESC_UUID		0x2901
+#define GATT_CLIENT_CHAR_CFG_UUID		0x2902
+
+#define GATT_NUM_ATTRS(attrs)			(sizeof(attrs) / sizeof(gattAttribute_t))
+
+typedef struct {
+	uint16 handle;
+	uint16 len;
+	uint8 *pValue;
+} attHandleValueNoti_t;
+
+typedef union {
+	attHandleValueNoti_t handleValueNoti;
+} gattMsg_t;
+
+typedef struct {
+	uint8 len;
+	const uint8 *uuid;
+} gattAttrType_t;
+
+typedef struct attAttribute_t {
+	gattAttrType_t type;
+	uint8 permissions;
+	uint16 handle;
+	uint8 * const pValue;
+} gattAttribute_t;
+
+typedef struct {
+	uint16 connHandle;
+	uint8 value;
+} gattCharCfg_t;
+
+typedef bStatus_t (*pfnGATTReadAttrCB_t)(uint16 connHandle, gattAttribute_t *pAttr, uint8 *pValue,
+		uint16 *pLen, uint16 offset, uint16 maxLen, uint8 method);
+typedef bStatus_t (*pfnGATTWriteAttrCB_t)(uint16 connHandle, gattAttribute_t *pAttr, uint8 *pValue,
+		uint16 len, uint16 offset, uint8 method);
+typedef bStatus_t (*pfnGATTAuthorizeAttrCB_t)(uint16 connHandle, gattAttribute_t *pAttr, uint8 opcode);
+
+typedef struct {
+	pfnGATTReadAttrCB_t pfnReadAttrCB;
+	pfnGATTWriteAttrCB_t pfnWriteAttrCB;
+	pfnGATTAuthorizeAttrCB_t pfnAuthorizeAttrCB;
+} gattServiceCBs_t;
+
+extern const uint8 primaryServiceUUID[ATT_BT_UUID_SIZE];
+extern const uint8 characterUUID[ATT_BT_UUID_SIZE];
+extern const uint8 charUserDescUUID[ATT_BT_UUID_SIZE];
+extern const uint8 clientCharCfgUUID[ATT_BT_UUID_SIZE];
+
+uint16 ATT_GetMTU(uint16 connHandle);
+
+void *GATT_bm_alloc(uint16 connHandle, uint8 opcode, uint16 size, uint16 *pSizeAlloc);
+void GATT_bm_free(gattMsg_t *pMsg, uint8 opcode);
+bStatus_t GATT_Notification(uint16 connHandle, attHandleValueNoti_t *pNoti, uint8 authenticated);
+
+bStatus_t GATTServApp_RegisterService(gattAttribute_t *pAttrs, uint16 numAttrs, uint8 encKeySize,
+		const gattServiceCBs_t *pServiceCBs);
+gattAttribute_t *GATTServApp_FindAttr(gattAttribute_t *pAttrTbl, uint16 numAttrs, uint8 *pValue);
+void GATTServApp_InitCharCfg(uint16 connHandle, gattCharCfg_t *charCfgTbl);
+uint16 GATTServApp_ReadCharCfg(uint16 connHandle, gattCharCfg_t *charCfgTbl);
+bStatus_t GATTServApp_ProcessCCCWriteReq(uint16 connHandle, gattAttribute_t *pAttr, uint8 *pValue,
+		uint16 len, uint16 offset, uint16 validCfg);
+bStatus_t GATTServApp_ProcessCharCfg(gattCharCfg_t *charCfgTbl, uint8 *pValue, uint8 authenticated,
+		gattAttribute_t *attrTbl, uint16 numAttrs, uint8 taskId, pfnGATTReadAttrCB_t pfnReadAttrCB);
+
+#endif /* HOST_ATT_H_ */
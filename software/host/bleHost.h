@@ -0,0 +1,58 @@
+/*
+ * bleHost.h
+ *
+ * The parts of the BLE stack seen by the application modules through bcomdef.h and the
+ * application headers, so they build on a host. The stack headers in this directory include
+ * this one.
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef HOST_BLEHOST_H_
+#define HOST_BLEHOST_H_
+
+#include <xdc/std.h>
+#include <string.h>
+
+typedef uint8_t uint8;
+typedef uint16_t uint16;
+typedef uint32_t uint32;
+typedef int8_t int8;
+typedef int16_t int16;
+typedef int32_t int32;
+typedef uint8_t bStatus_t;
+
+#define SUCCESS 0
+#define FAILURE 1
+#define MSG_BUFFER_NOT_AVAIL 0x04
+#define bleAlreadyInRequestedMode 0x11
+#define bleIncorrectMode 0x12
+#define bleNotConnected 0x14
+#define blePending 0x16
+#define bleInvalidRange 0x18
+#define TRUE 1
+#define FALSE 0
+
+#define CONST const
+#define VOID (void)
+
+#define LO_UINT16(a) ((a) & 0xFF)
+#define HI_UINT16(a) (((a) >> 8) & 0xFF)
+#define BUILD_UINT16(loByte, hiByte) ((uint16)(((loByte) & 0x00FF) + (((hiByte) & 0x00FF) << 8)))
+
+#define INVALID_TASK_ID 0xFF
+
+#define ATT_BT_UUID_SIZE 2
+#define ATT_UUID_SIZE 16
+#define B_ADDR_LEN 6
+#define INVALID_CONNHANDLE 0xFFFF
+
+// SNV items free for the application
+#define BLE_NVID_CUST_START 0x80
+#define BLE_NVID_CUST_END 0x8F
+
+#ifndef MAX_NUM_BLE_CONNS
+#define MAX_NUM_BLE_CONNS 1
+#endif
+
+#endif /* HOST_BLEHOST_H_ */
@@ -0,0 +1,27 @@
+/*
+ * boardHost.h
+ *
+ * Board definitions used by the external flash driver, which come from the board file of the
+ * SensorTag rather than from Application/Board.h. Included through the PIN driver stand-in.
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef HOST_BOARDHOST_H_
+#define HOST_BOARDHOST_H_
+
+#include "rtosHost.h"
+
+#define Board_SPI0				0
+#define Board_SPI0_MISO			IOID_18
+#define Board_SPI0_MOSI			IOID_19
+#define Board_SPI0_CLK			IOID_17
+#define Board_SPI_FLASH_CS		IOID_20
+#define Board_FLASH_CS_ON		0
+#define Board_FLASH_CS_OFF		1
+
+// W25X20CL manufacturer and device IDs
+#define EXT_FLASH_MAN_ID		0xEF
+#define EXT_FLASH_DEV_ID		0x11
+
+#endif /* HOST_BOARDHOST_H_ */
@@ -0,0 +1,173 @@
+/*
+ * cryptoHost.c
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#include <string.h>
+
+#include "hostSim.h"
+#include "cryptoHost.h"
+
+#define AES_ROUNDS		10
+
+static const uint8_t sbox[256] = {
+	0x63, 0x7C, 0x77, 0x7B, 0xF2, 0x6B, 0x6F, 0xC5, 0x30, 0x01, 0x67, 0x2B, 0xFE, 0xD7, 0xAB, 0x76,
+	0xCA, 0x82, 0xC9, 0x7D, 0xFA, 0x59, 0x47, 0xF0, 0xAD, 0xD4, 0xA2, 0xAF, 0x9C, 0xA4, 0x72, 0xC0,
+	0xB7, 0xFD, 0x93, 0x26, 0x36, 0x3F, 0xF7, 0xCC, 0x34, 0xA5, 0xE5, 0xF1, 0x71, 0xD8, 0x31, 0x15,
+	0x04, 0xC7, 0x23, 0xC3, 0x18, 0x96, 0x05, 0x9A, 0x07, 0x12, 0x80, 0xE2, 0xEB, 0x27, 0xB2, 0x75,
+	0x09, 0x83, 0x2C, 0x1A, 0x1B, 0x6E, 0x5A, 0xA0, 0x52, 0x3B, 0xD6, 0xB3, 0x29, 0xE3, 0x2F, 0x84,
+	0x53, 0xD1, 0x00, 0xED, 0x20, 0xFC, 0xB1, 0x5B, 0x6A, 0xCB, 0xBE, 0x39, 0x4A, 0x4C, 0x58, 0xCF,
+	0xD0, 0xEF, 0xAA, 0xFB, 0x43, 0x4D, 0x33, 0x85, 0x45, 0xF9, 0x02, 0x7F, 0x50, 0x3C, 0x9F, 0xA8,
+	0x51, 0xA3, 0x40, 0x8F, 0x92, 0x9D, 0x38, 0xF5, 0xBC, 0xB6, 0xDA, 0x21, 0x10, 0xFF, 0xF3, 0xD2,
+	0xCD, 0x0C, 0x13, 0xEC, 0x5F, 0x97, 0x44, 0x17, 0xC4, 0xA7, 0x7E, 0x3D, 0x64, 0x5D, 0x19, 0x73,
+	0x60, 0x81, 0x4F, 0xDC, 0x22, 0x2A, 0x90, 0x88, 0x46, 0xEE, 0xB8, 0x14, 0xDE, 0x5E, 0x0B, 0xDB,
+	0xE0, 0x32, 0x3A, 0x0A, 0x49, 0x06, 0x24, 0x5C, 0xC2, 0xD3, 0xAC, 0x62, 0x91, 0x95, 0xE4, 0x79,
+	0xE7, 0xC8, 0x37, 0x6D, 0x8D, 0xD5, 0x4E, 0xA9, 0x6C, 0x56, 0xF4, 0xEA, 0x65, 0x7A, 0xAE, 0x08,
+	0xBA, 0x78, 0x25, 0x2E, 0x1C, 0xA6, 0xB4, 0xC6, 0xE8, 0xDD, 0x74, 0x1F, 0x4B, 0xBD, 0x8B, 0x8A,
+	0x70, 0x3E, 0xB5, 0x66, 0x48, 0x03, 0xF6, 0x0E, 0x61, 0x35, 0x57, 0xB9, 0x86, 0xC1, 0x1D, 0x9E,
+	0xE1, 0xF8, 0x98, 0x11, 0x69, 0xD9, 0x8E, 0x94, 0x9B, 0x1E, 0x87, 0xE9, 0xCE, 0x55, 0x28, 0xDF,
+	0x8C, 0xA1, 0x89, 0x0D, 0xBF, 0xE6, 0x42, 0x68, 0x41, 0x99, 0x2D, 0x0F, 0xB0, 0x54, 0xBB, 0x16
+};
+
+static struct {
+	CryptoCC26XX_Object object;
+	uint64_t blockNs;
+	uint32_t blocks;
+} CRYPTO = { .blockNs = CRYPTOHOST_DEFAULT_BLOCK_NS };
+
+static uint8_t xtime(uint8_t x) {
+	return (uint8_t)((x << 1) ^ ((x & 0x80) ? 0x1B : 0x00));
+}
+
+static void expandKey(const uint8_t *key, uint8_t roundKeys[AES_ROUNDS + 1][16]) {
+	uint8_t rcon = 0x01, t[4];
+	uint8_t i, j;
+
+	memcpy(roundKeys[0], key, 16);
+
+	for (i = 1; i <= AES_ROUNDS; ++i) {
+		// RotWord, SubWord and the round constant on the last word of the previous round key
+		t[0] = sbox[roundKeys[i - 1][13]] ^ rcon;
+		t[1] = sbox[roundKeys[i - 1][14]];
+		t[2] = sbox[roundKeys[i - 1][15]];
+		t[3] = sbox[roundKeys[i - 1][12]];
+		rcon = xtime(rcon);
+
+		for (j = 0; j < 16; ++j) {
+			roundKeys[i][j] = roundKeys[i - 1][j] ^ ((j < 4) ? t[j] : roundKeys[i][j - 4]);
+		}
+	}
+}
+
+void cryptoHostEncryptBlock(const uint32_t *key, const uint8_t *in, uint8_t *out) {
+	uint8_t roundKeys[AES_ROUNDS + 1][16];
+	uint8_t state[16], shifted[16], a, b, c, d;
+	uint8_t round, i;
+
+	expandKey((const uint8_t *)key, roundKeys);
+
+	for (i = 0; i < 16; ++i) {
+		state[i] = in[i] ^ roundKeys[0][i];
+	}
+
+	for (round = 1; round <= AES_ROUNDS; ++round) {
+		// SubBytes and ShiftRows. The state is stored column by column.
+		for (i = 0; i < 16; ++i) {
+			shifted[i] = sbox[state[(i + 4 * (i % 4)) % 16]];
+		}
+
+		// MixColumns, except in the last round
+		for (i = 0; i < 16; i += 4) {
+			a = shifted[i];
+			b = shifted[i + 1];
+			c = shifted[i + 2];
+			d = shifted[i + 3];
+
+			if (round == AES_ROUNDS) {
+				state[i] = a;
+				state[i + 1] = b;
+				state[i + 2] = c;
+				state[i + 3] = d;
+			} else {
+				state[i] = xtime(a) ^ xtime(b) ^ b ^ c ^ d;
+				state[i + 1] = a ^ xtime(b) ^ xtime(c) ^ c ^ d;
+				state[i + 2] = a ^ b ^ xtime(c) ^ xtime(d) ^ d;
+				state[i + 3] = xtime(a) ^ a ^ b ^ c ^ xtime(d);
+			}
+		}
+
+		for (i = 0; i < 16; ++i) {
+			state[i] ^= roundKeys[round][i];
+		}
+	}
+
+	memcpy(out, state, 16);
+}
+
+void cryptoHostSetBlockTime(uint64_t ns) {
+	CRYPTO.blockNs = ns;
+}
+
+uint32_t cryptoHostTakeBlockCount(void) {
+	uint32_t blocks = CRYPTO.blocks;
+
+	CRYPTO.blocks = 0;
+
+	return blocks;
+}
+
+void CryptoCC26XX_init(void) { }
+
+CryptoCC26XX_Handle CryptoCC26XX_open(unsigned int index, bool exclusiveAccess, CryptoCC26XX_Params *params) {
+	memset(&CRYPTO.object, 0, sizeof(CRYPTO.object));
+
+	return &CRYPTO.object;
+}
+
+int CryptoCC26XX_allocateKey(CryptoCC26XX_Handle handle, CryptoCC26XX_KeyLocation location, const uint32_t *key) {
+	int i;
+
+	for (i = 0; i < CRYPTOHOST_NUM_KEYS; ++i) {
+		if (!handle->allocated[i]) {
+			handle->allocated[i] = true;
+			memcpy(handle->keys[i], key, sizeof(handle->keys[i]));
+			return i;
+		}
+	}
+
+	return CRYPTOCC26XX_STATUS_ERROR;
+}
+
+int CryptoCC26XX_releaseKey(CryptoCC26XX_Handle handle, int *keyIndex) {
+	if (*keyIndex < 0 || *keyIndex >= CRYPTOHOST_NUM_KEYS || !handle->allocated[*keyIndex]) {
+		return CRYPTOCC26XX_STATUS_ERROR;
+	}
+
+	handle->allocated[*keyIndex] = false;
+	memset(handle->keys[*keyIndex], 0, sizeof(handle->keys[*keyIndex]));
+	*keyIndex = CRYPTOCC26XX_STATUS_ERROR;
+
+	return CRYPTOCC26XX_STATUS_SUCCESS;
+}
+
+void CryptoCC26XX_Transac_init(CryptoCC26XX_Transaction *transaction, CryptoCC26XX_Operation opType) {
+	memset(transaction, 0, sizeof(CryptoCC26XX_Transaction));
+	transaction->opType = opType;
+	transaction->mode = CRYPTOCC26XX_MODE_POLLING;
+}
+
+int CryptoCC26XX_transactPolling(CryptoCC26XX_Handle handle, CryptoCC26XX_Transaction *transaction) {
+	if (transaction->opType != CRYPTOCC26XX_OP_AES_ECB_ENCRYPT
+			|| transaction->keyIndex >= CRYPTOHOST_NUM_KEYS || !handle->allocated[transaction->keyIndex]) {
+		return CRYPTOCC26XX_STATUS_ERROR;
+	}
+
+	cryptoHostEncryptBlock(handle->keys[transaction->keyIndex], transaction->msgIn, transaction->msgOut);
+
+	// The CPU polls the engine for the whole transaction
+	hostSimSpend(CRYPTO.blockNs);
+	++CRYPTO.blocks;
+
+	return CRYPTOCC26XX_STATUS_SUCCESS;
+}
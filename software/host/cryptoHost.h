@@ -0,0 +1,71 @@
+/*
+ * cryptoHost.h
+ *
+ * The parts of the TI crypto driver seen by logCrypt.c, so it builds on a host. AES is done in
+ * software. Each polled transaction spends the time the driver and the AES engine of the
+ * CC26xx would take, in simulated time, see hostSim.h.
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef HOST_CRYPTOHOST_H_
+#define HOST_CRYPTOHOST_H_
+
+#include "rtosHost.h"
+
+// Assumed cost of one polled AES-ECB block through the driver, most of it driver overhead
+#define CRYPTOHOST_DEFAULT_BLOCK_NS		25000
+
+#define CRYPTOHOST_NUM_KEYS				8
+
+#define CRYPTOCC26XX_STATUS_SUCCESS		0
+#define CRYPTOCC26XX_STATUS_ERROR		(-1)
+
+typedef enum {
+	CRYPTOCC26XX_KEY_0,
+	CRYPTOCC26XX_KEY_ANY = 0xFF
+} CryptoCC26XX_KeyLocation;
+
+typedef enum {
+	CRYPTOCC26XX_OP_AES_ECB_ENCRYPT,
+	CRYPTOCC26XX_OP_AES_ECB_DECRYPT
+} CryptoCC26XX_Operation;
+
+typedef enum { CRYPTOCC26XX_MODE_POLLING } CryptoCC26XX_Mode;
+
+typedef struct {
+	CryptoCC26XX_Operation opType;
+	CryptoCC26XX_Mode mode;
+	uint8_t keyIndex;
+	void *msgIn;
+	void *msgOut;
+} CryptoCC26XX_AESECB_Transaction;
+
+typedef CryptoCC26XX_AESECB_Transaction CryptoCC26XX_Transaction;
+
+typedef struct { int unused; } CryptoCC26XX_Params;
+
+typedef struct {
+	uint32_t keys[CRYPTOHOST_NUM_KEYS][4];
+	bool allocated[CRYPTOHOST_NUM_KEYS];
+} CryptoCC26XX_Object;
+
+typedef CryptoCC26XX_Object *CryptoCC26XX_Handle;
+
+void CryptoCC26XX_init(void);
+CryptoCC26XX_Handle CryptoCC26XX_open(unsigned int index, bool exclusiveAccess, CryptoCC26XX_Params *params);
+int CryptoCC26XX_allocateKey(CryptoCC26XX_Handle handle, CryptoCC26XX_KeyLocation location, const uint32_t *key);
+int CryptoCC26XX_releaseKey(CryptoCC26XX_Handle handle, int *keyIndex);
+void CryptoCC26XX_Transac_init(CryptoCC26XX_Transaction *transaction, CryptoCC26XX_Operation opType);
+int CryptoCC26XX_transactPolling(CryptoCC26XX_Handle handle, CryptoCC26XX_Transaction *transaction);
+
+// AES-128 of one block, without the cost of a transaction
+void cryptoHostEncryptBlock(const uint32_t *key, const uint8_t *in, uint8_t *out);
+
+// Simulated time spent per AES block
+void cryptoHostSetBlockTime(uint64_t ns);
+
+// AES blocks encrypted through transactions since the last call
+uint32_t cryptoHostTakeBlockCount(void);
+
+#endif /* HOST_CRYPTOHOST_H_ */
@@ -0,0 +1,383 @@
+/*
+ * flashEmulator.c
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#include <string.h>
+#include <unistd.h>
+
+#include "boardHost.h"
+#include "spiHost.h"
+#include "flashEmulator.h"
+
+// Instructions of the W25X20CL decoded here
+#define CODE_PROGRAM		0x02
+#define CODE_READ			0x03
+#define CODE_READ_STATUS	0x05
+#define CODE_WRITE_ENABLE	0x06
+#define CODE_FAST_READ		0x0B
+#define CODE_SECTOR_ERASE	0x20
+#define CODE_MDID			0x90
+#define CODE_RDP			0xAB
+#define CODE_DP				0xB9
+
+#define STATUS_WIP			0x01
+#define STATUS_WEL			0x02
+
+// The SPI driver clocks this out when a transfer has no transmit buffer
+#define DEFAULT_TX_VALUE	0x00
+
+static struct {
+	uint8_t *memory;
+
+	// Bus
+	SPI_Config config;
+	SPICC26XX_HWAttrs hwAttrs;
+	SPI_CallbackFxn callback;
+	SPI_TransferMode transferMode;
+	uint64_t byteNs;
+	uint64_t busFreeAt;			// End of the last transfer handed to the DMA
+	SPI_Transaction *pending;
+
+	// Instruction clocked in since the part was selected
+	bool selected;
+	uint8_t opcode;
+	uint32_t position;
+	uint32_t address;
+	bool ignored;
+
+	// Data of a page program, applied when the part is deselected
+	uint8_t page[FLASHEMU_PAGE_SIZE];
+	uint16_t order[FLASHEMU_PAGE_SIZE];
+	uint16_t programmed;
+
+	// Part state
+	uint64_t busyUntil;
+	bool writeEnabled;
+	bool poweredDown;
+
+	// Power cut
+	bool cutArmed;
+	uint32_t cutCountdown;
+	FlashEmuCutMode cutMode;
+	uint32_t random;
+	void (*cutHook)(void);
+
+	FlashEmuStats stats;
+} EMU;
+
+static void powerCut(void) {
+	_exit(FLASHEMU_POWER_CUT_EXIT);
+}
+
+void flashEmuInit(uint8_t *memory) {
+	memset(&EMU, 0, sizeof(EMU));
+	EMU.memory = memory;
+	EMU.config.hwAttrs = &EMU.hwAttrs;
+	EMU.cutHook = powerCut;
+}
+
+void flashEmuGetStats(FlashEmuStats *stats) {
+	*stats = EMU.stats;
+}
+
+void flashEmuResetStats(void) {
+	memset(&EMU.stats, 0, sizeof(EMU.stats));
+}
+
+void flashEmuCutPower(uint32_t operations, FlashEmuCutMode mode, uint32_t seed) {
+	EMU.cutArmed = true;
+	EMU.cutCountdown = operations;
+	EMU.cutMode = mode;
+	EMU.random = seed ? seed : 1;
+}
+
+void flashEmuOnPowerCut(void (*hook)(void)) {
+	EMU.cutHook = hook;
+}
+
+static uint32_t nextRandom(void) {
+	EMU.random ^= EMU.random << 13;
+	EMU.random ^= EMU.random >> 17;
+	EMU.random ^= EMU.random << 5;
+	return EMU.random;
+}
+
+static bool busy(void) {
+	return hostSimNow() < EMU.busyUntil;
+}
+
+// True if power is cut during this operation, which the caller then leaves torn
+static bool cutNow(void) {
+	if (!EMU.cutArmed) {
+		return false;
+	}
+
+	if (EMU.cutCountdown > 0) {
+		--EMU.cutCountdown;
+		return false;
+	}
+
+	EMU.cutArmed = false;
+	return true;
+}
+
+/*
+ * Program and erase, started when the part is deselected
+ */
+static void program(void) {
+	uint32_t base = EMU.address & ~(uint32_t)(FLASHEMU_PAGE_SIZE - 1);
+	uint16_t count = EMU.programmed, i;
+	bool torn = cutNow();
+
+	if (torn) {
+		count = (EMU.cutMode == FLASHEMU_CUT_BYTE) ? nextRandom() % (EMU.programmed + 1) : 0;
+	}
+
+	// Programming only ever clears bits
+	for (i = 0; i < count; ++i) {
+		EMU.memory[base + EMU.order[i]] &= EMU.page[EMU.order[i]];
+	}
+
+	++EMU.stats.programs;
+	EMU.stats.programBytes += EMU.programmed;
+	EMU.stats.busyNs += FLASHEMU_PROGRAM_NS;
+	EMU.busyUntil = hostSimNow() + FLASHEMU_PROGRAM_NS;
+
+	if (torn) {
+		EMU.cutHook();
+	}
+}
+
+static void erase(void) {
+	uint32_t base = EMU.address & ~(uint32_t)(FLASHEMU_SECTOR_SIZE - 1);
+	uint32_t pages, chance, i;
+
+	if (!cutNow()) {
+		memset(&EMU.memory[base], 0xFF, FLASHEMU_SECTOR_SIZE);
+	} else if (EMU.cutMode == FLASHEMU_CUT_PAGE) {
+		pages = nextRandom() % (FLASHEMU_SECTOR_SIZE / FLASHEMU_PAGE_SIZE);
+		memset(&EMU.memory[base], 0xFF, pages * FLASHEMU_PAGE_SIZE);
+		EMU.cutHook();
+	} else {
+		// Cells erase unevenly: a random share of the bytes, the others keeping some bits
+		chance = nextRandom() % 100;
+		for (i = 0; i < FLASHEMU_SECTOR_SIZE; ++i) {
+			if (nextRandom() % 100 < chance) {
+				EMU.memory[base + i] = 0xFF;
+			} else {
+				EMU.memory[base + i] |= nextRandom() & 0xFF;
+			}
+		}
+		EMU.cutHook();
+	}
+
+	++EMU.stats.erases;
+	EMU.stats.busyNs += FLASHEMU_ERASE_NS;
+	EMU.busyUntil = hostSimNow() + FLASHEMU_ERASE_NS;
+}
+
+static void deselect(void) {
+	if (!EMU.selected) {
+		return;
+	}
+
+	EMU.selected = false;
+
+	if (EMU.ignored) {
+		return;
+	}
+
+	switch (EMU.opcode) {
+	case CODE_WRITE_ENABLE:
+		EMU.writeEnabled = true;
+		break;
+	case CODE_PROGRAM:
+		if (EMU.writeEnabled && EMU.position > 4) {
+			EMU.writeEnabled = false;
+			program();
+		}
+		break;
+	case CODE_SECTOR_ERASE:
+		if (EMU.writeEnabled && EMU.position == 4) {
+			EMU.writeEnabled = false;
+			erase();
+		}
+		break;
+	case CODE_DP:
+		EMU.poweredDown = true;
+		break;
+	case CODE_RDP:
+		EMU.poweredDown = false;
+		break;
+	}
+}
+
+static void select(void) {
+	EMU.selected = true;
+	EMU.opcode = 0;
+	EMU.position = 0;
+	EMU.address = 0;
+	EMU.ignored = false;
+	EMU.programmed = 0;
+	memset(EMU.page, 0xFF, sizeof(EMU.page));
+
+	++EMU.stats.commands;
+}
+
+// Clocks one byte in and returns the byte clocked out
+static uint8_t clockByte(uint8_t in) {
+	uint32_t position = EMU.position++;
+	uint8_t offset;
+
+	if (position == 0) {
+		EMU.opcode = in;
+
+		if (EMU.poweredDown && in != CODE_RDP) {
+			EMU.ignored = true;
+		} else if (busy() && in != CODE_READ_STATUS) {
+			EMU.ignored = true;
+			++EMU.stats.busyViolations;
+		} else if (in == CODE_READ || in == CODE_FAST_READ) {
+			++EMU.stats.readCommands;
+		} else if (in == CODE_READ_STATUS) {
+			++EMU.stats.statusReads;
+		}
+
+		return 0xFF;
+	}
+
+	if (EMU.ignored) {
+		return 0xFF;
+	}
+
+	// 24 bit address, most significant byte first
+	if (position <= 3 && EMU.opcode != CODE_READ_STATUS && EMU.opcode != CODE_WRITE_ENABLE) {
+		EMU.address = (EMU.address << 8) | in;
+		return 0xFF;
+	}
+
+	switch (EMU.opcode) {
+	case CODE_READ_STATUS:
+		return (busy() ? STATUS_WIP : 0) | (EMU.writeEnabled ? STATUS_WEL : 0);
+
+	case CODE_READ:
+	case CODE_FAST_READ:
+		// Fast read clocks one dummy byte after the address
+		if (EMU.opcode == CODE_FAST_READ && position == 4) {
+			return 0xFF;
+		}
+		++EMU.stats.readBytes;
+		return EMU.memory[EMU.address++ % FLASHEMU_SIZE];
+
+	case CODE_PROGRAM:
+		// Data wraps within the program page
+		offset = (EMU.address + EMU.programmed) & (FLASHEMU_PAGE_SIZE - 1);
+		if (EMU.programmed < FLASHEMU_PAGE_SIZE) {
+			EMU.order[EMU.programmed++] = offset;
+		}
+		EMU.page[offset] &= in;
+		return 0xFF;
+
+	case CODE_MDID:
+		return (position == 4) ? EXT_FLASH_MAN_ID : (position == 5) ? EXT_FLASH_DEV_ID : 0xFF;
+
+	default:
+		return 0xFF;
+	}
+}
+
+/*
+ * PIN driver: only the chip select of the flash is wired
+ */
+PIN_Handle PIN_open(PIN_State *state, const PIN_Config pinList[]) {
+	return state;
+}
+
+void PIN_close(PIN_Handle handle) { }
+
+int PIN_setOutputValue(PIN_Handle handle, PIN_Id pin, uint32_t value) {
+	if (pin == Board_SPI_FLASH_CS) {
+		if (value == Board_FLASH_CS_ON) {
+			select();
+		} else {
+			deselect();
+		}
+	}
+
+	return 0;
+}
+
+/*
+ * SPI driver
+ */
+void SPI_Params_init(SPI_Params *params) {
+	memset(params, 0, sizeof(SPI_Params));
+	params->transferMode = SPI_MODE_BLOCKING;
+	params->mode = SPI_MASTER;
+	params->bitRate = 1000000;
+	params->dataSize = 8;
+}
+
+SPI_Handle SPI_open(unsigned int index, SPI_Params *params) {
+	EMU.callback = params->transferCallbackFxn;
+	EMU.transferMode = params->transferMode;
+	EMU.byteNs = 8000000000ULL / params->bitRate;
+	EMU.busFreeAt = hostSimNow();
+
+	return &EMU.config;
+}
+
+void SPI_close(SPI_Handle handle) { }
+
+static void transferDone(void *arg) {
+	SPI_Transaction *transaction = arg;
+
+	EMU.pending = NULL;
+	transaction->status = SPI_TRANSFER_COMPLETED;
+	EMU.callback(&EMU.config, transaction);
+}
+
+bool SPI_transfer(SPI_Handle handle, SPI_Transaction *transaction) {
+	const uint8_t *tx = transaction->txBuf;
+	uint8_t *rx = transaction->rxBuf;
+	uint64_t start = hostSimNow();
+	uint8_t out;
+	size_t i;
+
+	if (EMU.pending != NULL || transaction->count == 0) {
+		return false;
+	}
+
+	++EMU.stats.transactions;
+
+	// The bytes are exchanged as the transfer starts, which only matters to the busy bit
+	for (i = 0; i < transaction->count; ++i) {
+		out = EMU.selected ? clockByte(tx ? tx[i] : DEFAULT_TX_VALUE) : 0xFF;
+		if (rx != NULL) {
+			rx[i] = out;
+		}
+	}
+
+	if (EMU.busFreeAt > start) {
+		start = EMU.busFreeAt;
+	}
+	EMU.busFreeAt = start + FLASHEMU_DMA_SETUP_NS + transaction->count * EMU.byteNs;
+
+	if (EMU.transferMode == SPI_MODE_BLOCKING) {
+		hostSimSpend(EMU.busFreeAt - hostSimNow());
+		transaction->status = SPI_TRANSFER_COMPLETED;
+		return true;
+	}
+
+	EMU.pending = transaction;
+	transaction->status = SPI_TRANSFER_STARTED;
+	hostSimSchedule(EMU.busFreeAt, transferDone, transaction);
+
+	return true;
+}
+
+bool SSIBusy(uint32_t base) {
+	return false;
+}
@@ -0,0 +1,64 @@
+/*
+ * flashEmulator.h
+ *
+ * A W25X20CL on the SPI bus, for host builds of bsp_spi.c and ext_flash.c. It decodes the
+ * instructions clocked in between chip select edges, keeps its contents in memory given by the
+ * test, and takes as long as the part would: SPI transfers at the configured bit rate plus a
+ * fixed setup per DMA transaction, and typical page program and sector erase times during
+ * which the busy bit is set. Instructions other than a status read sent while the part is busy
+ * are ignored, as by the part, and counted.
+ *
+ * Power can be cut during a chosen program or erase. The operation is left torn at byte or
+ * page granularity and the hook given by the test is called, by default ending the process so
+ * that a parent can boot a fresh one on the same memory.
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef HOST_FLASHEMULATOR_H_
+#define HOST_FLASHEMULATOR_H_
+
+#include "hostSim.h"
+
+// Covers the whole external flash layout, which reaches past the 256 KB of the W25X20CL
+#define FLASHEMU_SIZE				0x80000
+#define FLASHEMU_SECTOR_SIZE		4096
+#define FLASHEMU_PAGE_SIZE			256
+
+// Typical times of the W25X20CL, and the cost of setting up one UDMA transaction
+#define FLASHEMU_PROGRAM_NS			700000
+#define FLASHEMU_ERASE_NS			30000000
+#define FLASHEMU_DMA_SETUP_NS		4000
+
+// Exit status of a process ended by a power cut
+#define FLASHEMU_POWER_CUT_EXIT		42
+
+typedef enum {
+	FLASHEMU_CUT_PAGE,				// A torn program is lost; a torn erase clears whole program pages
+	FLASHEMU_CUT_BYTE				// A torn program lands some of its bytes; a torn erase clears some bytes
+} FlashEmuCutMode;
+
+typedef struct {
+	uint32_t transactions;			// SPI transfers
+	uint32_t commands;				// Chip select cycles
+	uint32_t readCommands;
+	uint32_t readBytes;
+	uint32_t programs;
+	uint32_t programBytes;
+	uint32_t erases;
+	uint32_t statusReads;
+	uint32_t busyViolations;		// Instructions ignored because a program or erase was running
+	uint64_t busyNs;				// Time spent programming and erasing
+} FlashEmuStats;
+
+// Connects the part to the bus with the given contents, which are kept as they are
+void flashEmuInit(uint8_t *memory);
+
+void flashEmuGetStats(FlashEmuStats *stats);
+void flashEmuResetStats(void);
+
+// Cuts power during the program or erase that follows the given number of them
+void flashEmuCutPower(uint32_t operations, FlashEmuCutMode mode, uint32_t seed);
+void flashEmuOnPowerCut(void (*hook)(void));
+
+#endif /* HOST_FLASHEMULATOR_H_ */
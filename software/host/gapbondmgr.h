@@ -0,0 +1,13 @@
+/*
+ * gapbondmgr.h
+ *
+ * Stands in for the stack's bond manager header, which smartBandageProfile.c includes. The
+ * profile calls nothing from it: bond records are kept by the stack.
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef HOST_GAPBONDMGR_H_
+#define HOST_GAPBONDMGR_H_
+
+#endif /* HOST_GAPBONDMGR_H_ */
@@ -0,0 +1,2 @@
+// Host stand-in, see att.h
+#include "att.h"
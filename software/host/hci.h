@@ -0,0 +1,19 @@
+/*
+ * hci.h
+ *
+ * The vendor command of the stack's HCI interface used by the live stream, with the stack's
+ * name, so liveStream.c builds on a host. The function is defined by the test program.
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef HOST_HCI_H_
+#define HOST_HCI_H_
+
+#include "bleHost.h"
+
+typedef uint8 hciStatus_t;
+
+hciStatus_t HCI_EXT_ConnEventNoticeCmd(uint16 connHandle, uint8 taskID, uint16 taskEvent);
+
+#endif /* HOST_HCI_H_ */
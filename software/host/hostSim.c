@@ -0,0 +1,313 @@
+/*
+ * hostSim.c
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "hostSim.h"
+
+#define HOSTSIM_MAX_SEMAPHORES	16
+
+static struct {
+	uint64_t now;
+
+	struct {
+		uint64_t at;
+		HostSimEventFxn fxn;
+		void *arg;
+	} events[HOSTSIM_MAX_EVENTS];
+	uint8_t numEvents;
+
+	Clock_Struct *clocks[HOSTSIM_MAX_CLOCKS];
+	uint8_t numClocks;
+
+	Semaphore_Struct semaphores[HOSTSIM_MAX_SEMAPHORES];
+	uint8_t numSemaphores;
+
+	// Events run in place of a Swi or Hwi, which must never block
+	bool inEvent;
+} SIM;
+
+static void fatal(const char *message) {
+	fprintf(stderr, "hostSim: %s at %llu ns\n", message, (unsigned long long)SIM.now);
+	exit(2);
+}
+
+void hostSimReset(void) {
+	memset(&SIM, 0, sizeof(SIM));
+}
+
+uint64_t hostSimNow(void) {
+	return SIM.now;
+}
+
+void hostSimSchedule(uint64_t at, HostSimEventFxn fxn, void *arg) {
+	if (SIM.numEvents == HOSTSIM_MAX_EVENTS) {
+		fatal("too many events pending");
+	}
+
+	SIM.events[SIM.numEvents].at = at;
+	SIM.events[SIM.numEvents].fxn = fxn;
+	SIM.events[SIM.numEvents].arg = arg;
+	++SIM.numEvents;
+}
+
+// Due time of an active clock, never before now
+static uint64_t clockDue(const Clock_Struct *clock) {
+	int32_t ticks = (int32_t)(clock->due - Clock_getTicks());
+
+	return (ticks > 0) ? SIM.now + (uint64_t)ticks * HOSTSIM_NS_PER_TICK : SIM.now;
+}
+
+// Finds the next thing to run: an event index, or numEvents plus a clock index
+static bool findNext(uint64_t *at, uint8_t *index) {
+	bool found = false;
+	uint64_t due;
+	uint8_t i;
+
+	for (i = 0; i < SIM.numEvents; ++i) {
+		if (!found || SIM.events[i].at < *at) {
+			*at = SIM.events[i].at;
+			*index = i;
+			found = true;
+		}
+	}
+
+	for (i = 0; i < SIM.numClocks; ++i) {
+		if (!SIM.clocks[i]->active) {
+			continue;
+		}
+
+		due = clockDue(SIM.clocks[i]);
+		if (!found || due < *at) {
+			*at = due;
+			*index = SIM.numEvents + i;
+			found = true;
+		}
+	}
+
+	return found;
+}
+
+bool hostSimRunNext(void) {
+	HostSimEventFxn fxn;
+	Clock_Struct *clock;
+	uint64_t at;
+	uint8_t index;
+	void *arg;
+
+	if (!findNext(&at, &index)) {
+		return false;
+	}
+
+	if (at > SIM.now) {
+		SIM.now = at;
+	}
+
+	SIM.inEvent = true;
+
+	if (index < SIM.numEvents) {
+		fxn = SIM.events[index].fxn;
+		arg = SIM.events[index].arg;
+		SIM.events[index] = SIM.events[--SIM.numEvents];
+		fxn(arg);
+	} else {
+		clock = SIM.clocks[index - SIM.numEvents];
+		if (clock->period != 0) {
+			clock->due += clock->period;
+		} else {
+			clock->active = false;
+		}
+		clock->function(clock->arg);
+	}
+
+	SIM.inEvent = false;
+
+	return true;
+}
+
+void hostSimSpend(uint64_t ns) {
+	uint64_t end = SIM.now + ns;
+	uint64_t at;
+	uint8_t index;
+
+	while (findNext(&at, &index) && at <= end) {
+		hostSimRunNext();
+	}
+
+	SIM.now = end;
+}
+
+/*
+ * Task, Swi and Hwi. There is one thread, so locks have nothing to exclude.
+ */
+void Task_Params_init(Task_Params *params) { memset(params, 0, sizeof(Task_Params)); }
+UInt Task_disable(void) { return 0; }
+void Task_restore(UInt key) { }
+void Task_stat(Task_Handle handle, Task_Stat *stat) { memset(stat, 0, sizeof(Task_Stat)); }
+void Task_exit(void) { fatal("Task_exit called"); }
+UInt Swi_disable(void) { return 0; }
+void Swi_restore(UInt key) { }
+UInt Hwi_disable(void) { return 0; }
+void Hwi_restore(UInt key) { }
+
+void Task_sleep(uint32_t ticks) {
+	if (SIM.inEvent) {
+		fatal("Task_sleep from an event");
+	}
+
+	hostSimSpend((uint64_t)ticks * HOSTSIM_NS_PER_TICK);
+}
+
+/*
+ * Clock and Timestamp
+ */
+uint32_t Clock_getTicks(void) {
+	return (uint32_t)(SIM.now / HOSTSIM_NS_PER_TICK);
+}
+
+// The CPU timestamp counts at 48 MHz on the device
+uint32_t Timestamp_get32(void) {
+	return (uint32_t)(SIM.now * 48 / 1000);
+}
+
+void Clock_Params_init(Clock_Params *params) {
+	memset(params, 0, sizeof(Clock_Params));
+}
+
+void Clock_construct(Clock_Struct *clock, Clock_FuncPtr function, uint32_t timeout, const Clock_Params *params) {
+	if (SIM.numClocks == HOSTSIM_MAX_CLOCKS) {
+		fatal("too many clocks");
+	}
+
+	memset(clock, 0, sizeof(Clock_Struct));
+	clock->function = function;
+	clock->timeout = timeout;
+	clock->arg = params->arg;
+	clock->period = params->period;
+	SIM.clocks[SIM.numClocks++] = clock;
+
+	if (params->startFlag) {
+		Clock_start(clock);
+	}
+}
+
+void Clock_start(Clock_Handle handle) {
+	handle->active = true;
+	handle->due = Clock_getTicks() + handle->timeout;
+}
+
+void Clock_stop(Clock_Handle handle) {
+	handle->active = false;
+}
+
+bool Clock_isActive(Clock_Handle handle) {
+	return handle->active;
+}
+
+void Clock_setTimeout(Clock_Handle handle, uint32_t timeout) {
+	handle->timeout = timeout;
+}
+
+void Clock_setPeriod(Clock_Handle handle, uint32_t period) {
+	handle->period = period;
+}
+
+/*
+ * Semaphore. A pend runs events until the semaphore is posted or the timeout passes.
+ */
+void Semaphore_Params_init(Semaphore_Params *params) {
+	params->mode = Semaphore_Mode_COUNTING;
+}
+
+void Semaphore_construct(Semaphore_Struct *sem, int count, const Semaphore_Params *params) {
+	sem->binary = (params != NULL && params->mode == Semaphore_Mode_BINARY);
+	sem->count = (sem->binary && count > 1) ? 1 : count;
+}
+
+void Semaphore_destruct(Semaphore_Struct *sem) { }
+
+Semaphore_Handle Semaphore_create(int count, void *params, void *eb) {
+	Semaphore_Struct *sem;
+
+	if (SIM.numSemaphores == HOSTSIM_MAX_SEMAPHORES) {
+		return NULL;
+	}
+
+	sem = &SIM.semaphores[SIM.numSemaphores++];
+	Semaphore_construct(sem, count, params);
+
+	return sem;
+}
+
+bool Semaphore_pend(Semaphore_Handle handle, uint32_t timeout) {
+	uint64_t deadline = SIM.now + (uint64_t)timeout * HOSTSIM_NS_PER_TICK;
+	uint64_t at;
+	uint8_t index;
+
+	while (handle->count == 0) {
+		if (timeout == BIOS_NO_WAIT) {
+			return false;
+		}
+
+		if (SIM.inEvent) {
+			fatal("Semaphore_pend blocked in an event");
+		}
+
+		if (!findNext(&at, &index) || (timeout != BIOS_WAIT_FOREVER && at > deadline)) {
+			if (timeout == BIOS_WAIT_FOREVER) {
+				fatal("Semaphore_pend would block forever");
+			}
+
+			SIM.now = deadline;
+			return false;
+		}
+
+		hostSimRunNext();
+	}
+
+	--handle->count;
+
+	return true;
+}
+
+void Semaphore_post(Semaphore_Handle handle) {
+	if (!handle->binary || handle->count == 0) {
+		++handle->count;
+	}
+}
+
+/*
+ * Queue
+ */
+void Queue_construct(Queue_Struct *queue, void *params) {
+	queue->elem.next = &queue->elem;
+	queue->elem.prev = &queue->elem;
+}
+
+void Queue_enqueue(Queue_Handle queue, Queue_Elem *elem) {
+	elem->next = &queue->elem;
+	elem->prev = queue->elem.prev;
+	queue->elem.prev->next = elem;
+	queue->elem.prev = elem;
+}
+
+void *Queue_dequeue(Queue_Handle queue) {
+	Queue_Elem *elem = queue->elem.next;
+
+	if (elem == &queue->elem) {
+		return NULL;
+	}
+
+	queue->elem.next = elem->next;
+	elem->next->prev = &queue->elem;
+
+	return elem;
+}
+
+bool Queue_empty(Queue_Handle queue) {
+	return queue->elem.next == &queue->elem;
+}
@@ -0,0 +1,39 @@
+/*
+ * hostSim.h
+ *
+ * A discrete-event stand-in for TI-RTOS on one host thread, shared by the host tests that do
+ * not model their own tasks. Time is virtual and in nanoseconds. It moves on only when the
+ * code under test waits on a semaphore or sleeps, when a test spends CPU time explicitly with
+ * hostSimSpend, or when a test runs the next event. Clocks and simulated devices schedule
+ * events, which run in order of their due time in place of the Swi or Hwi that would run
+ * them on the device.
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef HOST_HOSTSIM_H_
+#define HOST_HOSTSIM_H_
+
+#include "rtosHost.h"
+
+#define HOSTSIM_NS_PER_TICK		(Clock_tickPeriod * 1000)
+#define HOSTSIM_MAX_EVENTS		16
+#define HOSTSIM_MAX_CLOCKS		16
+
+typedef void (*HostSimEventFxn)(void *arg);
+
+// Starts again at time zero with no events or clocks
+void hostSimReset(void);
+
+uint64_t hostSimNow(void);
+
+// Runs fxn at the given time, or as soon as time next moves if that is already past
+void hostSimSchedule(uint64_t at, HostSimEventFxn fxn, void *arg);
+
+// Moves time to the next event or clock and runs it. False if nothing is pending.
+bool hostSimRunNext(void);
+
+// Spends CPU time, running the events that fall due meanwhile
+void hostSimSpend(uint64_t ns);
+
+#endif /* HOST_HOSTSIM_H_ */
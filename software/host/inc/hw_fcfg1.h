@@ -0,0 +1,3 @@
+// Host stand-in
+#define FCFG1_O_MAC_BLE_0 0x000002E8
+#define FCFG1_O_MAC_BLE_1 0x000002EC
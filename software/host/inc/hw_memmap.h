@@ -0,0 +1,2 @@
+// Host stand-in
+#define FCFG1_BASE 0x50001000
@@ -0,0 +1,4 @@
+// Host stand-in. Registers read as a fixed value derived from their address.
+#include <stdint.h>
+
+#define HWREG(x) ((uint32_t)(x) * 2654435761u)
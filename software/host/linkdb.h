@@ -0,0 +1,2 @@
+// Host stand-in, see bleHost.h
+#include "bleHost.h"
@@ -0,0 +1,33 @@
+/*
+ * osal_snv.h
+ *
+ * Host stand-in for the simple NV store of the BLE stack. Items are kept in memory, which a
+ * test may share between processes to keep them across reboots.
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef HOST_OSAL_SNV_H_
+#define HOST_OSAL_SNV_H_
+
+#include "bleHost.h"
+
+#define SNVHOST_ITEM_LEN		64
+#define SNVHOST_NUM_ITEMS		(BLE_NVID_CUST_END - BLE_NVID_CUST_START + 1)
+
+typedef uint8 osalSnvId_t;
+typedef uint8 osalSnvLen_t;
+
+typedef struct {
+	uint8 length[SNVHOST_NUM_ITEMS];		// Zero for an item never written
+	uint8 data[SNVHOST_NUM_ITEMS][SNVHOST_ITEM_LEN];
+	uint32_t writes;
+} SnvHostStore;
+
+uint8 osal_snv_read(osalSnvId_t id, osalSnvLen_t len, void *pBuf);
+uint8 osal_snv_write(osalSnvId_t id, osalSnvLen_t len, void *pBuf);
+
+// Keeps the items in the given store, which starts out empty when zeroed
+void snvHostInit(SnvHostStore *store);
+
+#endif /* HOST_OSAL_SNV_H_ */
@@ -0,0 +1,185 @@
+/*
+ * rtosHost.h
+ *
+ * The parts of TI-RTOS and the TI drivers seen by the application, so its modules build on a
+ * host. The headers under ti/ and xdc/ include this one. The functions are defined either by
+ * the test program or by hostSim.c, which runs everything on one thread: locks do nothing and
+ * time only moves when the test or a simulated device moves it.
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef HOST_RTOSHOST_H_
+#define HOST_RTOSHOST_H_
+
+#include <xdc/std.h>
+#include <stdio.h>
+
+// BIOS
+#define BIOS_WAIT_FOREVER (~(uint32_t)0)
+#define BIOS_NO_WAIT 0
+
+// Task
+typedef struct { int unused; } Task_Struct;
+typedef Task_Struct *Task_Handle;
+typedef void (*Task_FuncPtr)(UArg a0, UArg a1);
+
+typedef struct {
+	void *stack;
+	size_t stackSize;
+	int priority;
+} Task_Params;
+
+typedef struct {
+	size_t used;
+	size_t stackSize;
+} Task_Stat;
+
+void Task_Params_init(Task_Params *params);
+Task_Handle Task_create(Task_FuncPtr function, const Task_Params *params, void *eb);
+UInt Task_disable(void);
+void Task_restore(UInt key);
+void Task_sleep(uint32_t ticks);
+void Task_stat(Task_Handle handle, Task_Stat *stat);
+void Task_exit(void);
+
+// Swi and Hwi
+UInt Swi_disable(void);
+void Swi_restore(UInt key);
+UInt Hwi_disable(void);
+void Hwi_restore(UInt key);
+
+// Clock. Ticks are 10us, as on the device.
+#define Clock_tickPeriod 10
+
+typedef void (*Clock_FuncPtr)(UArg arg);
+
+typedef struct {
+	Clock_FuncPtr function;
+	UArg arg;
+	uint32_t timeout;
+	uint32_t period;
+	bool active;
+	uint32_t due;
+} Clock_Struct;
+typedef Clock_Struct *Clock_Handle;
+
+typedef struct {
+	UArg arg;
+	uint32_t period;
+	bool startFlag;
+} Clock_Params;
+
+#define Clock_handle(pClock) (pClock)
+
+uint32_t Clock_getTicks(void);
+void Clock_Params_init(Clock_Params *params);
+void Clock_construct(Clock_Struct *clock, Clock_FuncPtr function, uint32_t timeout, const Clock_Params *params);
+void Clock_start(Clock_Handle handle);
+void Clock_stop(Clock_Handle handle);
+bool Clock_isActive(Clock_Handle handle);
+void Clock_setTimeout(Clock_Handle handle, uint32_t timeout);
+void Clock_setPeriod(Clock_Handle handle, uint32_t period);
+
+// Semaphore
+typedef enum {
+	Semaphore_Mode_COUNTING,
+	Semaphore_Mode_BINARY
+} Semaphore_Mode;
+
+typedef struct {
+	unsigned int count;
+	bool binary;
+} Semaphore_Struct;
+typedef Semaphore_Struct *Semaphore_Handle;
+
+typedef struct {
+	Semaphore_Mode mode;
+} Semaphore_Params;
+
+#define Semaphore_handle(pSem) (pSem)
+
+void Semaphore_Params_init(Semaphore_Params *params);
+void Semaphore_construct(Semaphore_Struct *sem, int count, const Semaphore_Params *params);
+void Semaphore_destruct(Semaphore_Struct *sem);
+Semaphore_Handle Semaphore_create(int count, void *params, void *eb);
+bool Semaphore_pend(Semaphore_Handle handle, uint32_t timeout);
+void Semaphore_post(Semaphore_Handle handle);
+
+// Queue
+typedef struct Queue_Elem {
+	struct Queue_Elem *next;
+	struct Queue_Elem *prev;
+} Queue_Elem;
+
+typedef struct {
+	Queue_Elem elem;
+} Queue_Struct;
+typedef Queue_Struct *Queue_Handle;
+
+#define Queue_handle(pQueue) (pQueue)
+
+void Queue_construct(Queue_Struct *queue, void *params);
+void Queue_enqueue(Queue_Handle queue, Queue_Elem *elem);
+void *Queue_dequeue(Queue_Handle queue);
+bool Queue_empty(Queue_Handle queue);
+
+// System and Timestamp
+#define System_printf printf
+#define System_flush() fflush(stdout)
+
+uint32_t Timestamp_get32(void);
+
+// PIN driver
+typedef uint32_t PIN_Config;
+typedef uint32_t PIN_Id;
+typedef struct { int unused; } PIN_State;
+typedef PIN_State *PIN_Handle;
+
+#define PIN_TERMINATE		0xFE
+#define PIN_GPIO_OUTPUT_EN	(1 << 23)
+#define PIN_GPIO_LOW		0
+#define PIN_GPIO_HIGH		(1 << 22)
+#define PIN_PUSHPULL		0
+#define PIN_DRVSTR_MIN		0
+#define PIN_PULLDOWN		(1 << 14)
+#define PIN_NOPULL			0
+
+#define IOID_0  0
+#define IOID_1  1
+#define IOID_2  2
+#define IOID_3  3
+#define IOID_4  4
+#define IOID_5  5
+#define IOID_6  6
+#define IOID_7  7
+#define IOID_8  8
+#define IOID_9  9
+#define IOID_10 10
+#define IOID_11 11
+#define IOID_12 12
+#define IOID_13 13
+#define IOID_14 14
+#define IOID_15 15
+#define IOID_16 16
+#define IOID_17 17
+#define IOID_18 18
+#define IOID_19 19
+#define IOID_20 20
+
+PIN_Handle PIN_open(PIN_State *state, const PIN_Config pinList[]);
+void PIN_close(PIN_Handle handle);
+int PIN_setOutputValue(PIN_Handle handle, PIN_Id pin, uint32_t value);
+
+// I2C driver, seen only as types
+typedef enum { I2C_100kHz, I2C_400kHz } I2C_BitRate;
+
+typedef struct {
+	void *writeBuf;
+	size_t writeCount;
+	void *readBuf;
+	size_t readCount;
+	uint8_t slaveAddress;
+} I2C_Transaction;
+
+#endif /* HOST_RTOSHOST_H_ */
@@ -0,0 +1,41 @@
+/*
+ * snvHost.c
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#include "osal_snv.h"
+
+static SnvHostStore *store;
+
+void snvHostInit(SnvHostStore *snvStore) {
+	store = snvStore;
+}
+
+uint8 osal_snv_read(osalSnvId_t id, osalSnvLen_t len, void *pBuf) {
+	uint8 item = id - BLE_NVID_CUST_START;
+
+	if (store == NULL || id < BLE_NVID_CUST_START || id > BLE_NVID_CUST_END
+			|| store->length[item] == 0 || len > store->length[item]) {
+		return FAILURE;
+	}
+
+	memcpy(pBuf, store->data[item], len);
+
+	return SUCCESS;
+}
+
+uint8 osal_snv_write(osalSnvId_t id, osalSnvLen_t len, void *pBuf) {
+	uint8 item = id - BLE_NVID_CUST_START;
+
+	if (store == NULL || id < BLE_NVID_CUST_START || id > BLE_NVID_CUST_END
+			|| len == 0 || len > SNVHOST_ITEM_LEN) {
+		return FAILURE;
+	}
+
+	memcpy(store->data[item], pBuf, len);
+	store->length[item] = len;
+	++store->writes;
+
+	return SUCCESS;
+}
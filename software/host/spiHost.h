@@ -0,0 +1,64 @@
+/*
+ * spiHost.h
+ *
+ * The parts of the TI SPI driver, its DMA and SSI layers, and the power driver seen by
+ * bsp_spi.c, so it builds on a host. The transfers are carried out by the external flash
+ * emulator, see flashEmulator.h.
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef HOST_SPIHOST_H_
+#define HOST_SPIHOST_H_
+
+#include "rtosHost.h"
+
+typedef enum {
+	SPI_TRANSFER_COMPLETED,
+	SPI_TRANSFER_STARTED,
+	SPI_TRANSFER_CANCELED,
+	SPI_TRANSFER_FAILED
+} SPI_Status;
+
+typedef enum { SPI_MASTER, SPI_SLAVE } SPI_Mode;
+typedef enum { SPI_MODE_BLOCKING, SPI_MODE_CALLBACK } SPI_TransferMode;
+
+typedef struct {
+	size_t count;
+	void *txBuf;
+	void *rxBuf;
+	void *arg;
+	SPI_Status status;
+} SPI_Transaction;
+
+typedef struct {
+	uint32_t baseAddr;
+} SPICC26XX_HWAttrs;
+
+typedef struct SPI_Config {
+	const void *fxnTablePtr;
+	void *object;
+	const void *hwAttrs;
+} SPI_Config;
+typedef SPI_Config *SPI_Handle;
+
+typedef void (*SPI_CallbackFxn)(SPI_Handle handle, SPI_Transaction *transaction);
+
+typedef struct {
+	SPI_TransferMode transferMode;
+	uint32_t transferTimeout;
+	SPI_CallbackFxn transferCallbackFxn;
+	SPI_Mode mode;
+	uint32_t bitRate;
+	uint32_t dataSize;
+	void *custom;
+} SPI_Params;
+
+void SPI_Params_init(SPI_Params *params);
+SPI_Handle SPI_open(unsigned int index, SPI_Params *params);
+void SPI_close(SPI_Handle handle);
+bool SPI_transfer(SPI_Handle handle, SPI_Transaction *transaction);
+
+bool SSIBusy(uint32_t base);
+
+#endif /* HOST_SPIHOST_H_ */
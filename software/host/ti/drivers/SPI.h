@@ -0,0 +1,2 @@
+// Host stand-in, see spiHost.h
+#include "spiHost.h"
@@ -0,0 +1,2 @@
+// Host stand-in, see cryptoHost.h
+#include "cryptoHost.h"
@@ -0,0 +1,2 @@
+// Host stand-in, see rtosHost.h and boardHost.h
+#include "boardHost.h"
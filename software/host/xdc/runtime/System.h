@@ -0,0 +1,2 @@
+// Host stand-in, see rtosHost.h
+#include "rtosHost.h"
@@ -0,0 +1,19 @@
+/*
+ * Host stand-in for the XDC standard types.
+ */
+
+#ifndef HOST_XDC_STD_H_
+#define HOST_XDC_STD_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef uintptr_t UArg;
+typedef unsigned int UInt;
+typedef int Int;
+typedef char Char;
+typedef bool Bool;
+typedef void Void;
+
+#endif /* HOST_XDC_STD_H_ */
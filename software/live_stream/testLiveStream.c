@@ -0,0 +1,1049 @@
+/*
+ * testLiveStream.c
+ *
+ * Host benchmark and test of the live stream. It links the real liveStream.c,
+ * smartBandageProfile.c and sampleRecord.c against the simulated kernel in ../host/, and
+ * stands in for the GATT server, the ATT bearer, the link layer and the phone. The stack holds a
+ * notification in one of its HCI buffers until the link has sent it. The link sends it in
+ * LL frames of 27 bytes, a few per connection event, and a lost frame is sent again in the
+ * next slot. The phone subscribes through the profile's write callback, decodes every
+ * notification the way the app does and checks it against what was pushed.
+ *
+ * Each scenario connects, pushes samples at a steady rate and disconnects once the stream
+ * has drained. The scenarios vary the MTU, the connection interval, the stack's buffers,
+ * failed allocations, frame loss and the number of centrals.
+ *
+ * Checked:
+ *  - Every record received decodes to the sample pushed, in order. Records are only missing
+ *    where the sequence number skips, and as many as the link counted as dropped.
+ *  - No notification is longer than the MTU allows
+ *  - Nothing is dropped while the link keeps up, and no sample waits longer than
+ *    SB_LIVESTREAM_MAX_LATENCY_MS and the connection events that follow to reach the phone
+ *  - A send the stack has no buffer for is retried, and loses nothing
+ *  - The connection events the stream counts are those the stack reported, and the stream
+ *    stops asking for them once it has drained
+ *  - The one notice follows the queued ATT responses before the stream, moves to another
+ *    link when its link closes, and is only turned off once neither needs it
+ *  - A time written by the phone during an update of the profile reaches the application as
+ *    written
+ *  - A flush sends the samples queued without waiting for the packet to fill, and stays
+ *    pending until the stack has taken every packet
+ *  - A value of up to MTU - 1 bytes is read whole and refuses a read blob, and a longer one
+ *    is read in parts
+ *
+ * Reports, for each scenario, the application throughput seen by the phone, the latency of a
+ * sample to the stack and to the phone, and the connection events used.
+ *
+ * Build and run from this directory, or with make in the parent directory:
+ *
+ *   gcc -std=gnu99 -O2 -Wall -DMAX_NUM_BLE_CONNS=2 -I../host \
+ *       -I../comms_module/SmartBandage/Application -I../comms_module/SmartBandage/PROFILES \
+ *       -I../comms_module/SmartBandage/Board/Interfaces testLiveStream.c ../host/hostSim.c \
+ *       ../comms_module/SmartBandage/Application/util.c \
+ *       ../comms_module/SmartBandage/Application/sampleRecord.c \
+ *       ../comms_module/SmartBandage/Application/connEvent.c \
+ *       ../comms_module/SmartBandage/Application/liveStream.c \
+ *       ../comms_module/SmartBandage/PROFILES/smartBandageProfile.c -o testLiveStream
+ *   ./testLiveStream
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "hostSim.h"
+#include "att.h"
+#include "hci.h"
+#include "sampleRecord.h"
+#include "connEvent.h"
+#include "liveStream.h"
+#include "smartBandageProfile.h"
+
+// The link layer: LL frames of up to 27 bytes, as many per connection event as the phone allows
+#define LL_PAYLOAD				27
+#define L2CAP_HEADER_LEN		4
+#define ATT_NOTI_HEADER_LEN		3
+#define FRAMES_PER_EVENT		6
+
+// HCI buffers of the stack, MAX_NUM_PDU in bleUserConfig.h
+#define STACK_PDUS				10
+
+#define CONN_EVENT_FLAG			0x0004
+
+// 18 October 2026, in UTCTime
+#define SYNC_TIME				845683200UL
+
+#define MAX_SAMPLES				16000
+#define MAX_WORK				32
+#define MAX_LINKS				MAX_NUM_BLE_CONNS
+#define MAX_QUEUED				STACK_PDUS
+
+#define MS						1000000ULL
+
+#define CHECK(condition, message) do { \
+		if (!(condition)) { \
+			fprintf(stderr, "FAIL: %s (%s:%d)\n", message, __FILE__, __LINE__); \
+			exit(1); \
+		} \
+	} while (0)
+
+typedef enum {
+	WORK_PUSH,
+	WORK_SEND,
+	WORK_CONN_EVENT
+} WorkType;
+
+// Messages for the BLE task, and samples for the peripheral manager. Events run in place of
+// a Swi, so they queue work for the tasks.
+typedef struct {
+	WorkType type;
+} Work;
+
+typedef struct {
+	uint8_t *value;
+	uint16_t len;
+	uint16_t handle;
+	uint8_t frames;
+} Notification;
+
+typedef struct {
+	const char *name;
+	uint16_t mtu;
+	uint16_t intervalMs;
+	uint8_t pdus;				// HCI buffers the stack has
+	uint8_t allocFailPercent;	// Notifications the stack has no memory for
+	uint8_t lossPercent;		// LL frames lost and sent again
+	uint16_t periodMs;			// Between two samples
+	uint16_t samples;
+	bool keepsUp;				// The link is fast enough to send every sample
+} Scenario;
+
+static const Scenario scenarios[] = {
+	// name                       MTU  int  PDUs alloc loss period samples keepsUp
+	{ "monitoring, MTU 23",        23, 450, STACK_PDUS, 0,  0, 1000,  120, true },
+	{ "monitoring, MTU 247",      247, 450, STACK_PDUS, 0,  0, 1000,  120, true },
+	{ "burst, MTU 23",             23,  30, STACK_PDUS, 0,  0,    4, 2000, false },
+	{ "burst, MTU 100",           100,  30, STACK_PDUS, 0,  0,    4, 2000, true },
+	{ "burst, MTU 247",           247,  30, STACK_PDUS, 0,  0,    4, 2000, true },
+	{ "burst, MTU 247, 15 ms",    247,  15, STACK_PDUS, 0,  0,    1, 2000, false },
+	{ "burst, MTU 247, 1 buffer", 247,  15,          1, 0,  0,    1, 2000, false },
+	{ "burst, MTU 247, no memory",247,  30, STACK_PDUS, 30, 0,    4, 2000, true },
+	{ "burst, MTU 247, 10% loss", 247,  30, STACK_PDUS, 0, 10,    4, 2000, true },
+};
+
+static struct {
+	Work items[MAX_WORK];
+	uint8_t first;
+	uint8_t count;
+} WORK;
+
+// What was pushed, in order
+static struct {
+	SB_Sample samples[MAX_SAMPLES];
+	uint64_t pushedNs[MAX_SAMPLES];
+	uint32_t count;
+	uint32_t target;			// Samples the running scenario pushes
+	uint64_t periodNs;
+	SB_SampleCodec codec;
+} PUSHED;
+
+// The GATT server, and the buffers and connection event notices of the stack
+static struct {
+	gattAttribute_t *attrs;
+	uint16_t numAttrs;
+	const gattServiceCBs_t *cbs;
+
+	uint8_t pdus;
+	uint8_t queued;
+	uint8_t allocFailPercent;
+
+	uint16_t noticeHandle;
+	uint16_t noticeEvent;
+} STACK = { .noticeHandle = INVALID_CONNHANDLE };
+
+// One connection, and the phone at the other end of it
+typedef struct {
+	bool connected;
+	uint32_t generation;
+	uint16_t connHandle;
+	uint16_t mtu;
+	uint64_t intervalNs;
+	uint8_t lossPercent;
+
+	Notification queue[MAX_QUEUED];
+	uint8_t head;
+	uint8_t count;
+	uint8_t headFramesSent;
+
+	uint32_t events;
+	uint32_t busyEvents;		// Events that carried a frame
+	uint32_t frames;
+	uint32_t lostFrames;
+	uint32_t notices;			// Connection event notices given to the BLE task
+
+	// The phone
+	bool haveSequence;
+	uint16_t nextSequence;
+	bool haveSample;
+	uint32_t nextSample;		// Sample the next record must be, unless some were dropped
+	SB_SampleCodec codec;
+	uint32_t received;
+	uint32_t missing;
+	uint32_t bytes;
+	uint64_t latencyTotalNs;
+	uint64_t maxLatencyNs;
+	uint64_t lastReceivedNs;
+
+	// Taken when the last sample is pushed, so the wait for the last packet is left out
+	uint32_t pushPhaseBytes;
+	uint32_t pushPhaseEvents;
+	uint32_t pushPhaseBusyEvents;
+	uint64_t pushPhaseNs;
+} Link;
+
+static Link links[MAX_LINKS];
+
+// Values passed with the last characteristic change
+static struct {
+	uint8_t paramID;
+	uint8_t value[SB_BLE_REPORTPOLICY_LEN];
+	uint8_t len;
+	uint32_t count;
+} CHANGED;
+
+static uint32_t random32 = 2463534242UL;
+
+static void queueWork(WorkType type) {
+	CHECK(WORK.count < MAX_WORK, "work queue full");
+	WORK.items[(WORK.first + WORK.count) % MAX_WORK].type = type;
+	++WORK.count;
+}
+
+// A deterministic xorshift, so every run sees the same losses
+static bool chance(uint8_t percent) {
+	random32 ^= random32 << 13;
+	random32 ^= random32 >> 17;
+	random32 ^= random32 << 5;
+
+	return (random32 % 100) < percent;
+}
+
+static Link *findLink(uint16_t connHandle) {
+	uint8_t i;
+
+	for (i = 0; i < MAX_LINKS; ++i) {
+		if (links[i].connected && links[i].connHandle == connHandle) {
+			return &links[i];
+		}
+	}
+
+	return NULL;
+}
+
+/*
+ * Stack stand-ins
+ */
+const uint8 primaryServiceUUID[ATT_BT_UUID_SIZE] = { LO_UINT16(GATT_PRIMARY_SERVICE_UUID), HI_UINT16(GATT_PRIMARY_SERVICE_UUID) };
+const uint8 characterUUID[ATT_BT_UUID_SIZE] = { LO_UINT16(GATT_CHARACTER_UUID), HI_UINT16(GATT_CHARACTER_UUID) };
+const uint8 charUserDescUUID[ATT_BT_UUID_SIZE] = { LO_UINT16(GATT_CHAR_USER_DESC_UUID), HI_UINT16(GATT_CHAR_USER_DESC_UUID) };
+const uint8 clientCharCfgUUID[ATT_BT_UUID_SIZE] = { LO_UINT16(GATT_CLIENT_CHAR_CFG_UUID), HI_UINT16(GATT_CLIENT_CHAR_CFG_UUID) };
+
+uint16 ATT_GetMTU(uint16 connHandle) {
+	Link *link = findLink(connHandle);
+
+	return (link != NULL) ? link->mtu : ATT_MTU_SIZE;
+}
+
+void *GATT_bm_alloc(uint16 connHandle, uint8 opcode, uint16 size, uint16 *pSizeAlloc) {
+	CHECK(opcode == ATT_HANDLE_VALUE_NOTI, "unexpected buffer allocation");
+
+	if (chance(STACK.allocFailPercent)) {
+		return NULL;
+	}
+
+	if (pSizeAlloc != NULL) {
+		*pSizeAlloc = size;
+	}
+
+	return malloc(size);
+}
+
+void GATT_bm_free(gattMsg_t *pMsg, uint8 opcode) {
+	free(pMsg->handleValueNoti.pValue);
+	pMsg->handleValueNoti.pValue = NULL;
+}
+
+bStatus_t GATT_Notification(uint16 connHandle, attHandleValueNoti_t *pNoti, uint8 authenticated) {
+	Link *link = findLink(connHandle);
+	Notification *noti;
+
+	if (link == NULL) {
+		return bleNotConnected;
+	}
+
+	CHECK(pNoti->len <= link->mtu - ATT_NOTI_HEADER_LEN, "notification longer than the MTU allows");
+
+	if (STACK.queued >= STACK.pdus) {
+		return MSG_BUFFER_NOT_AVAIL;
+	}
+
+	noti = &link->queue[(link->head + link->count) % MAX_QUEUED];
+	noti->value = pNoti->pValue;
+	noti->len = pNoti->len;
+	noti->handle = pNoti->handle;
+	noti->frames = (ATT_NOTI_HEADER_LEN + L2CAP_HEADER_LEN + pNoti->len + LL_PAYLOAD - 1) / LL_PAYLOAD;
+	++link->count;
+	++STACK.queued;
+
+	return SUCCESS;
+}
+
+bStatus_t GATTServApp_RegisterService(gattAttribute_t *pAttrs, uint16 numAttrs, uint8 encKeySize,
+		const gattServiceCBs_t *pServiceCBs) {
+	uint16 i;
+
+	for (i = 0; i < numAttrs; ++i) {
+		pAttrs[i].handle = 0x0020 + i;
+	}
+
+	STACK.attrs = pAttrs;
+	STACK.numAttrs = numAttrs;
+	STACK.cbs = pServiceCBs;
+
+	return SUCCESS;
+}
+
+gattAttribute_t *GATTServApp_FindAttr(gattAttribute_t *pAttrTbl, uint16 numAttrs, uint8 *pValue) {
+	uint16 i;
+
+	for (i = 0; i < numAttrs; ++i) {
+		if (pAttrTbl[i].pValue == pValue) {
+			return &pAttrTbl[i];
+		}
+	}
+
+	return NULL;
+}
+
+void GATTServApp_InitCharCfg(uint16 connHandle, gattCharCfg_t *charCfgTbl) {
+	uint8 i;
+
+	for (i = 0; i < MAX_NUM_BLE_CONNS; ++i) {
+		if (connHandle == INVALID_CONNHANDLE || charCfgTbl[i].connHandle == connHandle) {
+			charCfgTbl[i].connHandle = INVALID_CONNHANDLE;
+			charCfgTbl[i].value = GATT_CFG_NO_OPERATION;
+		}
+	}
+}
+
+uint16 GATTServApp_ReadCharCfg(uint16 connHandle, gattCharCfg_t *charCfgTbl) {
+	uint8 i;
+
+	for (i = 0; i < MAX_NUM_BLE_CONNS; ++i) {
+		if (charCfgTbl[i].connHandle == connHandle) {
+			return charCfgTbl[i].value;
+		}
+	}
+
+	return GATT_CFG_NO_OPERATION;
+}
+
+bStatus_t GATTServApp_ProcessCCCWriteReq(uint16 connHandle, gattAttribute_t *pAttr, uint8 *pValue,
+		uint16 len, uint16 offset, uint16 validCfg) {
+	gattCharCfg_t *table = *(gattCharCfg_t **)pAttr->pValue;
+	uint16 value;
+	uint8 i;
+
+	if (len != 2 || offset != 0) {
+		return ATT_ERR_INVALID_VALUE_SIZE;
+	}
+
+	value = BUILD_UINT16(pValue[0], pValue[1]);
+	CHECK((value & ~validCfg) == 0, "phone asked for an unsupported configuration");
+
+	for (i = 0; i < MAX_NUM_BLE_CONNS; ++i) {
+		if (table[i].connHandle == connHandle) {
+			table[i].value = value;
+			return SUCCESS;
+		}
+	}
+
+	for (i = 0; i < MAX_NUM_BLE_CONNS; ++i) {
+		if (table[i].connHandle == INVALID_CONNHANDLE) {
+			table[i].connHandle = connHandle;
+			table[i].value = value;
+			return SUCCESS;
+		}
+	}
+
+	return FAILURE;
+}
+
+bStatus_t GATTServApp_ProcessCharCfg(gattCharCfg_t *charCfgTbl, uint8 *pValue, uint8 authenticated,
+		gattAttribute_t *attrTbl, uint16 numAttrs, uint8 taskId, pfnGATTReadAttrCB_t pfnReadAttrCB) {
+	attHandleValueNoti_t noti;
+	gattAttribute_t *pAttr = GATTServApp_FindAttr(attrTbl, numAttrs, pValue);
+	Link *link;
+	uint16 len;
+	uint8 i;
+
+	for (i = 0; i < MAX_NUM_BLE_CONNS; ++i) {
+		link = findLink(charCfgTbl[i].connHandle);
+		if (link == NULL || pAttr == NULL || !(charCfgTbl[i].value & GATT_CLIENT_CFG_NOTIFY)) {
+			continue;
+		}
+
+		noti.pValue = GATT_bm_alloc(link->connHandle, ATT_HANDLE_VALUE_NOTI, link->mtu - ATT_NOTI_HEADER_LEN, NULL);
+		if (noti.pValue == NULL) {
+			continue;
+		}
+
+		noti.handle = pAttr->handle;
+		pfnReadAttrCB(link->connHandle, pAttr, noti.pValue, &len, 0, link->mtu - ATT_NOTI_HEADER_LEN, 0);
+		noti.len = len;
+
+		if (GATT_Notification(link->connHandle, &noti, authenticated) != SUCCESS) {
+			GATT_bm_free((gattMsg_t *)&noti, ATT_HANDLE_VALUE_NOTI);
+		}
+	}
+
+	return SUCCESS;
+}
+
+hciStatus_t HCI_EXT_ConnEventNoticeCmd(uint16 connHandle, uint8 taskID, uint16 taskEvent) {
+	// The stack reports the events of one connection at a time
+	if (taskEvent != 0) {
+		CHECK(STACK.noticeHandle == INVALID_CONNHANDLE, "notice registered over another");
+	} else {
+		CHECK(STACK.noticeHandle == connHandle, "notice turned off on a link without it");
+	}
+
+	STACK.noticeHandle = (taskEvent != 0) ? connHandle : INVALID_CONNHANDLE;
+	STACK.noticeEvent = taskEvent;
+
+	return SUCCESS;
+}
+
+/*
+ * The application
+ */
+static void liveStreamPendingCB(void) {
+	queueWork(WORK_SEND);
+}
+
+static void charValueChangeCB(uint8 paramID, uint8 *pValue, uint8 len) {
+	CHECK(len <= sizeof(CHANGED.value), "changed value too long");
+
+	CHANGED.paramID = paramID;
+	memcpy(CHANGED.value, pValue, len);
+	CHANGED.len = len;
+	++CHANGED.count;
+}
+
+static void notifyPendingCB(void) {
+}
+
+static simpleProfileCBs_t profileCBs = {
+	charValueChangeCB,
+	notifyPendingCB
+};
+
+/*
+ * The phone
+ */
+
+// The value attribute of a characteristic, in the table registered by the profile
+static gattAttribute_t *findValueAttr(uint16_t uuid) {
+	uint16_t i;
+
+	for (i = 0; i < STACK.numAttrs; ++i) {
+		if (STACK.attrs[i].type.len == ATT_BT_UUID_SIZE
+				&& BUILD_UINT16(STACK.attrs[i].type.uuid[0], STACK.attrs[i].type.uuid[1]) == uuid) {
+			return &STACK.attrs[i];
+		}
+	}
+
+	CHECK(false, "characteristic not registered");
+	return NULL;
+}
+
+static bStatus_t phoneWrite(Link *link, gattAttribute_t *pAttr, const uint8_t *value, uint16_t len) {
+	uint8_t pdu[32];
+
+	memcpy(pdu, value, len);
+
+	return STACK.cbs->pfnWriteAttrCB(link->connHandle, pAttr, pdu, len, 0, 0);
+}
+
+// A read or read blob request, answered with as much as fits in the response
+static bStatus_t phoneRead(Link *link, gattAttribute_t *pAttr, uint16_t offset, uint8_t *value, uint16_t *len) {
+	return STACK.cbs->pfnReadAttrCB(link->connHandle, pAttr, value, len, offset, link->mtu - 1, 0);
+}
+
+static void phoneSubscribe(Link *link) {
+	static const uint8_t enable[2] = { LO_UINT16(GATT_CLIENT_CFG_NOTIFY), HI_UINT16(GATT_CLIENT_CFG_NOTIFY) };
+
+	// The declaration, value, user description and configuration of a characteristic follow each other
+	CHECK(SUCCESS == phoneWrite(link, findValueAttr(SB_BLE_LIVESTREAM_UUID) + 2, enable, sizeof(enable)),
+			"subscribing to the live stream failed");
+	CHECK(SB_Profile_NotificationsEnabled(SB_CHARACTERISTIC_LIVESTREAM, link->connHandle),
+			"live stream not enabled by the subscription");
+}
+
+// Each sample carries its index in its values, so the phone can tell which it received
+static uint32_t sampleIndex(const SB_Sample *sample) {
+	return sample->values[0] | ((uint32_t)sample->values[1] << 16);
+}
+
+static void phoneReceive(Link *link, const Notification *noti) {
+	const uint8_t *p = noti->value + SB_LIVESTREAM_HEADER_LEN;
+	const uint8_t *end = noti->value + noti->len;
+	SB_Sample sample;
+	uint16_t sequence;
+	uint64_t latency;
+	uint32_t index;
+	uint8_t i, count, length;
+	bool skipped;
+
+	if (noti->handle != findValueAttr(SB_BLE_LIVESTREAM_UUID)->handle) {
+		return;
+	}
+
+	CHECK(noti->len >= SB_LIVESTREAM_HEADER_LEN, "live stream packet without a header");
+	sequence = BUILD_UINT16(noti->value[0], noti->value[1]);
+	count = noti->value[2];
+
+	// Each packet starts with an absolute record, so it is timed whatever was missed before it
+	memset(&link->codec, 0, sizeof(link->codec));
+
+	skipped = link->haveSequence && sequence != link->nextSequence;
+	if (skipped) {
+		CHECK((int16_t)(sequence - link->nextSequence) > 0, "sequence number went back");
+	}
+	link->haveSequence = true;
+	link->nextSequence = sequence + 1;
+
+	for (i = 0; i < count; ++i) {
+		length = SB_sampleLength(p, end - p);
+		CHECK(length > 0, "record overruns its packet");
+
+		CHECK(SB_sampleDecode(&link->codec, p, length, &sample) == length, "record cannot be decoded");
+
+		index = sampleIndex(&sample);
+		CHECK(index < PUSHED.count, "record received that was never pushed");
+		CHECK(sample.timestamp == PUSHED.samples[index].timestamp, "record has the wrong time");
+		CHECK(sample.channels == PUSHED.samples[index].channels
+				&& memcmp(sample.values, PUSHED.samples[index].values, sizeof(sample.values)) == 0,
+				"record has the wrong values");
+
+		if (link->haveSample && index != link->nextSample) {
+			CHECK(index > link->nextSample, "records out of order");
+			CHECK(i == 0 && skipped, "records missing without a gap in the sequence numbers");
+			link->missing += index - link->nextSample;
+		}
+		link->haveSample = true;
+		link->nextSample = index + 1;
+
+		latency = hostSimNow() - PUSHED.pushedNs[index];
+		link->latencyTotalNs += latency;
+		if (latency > link->maxLatencyNs) {
+			link->maxLatencyNs = latency;
+		}
+
+		++link->received;
+		p += length;
+	}
+
+	CHECK(p == end, "packet longer than its records");
+
+	link->bytes += noti->len;
+	link->lastReceivedNs = hostSimNow();
+}
+
+/*
+ * The link
+ */
+static void connectionEvent(void *arg) {
+	Link *link = &links[(uintptr_t)arg % MAX_LINKS];
+	Notification *noti;
+	uint8_t frames = 0;
+
+	if (!link->connected || (uintptr_t)arg / MAX_LINKS != link->generation) {
+		return;
+	}
+
+	++link->events;
+
+	while (link->count > 0 && frames < FRAMES_PER_EVENT) {
+		noti = &link->queue[link->head];
+		++frames;
+		++link->frames;
+
+		// Not acknowledged: the same frame goes again in the next slot
+		if (chance(link->lossPercent)) {
+			++link->lostFrames;
+			continue;
+		}
+
+		if (++link->headFramesSent == noti->frames) {
+			phoneReceive(link, noti);
+
+			free(noti->value);
+			link->head = (link->head + 1) % MAX_QUEUED;
+			--link->count;
+			--STACK.queued;
+			link->headFramesSent = 0;
+		}
+	}
+
+	if (frames > 0) {
+		++link->busyEvents;
+	}
+
+	if (STACK.noticeHandle == link->connHandle && STACK.noticeEvent == CONN_EVENT_FLAG) {
+		++link->notices;
+		queueWork(WORK_CONN_EVENT);
+	}
+
+	hostSimSchedule(hostSimNow() + link->intervalNs, connectionEvent, arg);
+}
+
+static Link *linkConnect(uint16_t connHandle, uint16_t mtu, uint16_t intervalMs, uint8_t lossPercent) {
+	Link *link = NULL;
+	uint32_t generation;
+	uint8_t i;
+
+	for (i = 0; i < MAX_LINKS && link == NULL; ++i) {
+		if (!links[i].connected) {
+			link = &links[i];
+		}
+	}
+	CHECK(link != NULL, "no free link");
+
+	generation = link->generation + 1;
+	memset(link, 0, sizeof(Link));
+	link->connected = true;
+	link->generation = generation;
+	link->connHandle = connHandle;
+	link->mtu = ATT_MTU_SIZE;
+	link->intervalNs = intervalMs * MS;
+	link->lossPercent = lossPercent;
+
+	SB_liveStreamConnected(connHandle);
+	phoneSubscribe(link);
+
+	// The phone asks for its MTU straight away
+	link->mtu = mtu;
+	SB_liveStreamSetMTU(connHandle, mtu);
+
+	hostSimSchedule(hostSimNow() + link->intervalNs, connectionEvent,
+			(void*)(uintptr_t)(link->generation * MAX_LINKS + (link - links)));
+
+	return link;
+}
+
+static void linkDrop(Link *link) {
+	uint16_t i;
+
+	CHECK(link->count == 0, "link dropped with notifications in flight");
+
+	link->connected = false;
+
+	// The stack stops the notice of the link, and the server forgets its configuration
+	if (STACK.noticeHandle == link->connHandle) {
+		STACK.noticeHandle = INVALID_CONNHANDLE;
+		STACK.noticeEvent = 0;
+	}
+
+	for (i = 0; i < STACK.numAttrs; ++i) {
+		if (memcmp(STACK.attrs[i].type.uuid, clientCharCfgUUID, ATT_BT_UUID_SIZE) == 0) {
+			GATTServApp_InitCharCfg(link->connHandle, *(gattCharCfg_t **)STACK.attrs[i].pValue);
+		}
+	}
+
+	// Then the BLE task hears of it, as in SimpleBLEPeripheral_processLinkChangeEvt
+	SB_connEventDisconnected(link->connHandle);
+	SB_liveStreamDisconnected(link->connHandle);
+}
+
+/*
+ * The peripheral manager
+ */
+static void pushSample(void) {
+	uint8_t record[SB_SAMPLE_MAX_LEN];
+	SB_Sample *sample;
+	uint8_t length;
+
+	CHECK(PUSHED.count < MAX_SAMPLES, "too many samples for the test");
+
+	sample = &PUSHED.samples[PUSHED.count];
+	memset(sample, 0, sizeof(SB_Sample));
+	sample->timestamp = SYNC_TIME + hostSimNow() / 1000000000ULL;
+	sample->channels = 0x1F;
+	sample->values[0] = PUSHED.count & 0xFFFF;
+	sample->values[1] = PUSHED.count >> 16;
+	sample->values[2] = 400 + PUSHED.count % 7;
+	sample->values[3] = 410;
+	sample->values[4] = 900;
+
+	length = SB_sampleEncode(&PUSHED.codec, sample, record);
+	PUSHED.pushedNs[PUSHED.count] = hostSimNow();
+	++PUSHED.count;
+
+	CHECK(NoError == SB_liveStreamPush(record, length), "push failed");
+}
+
+static void sampleClock(void *arg) {
+	if (PUSHED.count >= PUSHED.target) {
+		return;
+	}
+
+	queueWork(WORK_PUSH);
+	hostSimSchedule(hostSimNow() + PUSHED.periodNs, sampleClock, NULL);
+}
+
+/*
+ * Running the tasks
+ */
+static void runTasks(void) {
+	Work item;
+
+	while (WORK.count > 0) {
+		item = WORK.items[WORK.first];
+		WORK.first = (WORK.first + 1) % MAX_WORK;
+		--WORK.count;
+
+		switch (item.type) {
+			case WORK_PUSH:
+				pushSample();
+				break;
+
+			case WORK_SEND:
+				SB_liveStreamSend();
+				break;
+
+			case WORK_CONN_EVENT:
+				SB_liveStreamConnEvent();
+				break;
+		}
+	}
+}
+
+static void runFor(uint64_t ns) {
+	uint64_t end = hostSimNow() + ns;
+
+	runTasks();
+	while (hostSimNow() < end && hostSimRunNext()) {
+		runTasks();
+	}
+}
+
+// Pushes the samples of a scenario, then waits for the last packet
+static void runPushes(uint16_t samples, uint16_t periodMs) {
+	uint32_t first = PUSHED.count;
+	uint64_t startNs = hostSimNow();
+	Link *link;
+	uint8_t i;
+
+	PUSHED.target = first + samples;
+	PUSHED.periodNs = periodMs * MS;
+
+	// Off the connection events, so neither is always first
+	hostSimSchedule(hostSimNow() + PUSHED.periodNs + MS / 3, sampleClock, NULL);
+
+	while (PUSHED.count < PUSHED.target && hostSimRunNext()) {
+		runTasks();
+	}
+
+	for (i = 0; i < MAX_LINKS; ++i) {
+		link = &links[i];
+		if (link->connected) {
+			link->pushPhaseBytes = link->bytes;
+			link->pushPhaseEvents = link->events;
+			link->pushPhaseBusyEvents = link->busyEvents;
+			link->pushPhaseNs = hostSimNow() - startNs;
+		}
+	}
+
+	runFor(SB_LIVESTREAM_MAX_LATENCY_MS * MS + 1000 * MS);
+}
+
+/*
+ * Checks
+ */
+static void checkLink(const Link *link, uint32_t first, bool keepsUp, const Scenario *scenario) {
+	SB_LiveStreamStats stats;
+	uint64_t latencyBoundNs;
+	uint8_t i;
+
+	for (i = 0; i < MAX_LINKS; ++i) {
+		if (SB_liveStreamGetLinkStats(i, &stats) == link->connHandle) {
+			break;
+		}
+	}
+	CHECK(i < MAX_LINKS, "live stream has no statistics for the link");
+
+	CHECK(link->haveSample && link->nextSample == PUSHED.count, "last sample never reached the phone");
+	CHECK(link->received + link->missing == PUSHED.count - first, "samples neither received nor dropped");
+	CHECK(link->missing == stats.samplesDropped, "samples missing that the link did not count as dropped");
+	CHECK(link->received == stats.samplesSent, "phone received other samples than the link sent");
+	CHECK(link->notices == stats.connectionEvents, "connection events counted that the stack did not report");
+	CHECK(STACK.noticeEvent == 0 && SB_connEventHandle() == INVALID_CONNHANDLE, "still asking for connection events once drained");
+
+	if (keepsUp) {
+		latencyBoundNs = SB_LIVESTREAM_MAX_LATENCY_MS * MS + 4 * link->intervalNs;
+
+		CHECK(link->missing == 0, "samples dropped although the link keeps up");
+		CHECK(link->maxLatencyNs <= latencyBoundNs, "a sample waited too long to reach the phone");
+	}
+
+	if (scenario != NULL && scenario->pdus < STACK_PDUS) {
+		CHECK(stats.sendRetries > 0, "the stack never ran out of buffers");
+	}
+
+	if (scenario != NULL && scenario->allocFailPercent > 0) {
+		CHECK(stats.sendRetries > 0, "no send was retried although allocations failed");
+	}
+}
+
+/**
+ * Throughput and connection events while samples were pushed, latency over every sample.
+ */
+static void report(const char *name, const Link *link) {
+	SB_LiveStreamStats stats;
+	double seconds = link->pushPhaseNs / 1e9;
+	uint8_t i;
+
+	for (i = 0; i < MAX_LINKS; ++i) {
+		if (SB_liveStreamGetLinkStats(i, &stats) == link->connHandle) {
+			break;
+		}
+	}
+
+	printf("  %-27s %3u %5.0f B/s, latency to stack %5.0f/%5u ms, to phone %5.0f/%5.0f ms, "
+			"%4u events %5.1f%% used, %4u retries, %4u of %4u dropped\n",
+			name, link->mtu, link->pushPhaseBytes / seconds,
+			stats.samplesSent ? (double)stats.latencyTotalMs / stats.samplesSent : 0.0, stats.maxLatencyMs,
+			link->received ? link->latencyTotalNs / 1e6 / link->received : 0.0, link->maxLatencyNs / 1e6,
+			link->pushPhaseEvents, 100.0 * link->pushPhaseBusyEvents / link->pushPhaseEvents,
+			stats.sendRetries, link->missing, link->received + link->missing);
+}
+
+static void runScenario(const Scenario *scenario) {
+	uint32_t first = PUSHED.count;
+	Link *link;
+
+	STACK.pdus = scenario->pdus;
+	STACK.allocFailPercent = scenario->allocFailPercent;
+
+	link = linkConnect(0, scenario->mtu, scenario->intervalMs, scenario->lossPercent);
+
+	// Records only start once the phone is listening
+	link->haveSample = true;
+	link->nextSample = first;
+
+	runPushes(scenario->samples, scenario->periodMs);
+
+	checkLink(link, first, scenario->keepsUp, scenario);
+	report(scenario->name, link);
+
+	linkDrop(link);
+}
+
+/**
+ * Two centrals with different MTUs and intervals share the queue, and each receives every
+ * sample at its own pace.
+ */
+static void checkTwoCentrals(void) {
+	uint32_t first = PUSHED.count;
+	Link *slow, *fast;
+
+	STACK.pdus = STACK_PDUS;
+	STACK.allocFailPercent = 0;
+
+	slow = linkConnect(0, 23, 100, 0);
+	fast = linkConnect(1, 247, 30, 0);
+	slow->haveSample = fast->haveSample = true;
+	slow->nextSample = fast->nextSample = first;
+
+	runPushes(600, 20);
+
+	checkLink(slow, first, true, NULL);
+	checkLink(fast, first, true, NULL);
+
+	report("two centrals, slow", slow);
+	report("two centrals, fast", fast);
+
+	linkDrop(slow);
+	linkDrop(fast);
+}
+
+/**
+ * A time written while the peripheral manager is updating the profile is passed on as
+ * written, although readers keep seeing the old value until the update ends.
+ */
+static void checkWriteDuringUpdate(void) {
+	uint32_t before = 1000, written = SYNC_TIME, read;
+	uint32_t changes = CHANGED.count;
+	Link *link;
+
+	link = linkConnect(0, ATT_MTU_SIZE, 30, 0);
+	SB_Profile_SetParameter(SB_CHARACTERISTIC_SYSTEMTIME, sizeof(before), &before);
+
+	SB_Profile_BeginUpdate();
+	CHECK(SUCCESS == phoneWrite(link, findValueAttr(SB_BLE_SYSTEMTIME_UUID), (uint8_t *)&written, sizeof(written)),
+			"writing the time failed");
+
+	CHECK(CHANGED.count == changes + 1 && CHANGED.paramID == SB_CHARACTERISTIC_SYSTEMTIME,
+			"application not told of the new time");
+	CHECK(CHANGED.len == sizeof(written) && memcmp(CHANGED.value, &written, sizeof(written)) == 0,
+			"application not given the time as written");
+
+	SB_Profile_GetParameter(SB_CHARACTERISTIC_SYSTEMTIME, &read, sizeof(read));
+	CHECK(read == before, "time published in the middle of an update");
+	SB_Profile_EndUpdate();
+
+	SB_Profile_GetParameter(SB_CHARACTERISTIC_SYSTEMTIME, &read, sizeof(read));
+	CHECK(read == written, "time not published at the end of the update");
+
+	runFor(2 * link->intervalNs);
+	linkDrop(link);
+}
+
+/**
+ * The ATT responses and the stream share the notice. Both ask for it on different links, and
+ * each change of owner turns the old registration off before the new one is made.
+ */
+static void checkConnEventOwner(void) {
+	Link *first, *second;
+
+	first = linkConnect(0, ATT_MTU_SIZE, 30, 0);
+	second = linkConnect(1, ATT_MTU_SIZE, 30, 0);
+	CHECK(STACK.noticeHandle == INVALID_CONNHANDLE, "notice on while idle");
+
+	CHECK(SUCCESS == SB_connEventRequest(SB_CONN_EVENT_LIVESTREAM, first->connHandle), "request refused");
+	CHECK(STACK.noticeHandle == first->connHandle, "notice not on the link of the stream");
+
+	// A queued response takes the notice to its link, and gives it back once sent
+	CHECK(SUCCESS == SB_connEventRequest(SB_CONN_EVENT_ATT_RSP, second->connHandle), "request refused");
+	CHECK(STACK.noticeHandle == second->connHandle && SB_connEventHandle() == second->connHandle,
+			"notice not on the link of the queued response");
+	SB_connEventRelease(SB_CONN_EVENT_ATT_RSP);
+	CHECK(STACK.noticeHandle == first->connHandle, "notice not back on the link of the stream");
+
+	// The link of the response closes: the stream still gets its notice
+	SB_connEventRequest(SB_CONN_EVENT_ATT_RSP, second->connHandle);
+	linkDrop(second);
+	CHECK(STACK.noticeHandle == first->connHandle, "notice lost with the link of the response");
+
+	SB_connEventRelease(SB_CONN_EVENT_LIVESTREAM);
+	CHECK(STACK.noticeHandle == INVALID_CONNHANDLE && SB_connEventHandle() == INVALID_CONNHANDLE,
+			"notice left on with no user");
+
+	runFor(2 * first->intervalNs);
+	linkDrop(first);
+}
+
+/**
+ * An alert flushes the samples queued in a partial packet. With a single stack buffer, the
+ * flush is pending until the connection events have freed it for every packet.
+ */
+static void checkFlush(void) {
+	uint32_t first = PUSHED.count;
+	Link *link;
+	uint8_t i;
+
+	STACK.pdus = 1;
+	STACK.allocFailPercent = 0;
+
+	link = linkConnect(0, 247, 30, 0);
+	link->haveSample = true;
+	link->nextSample = first;
+
+	for (i = 0; i < 3; ++i) {
+		pushSample();
+	}
+	runTasks();
+	CHECK(link->count == 0, "partial packet sent before the flush");
+
+	SB_liveStreamFlush();
+	CHECK(link->count == 1 && !SB_liveStreamIsPending(), "partial packet not flushed");
+	runFor(2 * link->intervalNs);
+	CHECK(link->received == 3, "flushed samples not received");
+
+	// A record to a packet, more packets than the stack has buffers
+	link->mtu = ATT_MTU_SIZE;
+	SB_liveStreamSetMTU(link->connHandle, ATT_MTU_SIZE);
+	for (i = 0; i < 3; ++i) {
+		pushSample();
+	}
+
+	SB_liveStreamFlush();
+	CHECK(SB_liveStreamIsPending(), "flush done although the stack had no buffers");
+	runFor(6 * link->intervalNs);
+	CHECK(!SB_liveStreamIsPending() && link->received == 6, "flush not finished once buffers were freed");
+
+	linkDrop(link);
+}
+
+/**
+ * A read response carries MTU - 1 bytes of the value. The diagnostics just fit in one at an
+ * MTU of one more than their length, and take a read blob at an MTU one less.
+ */
+static void checkLongRead(void) {
+	gattAttribute_t *pAttr = findValueAttr(SB_BLE_DIAGNOSTICS_UUID);
+	uint8_t value[SB_BLE_DIAGNOSTICS_LEN];
+	uint16_t len;
+	Link *link;
+
+	link = linkConnect(0, SB_BLE_DIAGNOSTICS_LEN + 1, 30, 0);
+	CHECK(SUCCESS == phoneRead(link, pAttr, 0, value, &len) && len == SB_BLE_DIAGNOSTICS_LEN,
+			"diagnostics not read whole");
+	CHECK(ATT_ERR_ATTR_NOT_LONG == phoneRead(link, pAttr, 1, value, &len) && len == 0,
+			"read blob allowed on a value that fits in one read");
+	runFor(2 * link->intervalNs);
+	linkDrop(link);
+
+	link = linkConnect(0, SB_BLE_DIAGNOSTICS_LEN, 30, 0);
+	CHECK(SUCCESS == phoneRead(link, pAttr, 0, value, &len) && len == SB_BLE_DIAGNOSTICS_LEN - 1,
+			"first part of the diagnostics not as long as the response");
+	CHECK(SUCCESS == phoneRead(link, pAttr, len, value + len, &len) && len == 1,
+			"rest of the diagnostics not read");
+	CHECK(ATT_ERR_INVALID_OFFSET == phoneRead(link, pAttr, SB_BLE_DIAGNOSTICS_LEN + 1, value, &len),
+			"read blob allowed past the end of the value");
+	runFor(2 * link->intervalNs);
+	linkDrop(link);
+}
+
+int main(int argc, char **argv) {
+	uint8_t i;
+
+	hostSimReset();
+
+	CHECK(SUCCESS == SB_Profile_AddService(SB_BLE_SERVICE) && STACK.attrs != NULL, "service not registered");
+	CHECK(SUCCESS == SB_Profile_RegisterAppCBs(&profileCBs), "profile callbacks not registered");
+	SB_connEventInit(0, CONN_EVENT_FLAG);
+	CHECK(NoError == SB_liveStreamInit(liveStreamPendingCB), "live stream init failed");
+
+	printf("Live stream over %u byte LL frames, %u per connection event, %u record queue, "
+			"partial packets after %u ms\n", LL_PAYLOAD, FRAMES_PER_EVENT, SB_LIVESTREAM_QUEUE_LEN,
+			SB_LIVESTREAM_MAX_LATENCY_MS);
+	printf("  %-27s %3s %9s  latency mean/max, connection events and throughput while pushing\n",
+			"", "MTU", "phone");
+
+	for (i = 0; i < sizeof(scenarios) / sizeof(scenarios[0]); ++i) {
+		runScenario(&scenarios[i]);
+	}
+
+	checkTwoCentrals();
+	checkWriteDuringUpdate();
+	checkLongRead();
+	checkFlush();
+	checkConnEventOwner();
+
+	printf("PASS\n");
+
+	return 0;
+}
@@ -0,0 +1,280 @@
+/*
+ * testLogCrypt.c
+ *
+ * Host test and benchmark for the encryption of the flash logs. It links the real logCrypt.c,
+ * flashLog.c, util.c, bsp_spi.c and ext_flash.c against the W25X20CL emulator, an SNV store in
+ * memory and a software AES in ../host/. Every polled AES block spends the time given on the
+ * command line, so the benchmark shows how much of the encryption the pipeline in
+ * SB_logCryptWrite hides behind the flash for a range of costs of the crypto driver.
+ *
+ * Checked:
+ *  - The software AES against the FIPS-197 example
+ *  - The key is derived once and kept in SNV, and every load of it starts a new key epoch
+ *  - A log that recovers empty reuses its sector sequence numbers, but not its keystream
+ *  - Encrypted writes read back to their plaintext, with the CRC covering the ciphertext
+ *
+ * Build and run from this directory, or with make in the parent directory:
+ *
+ *   gcc -std=gnu99 -O2 -Wall -DTI_DRIVERS_SPI_INCLUDED -I../host \
+ *       -I../comms_module/SmartBandage/Application -I../comms_module/SmartBandage/PROFILES \
+ *       -I../comms_module/SmartBandage/Board/Interfaces testLogCrypt.c \
+ *       ../host/hostSim.c ../host/flashEmulator.c ../host/cryptoHost.c ../host/snvHost.c \
+ *       ../comms_module/SmartBandage/Board/Interfaces/bsp_spi.c \
+ *       ../comms_module/SmartBandage/Board/Devices/ext_flash.c \
+ *       ../comms_module/SmartBandage/Application/flashLog.c \
+ *       ../comms_module/SmartBandage/Application/logCrypt.c \
+ *       ../comms_module/SmartBandage/Application/util.c -o testLogCrypt
+ *   ./testLogCrypt [us per AES block ...]
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "hostSim.h"
+#include "flashEmulator.h"
+#include "cryptoHost.h"
+#include "osal_snv.h"
+#include "util.h"
+#include "flashLog.h"
+#include "logCrypt.h"
+
+// Free flash between the user region and the metadata
+#define BENCH_BASE			0x60000
+#define BENCH_LEN			(64 * 1024)
+
+// Writes of one whole sector, and writes the size of the largest log record
+#define BULK_WRITE_LEN		FLASHLOG_SECTOR_SIZE
+#define RECORD_WRITE_LEN	FLASHLOG_MAX_RECORD_LEN
+
+#define BENCH_EPOCH			7
+#define BENCH_NONCE			1
+
+#define MAX_BLOCK_TIMES		8
+
+#define CHECK(condition, message) do { \
+		if (!(condition)) { \
+			fprintf(stderr, "FAIL: %s (%s:%d)\n", message, __FILE__, __LINE__); \
+			exit(1); \
+		} \
+	} while (0)
+
+static uint8_t memory[FLASHEMU_SIZE];
+static SnvHostStore snv;
+
+static uint8_t plaintext[BENCH_LEN];
+static uint8_t buf[BENCH_LEN];
+
+static void boot(void) {
+	CHECK(NoError == SB_logCryptInit(), "crypto init failed");
+	CHECK(NoError == SB_logCryptLoadKey(), "key load failed");
+}
+
+static void checkAes(void) {
+	static const uint8_t key[16] = {
+		0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F };
+	static const uint8_t in[16] = {
+		0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88, 0x99, 0xAA, 0xBB, 0xCC, 0xDD, 0xEE, 0xFF };
+	static const uint8_t expected[16] = {
+		0x69, 0xC4, 0xE0, 0xD8, 0x6A, 0x7B, 0x04, 0x30, 0xD8, 0xCD, 0xB7, 0x80, 0x70, 0xB4, 0xC5, 0x5A };
+	uint32_t keyWords[4];
+	uint8_t out[16];
+
+	memcpy(keyWords, key, sizeof(keyWords));
+	cryptoHostEncryptBlock(keyWords, in, out);
+	CHECK(memcmp(out, expected, sizeof(out)) == 0, "software AES does not match FIPS-197");
+}
+
+/**
+ * \brief The key survives reboots and each boot has a new epoch.
+ */
+static void checkKeyAndEpoch(void) {
+	SB_LogCryptStats stats;
+	uint8_t first[32], second[32];
+
+	boot();
+	SB_logCryptGetStats(&stats);
+	CHECK(stats.keyDerived, "no key derived on the first boot");
+	CHECK(SB_logCryptGetEpoch() == 1, "first boot is not epoch 1");
+
+	memset(first, 0, sizeof(first));
+	CHECK(NoError == SB_logCryptApply(0x1234, first, sizeof(first), BENCH_EPOCH, BENCH_NONCE), "apply failed");
+
+	boot();
+	SB_logCryptGetStats(&stats);
+	CHECK(SB_logCryptGetEpoch() == 2, "epoch did not advance on reboot");
+
+	// Same key: the same epoch, nonce and address give the same keystream
+	memset(second, 0, sizeof(second));
+	CHECK(NoError == SB_logCryptApply(0x1234, second, sizeof(second), BENCH_EPOCH, BENCH_NONCE), "apply failed");
+	CHECK(memcmp(first, second, sizeof(first)) == 0, "key changed across reboots");
+
+	memset(second, 0, sizeof(second));
+	CHECK(NoError == SB_logCryptApply(0x1234, second, sizeof(second), BENCH_EPOCH + 1, BENCH_NONCE), "apply failed");
+	CHECK(memcmp(first, second, sizeof(first)) != 0, "epoch does not change the keystream");
+}
+
+/**
+ * \brief A log found empty after a reboot opens sector 1 again. The ciphertext of the same
+ * 			record at the same address must still differ.
+ */
+static void checkEmptyRecovery(void) {
+	SB_FlashLogSectorHeader header;
+	SB_FlashLogCursor cursor;
+	SB_FlashLog log;
+	uint8_t record[RECORD_WRITE_LEN], first[RECORD_WRITE_LEN], second[RECORD_WRITE_LEN];
+	uint32_t base = FLASHLOG_HOURS_BASE;
+	uint32_t payload = base + sizeof(SB_FlashLogSectorHeader) + sizeof(SB_FlashLogRecordHeader);
+	uint8_t length;
+	uint8_t i;
+
+	for (i = 0; i < sizeof(record); ++i) {
+		record[i] = i;
+	}
+
+	CHECK(NoError == SB_flashLogInit(&log, base, FLASHLOG_HOURS_NUM_SECTORS, true), "log init failed");
+	CHECK(NoError == SB_flashLogAppend(&log, record, sizeof(record)), "append failed");
+	memcpy(first, &memory[payload], sizeof(first));
+	CHECK(memcmp(first, record, sizeof(record)) != 0, "record stored in the clear");
+
+	// Lose the whole log and reboot
+	CHECK(extFlashErase(base, FLASHLOG_HOURS_NUM_SECTORS * FLASHLOG_SECTOR_SIZE), "erase failed");
+	boot();
+
+	CHECK(NoError == SB_flashLogInit(&log, base, FLASHLOG_HOURS_NUM_SECTORS, true), "log init failed");
+	CHECK(log.empty, "log did not recover empty");
+	CHECK(NoError == SB_flashLogAppend(&log, record, sizeof(record)), "append failed");
+	memcpy(second, &memory[payload], sizeof(second));
+
+	memcpy(&header, &memory[base], sizeof(header));
+	CHECK(header.sectorSeq == 1, "expected the sector sequence to start over");
+	CHECK(header.keyEpoch == SB_logCryptGetEpoch(), "sector header does not carry the key epoch");
+	CHECK(memcmp(first, second, sizeof(first)) != 0, "keystream reused after the log recovered empty");
+
+	// And it still reads back
+	CHECK(NoError == SB_flashLogSeek(&log, &cursor, 0), "seek failed");
+	CHECK(NoError == SB_flashLogRead(&log, &cursor, first, sizeof(first), &length), "read failed");
+	CHECK(length == sizeof(record) && memcmp(first, record, length) == 0, "record did not decrypt");
+}
+
+static void erase(void) {
+	CHECK(extFlashErase(BENCH_BASE, BENCH_LEN), "erase failed");
+}
+
+static void checkReadBack(void) {
+	uint32_t offset;
+
+	CHECK(extFlashRead(BENCH_BASE, BENCH_LEN, buf), "read failed");
+
+	for (offset = 0; offset < BENCH_LEN; offset += BULK_WRITE_LEN) {
+		CHECK(NoError == SB_logCryptApply(BENCH_BASE + offset, buf + offset, BULK_WRITE_LEN, BENCH_EPOCH, BENCH_NONCE),
+				"decrypt failed");
+	}
+	CHECK(memcmp(buf, plaintext, BENCH_LEN) == 0, "encrypted write did not read back");
+}
+
+static double kbps(uint64_t ns) {
+	return BENCH_LEN / 1024.0 / (ns / 1e9);
+}
+
+/**
+ * \brief Writes BENCH_LEN bytes through SB_logCryptWrite in writes of the given length, until
+ * 			the last page has programmed, and checks that the CRC of each covers the ciphertext.
+ */
+static uint64_t timeWrites(uint16_t writeLen) {
+	static uint16_t crcs[BENCH_LEN / RECORD_WRITE_LEN + 1];
+	uint64_t start, elapsed;
+	uint32_t offset;
+	uint16_t length, n;
+
+	erase();
+
+	start = hostSimNow();
+	for (offset = 0, n = 0; offset < BENCH_LEN; offset += writeLen, ++n) {
+		length = (BENCH_LEN - offset < writeLen) ? BENCH_LEN - offset : writeLen;
+		crcs[n] = 0xFFFF;
+		CHECK(NoError == SB_logCryptWrite(BENCH_BASE + offset, plaintext + offset, length, BENCH_EPOCH, BENCH_NONCE, &crcs[n]),
+				"encrypted write failed");
+	}
+
+	// A read waits for the last program to finish
+	CHECK(extFlashRead(BENCH_BASE, 1, buf), "read failed");
+	elapsed = hostSimNow() - start;
+
+	CHECK(extFlashRead(BENCH_BASE, BENCH_LEN, buf), "read failed");
+	for (offset = 0, n = 0; offset < BENCH_LEN; offset += writeLen, ++n) {
+		length = (BENCH_LEN - offset < writeLen) ? BENCH_LEN - offset : writeLen;
+		CHECK(crcs[n] == Util_crc16(0xFFFF, buf + offset, length), "CRC does not cover the ciphertext");
+	}
+
+	return elapsed;
+}
+
+/**
+ * \brief Compares the pipelined write with the flash alone, which is the same write path with
+ * 			free encryption, and with encrypting before writing, which adds the encryption time.
+ */
+static void benchWrites(uint16_t writeLen, const char *name, uint64_t blockNs) {
+	SB_LogCryptStats before, after;
+	uint64_t flashNs, pipelinedNs, encryptNs;
+
+	cryptoHostSetBlockTime(0);
+	flashNs = timeWrites(writeLen);
+
+	cryptoHostSetBlockTime(blockNs);
+	SB_logCryptGetStats(&before);
+	pipelinedNs = timeWrites(writeLen);
+	SB_logCryptGetStats(&after);
+	checkReadBack();
+
+	encryptNs = (uint64_t)(after.encryptTicks - before.encryptTicks) * HOSTSIM_NS_PER_TICK;
+
+	printf("    %-14s flash alone %6.1f KB/s  encrypt then write %6.1f KB/s  pipelined %6.1f KB/s  "
+			"%3.0f%% of %5.1f ms encryption hidden\n",
+			name, kbps(flashNs), kbps(flashNs + encryptNs), kbps(pipelinedNs),
+			100.0 * (1.0 - ((double)pipelinedNs - flashNs) / encryptNs), encryptNs / 1e6);
+}
+
+int main(int argc, char **argv) {
+	uint32_t blockTimes[MAX_BLOCK_TIMES] = { 10, 25, 40, 60, 100 };
+	uint8_t numBlockTimes = 5, i;
+	uint32_t seed = 1, offset;
+
+	if (argc > 1) {
+		for (numBlockTimes = 0; numBlockTimes < MAX_BLOCK_TIMES && numBlockTimes + 1 < argc; ++numBlockTimes) {
+			blockTimes[numBlockTimes] = strtoul(argv[numBlockTimes + 1], NULL, 0);
+		}
+	}
+
+	hostSimReset();
+	memset(memory, 0xFF, sizeof(memory));
+	flashEmuInit(memory);
+	memset(&snv, 0, sizeof(snv));
+	snvHostInit(&snv);
+
+	for (offset = 0; offset < BENCH_LEN; ++offset) {
+		seed = seed * 1103515245 + 12345;
+		plaintext[offset] = seed >> 16;
+	}
+
+	checkAes();
+	checkKeyAndEpoch();
+	checkEmptyRecovery();
+
+	printf("Encrypted writes of %u KB, program page %u us, %u MHz SPI\n", BENCH_LEN / 1024,
+			FLASHEMU_PROGRAM_NS / 1000, 4);
+
+	for (i = 0; i < numBlockTimes; ++i) {
+		printf("  %u us per AES block (%u us per program page):\n", blockTimes[i],
+				blockTimes[i] * (EXT_FLASH_PROGRAM_PAGE_SIZE / SB_LOGCRYPT_BLOCK_LEN));
+
+		benchWrites(BULK_WRITE_LEN, "sector writes", (uint64_t)blockTimes[i] * 1000);
+		benchWrites(RECORD_WRITE_LEN, "record writes", (uint64_t)blockTimes[i] * 1000);
+	}
+
+	printf("PASS\n");
+
+	return 0;
+}